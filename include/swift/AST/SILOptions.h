@@ -105,6 +105,10 @@ public:
 
   /// The name of the SIL outputfile if compiled with SIL debugging (-gsil).
   std::string SILOutputFileNameForDebugging;
+
+  /// If non-empty, profile every SIL pass and write the report as JSON to
+  /// this file.
+  std::string PassProfileFilename;
 };
 
 } // end namespace swift
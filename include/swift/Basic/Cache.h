@@ -55,6 +55,24 @@ struct CacheValueInfo : public CacheValueCostInfo<T>,
                         public CacheTypeMgmtInfo<T> {
 };
 
+/// Counters describing the use of a cache.
+struct CacheStats {
+  /// The number of lookups which found a value.
+  uint64_t Hits = 0;
+  /// The number of lookups which didn't find a value.
+  uint64_t Misses = 0;
+  /// The number of values removed by the cache itself to stay within its
+  /// cost limit.
+  uint64_t Evictions = 0;
+  /// The number of values in the cache.
+  size_t Count = 0;
+  /// The sum of the costs of the values in the cache.
+  size_t TotalCost = 0;
+  /// The total cost above which the cache evicts values, or 0 if eviction
+  /// is left to the system.
+  size_t CostLimit = 0;
+};
+
 /// The underlying implementation of the caching mechanism.
 /// It should be inherently thread-safe.
 class CacheImpl {
@@ -131,6 +149,17 @@ protected:
 
   /// Destroys cache.
   void destroy();
+
+  /// Sets the total cost of the values the cache keeps before it starts
+  /// evicting values that are not retained, least recently used first.
+  ///
+  /// Has no effect on hosts where the system evicts values under memory
+  /// pressure instead.
+  void setCostLimit(size_t Limit);
+
+  /// Returns counters describing the use of the cache. On hosts where the
+  /// system manages the cache, only what the system reports is filled in.
+  CacheStats getStats() const;
 };
 
 /// Caching mechanism, that is thread-safe and can evict its entries when there
@@ -192,6 +221,16 @@ public:
     removeAll();
   }
 
+  /// Limits the total cost of the values in the cache, as computed by
+  /// \c ValueInfoT::getCost(). See \c CacheImpl::setCostLimit().
+  void setCostLimit(size_t Limit) {
+    CacheImpl::setCostLimit(Limit);
+  }
+
+  CacheStats getStats() const {
+    return CacheImpl::getStats();
+  }
+
 private:
   static uintptr_t keyHash(void *Key, void *UserData) {
     return KeyInfoT::getHashValue(*static_cast<KeyT*>(Key));
@@ -18,6 +18,7 @@
 #include <vector>
 #include <cassert>
 #include <cstdint>
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "swift/Basic/Malloc.h"
 
@@ -151,20 +152,20 @@ private:
   PayloadKind NodePayloadKind;
 
   union {
-    std::string TextPayload;
+    llvm::StringRef TextPayload;
     IndexType IndexPayload;
   };
 
-  // FIXME: use allocator.
-  typedef std::vector<NodePointer> NodeVector;
+  // Most nodes have at most two children, which are then stored inline.
+  typedef llvm::SmallVector<NodePointer, 2> NodeVector;
   NodeVector Children;
 
   Node(Kind k)
       : NodeKind(k), NodePayloadKind(PayloadKind::None) {
   }
-  Node(Kind k, std::string &&t)
+  Node(Kind k, llvm::StringRef t)
       : NodeKind(k), NodePayloadKind(PayloadKind::Text) {
-    new (&TextPayload) std::string(std::move(t));
+    new (&TextPayload) llvm::StringRef(t);
   }
   Node(Kind k, IndexType index)
       : NodeKind(k), NodePayloadKind(PayloadKind::Index) {
@@ -174,14 +175,18 @@ private:
   Node &operator=(const Node &) = delete;
 
   friend struct NodeFactory;
+  friend class Demangler;
 
 public:
-  ~Node();
+  ~Node() {}
 
   Kind getKind() const { return NodeKind; }
 
   bool hasText() const { return NodePayloadKind == PayloadKind::Text; }
-  const std::string &getText() const {
+
+  /// Returns the text of this node. It is owned by the node, or, for nodes
+  /// created by a Demangler, by the node's arena or the mangled name.
+  llvm::StringRef getText() const {
     assert(hasText());
     return TextPayload;
   }
@@ -348,6 +353,8 @@ std::string mangleNode(const NodePointer &root);
 std::string nodeToString(NodePointer Root,
                          const DemangleOptions &Options = DemangleOptions());
 
+/// Creates nodes on the heap. They are freed when the last reference to them
+/// goes away.
 struct NodeFactory {
   static NodePointer create(Node::Kind K) {
     return NodePointer(new Node(K));
@@ -355,16 +362,80 @@ struct NodeFactory {
   static NodePointer create(Node::Kind K, Node::IndexType Index) {
     return NodePointer(new Node(K, Index));
   }
-  static NodePointer create(Node::Kind K, llvm::StringRef Text) {
-    return NodePointer(new Node(K, Text));
-  }
-  static NodePointer create(Node::Kind K, std::string &&Text) {
-    return NodePointer(new Node(K, std::move(Text)));
-  }
-  template <size_t N>
-  static NodePointer create(Node::Kind K, const char (&Text)[N]) {
-    return NodePointer(new Node(K, llvm::StringRef(Text)));
-  }
+  /// Creates a node with a copy of \p Text.
+  static NodePointer create(Node::Kind K, llvm::StringRef Text);
+};
+
+/// Demangles symbols into node trees that are allocated from an arena
+/// rather than node by node on the heap.
+///
+/// Every node keeps the arena it was allocated from alive, so a tree stays
+/// valid as long as a NodePointer into it exists, even across reset() or
+/// the destruction of the Demangler. Text payloads refer directly into the
+/// mangled name wherever possible, though, so the mangled name must outlive
+/// the tree.
+///
+/// Reusing one Demangler for many symbols, resetting it in between, lets
+/// each symbol be demangled without touching malloc, as long as no node of
+/// the previous symbol is still referenced when reset() is called.
+///
+/// Typical usage:
+/// \code
+///   Demangler Dem;
+///   for (StringRef Name : Names) {
+///     Dem.reset();
+///     if (NodePointer Root = Dem.demangleSymbol(Name))
+///       ...
+///   }
+/// \endcode
+class Demangler {
+  class Arena;
+
+  /// The arena new nodes are allocated from, or null if there is none yet.
+  /// The Demangler holds one reference to it.
+  Arena *CurArena = nullptr;
+
+  /// The mangled name being demangled.
+  llvm::StringRef Mangled;
+
+  template <typename T> class ArenaAllocator;
+  struct NodeDeleter;
+
+  void *allocate(size_t Size, size_t Alignment);
+  NodePointer makeNode(Node *N);
+
+public:
+  Demangler() {}
+  ~Demangler();
+
+  Demangler(const Demangler &) = delete;
+  Demangler &operator=(const Demangler &) = delete;
+
+  /// Demangle \p MangledName as a Swift symbol.
+  ///
+  /// \returns the root of the tree, or null on failure.
+  NodePointer demangleSymbol(llvm::StringRef MangledName,
+                             const DemangleOptions &Options =
+                               DemangleOptions());
+
+  /// Demangle \p MangledName as a Swift type.
+  ///
+  /// \returns the root of the tree, or null on failure.
+  NodePointer demangleType(llvm::StringRef MangledName,
+                           const DemangleOptions &Options =
+                             DemangleOptions());
+
+  /// Start over for the next symbol. The arena's memory is reused if no
+  /// node allocated from it is still referenced; otherwise those nodes keep
+  /// it alive, and a new arena is started.
+  void reset();
+
+  NodePointer createNode(Node::Kind K);
+  NodePointer createNode(Node::Kind K, Node::IndexType Index);
+
+  /// Creates a node with text \p Text, which is copied into the arena
+  /// unless it is part of the mangled name being demangled.
+  NodePointer createNode(Node::Kind K, llvm::StringRef Text);
 };
 
   /// A class for printing to a std::string.
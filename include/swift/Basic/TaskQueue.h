@@ -15,6 +15,7 @@
 
 #include "swift/Basic/LLVM.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/Config/config.h"
 #include "llvm/Support/Program.h"
 
@@ -38,6 +39,19 @@ enum class TaskFinishedResponse {
   StopExecution,
 };
 
+/// \brief Resources consumed by a task, as reported by the operating system
+/// when the task was reaped.
+struct TaskResourceUsage {
+  /// Wall-clock time between spawning the task and reaping it.
+  uint64_t WallTimeMicroseconds = 0;
+  /// CPU time spent in user mode.
+  uint64_t UserTimeMicroseconds = 0;
+  /// CPU time spent in the kernel on behalf of the task.
+  uint64_t SystemTimeMicroseconds = 0;
+  /// Peak resident set size.
+  uint64_t MaxResidentSetBytes = 0;
+};
+
 /// \brief A class encapsulating the execution of multiple tasks in parallel.
 class TaskQueue {
   /// Tasks which have not begun execution.
@@ -46,6 +60,10 @@ class TaskQueue {
   /// The number of tasks to execute in parallel.
   unsigned NumberOfParallelTasks;
 
+  /// The maximum address space, in bytes, that each task may use, or 0 for
+  /// no limit.
+  uint64_t MemoryLimitPerTask = 0;
+
 public:
   /// \brief Create a new TaskQueue instance.
   ///
@@ -73,11 +91,14 @@ public:
   /// \param Output the output from the task which finished execution,
   /// if available. (This may not be available on all platforms.)
   /// \param Context the context which was passed when the task was added
+  /// \param Usage the resources consumed by the task, if available. (This may
+  /// not be available on all platforms.)
   ///
   /// \returns true if further execution of tasks should stop,
   /// false if execution should continue
   typedef std::function<TaskFinishedResponse(ProcessId Pid, int ReturnCode,
-                                             StringRef Output, void *Context)>
+                                             StringRef Output, void *Context,
+                                             Optional<TaskResourceUsage> Usage)>
     TaskFinishedCallback;
 
   /// \brief A callback which will be executed if a task exited abnormally due
@@ -89,11 +110,14 @@ public:
   /// \param Output the output from the task which exited abnormally, if
   /// available. (This may not be available on all platforms.)
   /// \param Context the context which was passed when the task was added
+  /// \param Usage the resources consumed by the task, if available. (This may
+  /// not be available on all platforms.)
   ///
   /// \returns a TaskFinishedResponse indicating whether or not execution
   /// should proceed
   typedef std::function<TaskFinishedResponse(ProcessId Pid, StringRef ErrorMsg,
-                                             StringRef Output, void *Context)>
+                                             StringRef Output, void *Context,
+                                             Optional<TaskResourceUsage> Usage)>
     TaskSignalledCallback;
 #pragma clang diagnostic pop
 
@@ -113,6 +137,14 @@ public:
   /// parallel
   unsigned getNumberOfParallelTasks() const;
 
+  /// \brief Limits the address space of each task to \p Bytes. Tasks which
+  /// exceed the limit fail to allocate memory rather than pushing the system
+  /// into swap. A value of 0 removes the limit.
+  void setMemoryLimitPerTask(uint64_t Bytes) { MemoryLimitPerTask = Bytes; }
+
+  /// \returns the address space limit for each task, or 0 if there is none.
+  uint64_t getMemoryLimitPerTask() const { return MemoryLimitPerTask; }
+
   /// \brief Adds a task to the TaskQueue.
   ///
   /// \param ExecPath the path to the executable which the task should execute
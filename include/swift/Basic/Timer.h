@@ -14,12 +14,16 @@
 #define SWIFT_BASIC_TIMER_H
 
 #include "swift/Basic/LLVM.h"
+#include "swift/Basic/TraceEvents.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/Support/Timer.h"
 
 namespace swift {
   /// A convenience class for declaring a timer that's part of the Swift
   /// compilation timers group.
+  ///
+  /// The timed region is also recorded as a "phase" interval when tracing
+  /// is enabled.
   class SharedTimer {
     enum class State {
       Initial,
@@ -29,9 +33,10 @@ namespace swift {
     static State CompilationTimersEnabled;
 
     Optional<llvm::NamedRegionTimer> Timer;
+    TraceScope Trace;
 
   public:
-    explicit SharedTimer(StringRef name) {
+    explicit SharedTimer(StringRef name) : Trace("phase", name) {
       if (CompilationTimersEnabled == State::Enabled)
         Timer.emplace(name, StringRef("Swift compilation"));
       else
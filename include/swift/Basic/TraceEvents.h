@@ -0,0 +1,116 @@
+//===--- TraceEvents.h - Compilation trace events ---------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Records nested intervals of a compilation (parsing, type checking of
+// individual declarations and expressions, SILGen, SIL passes, IRGen...) and
+// writes them out in the Chrome trace-event JSON format, which can be loaded
+// into chrome://tracing and similar viewers.
+//
+// Recording is off unless TraceScope::enableTracing() is called, which the
+// frontend does for -trace-events-output. A disabled TraceScope costs a
+// single branch.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_BASIC_TRACEEVENTS_H
+#define SWIFT_BASIC_TRACEEVENTS_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Compiler.h"
+#include <string>
+
+namespace llvm {
+  class raw_ostream;
+}
+
+namespace swift {
+
+/// An interval in the trace of the current process.
+///
+/// The interval starts when the scope is constructed and ends when it is
+/// destroyed; scopes that are alive at the same time on one thread nest.
+class TraceScope {
+  static bool TracingEnabled;
+
+  /// The index of this scope's event, or ~0U if tracing is disabled.
+  unsigned Index = ~0U;
+
+  void begin(const char *category, StringRef name);
+  void begin(const char *category,
+             llvm::function_ref<void(llvm::raw_ostream &)> printName);
+  void end();
+
+public:
+  /// Starts an interval named \p name.
+  ///
+  /// \p category must be a string literal; it is used to group events in
+  /// trace viewers.
+  TraceScope(const char *category, StringRef name) {
+    if (LLVM_UNLIKELY(TracingEnabled))
+      begin(category, name);
+  }
+
+  // Avoids an ambiguity between the StringRef and function_ref overloads
+  // for string literals.
+  TraceScope(const char *category, const char *name)
+    : TraceScope(category, StringRef(name)) {}
+
+  /// Starts an interval whose name is printed by \p printName, which is
+  /// only called if tracing is enabled.
+  TraceScope(const char *category,
+             llvm::function_ref<void(llvm::raw_ostream &)> printName) {
+    if (LLVM_UNLIKELY(TracingEnabled))
+      begin(category, printName);
+  }
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+  ~TraceScope() {
+    if (LLVM_UNLIKELY(Index != ~0U))
+      end();
+  }
+
+  /// Whether this scope is being recorded.
+  bool isRecording() const { return Index != ~0U; }
+
+  /// Attaches a numeric argument to this interval. \p name must be a string
+  /// literal.
+  void addArg(const char *name, uint64_t value);
+
+  /// Starts recording. Scopes that were already alive are not recorded.
+  static void enableTracing() { TracingEnabled = true; }
+
+  static bool isTracingEnabled() { return TracingEnabled; }
+
+  /// Writes all recorded events to \p path as a trace-event JSON object.
+  ///
+  /// Intervals that have not ended yet are closed at the current time.
+  /// \p processName labels this process's events in trace viewers.
+  ///
+  /// \returns true on error.
+  static bool writeTrace(StringRef path, StringRef processName);
+};
+
+/// Merges the trace-event files written by TraceScope::writeTrace() at
+/// \p inputs into a single file at \p output. Inputs that do not exist are
+/// skipped.
+///
+/// \returns true on error.
+bool mergeTraceEventFiles(ArrayRef<std::string> inputs, StringRef output);
+
+} // end namespace swift
+
+#endif // SWIFT_BASIC_TRACEEVENTS_H
@@ -92,6 +92,11 @@ private:
   /// This is used for incremental builds.
   std::string CompilationRecordPath;
 
+  /// Merge the trace events written by the individual jobs into this file.
+  ///
+  /// \sa swift::TraceScope
+  std::string TraceEventsOutputPath;
+
   /// A hash representing all the arguments that could trigger a full rebuild.
   std::string ArgsHash;
 
@@ -110,6 +115,9 @@ private:
   /// parallel.
   unsigned NumberOfParallelCommands;
 
+  /// The maximum address space, in bytes, of each job, or 0 for no limit.
+  uint64_t JobMemoryLimit = 0;
+
   /// Indicates whether this Compilation should use skip execution of
   /// subtasks during performJobs() by using a dummy TaskQueue.
   ///
@@ -132,6 +140,10 @@ private:
   /// rebuilt.
   bool ShowIncrementalBuildDecisions = false;
 
+  /// When true, compile jobs that are ready to run at the same time are
+  /// grouped into batches, each run by a single frontend process.
+  bool BatchModeEnabled = false;
+
   static const Job *unwrap(const std::unique_ptr<const Job> &p) {
     return p.get();
   }
@@ -178,6 +190,13 @@ public:
     EnableIncrementalBuild = false;
   }
   
+  bool getBatchModeEnabled() const {
+    return BatchModeEnabled;
+  }
+  void setBatchModeEnabled(bool Value = true) {
+    BatchModeEnabled = Value;
+  }
+
   bool getContinueBuildingAfterErrors() const {
     return ContinueBuildingAfterErrors;
   }
@@ -185,6 +204,13 @@ public:
     ContinueBuildingAfterErrors = Value;
   }
 
+  uint64_t getJobMemoryLimit() const {
+    return JobMemoryLimit;
+  }
+  void setJobMemoryLimit(uint64_t Bytes) {
+    JobMemoryLimit = Bytes;
+  }
+
   void setShowsIncrementalBuildDecisions(bool value = true) {
     ShowIncrementalBuildDecisions = value;
   }
@@ -194,6 +220,10 @@ public:
     CompilationRecordPath = path;
   }
 
+  void setTraceEventsOutputPath(StringRef path) {
+    TraceEventsOutputPath = path;
+  }
+
   void setLastBuildTime(llvm::sys::TimeValue time) {
     LastBuildTime = time;
   }
@@ -24,6 +24,7 @@
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/PointerLikeTypeTraits.h"
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -44,6 +45,12 @@ public:
   /// It is only used in the implementation.
   enum class DependencyKind : uint8_t;
 
+  /// The parsed contents of a single dependency file.
+  ///
+  /// Clients of DependencyGraph should have no reason to use this type.
+  /// It is only used in the implementation.
+  struct FileSummary;
+
   /// Describes the result of loading a dependency file for a particular node.
   enum class LoadResult {
     /// There was an error loading the file; the entire graph should be
@@ -77,6 +84,7 @@ public:
 
 private:
   enum class DependencyFlags : uint8_t;
+  class SummaryCache;
   using DependencyMaskTy = OptionSet<DependencyKind>;
   using DependencyFlagsTy = OptionSet<DependencyFlags>;
 
@@ -129,7 +137,14 @@ private:
   /// \sa SourceFile::getInterfaceHash
   llvm::DenseMap<const void *, std::string> InterfaceHashes;
 
+  /// The parsed contents of every dependency file loaded by path, keyed by
+  /// path and tagged with the file's size and modification time.
+  ///
+  /// \sa loadSummaryCache
+  std::unique_ptr<SummaryCache> Summaries;
+
   LoadResult loadFromBuffer(const void *node, llvm::MemoryBuffer &buffer);
+  LoadResult loadFromSummary(const void *node, const FileSummary &summary);
 
   // FIXME: We should be able to use llvm::mapped_iterator for this, but
   // StringMapConstIterator isn't quite an InputIterator (no ->).
@@ -159,6 +174,9 @@ private:
   };
 
 protected:
+  DependencyGraphImpl();
+  ~DependencyGraphImpl();
+
   LoadResult loadFromString(const void *node, StringRef data);
   LoadResult loadFromPath(const void *node, StringRef path);
 
@@ -183,6 +201,25 @@ protected:
   }
 
 public:
+  /// Reads a summary of previously-loaded dependency files written by
+  /// writeSummaryCache.
+  ///
+  /// Later calls to loadFromPath for a file whose size and modification time
+  /// match the summary use the saved contents instead of parsing the file
+  /// again. The summary is memory-mapped and must not be modified while the
+  /// graph is alive; writeSummaryCache replaces it rather than rewriting it
+  /// in place.
+  ///
+  /// \returns true if the summary was read, false if it was missing or
+  /// invalid. A missing summary is not an error; every file will be parsed.
+  bool loadSummaryCache(StringRef path);
+
+  /// Writes a summary of every dependency file loaded by path, for use by
+  /// loadSummaryCache in a later build.
+  ///
+  /// \returns true on success.
+  bool writeSummaryCache(StringRef path) const;
+
   llvm::iterator_range<StringSetIterator> getExternalDependencies() const {
     return llvm::make_range(StringSetIterator(ExternalDependencies.begin()),
                             StringSetIterator(ExternalDependencies.end()));
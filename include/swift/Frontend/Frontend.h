@@ -64,6 +64,8 @@ class CompilerInvocation {
 
   CodeCompletionCallbacksFactory *CodeCompletionFactory = nullptr;
 
+  DelayedParsingCallbacks *DelayedParseCB = nullptr;
+
 public:
   CompilerInvocation();
 
@@ -280,6 +282,17 @@ public:
   bool isDelayedFunctionBodyParsing() const {
     return FrontendOpts.DelayedFunctionBodyParsing;
   }
+
+  /// Sets the callbacks that decide which function bodies the parser delays
+  /// or skips. They are not owned by the invocation, and code completion
+  /// uses its own.
+  void setDelayedParsingCallbacks(DelayedParsingCallbacks *CB) {
+    DelayedParseCB = CB;
+  }
+
+  DelayedParsingCallbacks *getDelayedParsingCallbacks() const {
+    return DelayedParseCB;
+  }
 };
 
 class CompilerInstance {
@@ -292,6 +305,14 @@ class CompilerInstance {
   DependencyTracker *DepTracker = nullptr;
   ReferencedNameTracker *NameTracker = nullptr;
 
+  /// In a batch compile, records the dependencies of the invocation's own
+  /// primary file; see addAdditionalPrimaryInput().
+  DependencyTracker *PrimaryDepTracker = nullptr;
+
+  /// The number of DepTracker's dependencies that have been handed out to
+  /// the trackers of the primary files of a batch.
+  unsigned NumDistributedDependencies = 0;
+
   Module *MainModule = nullptr;
   SerializedModuleLoader *SML = nullptr;
 
@@ -313,10 +334,29 @@ class CompilerInstance {
 
   SourceFile *PrimarySourceFile = nullptr;
 
+  /// A primary file of a batch compile besides the invocation's own primary
+  /// input.
+  struct AdditionalPrimaryInput {
+    /// The index of the input in the invocation's input filenames.
+    unsigned InputIndex;
+    ReferencedNameTracker *NameTracker;
+    DependencyTracker *DepTracker;
+    unsigned BufferID = NO_SUCH_BUFFER;
+    SourceFile *File = nullptr;
+  };
+
+  SmallVector<AdditionalPrimaryInput, 4> AdditionalPrimaryInputs;
+
   void createSILModule(bool WholeModule = false);
   void setPrimarySourceFile(SourceFile *SF);
+  void noteAdditionalPrimarySourceFile(SourceFile *SF, unsigned BufferID);
+  bool isPrimaryBuffer(unsigned BufferID) const;
+  bool isPrimarySourceFile(const SourceFile *SF) const;
+  void distributeDependencies(const SourceFile *SF);
 
 public:
+  CompilerInvocation &getInvocation() { return Invocation; }
+
   SourceManager &getSourceMgr() { return SourceMgr; }
 
   DiagnosticEngine &getDiags() { return Diagnostics; }
@@ -386,6 +426,41 @@ public:
   /// \returns the primary SourceFile, or nullptr if there is no primary input
   SourceFile *getPrimarySourceFile() { return PrimarySourceFile; }
 
+  /// Makes the input filename at \p InputIndex another primary file, so that
+  /// one frontend invocation can compile a batch of primary files while
+  /// importing modules only once. performSema() type-checks all primary
+  /// files; \p Tracker, if non-null, records the names referenced by this
+  /// one.
+  ///
+  /// If \p DepTracker is non-null, it receives the dependencies this
+  /// primary file would have had if it had been compiled on its own: those
+  /// picked up while importing modules for the whole module, and those
+  /// picked up while type-checking this file. The tracker passed to
+  /// setDependencyTracker() still receives the dependencies of the batch.
+  ///
+  /// Must be called before setup().
+  void addAdditionalPrimaryInput(unsigned InputIndex,
+                                 ReferencedNameTracker *Tracker,
+                                 DependencyTracker *DepTracker = nullptr) {
+    assert(!Context && "must be called before setup()");
+    AdditionalPrimaryInputs.push_back({InputIndex, Tracker, DepTracker});
+  }
+
+  /// Like the \p DepTracker of addAdditionalPrimaryInput(), but for the
+  /// invocation's own primary input.
+  ///
+  /// Must be called before setup().
+  void setPrimaryDependencyTracker(DependencyTracker *DT) {
+    assert(!Context && "must be called before setup()");
+    PrimaryDepTracker = DT;
+  }
+
+  /// Gets the SourceFile for the \p Index'th call to
+  /// addAdditionalPrimaryInput(), or nullptr if it was not loaded.
+  SourceFile *getAdditionalPrimarySourceFile(unsigned Index) {
+    return AdditionalPrimaryInputs[Index].File;
+  }
+
   /// \brief Returns true if there was an error during setup.
   bool setup(const CompilerInvocation &Invocation);
 
@@ -122,6 +122,18 @@ public:
   /// should only be used for debugging and experimental features.
   std::vector<std::string> LLVMArgs;
 
+  /// If non-empty, the path to a file listing the arguments of several
+  /// frontend jobs, which are run one after the other in a single
+  /// CompilerInstance; all other arguments are ignored.
+  ///
+  /// The driver writes this file in batch mode.
+  std::string BatchJobsFilePath;
+
+  /// If non-empty, the path to which a job of a batch jobs file writes the
+  /// diagnostics that belong to it, so that the driver can report them as
+  /// that job's output.
+  std::string BatchDiagnosticsOutputPath;
+
   /// The path to output swift interface files for the compiled source files.
   std::string DumpAPIPath;
 
@@ -169,12 +181,22 @@ public:
   /// If set, dumps wall time taken to check each function body to llvm::errs().
   bool DebugTimeFunctionBodies = false;
 
+  /// If set, dumps wall time and memory taken to load each serialized module
+  /// to llvm::errs().
+  bool DebugTimeModuleLoading = false;
+
   /// If set, prints the time taken in each major compilation phase to 
   /// llvm::errs().
   ///
   /// \sa swift::SharedTimer
   bool DebugTimeCompilation = false;
 
+  /// If non-empty, a timeline of the compilation is written to this path
+  /// in the Chrome trace-event format.
+  ///
+  /// \sa swift::TraceScope
+  std::string TraceEventsOutputPath;
+
   /// Indicates whether function body parsing should be delayed
   /// until the end of all files.
   bool DelayedFunctionBodyParsing = false;
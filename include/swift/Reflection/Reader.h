@@ -21,9 +21,14 @@
 #include "swift/SwiftReflection/MemoryReaderInterface.h"
 
 #include <dlfcn.h>
+#include <algorithm>
+#include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <list>
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace swift {
@@ -150,6 +155,235 @@ public:
   }
 };
 
+/// A MemoryReader that reads from another reader a page at a time and keeps
+/// the pages it has read, so that the many small reads of metadata headers,
+/// descriptors and field records that land on the same pages cost a single
+/// request to the underlying reader, such as a pipe to another process.
+///
+/// Consecutive missing pages are fetched with one read. If a page-aligned
+/// read fails, for example because the range runs into unmapped memory, the
+/// request is forwarded to the underlying reader as is.
+///
+/// The cached pages are a snapshot of the target; call invalidate() once it
+/// may have changed.
+class CachingMemoryReader final : public MemoryReader {
+public:
+  struct Statistics {
+    /// Calls to readBytes() and readString().
+    uint64_t NumReads = 0;
+    /// Requests made to the underlying reader.
+    uint64_t NumUnderlyingReads = 0;
+    /// Bytes requested from the underlying reader.
+    uint64_t NumUnderlyingBytes = 0;
+    uint64_t NumPageHits = 0;
+    uint64_t NumPageMisses = 0;
+  };
+
+private:
+  struct Page {
+    std::unique_ptr<uint8_t[]> Bytes;
+    std::list<addr_t>::iterator LRUPosition;
+  };
+
+  MemoryReader &Underlying;
+  const uint64_t PageSize;
+  const size_t MaxPages;
+  const unsigned PrefetchPages;
+
+  std::unordered_map<addr_t, Page> Pages;
+  /// Page addresses, most recently used first.
+  std::list<addr_t> LRU;
+  Statistics Stats;
+
+  addr_t getPageAddress(addr_t Address) const {
+    return Address & ~(PageSize - 1);
+  }
+
+  /// Returns the cached page at \p PageAddress, or null.
+  const uint8_t *lookupPage(addr_t PageAddress) {
+    auto Found = Pages.find(PageAddress);
+    if (Found == Pages.end())
+      return nullptr;
+    LRU.splice(LRU.begin(), LRU, Found->second.LRUPosition);
+    return Found->second.Bytes.get();
+  }
+
+  bool isCached(addr_t PageAddress) const {
+    return Pages.count(PageAddress) != 0;
+  }
+
+  bool readUnderlying(addr_t Address, uint8_t *Dest, uint64_t Size) {
+    ++Stats.NumUnderlyingReads;
+    Stats.NumUnderlyingBytes += Size;
+    return Underlying.readBytes(Address, Dest, Size);
+  }
+
+  /// Reads \p Count pages starting at \p PageAddress with one request and
+  /// caches them. Up to PrefetchPages more uncached pages that follow are
+  /// read along with them if that succeeds.
+  bool fetchPages(addr_t PageAddress, uint64_t Count) {
+    uint64_t Prefetch = 0;
+    while (Prefetch < PrefetchPages &&
+           !isCached(PageAddress + (Count + Prefetch) * PageSize))
+      ++Prefetch;
+
+    std::unique_ptr<uint8_t[]> Buffer(
+        new uint8_t[(Count + Prefetch) * PageSize]);
+    if (Prefetch == 0 ||
+        !readUnderlying(PageAddress, Buffer.get(),
+                        (Count + Prefetch) * PageSize)) {
+      Prefetch = 0;
+      if (!readUnderlying(PageAddress, Buffer.get(), Count * PageSize))
+        return false;
+    }
+
+    for (uint64_t i = 0; i < Count + Prefetch; ++i) {
+      Page &NewPage = Pages[PageAddress + i * PageSize];
+      NewPage.Bytes.reset(new uint8_t[PageSize]);
+      memcpy(NewPage.Bytes.get(), Buffer.get() + i * PageSize, PageSize);
+      LRU.push_front(PageAddress + i * PageSize);
+      NewPage.LRUPosition = LRU.begin();
+    }
+    return true;
+  }
+
+  /// Makes sure that the pages from \p First to \p Last are cached.
+  bool fetchRange(addr_t First, addr_t Last) {
+    for (addr_t PageAddress = First; PageAddress <= Last;) {
+      if (isCached(PageAddress)) {
+        ++Stats.NumPageHits;
+        PageAddress += PageSize;
+        continue;
+      }
+
+      uint64_t Count = 1;
+      while (PageAddress + Count * PageSize <= Last &&
+             !isCached(PageAddress + Count * PageSize))
+        ++Count;
+      Stats.NumPageMisses += Count;
+      if (!fetchPages(PageAddress, Count))
+        return false;
+      PageAddress += Count * PageSize;
+    }
+    return true;
+  }
+
+  /// Drops the least recently used pages until \p NumPages more, plus the
+  /// ones that may be prefetched along with them, fit.
+  void makeRoomFor(uint64_t NumPages) {
+    uint64_t Needed = NumPages + PrefetchPages;
+    size_t Limit = MaxPages > Needed ? MaxPages - Needed : 0;
+    while (Pages.size() > Limit) {
+      Pages.erase(LRU.back());
+      LRU.pop_back();
+    }
+  }
+
+public:
+  /// \param PageSize must be a power of two.
+  /// \param MaxPages bounds the number of pages kept.
+  /// \param PrefetchPages is the number of pages past the end of a request
+  ///        that are read along with it. Only use this with readers that
+  ///        report reads of unmapped memory as failures.
+  CachingMemoryReader(MemoryReader &Underlying, uint64_t PageSize = 4096,
+                      size_t MaxPages = 4096, unsigned PrefetchPages = 0)
+    : Underlying(Underlying), PageSize(PageSize), MaxPages(MaxPages),
+      PrefetchPages(PrefetchPages) {
+    assert(PageSize && (PageSize & (PageSize - 1)) == 0 &&
+           "Page size must be a power of two");
+    assert(MaxPages > 0 && "Must be able to cache at least one page");
+    assert(PrefetchPages <= MaxPages / 2 && "Too many pages to prefetch");
+  }
+
+  uint8_t getPointerSize() override {
+    return Underlying.getPointerSize();
+  }
+
+  uint8_t getSizeSize() override {
+    return Underlying.getSizeSize();
+  }
+
+  addr_t getSymbolAddress(const std::string &Name) override {
+    return Underlying.getSymbolAddress(Name);
+  }
+
+  std::string readString(addr_t Address) override {
+    ++Stats.NumReads;
+    std::string Result;
+    for (addr_t PageAddress = getPageAddress(Address);;
+         PageAddress += PageSize) {
+      auto Bytes = lookupPage(PageAddress);
+      if (Bytes) {
+        ++Stats.NumPageHits;
+      } else {
+        ++Stats.NumPageMisses;
+        makeRoomFor(1);
+        if (!fetchPages(PageAddress, 1)) {
+          ++Stats.NumUnderlyingReads;
+          return Underlying.readString(Address);
+        }
+        Bytes = lookupPage(PageAddress);
+      }
+
+      uint64_t Offset = PageAddress < Address ? Address - PageAddress : 0;
+      auto Start = reinterpret_cast<const char *>(Bytes) + Offset;
+      auto End = static_cast<const char *>(memchr(Start, 0, PageSize - Offset));
+      if (End) {
+        Result.append(Start, End);
+        return Result;
+      }
+      Result.append(Start, PageSize - Offset);
+    }
+  }
+
+  bool readBytes(addr_t Address, uint8_t *Dest, uint64_t Size) override {
+    ++Stats.NumReads;
+    if (Size == 0)
+      return true;
+
+    addr_t First = getPageAddress(Address);
+    addr_t Last = getPageAddress(Address + Size - 1);
+    uint64_t NumPages = (Last - First) / PageSize + 1;
+
+    // Requests too large to keep around are not worth caching.
+    if (Last < First || NumPages > MaxPages / 2)
+      return readUnderlying(Address, Dest, Size);
+
+    // Mark the cached pages as used first, so that making room for the
+    // missing ones doesn't evict them.
+    uint64_t NumMissing = 0;
+    for (addr_t PageAddress = First; PageAddress <= Last;
+         PageAddress += PageSize) {
+      if (!lookupPage(PageAddress))
+        ++NumMissing;
+    }
+    if (NumMissing)
+      makeRoomFor(NumMissing);
+    if (!fetchRange(First, Last))
+      return readUnderlying(Address, Dest, Size);
+
+    for (addr_t PageAddress = First; PageAddress <= Last;
+         PageAddress += PageSize) {
+      auto Bytes = lookupPage(PageAddress);
+      uint64_t Begin = PageAddress < Address ? Address - PageAddress : 0;
+      uint64_t End = std::min(PageSize, Address + Size - PageAddress);
+      memcpy(Dest, Bytes + Begin, End - Begin);
+      Dest += End - Begin;
+    }
+    return true;
+  }
+
+  /// Forgets all cached pages.
+  void invalidate() {
+    Pages.clear();
+    LRU.clear();
+  }
+
+  const Statistics &getStatistics() const {
+    return Stats;
+  }
+};
+
 } // end namespace reflection
 } // end namespace swift
 
@@ -13,6 +13,9 @@
 #define SWIFT_RUNTIME_CONCURRENTUTILS_H
 #include <iterator>
 #include <atomic>
+#include <cassert>
+#include <new>
+#include <thread>
 #include <stdint.h>
 
 #if defined(__FreeBSD__)
@@ -123,9 +126,21 @@ template <class ElemTy> struct ConcurrentList {
   std::atomic<ConcurrentListNode<ElemTy> *> First;
 };
 
-/// A concurrent map that is implemented using a binary tree. It supports
-/// concurrent insertions but does not support removals or rebalancing of
-/// the tree.
+/// A concurrent map that is implemented using an open-addressed hash table
+/// with linear probing. It supports lock-free lookups and concurrent
+/// insertions, but does not support removals.
+///
+/// Entries are allocated individually and never move, so a pointer returned
+/// by find or getOrInsert remains valid for the lifetime of the map. The
+/// bucket array only holds pointers to the entries (plus their hashes in the
+/// entries themselves), so a lookup usually touches one bucket cache line and
+/// one entry. When the table grows, the old bucket array is retired rather
+/// than freed, because readers may still be probing it; retired arrays are
+/// released together with the map.
+///
+/// Lookups never write to shared memory. Insertions are serialized by a
+/// small writer lock, which is only taken after a lock-free lookup has
+/// failed to find the key.
 ///
 /// The entry type must provide the following operations:
 ///
@@ -133,83 +148,176 @@ template <class ElemTy> struct ConcurrentList {
 ///   long getKeyIntValueForDump() const;
 ///
 ///   /// A ternary comparison.  KeyTy is the type of the key provided
-///   /// to find or getOrInsert.
+///   /// to find or getOrInsert.  Only equality (a result of zero) is
+///   /// significant to the map.
 ///   int compareWithKey(KeyTy key) const;
 ///
+///   /// Hash a key.  Keys that compare equal must have equal hashes.
+///   /// The map mixes the result itself, so a cheap hash is fine.
+///   static size_t getKeyHash(KeyTy key);
+///
 ///   /// Return the amount of extra trailing space required by an entry,
 ///   /// where KeyTy is the type of the first argument to getOrInsert and
 ///   /// ArgTys is the type of the remaining arguments.
 ///   static size_t getExtraAllocationSize(KeyTy key, ArgTys...)
 template <class EntryTy> class ConcurrentMap {
   struct Node {
-    std::atomic<Node*> Left;
-    std::atomic<Node*> Right;
+    /// The hash of the key, cached so that probing can usually reject a
+    /// bucket without calling compareWithKey.
+    size_t Hash;
     EntryTy Payload;
 
     template <class... Args>
-    Node(Args &&... args)
-      : Left(nullptr), Right(nullptr), Payload(std::forward<Args>(args)...) {}
+    Node(size_t hash, Args &&... args)
+      : Hash(hash), Payload(std::forward<Args>(args)...) {}
 
     Node(const Node &) = delete;
     Node &operator=(const Node &) = delete;
 
-    ~Node() {
-      // These can be relaxed accesses because there is no safe way for
-      // another thread to race an access to this node with our destruction
-      // of it.
-      ::delete Left.load(std::memory_order_relaxed);
-      ::delete Right.load(std::memory_order_relaxed);
+    static void destroy(Node *node) {
+      node->~Node();
+      ::operator delete(node);
     }
+  };
 
-#ifndef NDEBUG
-    void dump() const {
-      auto L = Left.load(std::memory_order_acquire);
-      auto R = Right.load(std::memory_order_acquire);
-      printf("\"%p\" [ label = \" {<f0> %08lx | {<f1> | <f2>}}\" "
-             "style=\"rounded\" shape=\"record\"];\n",
-             this, (long) Payload.getKeyValueForDump());
-
-      if (L) {
-        L->dump();
-        printf("\"%p\":f1 -> \"%p\":f0;\n", this, L);
-      }
-      if (R) {
-        R->dump();
-        printf("\"%p\":f2 -> \"%p\":f0;\n", this, R);
-      }
+  /// A bucket array.  The capacity is always a power of two, and the array
+  /// is never more than three quarters full, so probing always terminates
+  /// at an empty bucket.
+  struct Storage {
+    /// The number of buckets.
+    size_t Capacity;
+
+    /// The number of occupied buckets.  Only accessed under the writer lock.
+    size_t Count;
+
+    /// 64 minus log2(Capacity), for Fibonacci hashing into the array.
+    unsigned Shift;
+
+    /// The bucket array that this one replaced, if any.
+    Storage *Retired;
+
+    /// The buckets, tail-allocated.
+    std::atomic<Node*> Buckets[1];
+
+    static Storage *allocate(size_t capacity, Storage *retired) {
+      assert((capacity & (capacity - 1)) == 0 && "capacity not a power of 2");
+      size_t allocSize = sizeof(Storage)
+                         + (capacity - 1) * sizeof(std::atomic<Node*>);
+      auto storage = reinterpret_cast<Storage *>(::operator new(allocSize));
+      storage->Capacity = capacity;
+      storage->Count = 0;
+      storage->Shift = 64;
+      for (size_t c = capacity; c > 1; c >>= 1)
+        --storage->Shift;
+      storage->Retired = retired;
+      for (size_t i = 0; i != capacity; ++i)
+        ::new (&storage->Buckets[i]) std::atomic<Node*>(nullptr);
+      return storage;
+    }
+
+    static void deallocate(Storage *storage) {
+      ::operator delete(storage);
+    }
+
+    size_t getBucketIndex(size_t hash) const {
+      // Pointer-derived hashes tend to have clustered low bits, so scramble
+      // the hash with a multiplicative (Fibonacci) hash and use the high
+      // bits of the product.
+      if (Shift == 64)
+        return 0;
+      return size_t((uint64_t(hash) * 0x9E3779B97F4A7C15ULL) >> Shift);
+    }
+
+    bool needsGrowthForInsert() const {
+      return (Count + 1) * 4 > Capacity * 3;
+    }
+
+    /// Insert a node into a bucket array that is not visible to any other
+    /// thread yet.
+    void insertUnpublished(Node *node) {
+      size_t mask = Capacity - 1;
+      size_t i = getBucketIndex(node->Hash);
+      while (Buckets[i].load(std::memory_order_relaxed))
+        i = (i + 1) & mask;
+      Buckets[i].store(node, std::memory_order_relaxed);
+      ++Count;
     }
-#endif
   };
 
-  /// The root of the tree.
-  std::atomic<Node*> Root;
+  /// The initial number of buckets.
+  static const size_t InitialCapacity = 16;
+
+  /// The current bucket array, or null if nothing has been inserted yet.
+  std::atomic<Storage*> Table;
+
+  /// Serializes insertions.  Lookups never take this lock.
+  std::atomic<bool> WriterLock;
+
+  void lockWriters() {
+    while (WriterLock.exchange(true, std::memory_order_acquire)) {
+      while (WriterLock.load(std::memory_order_relaxed))
+        std::this_thread::yield();
+    }
+  }
+
+  void unlockWriters() {
+    WriterLock.store(false, std::memory_order_release);
+  }
 
-  /// This member stores the address of the last node that was found by the
-  /// search procedure. We cache the last search to accelerate code that
-  /// searches the same value in a loop.
-  std::atomic<Node*> LastSearch;
+  template <class KeyTy>
+  static Node *findInTable(Storage *table, const KeyTy &key, size_t hash) {
+    size_t mask = table->Capacity - 1;
+    for (size_t i = table->getBucketIndex(hash); ; i = (i + 1) & mask) {
+      Node *node = table->Buckets[i].load(std::memory_order_acquire);
+      if (!node)
+        return nullptr;
+      if (node->Hash == hash && node->Payload.compareWithKey(key) == 0)
+        return node;
+    }
+  }
 
 public:
-  constexpr ConcurrentMap() : Root(nullptr), LastSearch(nullptr) {}
+  constexpr ConcurrentMap() : Table(nullptr), WriterLock(false) {}
 
   ConcurrentMap(const ConcurrentMap &) = delete;
   ConcurrentMap &operator=(const ConcurrentMap &) = delete;
 
   ~ConcurrentMap() {
-    ::delete Root.load(std::memory_order_relaxed);
+    // These can be relaxed accesses because there is no safe way for
+    // another thread to race an access to the map with its destruction.
+    Storage *table = Table.load(std::memory_order_relaxed);
+    if (!table)
+      return;
+
+    // The current table holds every node; retired tables only hold a
+    // prefix of them.
+    for (size_t i = 0; i != table->Capacity; ++i)
+      if (Node *node = table->Buckets[i].load(std::memory_order_relaxed))
+        Node::destroy(node);
+
+    while (table) {
+      Storage *retired = table->Retired;
+      Storage::deallocate(table);
+      table = retired;
+    }
   }
 
 #ifndef NDEBUG
   void dump() const {
-    auto R = Root.load(std::memory_order_acquire);
-    printf("digraph g {\n"
-           "graph [ rankdir = \"TB\"];\n"
-           "node  [ fontsize = \"16\" ];\n"
-           "edge  [ ];\n");
-    if (R) {
-      R->dump();
+    Storage *table = Table.load(std::memory_order_acquire);
+    if (!table) {
+      printf("<empty>\n");
+      return;
+    }
+    printf("%zu entries in %zu buckets\n", table->Count, table->Capacity);
+    for (size_t i = 0; i != table->Capacity; ++i) {
+      Node *node = table->Buckets[i].load(std::memory_order_acquire);
+      if (!node)
+        continue;
+      printf("  [%zu] hash %016zx home %zu key %08lx\n", i, node->Hash,
+             table->getBucketIndex(node->Hash),
+             (long) node->Payload.getKeyIntValueForDump());
     }
-    printf("\n}\n");
   }
 #endif
 
@@ -217,27 +325,12 @@ public:
   /// \returns a pointer to the value or null if the value is not in the map.
   template <class KeyTy>
   EntryTy *find(const KeyTy &key) {
-    // Check if we are looking for the same key that we looked for in the last
-    // time we called this function.
-    if (Node *last = LastSearch.load(std::memory_order_acquire)) {
-      if (last->Payload.compareWithKey(key) == 0)
-        return &last->Payload;
-    }
-
-    // Search the tree, starting from the root.
-    Node *node = Root.load(std::memory_order_acquire);
-    while (node) {
-      int comparisonResult = node->Payload.compareWithKey(key);
-      if (comparisonResult == 0) {
-        LastSearch.store(node, std::memory_order_release);
-        return &node->Payload;
-      } else if (comparisonResult < 0) {
-        node = node->Left.load(std::memory_order_acquire);
-      } else {
-        node = node->Right.load(std::memory_order_acquire);
-      }
-    }
+    Storage *table = Table.load(std::memory_order_acquire);
+    if (!table)
+      return nullptr;
 
+    if (Node *node = findInTable(table, key, EntryTy::getKeyHash(key)))
+      return &node->Payload;
     return nullptr;
   }
 
@@ -247,69 +340,59 @@ public:
   ///   or already existed (false)
   template <class KeyTy, class... ArgTys>
   std::pair<EntryTy*, bool> getOrInsert(KeyTy key, ArgTys &&... args) {
-    // Check if we are looking for the same key that we looked for the
-    // last time we called this function.
-    if (Node *last = LastSearch.load(std::memory_order_acquire)) {
-      if (last && last->Payload.compareWithKey(key) == 0)
-        return { &last->Payload, false };
-    }
-
-    // The node we allocated.
-    Node *newNode = nullptr;
+    size_t hash = EntryTy::getKeyHash(key);
 
-    // Start from the root.
-    auto edge = &Root;
-
-    while (true) {
-      // Load the edge.
-      Node *node = edge->load(std::memory_order_acquire);
-
-      // If there's a node there, it's either a match or we're going to
-      // one of its children.
-      if (node) {
-      searchFromNode:
-
-        // Compare our key against the node's key.
-        int comparisonResult = node->Payload.compareWithKey(key);
-
-        // If it's equal, we can use this node.
-        if (comparisonResult == 0) {
-          // Destroy the node we allocated before if we're carrying one around.
-          ::delete newNode;
+    // Try a lock-free lookup first.
+    if (Storage *table = Table.load(std::memory_order_acquire)) {
+      if (Node *node = findInTable(table, key, hash))
+        return { &node->Payload, false };
+    }
 
-          // Cache and report that we found an existing node.
-          LastSearch.store(node, std::memory_order_release);
-          return { &node->Payload, false };
-        }
+    lockWriters();
 
-        // Otherwise, select the appropriate child edge and descend.
-        edge = (comparisonResult < 0 ? &node->Left : &node->Right);
-        continue;
-      }
-
-      // Create a new node.
-      if (!newNode) {
-        size_t allocSize =
-          sizeof(Node) + EntryTy::getExtraAllocationSize(key, args...);
-        void *memory = ::operator new(allocSize);
-        newNode = ::new (memory) Node(key, std::forward<ArgTys>(args)...);
+    // Search again now that insertions are excluded; another thread may
+    // have inserted the key, possibly into a new bucket array.
+    Storage *table = Table.load(std::memory_order_acquire);
+    if (table) {
+      if (Node *node = findInTable(table, key, hash)) {
+        unlockWriters();
+        return { &node->Payload, false };
       }
+    }
 
-      // Try to set the edge to the new node.
-      if (std::atomic_compare_exchange_strong_explicit(edge, &node, newNode,
-                                                  std::memory_order_release,
-                                                  std::memory_order_acquire)) {
-        // If that succeeded, cache and report that we created a new node.
-        LastSearch.store(newNode, std::memory_order_release);
-        return { &newNode->Payload, true };
+    // Grow the table if this insertion would overfill it.  The new array is
+    // fully populated before it is published, and the old one stays valid
+    // for readers that are still probing it.
+    if (!table || table->needsGrowthForInsert()) {
+      size_t capacity = table ? table->Capacity * 2 : InitialCapacity;
+      Storage *newTable = Storage::allocate(capacity, table);
+      if (table) {
+        for (size_t i = 0; i != table->Capacity; ++i)
+          if (Node *node = table->Buckets[i].load(std::memory_order_relaxed))
+            newTable->insertUnpublished(node);
       }
-
-      // Otherwise, we lost the race because some other thread initialized
-      // the edge before us.  node will be set to the current value;
-      // repeat the search from there.
-      assert(node && "spurious failure from compare_exchange_strong?");
-      goto searchFromNode;
+      Table.store(newTable, std::memory_order_release);
+      table = newTable;
     }
+
+    // Create the new node.
+    size_t allocSize =
+      sizeof(Node) + EntryTy::getExtraAllocationSize(key, args...);
+    void *memory = ::operator new(allocSize);
+    Node *newNode = ::new (memory) Node(hash, key,
+                                        std::forward<ArgTys>(args)...);
+
+    // Publish it in the first free bucket of its probe sequence.  Readers
+    // that observe the bucket also observe the fully-constructed node.
+    size_t mask = table->Capacity - 1;
+    size_t i = table->getBucketIndex(hash);
+    while (table->Buckets[i].load(std::memory_order_relaxed))
+      i = (i + 1) & mask;
+    table->Buckets[i].store(newNode, std::memory_order_release);
+    ++table->Count;
+
+    unlockWriters();
+    return { &newNode->Payload, true };
   }
 };
 
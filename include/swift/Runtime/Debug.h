@@ -18,6 +18,7 @@
 #define _SWIFT_RUNTIME_DEBUG_HELPERS_
 
 #include <llvm/Support/Compiler.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "swift/Runtime/Config.h"
 
@@ -109,6 +110,30 @@ SWIFT_RUNTIME_EXPORT
 extern "C"
 void swift_reportError(uint32_t flags, const char *message);
 
+/// Memory the runtime has allocated for one kind of metadata cache.
+struct MetadataAllocationStats {
+  /// The kind of cache, such as "GenericCache" or "WitnessTableCache".
+  const char *Kind;
+  uint64_t NumAllocations;
+  uint64_t BytesAllocated;
+};
+
+/// Copies the metadata allocation statistics for up to \p count kinds of
+/// cache into \p stats, and the number of bytes mapped for metadata so far
+/// into \p bytesMapped if it is not null.
+///
+/// \returns the number of kinds of cache the runtime keeps statistics for.
+SWIFT_RUNTIME_EXPORT
+extern "C"
+size_t swift_getMetadataAllocationStats(MetadataAllocationStats *stats,
+                                        size_t count, uint64_t *bytesMapped);
+
+/// Prints the metadata allocation statistics to stderr. Intended to be
+/// called from a debugger.
+SWIFT_RUNTIME_EXPORT
+extern "C"
+void swift_dumpMetadataAllocationStats();
+
 // namespace swift
 }
 
@@ -167,6 +167,11 @@ extern "C" BoxPair::Return (*_swift_allocBox)(Metadata const *type);
 // Never returns nil. The returned memory is uninitialized. 
 //
 // An "alignment mask" is just the alignment (a power of 2) minus 1.
+//
+// Setting SWIFT_RUNTIME_ALLOCATOR=thread-cache in the environment serves
+// small allocations from per-thread free lists instead of calling malloc
+// each time. The memory is still allocated by malloc and may be freed with
+// free().
 
 SWIFT_RT_ENTRY_VISIBILITY
 extern "C"
@@ -176,6 +181,8 @@ void *swift_slowAlloc(size_t bytes, size_t alignMask)
 
 // If the caller cannot promise to zero the object during destruction,
 // then call these corresponding APIs:
+//
+// 'bytes' must be no larger than the size the memory was allocated with.
 SWIFT_RT_ENTRY_VISIBILITY
 extern "C"
 void swift_slowDealloc(void *ptr, size_t bytes, size_t alignMask)
@@ -212,6 +219,18 @@ extern "C"
 void (*SWIFT_CC(RegisterPreservingCC) _swift_retain_n)(HeapObject *object,
                                                        uint32_t n);
 
+/// Increments the reference count of an object without atomic operations.
+///
+/// The object must not be visible to any other thread; the compiler only
+/// emits calls to this for objects that escape analysis proves are not
+/// shared.
+///
+/// \param object - may be null, in which case this is a no-op
+SWIFT_RT_ENTRY_VISIBILITY
+extern "C"
+void swift_nonatomic_retain(HeapObject *object)
+    SWIFT_CC(RegisterPreservingCC);
+
 static inline void _swift_retain_inlined(HeapObject *object) {
   if (object) {
     object->refCount.increment();
@@ -281,6 +300,17 @@ SWIFT_RUNTIME_EXPORT
 extern "C" void (*SWIFT_CC(RegisterPreservingCC)
                      _swift_release)(HeapObject *object);
 
+/// Decrements the reference count of an object without atomic operations,
+/// destroying it as swift_release does if the count reaches zero.
+///
+/// The object must not be visible to any other thread.
+///
+/// \param object - may be null, in which case this is a no-op
+SWIFT_RT_ENTRY_VISIBILITY
+extern "C"
+void swift_nonatomic_release(HeapObject *object)
+    SWIFT_CC(RegisterPreservingCC);
+
 /// Atomically decrements the retain count of an object n times. If the retain
 /// count reaches zero, the object is destroyed
 SWIFT_RT_ENTRY_VISIBILITY
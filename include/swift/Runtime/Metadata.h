@@ -3346,6 +3346,25 @@ extern "C"
 const WitnessTable *swift_conformsToProtocol(const Metadata *type,
                                             const ProtocolDescriptor *protocol);
 
+/// Counters describing the behavior of swift_conformsToProtocol.
+struct ConformanceCacheStatistics {
+  /// Lookups answered from the conformance cache. Only counted when
+  /// SWIFT_DEBUG_CONFORMANCE_STATISTICS is set in the environment.
+  size_t CacheHits;
+  /// Lookups that had to consult the conformance record index.
+  size_t CacheMisses;
+  /// Conformance sections whose records have been indexed. Each loaded
+  /// image is scanned at most once.
+  size_t SectionScans;
+  /// Conformance records added to the index.
+  size_t RecordsIndexed;
+};
+
+/// Fill in \p stats with the current conformance cache counters.
+SWIFT_RUNTIME_EXPORT
+extern "C"
+void swift_getConformanceCacheStatistics(ConformanceCacheStatistics *stats);
+
 /// Register a block of protocol conformance records for dynamic lookup.
 SWIFT_RUNTIME_EXPORT
 extern "C"
@@ -1421,9 +1421,11 @@ template<typename ImplClass>
 void
 SILCloner<ImplClass>::visitStrongRetainInst(StrongRetainInst *Inst) {
   getBuilder().setCurrentDebugScope(getOpScope(Inst->getDebugScope()));
-  doPostProcess(Inst,
+  auto *Cloned =
     getBuilder().createStrongRetain(getOpLocation(Inst->getLoc()),
-                                    getOpValue(Inst->getOperand())));
+                                    getOpValue(Inst->getOperand()));
+  Cloned->setAtomicity(Inst->getAtomicity());
+  doPostProcess(Inst, Cloned);
 }
 
 template<typename ImplClass>
@@ -1467,9 +1469,11 @@ template<typename ImplClass>
 void
 SILCloner<ImplClass>::visitStrongReleaseInst(StrongReleaseInst *Inst) {
   getBuilder().setCurrentDebugScope(getOpScope(Inst->getDebugScope()));
-  doPostProcess(Inst,
+  auto *Cloned =
     getBuilder().createStrongRelease(getOpLocation(Inst->getLoc()),
-                                     getOpValue(Inst->getOperand())));
+                                     getOpValue(Inst->getOperand()));
+  Cloned->setAtomicity(Inst->getAtomicity());
+  doPostProcess(Inst, Cloned);
 }
 
 template<typename ImplClass>
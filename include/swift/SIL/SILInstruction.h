@@ -2285,11 +2285,30 @@ public:
 /// RefCountingInst - An abstract class of instructions which
 /// manipulate the reference count of their object operand.
 class RefCountingInst : public SILInstruction {
+public:
+  /// Whether a reference counting operation must be atomic.
+  enum class Atomicity : bool {
+    /// The operation may race with operations on other threads.
+    Atomic,
+    /// The object is known not to be visible to any other thread while the
+    /// operation executes, so a non-atomic update is enough.
+    NonAtomic,
+  };
+
+private:
+  Atomicity RCAtomicity = Atomicity::Atomic;
+
 protected:
   RefCountingInst(ValueKind Kind, SILDebugLocation DebugLoc)
       : SILInstruction(Kind, DebugLoc) {}
 
 public:
+  Atomicity getAtomicity() const { return RCAtomicity; }
+  void setAtomicity(Atomicity A) { RCAtomicity = A; }
+
+  bool isNonAtomic() const { return RCAtomicity == Atomicity::NonAtomic; }
+  void setNonAtomic() { RCAtomicity = Atomicity::NonAtomic; }
+
   static bool classof(const ValueBase *V) {
     return V->getKind() >= ValueKind::First_RefCountingInst &&
            V->getKind() <= ValueKind::Last_RefCountingInst;
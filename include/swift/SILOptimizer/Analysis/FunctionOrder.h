@@ -19,6 +19,7 @@
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/TinyPtrVector.h"
+#include <vector>
 
 namespace swift {
 
@@ -34,6 +35,7 @@ private:
   SILModule &M;
   llvm::SmallVector<SCC, 32> TheSCCs;
   llvm::SmallVector<SILFunction *, 32> TheFunctions;
+  std::vector<std::vector<SILFunction *>> TheLevels;
 
   // The callee analysis we use to determine the callees at each call site.
   BasicCalleeAnalysis *BCA;
@@ -69,9 +71,22 @@ public:
     return TheFunctions;
   }
 
+  /// Get all functions grouped into levels, where every callee of a
+  /// function in level N (outside of its own SCC) is in a level below N.
+  ///
+  /// Functions in the same level have no call edges between them, so
+  /// bottom-up passes could process them independently of each other.
+  /// Within a level, functions appear in bottom-up order.
+  ArrayRef<std::vector<SILFunction *>> getLevels() {
+    if (TheLevels.empty())
+      FindLevels();
+    return TheLevels;
+  }
+
 private:
   void DFS(SILFunction *F);
   void FindSCCs(SILModule &M);
+  void FindLevels();
 };
 
 } // end namespace swift
@@ -15,6 +15,7 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/ErrorHandling.h"
 #include <vector>
@@ -69,6 +70,38 @@ class SILPassManager {
   /// same function.
   bool RestartPipeline = false;
 
+  /// True if passes are recorded in the SILPassProfile.
+  bool ProfilePasses = false;
+
+  /// The number of invalidation broadcasts made by the current pass. Only
+  /// maintained if ProfilePasses is set.
+  unsigned NumInvalidationsInCurrentPass = 0;
+
+  /// The functions the current pass invalidated analyses of, and whether it
+  /// invalidated the whole module. Only maintained if ProfilePasses is set.
+  llvm::SmallPtrSet<SILFunction *, 16> FunctionsInvalidatedByCurrentPass;
+  bool CurrentPassInvalidatedModule = false;
+
+  /// Reset the per-pass invalidation bookkeeping before running a pass.
+  void resetCurrentPassInvalidations() {
+    CurrentPassHasInvalidated = false;
+    NumInvalidationsInCurrentPass = 0;
+    FunctionsInvalidatedByCurrentPass.clear();
+    CurrentPassInvalidatedModule = false;
+  }
+
+  /// Record an invalidation of \p F, or the whole module if \p F is null,
+  /// for the SILPassProfile.
+  void recordInvalidation(SILFunction *F) {
+    if (!ProfilePasses)
+      return;
+    ++NumInvalidationsInCurrentPass;
+    if (F)
+      FunctionsInvalidatedByCurrentPass.insert(F);
+    else
+      CurrentPassInvalidatedModule = true;
+  }
+
 public:
   /// C'tor. It creates and registers all analysis passes, which are defined
   /// in Analysis.def.
@@ -119,6 +152,7 @@ public:
         AP->invalidate(K);
 
     CurrentPassHasInvalidated = true;
+    recordInvalidation(nullptr);
 
     // Assume that all functions have changed. Clear all masks of all functions.
     CompletedPassesMap.clear();
@@ -147,6 +181,7 @@ public:
         AP->invalidate(F, K);
     
     CurrentPassHasInvalidated = true;
+    recordInvalidation(F);
     // Any change let all passes run again.
     CompletedPassesMap[F].reset();
   }
@@ -162,6 +197,7 @@ public:
         AP->invalidateForDeadFunction(F, K);
     
     CurrentPassHasInvalidated = true;
+    recordInvalidation(F);
     // Any change let all passes run again.
     CompletedPassesMap[F].reset();
   }
@@ -0,0 +1,134 @@
+//===--- PassProfile.h - Optimizer profiling report -------------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// Collects per-pass and per-(pass, function) statistics from the SIL pass
+// managers and writes them out as a JSON report.
+//
+// Profiling is enabled by setting SILOptions::PassProfileFilename, which the
+// frontend does for -sil-pass-profile and sil-opt does for its option of the
+// same name. Every SILPassManager in the process records into the same
+// profile, so the report covers the diagnostic pipeline as well as the
+// optimization or -Onone pipeline that follows it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_SILOPTIMIZER_PASSMANAGER_PASSPROFILE_H
+#define SWIFT_SILOPTIMIZER_PASSMANAGER_PASSPROFILE_H
+
+#include "swift/Basic/LLVM.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace llvm {
+  class raw_ostream;
+}
+
+namespace swift {
+
+class SILFunction;
+class SILModule;
+
+class SILPassProfile {
+public:
+  /// Aggregated statistics for one pass in one pipeline stage.
+  struct PassStats {
+    std::string Stage;
+    std::string Pass;
+    bool IsModulePass = false;
+
+    /// The number of times the pass ran (once per function for function
+    /// passes).
+    unsigned NumRuns = 0;
+
+    uint64_t Nanoseconds = 0;
+
+    /// The number of instructions in the functions (or module) the pass
+    /// ran on, summed over all runs, before and after each run.
+    uint64_t InstsBefore = 0;
+    uint64_t InstsAfter = 0;
+
+    /// The number of runs after which a function was reported as changed.
+    /// For module passes, the number of functions whose analyses were
+    /// invalidated, or all functions if the whole module was.
+    unsigned NumFunctionsChanged = 0;
+
+    /// The number of analysis invalidation broadcasts the pass made.
+    unsigned NumInvalidations = 0;
+  };
+
+  /// Aggregated statistics for one function pass on one function.
+  struct FunctionStats {
+    unsigned NumRuns = 0;
+    uint64_t Nanoseconds = 0;
+    uint64_t InstsBefore = 0;
+    uint64_t InstsAfter = 0;
+  };
+
+private:
+  /// All passes, in the order they first ran.
+  std::vector<PassStats> Passes;
+
+  /// Maps "stage\0pass" to an index into Passes.
+  llvm::StringMap<unsigned> PassIDs;
+
+  /// Interned function names.
+  llvm::StringMap<unsigned> FunctionIDs;
+  std::vector<StringRef> FunctionNames;
+
+  /// Maps (pass ID, function ID) to the statistics for that pair.
+  llvm::DenseMap<std::pair<unsigned, unsigned>, FunctionStats> PairStats;
+
+public:
+  /// Returns the profile that all pass managers in the process record into.
+  static SILPassProfile &get();
+
+  /// Returns a stable ID for the pass \p Pass in stage \p Stage.
+  unsigned getPassID(StringRef Stage, StringRef Pass, bool IsModulePass);
+
+  /// Records one run of a function pass.
+  void recordFunctionPass(unsigned PassID, SILFunction *F,
+                          uint64_t Nanoseconds, unsigned InstsBefore,
+                          unsigned InstsAfter, bool Changed,
+                          unsigned NumInvalidations);
+
+  /// Records one run of a module pass.
+  void recordModulePass(unsigned PassID, uint64_t Nanoseconds,
+                        uint64_t InstsBefore, uint64_t InstsAfter,
+                        unsigned NumFunctionsChanged,
+                        unsigned NumInvalidations);
+
+  /// Prints the profile as JSON, listing the \p TopN most expensive
+  /// (pass, function) pairs.
+  void print(llvm::raw_ostream &OS, unsigned TopN) const;
+
+  /// Writes the profile as JSON to \p Path, listing as many (pass,
+  /// function) pairs as -sil-pass-profile-top asks for (20 by default).
+  ///
+  /// \returns true on error.
+  bool write(StringRef Path) const;
+
+  /// Discards everything recorded so far.
+  void clear();
+
+  /// Returns the number of instructions in \p F.
+  static unsigned countInstructions(SILFunction *F);
+
+  /// Returns the number of instructions in all functions of \p M.
+  static uint64_t countInstructions(SILModule *M);
+};
+
+} // end namespace swift
+
+#endif
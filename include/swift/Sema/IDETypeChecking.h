@@ -104,6 +104,10 @@ namespace swift {
   bool typeCheckAbstractFunctionBodyUntil(AbstractFunctionDecl *AFD,
                                           SourceLoc EndTypeCheckLoc);
 
+  /// Typecheck the specified function body and the functions nested in it,
+  /// after the rest of its file was typechecked with the body delayed.
+  void typeCheckAbstractFunctionBody(AbstractFunctionDecl *AFD);
+
   /// \brief Typecheck top-level code parsed during code completion.
   ///
   /// \returns true on success, false on error.
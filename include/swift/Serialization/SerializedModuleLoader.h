@@ -29,6 +29,10 @@ private:
   using LoadedModulePair = std::pair<std::unique_ptr<ModuleFile>, unsigned>;
   std::vector<LoadedModulePair> LoadedModuleFiles;
 
+  /// If set, the time and memory taken to load each module is printed to
+  /// llvm::errs().
+  bool DebugTimeModuleLoading = false;
+
   explicit SerializedModuleLoader(ASTContext &ctx, DependencyTracker *tracker);
 
 public:
@@ -48,6 +52,10 @@ public:
   SerializedModuleLoader &operator=(const SerializedModuleLoader &) = delete;
   SerializedModuleLoader &operator=(SerializedModuleLoader &&) = delete;
 
+  void enableDebugTimeModuleLoading() {
+    DebugTimeModuleLoading = true;
+  }
+
   /// \brief Import a module with the given module path.
   ///
   /// \param importLoc The location of the 'import' keyword.
@@ -14,12 +14,24 @@
 #include "Darwin/Cache-Mac.cpp"
 #else
 
-//  This file implements a default caching implementation that never evicts
-//  its entries.
+//  This file implements a default caching implementation for hosts without
+//  libcache. Its memory use is bounded by a cost limit: once the values in
+//  the cache cost more than that, values which are not retained by a client
+//  are evicted, approximately least recently used first (CLOCK).
+//
+//  Entries are spread over independently locked shards by the hash of their
+//  key, and lookups only take a shard's lock for reading, so that concurrent
+//  lookups don't contend. Retain counts are kept per value, in a separately
+//  sharded table, since releaseValue() is only given the value.
 
 #include "swift/Basic/Cache.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/RWMutex.h"
+#include <atomic>
+#include <list>
 
 using namespace swift::sys;
 using llvm::StringRef;
@@ -32,14 +44,6 @@ struct DefaultCacheKey {
   //DefaultCacheKey() = default;
   DefaultCacheKey(void *Key, CacheImpl::CallBacks *CBs) : Key(Key), CBs(CBs) {}
 };
-
-struct DefaultCache {
-  llvm::sys::Mutex Mux;
-  CacheImpl::CallBacks CBs;
-  llvm::DenseMap<DefaultCacheKey, void *> Entries;
-
-  explicit DefaultCache(CacheImpl::CallBacks CBs) : CBs(std::move(CBs)) { }
-};
 } // end anonymous namespace
 
 namespace llvm {
@@ -51,7 +55,7 @@ template<> struct DenseMapInfo<DefaultCacheKey> {
     return { DenseMapInfo<void*>::getTombstoneKey(), nullptr };
   }
   static unsigned getHashValue(const DefaultCacheKey &Val) {
-    uintptr_t Hash = Val.CBs->keyHashCB(Val.Key, nullptr);
+    uintptr_t Hash = Val.CBs->keyHashCB(Val.Key, Val.CBs->UserData);
     return DenseMapInfo<uintptr_t>::getHashValue(Hash);
   }
   static bool isEqual(const DefaultCacheKey &LHS, const DefaultCacheKey &RHS) {
@@ -62,76 +66,306 @@ template<> struct DenseMapInfo<DefaultCacheKey> {
         RHS.Key == DenseMapInfo<void*>::getEmptyKey() ||
         RHS.Key == DenseMapInfo<void*>::getTombstoneKey())
       return false;
-    return LHS.CBs->keyIsEqualCB(LHS.Key, RHS.Key, nullptr);
+    return LHS.CBs->keyIsEqualCB(LHS.Key, RHS.Key, LHS.CBs->UserData);
   }
 };
 }
 
-CacheImpl::ImplTy CacheImpl::create(StringRef Name, const CallBacks &CBs) {
-  return new DefaultCache(CBs);
-}
+namespace {
+/// The number of independently locked parts of each cache.
+const unsigned NumShards = 16;
 
-void CacheImpl::setAndRetain(void *Key, void *Value, size_t Cost) {
-  DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
-  llvm::sys::ScopedLock L(DCache.Mux);
+/// The cost limit of a cache until setCostLimit() is called.
+const size_t DefaultCostLimit = size_t(1) << 30;
 
-  DefaultCacheKey CKey(Key, &DCache.CBs);
-  auto Entry = DCache.Entries.find(CKey);
-  if (Entry != DCache.Entries.end()) {
-    DCache.CBs.keyDestroyCB(Entry->first.Key, nullptr);
-    DCache.CBs.valueDestroyCB(Entry->second, nullptr);
-    DCache.Entries.erase(Entry);
+struct CacheEntry {
+  void *Key;
+  void *Value;
+  size_t Cost;
+
+  /// Set by lookups, and cleared when the clock hand passes the entry. An
+  /// entry is only evicted if it wasn't looked up since the hand last
+  /// passed it.
+  std::atomic<bool> Referenced;
+
+  CacheEntry(void *Key, void *Value, size_t Cost)
+    : Key(Key), Value(Value), Cost(Cost), Referenced(true) {}
+};
+
+/// Keys and values whose destroy callbacks have to be called once no lock
+/// is held anymore.
+struct DestroyList {
+  llvm::SmallVector<void *, 4> Keys;
+  llvm::SmallVector<void *, 4> Values;
+
+  void run(const CacheImpl::CallBacks &CBs) {
+    for (void *Key : Keys)
+      CBs.keyDestroyCB(Key, CBs.UserData);
+    for (void *Value : Values)
+      CBs.valueDestroyCB(Value, CBs.UserData);
   }
+};
 
-  DCache.Entries[CKey] = Value;
+/// The retain counts of the values of a cache.
+///
+/// A value is only in the table while it is retained. A value that leaves
+/// the cache while it is retained is destroyed when it is released for the
+/// last time.
+class RetainTable {
+  struct Record {
+    unsigned RetainCount = 0;
+    /// The number of times the value left the cache while it was retained.
+    unsigned PendingDestroys = 0;
+  };
 
-  // FIXME: Not thread-safe! It should avoid deleting the value until
-  // 'releaseValue is called on it.
-}
+  struct Shard {
+    llvm::sys::Mutex Lock;
+    llvm::DenseMap<void *, Record> Records;
+  };
 
-bool CacheImpl::getAndRetain(const void *Key, void **Value_out) {
-  DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
-  llvm::sys::ScopedLock L(DCache.Mux);
-
-  DefaultCacheKey CKey(const_cast<void*>(Key), &DCache.CBs);
-  auto Entry = DCache.Entries.find(CKey);
-  if (Entry != DCache.Entries.end()) {
-    // FIXME: Not thread-safe! It should avoid deleting the value until
-    // 'releaseValue is called on it.
-    *Value_out = Entry->second;
+  Shard Shards[NumShards];
+
+  Shard &getShard(void *Value) {
+    return Shards[llvm::DenseMapInfo<void *>::getHashValue(Value) % NumShards];
+  }
+
+public:
+  void retain(void *Value) {
+    Shard &S = getShard(Value);
+    llvm::sys::ScopedLock L(S.Lock);
+    ++S.Records[Value].RetainCount;
+  }
+
+  /// \returns the number of times the value has to be destroyed.
+  unsigned release(void *Value) {
+    Shard &S = getShard(Value);
+    llvm::sys::ScopedLock L(S.Lock);
+    auto Found = S.Records.find(Value);
+    assert(Found != S.Records.end() && "releasing a value that isn't retained");
+    if (--Found->second.RetainCount != 0)
+      return 0;
+    unsigned PendingDestroys = Found->second.PendingDestroys;
+    S.Records.erase(Found);
+    return PendingDestroys;
+  }
+
+  bool isRetained(void *Value) {
+    Shard &S = getShard(Value);
+    llvm::sys::ScopedLock L(S.Lock);
+    return S.Records.count(Value);
+  }
+
+  /// Called when \p Value leaves the cache.
+  ///
+  /// \returns true if the value can be destroyed right away.
+  bool discard(void *Value) {
+    Shard &S = getShard(Value);
+    llvm::sys::ScopedLock L(S.Lock);
+    auto Found = S.Records.find(Value);
+    if (Found == S.Records.end())
+      return true;
+    ++Found->second.PendingDestroys;
+    return false;
+  }
+};
+
+class DefaultCache {
+  struct Shard {
+    llvm::sys::RWMutex Lock;
+    llvm::DenseMap<DefaultCacheKey, std::list<CacheEntry>::iterator> Entries;
+
+    /// All entries, in the order the clock hand visits them.
+    std::list<CacheEntry> Clock;
+    std::list<CacheEntry>::iterator Hand = Clock.end();
+
+    std::atomic<uint64_t> Hits{0};
+    std::atomic<uint64_t> Misses{0};
+    std::atomic<uint64_t> Evictions{0};
+  };
+
+  Shard Shards[NumShards];
+  RetainTable Retains;
+  std::atomic<size_t> TotalCost{0};
+  std::atomic<size_t> CostLimit{DefaultCostLimit};
+
+  unsigned getShardIndex(DefaultCacheKey Key) {
+    uintptr_t Hash = CBs.keyHashCB(Key.Key, CBs.UserData);
+    return llvm::hash_value(Hash) % NumShards;
+  }
+
+  /// Removes the entry at \p I from \p S, which must be locked for writing.
+  void removeEntry(Shard &S, std::list<CacheEntry>::iterator I,
+                   DestroyList &ToDestroy) {
+    S.Entries.erase(DefaultCacheKey(I->Key, &CBs));
+    TotalCost -= I->Cost;
+    ToDestroy.Keys.push_back(I->Key);
+    if (Retains.discard(I->Value))
+      ToDestroy.Values.push_back(I->Value);
+    if (S.Hand == I)
+      S.Hand = S.Clock.erase(I);
+    else
+      S.Clock.erase(I);
+  }
+
+  /// Evicts entries from \p S, which must be locked for writing, until the
+  /// cache is within its cost limit or the clock hand went around once.
+  void evictFromShard(Shard &S, DestroyList &ToDestroy) {
+    size_t Steps = S.Clock.size();
+    while (TotalCost > CostLimit && !S.Clock.empty() && Steps-- != 0) {
+      if (S.Hand == S.Clock.end())
+        S.Hand = S.Clock.begin();
+
+      CacheEntry &Entry = *S.Hand;
+      if (Entry.Referenced.exchange(false) || Retains.isRetained(Entry.Value)) {
+        ++S.Hand;
+        continue;
+      }
+
+      removeEntry(S, S.Hand, ToDestroy);
+      ++S.Evictions;
+    }
+  }
+
+  /// Evicts entries until the cache is within its cost limit, starting with
+  /// the shard at \p FirstIndex. Shards are locked one at a time.
+  ///
+  /// The hand of each shard goes around at most twice, once in each pass
+  /// over the shards, so that an entry which was just looked up is only
+  /// evicted if no shard has an entry which wasn't.
+  void evict(unsigned FirstIndex, DestroyList &ToDestroy) {
+    for (unsigned i = 0; i != 2 * NumShards && TotalCost > CostLimit; ++i) {
+      Shard &S = Shards[(FirstIndex + i) % NumShards];
+      llvm::sys::ScopedWriter L(S.Lock);
+      evictFromShard(S, ToDestroy);
+    }
+  }
+
+public:
+  CacheImpl::CallBacks CBs;
+
+  explicit DefaultCache(CacheImpl::CallBacks CBs) : CBs(std::move(CBs)) { }
+
+  void set(void *Key, void *Value, size_t Cost) {
+    DefaultCacheKey CKey(Key, &CBs);
+    unsigned Index = getShardIndex(CKey);
+    Shard &S = Shards[Index];
+    DestroyList ToDestroy;
+
+    Retains.retain(Value);
+    {
+      llvm::sys::ScopedWriter L(S.Lock);
+      auto Found = S.Entries.find(CKey);
+      if (Found != S.Entries.end())
+        removeEntry(S, Found->second, ToDestroy);
+
+      // New entries go right behind the hand, so that they are visited
+      // last.
+      auto I = S.Clock.emplace(S.Hand, Key, Value, Cost);
+      S.Entries.insert({CKey, I});
+      TotalCost += Cost;
+    }
+
+    if (TotalCost > CostLimit)
+      evict(Index, ToDestroy);
+    ToDestroy.run(CBs);
+  }
+
+  bool get(const void *Key, void **Value_out) {
+    DefaultCacheKey CKey(const_cast<void *>(Key), &CBs);
+    Shard &S = Shards[getShardIndex(CKey)];
+
+    llvm::sys::ScopedReader L(S.Lock);
+    auto Found = S.Entries.find(CKey);
+    if (Found == S.Entries.end()) {
+      ++S.Misses;
+      return false;
+    }
+
+    CacheEntry &Entry = *Found->second;
+    Entry.Referenced = true;
+    Retains.retain(Entry.Value);
+    *Value_out = Entry.Value;
+    ++S.Hits;
     return true;
   }
-  return false;
+
+  void release(void *Value) {
+    for (unsigned n = Retains.release(Value); n != 0; --n)
+      CBs.valueDestroyCB(Value, CBs.UserData);
+  }
+
+  bool remove(const void *Key) {
+    DefaultCacheKey CKey(const_cast<void *>(Key), &CBs);
+    Shard &S = Shards[getShardIndex(CKey)];
+    DestroyList ToDestroy;
+    {
+      llvm::sys::ScopedWriter L(S.Lock);
+      auto Found = S.Entries.find(CKey);
+      if (Found == S.Entries.end())
+        return false;
+      removeEntry(S, Found->second, ToDestroy);
+    }
+    ToDestroy.run(CBs);
+    return true;
+  }
+
+  void removeAll() {
+    for (Shard &S : Shards) {
+      DestroyList ToDestroy;
+      {
+        llvm::sys::ScopedWriter L(S.Lock);
+        while (!S.Clock.empty())
+          removeEntry(S, S.Clock.begin(), ToDestroy);
+      }
+      ToDestroy.run(CBs);
+    }
+  }
+
+  void setCostLimit(size_t Limit) {
+    CostLimit = Limit;
+    DestroyList ToDestroy;
+    evict(0, ToDestroy);
+    ToDestroy.run(CBs);
+  }
+
+  CacheStats getStats() {
+    CacheStats Stats;
+    for (Shard &S : Shards) {
+      llvm::sys::ScopedReader L(S.Lock);
+      Stats.Hits += S.Hits;
+      Stats.Misses += S.Misses;
+      Stats.Evictions += S.Evictions;
+      Stats.Count += S.Entries.size();
+    }
+    Stats.TotalCost = TotalCost;
+    Stats.CostLimit = CostLimit;
+    return Stats;
+  }
+};
+} // end anonymous namespace
+
+CacheImpl::ImplTy CacheImpl::create(StringRef Name, const CallBacks &CBs) {
+  return new DefaultCache(CBs);
+}
+
+void CacheImpl::setAndRetain(void *Key, void *Value, size_t Cost) {
+  static_cast<DefaultCache*>(Impl)->set(Key, Value, Cost);
+}
+
+bool CacheImpl::getAndRetain(const void *Key, void **Value_out) {
+  return static_cast<DefaultCache*>(Impl)->get(Key, Value_out);
 }
 
 void CacheImpl::releaseValue(void *Value) {
-  // FIXME: Implementation.
+  static_cast<DefaultCache*>(Impl)->release(Value);
 }
 
 bool CacheImpl::remove(const void *Key) {
-  DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
-  llvm::sys::ScopedLock L(DCache.Mux);
-
-  DefaultCacheKey CKey(const_cast<void*>(Key), &DCache.CBs);
-  auto Entry = DCache.Entries.find(CKey);
-  if (Entry != DCache.Entries.end()) {
-    DCache.CBs.keyDestroyCB(Entry->first.Key, nullptr);
-    DCache.CBs.valueDestroyCB(Entry->second, nullptr);
-    DCache.Entries.erase(Entry);
-    return true;
-  }
-  return false;
+  return static_cast<DefaultCache*>(Impl)->remove(Key);
 }
 
 void CacheImpl::removeAll() {
-  DefaultCache &DCache = *static_cast<DefaultCache*>(Impl);
-  llvm::sys::ScopedLock L(DCache.Mux);
-
-  for (auto Entry : DCache.Entries) {
-    DCache.CBs.keyDestroyCB(Entry.first.Key, nullptr);
-    DCache.CBs.valueDestroyCB(Entry.second, nullptr);
-  }
-  DCache.Entries.clear();
+  static_cast<DefaultCache*>(Impl)->removeAll();
 }
 
 void CacheImpl::destroy() {
@@ -139,4 +373,12 @@ void CacheImpl::destroy() {
   delete static_cast<DefaultCache*>(Impl);
 }
 
+void CacheImpl::setCostLimit(size_t Limit) {
+  static_cast<DefaultCache*>(Impl)->setCostLimit(Limit);
+}
+
+CacheStats CacheImpl::getStats() const {
+  return static_cast<DefaultCache*>(Impl)->getStats();
+}
+
 #endif // finish default implementation
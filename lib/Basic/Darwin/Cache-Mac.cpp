@@ -68,3 +68,12 @@ void CacheImpl::removeAll() {
 void CacheImpl::destroy() {
   cache_destroy(static_cast<cache_t*>(Impl));
 }
+
+void CacheImpl::setCostLimit(size_t Limit) {
+  // libcache evicts values under memory pressure.
+}
+
+CacheStats CacheImpl::getStats() const {
+  // libcache doesn't expose any counters.
+  return CacheStats();
+}
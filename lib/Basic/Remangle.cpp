@@ -1387,7 +1387,7 @@ void Remangler::mangleGenerics(Node *node, EntityContext &ctx) {
   unsigned index = 0;
   for (; i != e && i->get()->getKind() == Node::Kind::Archetype; ++i) {
     auto child = i->get();
-    Archetypes[child->getText()] = ArchetypeInfo{index++, absoluteDepth};
+    Archetypes[child->getText().str()] = ArchetypeInfo{index++, absoluteDepth};
     mangle(child); // archetype
   }
   if (i != e) {
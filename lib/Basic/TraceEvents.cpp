@@ -0,0 +1,216 @@
+//===--- TraceEvents.cpp - Compilation trace events -----------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Basic/TraceEvents.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace swift;
+
+bool TraceScope::TracingEnabled = false;
+
+namespace {
+  struct TraceEvent {
+    const char *Category;
+    std::string Name;
+    unsigned ThreadID;
+    /// Microseconds since the epoch, so that traces written by different
+    /// processes line up when they are merged.
+    uint64_t Start;
+    uint64_t Duration = 0;
+    bool Ended = false;
+    llvm::SmallVector<std::pair<const char *, uint64_t>, 2> Args;
+  };
+
+  struct TraceLog {
+    std::mutex Lock;
+    std::vector<TraceEvent> Events;
+  };
+}
+
+static TraceLog &getTraceLog() {
+  static TraceLog Log;
+  return Log;
+}
+
+static uint64_t getCurrentMicroseconds() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(
+      system_clock::now().time_since_epoch()).count();
+}
+
+/// Returns a small, stable number for the current thread.
+static unsigned getCurrentThreadID() {
+  static std::atomic<unsigned> NextThreadID{1};
+  static LLVM_THREAD_LOCAL unsigned ThreadID = 0;
+  if (ThreadID == 0)
+    ThreadID = NextThreadID++;
+  return ThreadID;
+}
+
+void TraceScope::begin(const char *category, StringRef name) {
+  TraceEvent event;
+  event.Category = category;
+  event.Name = name.str();
+  event.ThreadID = getCurrentThreadID();
+  event.Start = getCurrentMicroseconds();
+
+  auto &log = getTraceLog();
+  std::lock_guard<std::mutex> guard(log.Lock);
+  Index = log.Events.size();
+  log.Events.push_back(std::move(event));
+}
+
+void TraceScope::begin(
+    const char *category,
+    llvm::function_ref<void(llvm::raw_ostream &)> printName) {
+  llvm::SmallString<64> name;
+  llvm::raw_svector_ostream OS(name);
+  printName(OS);
+  begin(category, OS.str());
+}
+
+void TraceScope::end() {
+  uint64_t now = getCurrentMicroseconds();
+
+  auto &log = getTraceLog();
+  std::lock_guard<std::mutex> guard(log.Lock);
+  auto &event = log.Events[Index];
+  event.Duration = now - event.Start;
+  event.Ended = true;
+}
+
+void TraceScope::addArg(const char *name, uint64_t value) {
+  if (!isRecording())
+    return;
+
+  auto &log = getTraceLog();
+  std::lock_guard<std::mutex> guard(log.Lock);
+  log.Events[Index].Args.push_back({name, value});
+}
+
+static void writeEscapedString(llvm::raw_ostream &OS, StringRef str) {
+  OS << '"';
+  for (unsigned char c : str) {
+    switch (c) {
+    case '"': OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if (c < 0x20)
+        OS << llvm::format("\\u%04x", c);
+      else
+        OS << c;
+    }
+  }
+  OS << '"';
+}
+
+// The files written here have one event per line between a line holding
+// only "[" and a line holding only "]", which mergeTraceEventFiles() relies
+// on to combine them without a JSON parser.
+bool TraceScope::writeTrace(StringRef path, StringRef processName) {
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(path, EC, llvm::sys::fs::F_None);
+  if (EC)
+    return true;
+
+  auto pid = llvm::sys::Process::getProcessId();
+  uint64_t now = getCurrentMicroseconds();
+
+  OS << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":\n[\n";
+  OS << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << pid
+     << ",\"tid\":0,\"args\":{\"name\":";
+  writeEscapedString(OS, processName);
+  OS << "}}";
+
+  auto &log = getTraceLog();
+  std::lock_guard<std::mutex> guard(log.Lock);
+  for (auto &event : log.Events) {
+    uint64_t duration = event.Ended ? event.Duration : now - event.Start;
+    OS << ",\n{\"ph\":\"X\",\"cat\":\"" << event.Category << "\",\"name\":";
+    writeEscapedString(OS, event.Name);
+    OS << ",\"pid\":" << pid << ",\"tid\":" << event.ThreadID
+       << ",\"ts\":" << event.Start << ",\"dur\":" << duration;
+    if (!event.Args.empty()) {
+      OS << ",\"args\":{";
+      bool first = true;
+      for (auto &arg : event.Args) {
+        if (!first)
+          OS << ',';
+        first = false;
+        OS << '"' << arg.first << "\":" << arg.second;
+      }
+      OS << '}';
+    }
+    OS << '}';
+  }
+  OS << "\n]\n}\n";
+
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    return true;
+  }
+  return false;
+}
+
+bool swift::mergeTraceEventFiles(ArrayRef<std::string> inputs,
+                                 StringRef output) {
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(output, EC, llvm::sys::fs::F_None);
+  if (EC)
+    return true;
+
+  OS << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":\n[\n";
+  bool first = true;
+  for (auto &input : inputs) {
+    auto buffer = llvm::MemoryBuffer::getFile(input);
+    if (!buffer)
+      continue;
+
+    // Copy the lines between "[" and "]".
+    StringRef contents = buffer.get()->getBuffer();
+    size_t begin = contents.find("\n[\n");
+    size_t end = contents.rfind("\n]\n");
+    if (begin == StringRef::npos || end == StringRef::npos ||
+        end <= begin + 2)
+      continue;
+    StringRef events = contents.slice(begin + 3, end);
+    if (events.empty())
+      continue;
+
+    if (!first)
+      OS << ",\n";
+    first = false;
+    OS << events;
+  }
+  OS << "\n]\n}\n";
+
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    return true;
+  }
+  return false;
+}
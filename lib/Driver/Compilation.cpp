@@ -17,6 +17,7 @@
 #include "swift/Basic/Fallthrough.h"
 #include "swift/Basic/Program.h"
 #include "swift/Basic/TaskQueue.h"
+#include "swift/Basic/TraceEvents.h"
 #include "swift/Basic/Version.h"
 #include "swift/Basic/type_traits.h"
 #include "swift/Driver/Action.h"
@@ -31,6 +32,7 @@
 #include "llvm/Option/Arg.h"
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/YAMLParser.h"
@@ -83,9 +85,62 @@ namespace {
     ///
     /// Only intended for source files.
     llvm::SmallDenseMap<const Job *, bool, 16> UnfinishedCommands;
+
+    /// Batchable jobs which are ready to run but have not been given to the
+    /// TaskQueue yet.
+    SmallVector<const Job *, 16> PendingBatchCommands;
+
+    /// A group of compile jobs run by a single frontend process.
+    struct Batch {
+      SmallVector<const Job *, 8> Jobs;
+
+      /// The files the frontend writes the diagnostics of each job to.
+      SmallVector<std::string, 8> DiagnosticsPaths;
+
+      /// The arguments of the frontend process, which must stay alive as
+      /// long as the TaskQueue may run it.
+      llvm::opt::ArgStringList Arguments;
+    };
+
+    /// A map from the first job of each batch, which stands for the batch in
+    /// the TaskQueue, to the whole batch.
+    llvm::SmallDenseMap<const Job *, std::unique_ptr<Batch>, 4> Batches;
+
+    /// Returns the jobs run by the task for \p Cmd.
+    SmallVector<const Job *, 8> getJobsRunBy(const Job *Cmd) const {
+      auto Found = Batches.find(Cmd);
+      if (Found == Batches.end())
+        return {Cmd};
+      return Found->second->Jobs;
+    }
+
+    /// Returns the diagnostics the frontend wrote for \p Cmd, if it was run
+    /// as part of the batch that stands for \p TaskCmd in the TaskQueue.
+    std::string getBatchDiagnostics(const Job *Cmd,
+                                    const Job *TaskCmd) const {
+      auto Found = Batches.find(TaskCmd);
+      if (Found == Batches.end())
+        return std::string();
+      const Batch &B = *Found->second;
+      auto Position = std::find(B.Jobs.begin(), B.Jobs.end(), Cmd);
+      assert(Position != B.Jobs.end() && "job is not part of the batch");
+
+      auto Buffer = llvm::MemoryBuffer::getFile(
+          B.DiagnosticsPaths[Position - B.Jobs.begin()]);
+      if (!Buffer)
+        return std::string();
+      return Buffer.get()->getBuffer();
+    }
   };
 }
 
+/// The largest number of jobs run by one frontend process in batch mode.
+///
+/// Batches are kept small enough that a failure or a slow file does not hold
+/// up too much of the build, and that the memory used for the AST of all
+/// their primary files stays reasonable.
+static const size_t MaxBatchSize = 25;
+
 Compilation::~Compilation() = default;
 
 Job *Compilation::addJob(std::unique_ptr<Job> J) {
@@ -215,6 +270,12 @@ static void writeCompilationRecord(StringRef path, StringRef argsHash,
   }
 }
 
+/// Returns the path of the dependency graph summary saved alongside the
+/// compilation record at \p recordPath.
+static std::string getDependencySummaryPath(StringRef recordPath) {
+  return (recordPath + ".depsummary").str();
+}
+
 static bool writeFilelistIfNecessary(const Job *job, DiagnosticEngine &diags) {
   FilelistInfo filelistInfo = job->getFilelistInfo();
   if (filelistInfo.path.empty())
@@ -252,6 +313,48 @@ static bool writeFilelistIfNecessary(const Job *job, DiagnosticEngine &diags) {
   return true;
 }
 
+/// Returns true if \p Cmd can be run in the same frontend process as other
+/// jobs like it.
+static bool isBatchable(const Job *Cmd) {
+  if (!isa<CompileJobAction>(Cmd->getSource()))
+    return false;
+
+  // These are written by diagnostic consumers, which would see the
+  // diagnostics of the whole batch.
+  const CommandOutput &Output = Cmd->getOutput();
+  return Output.getAdditionalOutputForType(
+             types::TY_SerializedDiagnostics).empty() &&
+         Output.getAdditionalOutputForType(types::TY_Remapping).empty();
+}
+
+/// Writes the frontend arguments of each job in \p Batch to \p path, as a
+/// YAML sequence of sequences, for -batch-jobs-file. Each job is told to
+/// write its diagnostics to its entry in \p DiagnosticsPaths.
+static bool writeBatchJobsFile(StringRef path, ArrayRef<const Job *> Batch,
+                               ArrayRef<std::string> DiagnosticsPaths,
+                               DiagnosticEngine &diags) {
+  std::error_code error;
+  llvm::raw_fd_ostream out(path, error, llvm::sys::fs::F_None);
+  if (error) {
+    diags.diagnose(SourceLoc(), diag::error_unable_to_make_temporary_file,
+                   error.message());
+    return false;
+  }
+
+  for (size_t i = 0, e = Batch.size(); i != e; ++i) {
+    auto Args = llvm::makeArrayRef(Batch[i]->getArguments());
+    assert(!Args.empty() && StringRef(Args.front()) == "-frontend" &&
+           "only frontend jobs can be batched");
+    out << "- [";
+    for (const char *Arg : Args.slice(1))
+      out << '"' << llvm::yaml::escape(Arg) << "\", ";
+    out << "\"-batch-diagnostics-output\", \""
+        << llvm::yaml::escape(DiagnosticsPaths[i]) << "\"]\n";
+  }
+
+  return true;
+}
+
 int Compilation::performJobsImpl() {
   // Create a TaskQueue for execution.
   std::unique_ptr<TaskQueue> TQ;
@@ -259,6 +362,7 @@ int Compilation::performJobsImpl() {
     TQ.reset(new DummyTaskQueue(NumberOfParallelCommands));
   else
     TQ.reset(new TaskQueue(NumberOfParallelCommands));
+  TQ->setMemoryLimitPerTask(JobMemoryLimit);
 
   PerformJobsState State;
 
@@ -307,10 +411,84 @@ int Compilation::performJobsImpl() {
     assert(Cmd->getExtraEnvironment().empty() &&
            "not implemented for compilations with multiple jobs");
     State.ScheduledCommands.insert(Cmd);
+    if (BatchModeEnabled && isBatchable(Cmd)) {
+      State.PendingBatchCommands.push_back(Cmd);
+      return;
+    }
     TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
                 (void *)Cmd);
   };
 
+  // Gives the pending batchable jobs to the TaskQueue. They are split into
+  // as many batches as there are parallel slots, so that a handful of jobs
+  // still run in parallel while many jobs share the cost of importing
+  // modules.
+  auto schedulePendingBatchCommands = [&] {
+    auto &Pending = State.PendingBatchCommands;
+    if (Pending.empty())
+      return;
+
+    size_t NumBatches = std::max(NumberOfParallelCommands, 1U);
+    size_t BatchSize = (Pending.size() + NumBatches - 1) / NumBatches;
+    BatchSize = std::min(BatchSize, MaxBatchSize);
+
+    for (size_t Start = 0; Start < Pending.size(); Start += BatchSize) {
+      auto Jobs = llvm::makeArrayRef(Pending).slice(
+          Start, std::min(BatchSize, Pending.size() - Start));
+      const Job *First = Jobs.front();
+
+      std::unique_ptr<PerformJobsState::Batch> B(new PerformJobsState::Batch);
+      B->Jobs.append(Jobs.begin(), Jobs.end());
+
+      auto makeTemporaryFile = [&](StringRef Prefix, StringRef Suffix,
+                                   SmallString<128> &Path) -> bool {
+        std::error_code EC =
+            llvm::sys::fs::createTemporaryFile(Prefix, Suffix, Path);
+        if (EC) {
+          Diags.diagnose(SourceLoc(),
+                         diag::error_unable_to_make_temporary_file,
+                         EC.message());
+          Path.clear();
+          return false;
+        }
+        addTemporaryFile(Path);
+        return true;
+      };
+
+      SmallString<128> Path;
+      if (Jobs.size() > 1) {
+        // Each job's diagnostics are written to a file of their own, so that
+        // they can be reported as that job's output.
+        for (size_t i = 0, e = Jobs.size(); i != e; ++i) {
+          SmallString<128> DiagnosticsPath;
+          if (!makeTemporaryFile("batch-diagnostics", "txt", DiagnosticsPath))
+            break;
+          B->DiagnosticsPaths.push_back(DiagnosticsPath.str());
+        }
+        if (B->DiagnosticsPaths.size() == Jobs.size() &&
+            makeTemporaryFile("batch", "yaml", Path) &&
+            !writeBatchJobsFile(Path, Jobs, B->DiagnosticsPaths, Diags))
+          Path.clear();
+      }
+
+      // Run the jobs one by one if they can't be batched.
+      if (Path.empty()) {
+        for (const Job *Cmd : Jobs)
+          TQ->addTask(Cmd->getExecutable(), Cmd->getArguments(), llvm::None,
+                      (void *)Cmd);
+        continue;
+      }
+
+      B->Arguments.push_back("-frontend");
+      B->Arguments.push_back("-batch-jobs-file");
+      B->Arguments.push_back(getArgs().MakeArgString(Path));
+      TQ->addTask(First->getExecutable(), B->Arguments, llvm::None,
+                  (void *)First);
+      State.Batches[First] = std::move(B);
+    }
+    Pending.clear();
+  };
+
   // When a task finishes, we need to reevaluate the other commands that
   // might have been blocked.
   auto markFinished = [&] (const Job *Cmd) {
@@ -325,6 +503,11 @@ int Compilation::performJobsImpl() {
     }
   };
 
+  // Reuse the dependency information parsed during the last build for any
+  // swiftdeps files that haven't changed since.
+  if (getIncrementalBuildEnabled() && !CompilationRecordPath.empty())
+    DepGraph.loadSummaryCache(getDependencySummaryPath(CompilationRecordPath));
+
   // Schedule all jobs we can.
   for (const Job *Cmd : getJobs()) {
     if (!getIncrementalBuildEnabled()) {
@@ -420,20 +603,34 @@ int Compilation::performJobsImpl() {
     }
   }
 
+  schedulePendingBatchCommands();
+
   int Result = EXIT_SUCCESS;
 
   // Set up a callback which will be called immediately after a task has
   // started. This callback may be used to provide output indicating that the
   // task began.
-  auto taskBegan = [this] (ProcessId Pid, void *Context) {
+  auto taskBegan = [&] (ProcessId Pid, void *Context) {
     // TODO: properly handle task began.
     const Job *BeganCmd = (const Job *)Context;
 
     // For verbose output, print out each command as it begins execution.
-    if (Level == OutputLevel::Verbose)
-      BeganCmd->printCommandLine(llvm::errs());
-    else if (Level == OutputLevel::Parseable)
-      parseable_output::emitBeganMessage(llvm::errs(), *BeganCmd, Pid);
+    if (Level == OutputLevel::Verbose) {
+      auto Found = State.Batches.find(BeganCmd);
+      if (Found == State.Batches.end()) {
+        BeganCmd->printCommandLine(llvm::errs());
+      } else {
+        llvm::opt::ArgStringList CommandLine;
+        CommandLine.push_back(BeganCmd->getExecutable());
+        CommandLine.append(Found->second->Arguments.begin(),
+                           Found->second->Arguments.end());
+        Job::printArguments(llvm::errs(), CommandLine);
+        llvm::errs() << "\n";
+      }
+    } else if (Level == OutputLevel::Parseable) {
+      for (const Job *Cmd : State.getJobsRunBy(BeganCmd))
+        parseable_output::emitBeganMessage(llvm::errs(), *Cmd, Pid);
+    }
   };
 
   // Set up a callback which will be called immediately after a task has
@@ -442,15 +639,28 @@ int Compilation::performJobsImpl() {
   // it should also schedule any additional commands which we now know need
   // to run.
   auto taskFinished = [&] (ProcessId Pid, int ReturnCode, StringRef Output,
-                           void *Context) -> TaskFinishedResponse {
+                           void *Context, Optional<TaskResourceUsage> Usage)
+      -> TaskFinishedResponse {
     const Job *FinishedCmd = (const Job *)Context;
+    auto FinishedCmds = State.getJobsRunBy(FinishedCmd);
 
     if (Level == OutputLevel::Parseable) {
-      // Parseable output was requested.
-      parseable_output::emitFinishedMessage(llvm::errs(), *FinishedCmd, Pid,
-                                            ReturnCode, Output);
+      // Parseable output was requested. Each job of a batch reports its own
+      // diagnostics; anything else the batch printed is attributed to its
+      // first job.
+      for (const Job *Cmd : FinishedCmds) {
+        std::string CmdOutput = State.getBatchDiagnostics(Cmd, FinishedCmd);
+        if (Cmd == FinishedCmd)
+          CmdOutput += Output;
+        parseable_output::emitFinishedMessage(llvm::errs(), *Cmd, Pid,
+                                              ReturnCode, CmdOutput, Usage);
+      }
     } else {
-      // Otherwise, send the buffered output to stderr, though only if we
+      // Otherwise, print the diagnostics of each job of a batch...
+      for (const Job *Cmd : FinishedCmds)
+        llvm::errs() << State.getBatchDiagnostics(Cmd, FinishedCmd);
+
+      // ...and send the buffered output to stderr, though only if we
       // support getting buffered output.
       if (TaskQueue::supportsBufferingOutput())
         llvm::errs() << Output;
@@ -477,58 +687,72 @@ int Compilation::performJobsImpl() {
           TaskFinishedResponse::StopExecution;
     }
 
-    // When a task finishes, we need to reevaluate the other commands that
-    // might have been blocked.
-    markFinished(FinishedCmd);
-
-    // In order to handle both old dependencies that have disappeared and new
-    // dependencies that have arisen, we need to reload the dependency file.
-    if (getIncrementalBuildEnabled()) {
-      const CommandOutput &Output = FinishedCmd->getOutput();
-      StringRef DependenciesFile =
-        Output.getAdditionalOutputForType(types::TY_SwiftDeps);
-      if (!DependenciesFile.empty()) {
-        SmallVector<const Job *, 16> Dependents;
-        bool wasCascading = DepGraph.isMarked(FinishedCmd);
-
-        switch (DepGraph.loadFromPath(FinishedCmd, DependenciesFile)) {
-        case DependencyGraphImpl::LoadResult::HadError:
-          disableIncrementalBuild();
-          for (const Job *Cmd : DeferredCommands)
-            scheduleCommandIfNecessaryAndPossible(Cmd);
-          DeferredCommands.clear();
-          Dependents.clear();
-          break;
-        case DependencyGraphImpl::LoadResult::UpToDate:
-          if (!wasCascading)
+    for (const Job *FinishedCmd : FinishedCmds) {
+      // When a task finishes, we need to reevaluate the other commands that
+      // might have been blocked.
+      markFinished(FinishedCmd);
+
+      // In order to handle both old dependencies that have disappeared and new
+      // dependencies that have arisen, we need to reload the dependency file.
+      if (getIncrementalBuildEnabled()) {
+        const CommandOutput &Output = FinishedCmd->getOutput();
+        StringRef DependenciesFile =
+          Output.getAdditionalOutputForType(types::TY_SwiftDeps);
+        if (!DependenciesFile.empty()) {
+          SmallVector<const Job *, 16> Dependents;
+          bool wasCascading = DepGraph.isMarked(FinishedCmd);
+
+          switch (DepGraph.loadFromPath(FinishedCmd, DependenciesFile)) {
+          case DependencyGraphImpl::LoadResult::HadError:
+            disableIncrementalBuild();
+            for (const Job *Cmd : DeferredCommands)
+              scheduleCommandIfNecessaryAndPossible(Cmd);
+            DeferredCommands.clear();
+            Dependents.clear();
             break;
-          SWIFT_FALLTHROUGH;
-        case DependencyGraphImpl::LoadResult::AffectsDownstream:
-          DepGraph.markTransitive(Dependents, FinishedCmd);
-          break;
-        }
+          case DependencyGraphImpl::LoadResult::UpToDate:
+            if (!wasCascading)
+              break;
+            SWIFT_FALLTHROUGH;
+          case DependencyGraphImpl::LoadResult::AffectsDownstream:
+            DepGraph.markTransitive(Dependents, FinishedCmd);
+            break;
+          }
 
-        for (const Job *Cmd : Dependents) {
-          DeferredCommands.erase(Cmd);
-          noteBuilding(Cmd, "because of dependencies discovered later");
-          scheduleCommandIfNecessaryAndPossible(Cmd);
+          for (const Job *Cmd : Dependents) {
+            DeferredCommands.erase(Cmd);
+            noteBuilding(Cmd, "because of dependencies discovered later");
+            scheduleCommandIfNecessaryAndPossible(Cmd);
+          }
         }
       }
     }
 
+    schedulePendingBatchCommands();
+
     return TaskFinishedResponse::ContinueExecution;
   };
 
   auto taskSignalled = [&] (ProcessId Pid, StringRef ErrorMsg, StringRef Output,
-                            void *Context) -> TaskFinishedResponse {
+                            void *Context, Optional<TaskResourceUsage> Usage)
+      -> TaskFinishedResponse {
     const Job *SignalledCmd = (const Job *)Context;
 
     if (Level == OutputLevel::Parseable) {
       // Parseable output was requested.
-      parseable_output::emitSignalledMessage(llvm::errs(), *SignalledCmd, Pid,
-                                             ErrorMsg, Output);
+      for (const Job *Cmd : State.getJobsRunBy(SignalledCmd)) {
+        std::string CmdOutput = State.getBatchDiagnostics(Cmd, SignalledCmd);
+        if (Cmd == SignalledCmd)
+          CmdOutput += Output;
+        parseable_output::emitSignalledMessage(llvm::errs(), *Cmd, Pid,
+                                               ErrorMsg, CmdOutput, Usage);
+      }
     } else {
-      // Otherwise, send the buffered output to stderr, though only if we
+      // Otherwise, print the diagnostics of each job of a batch...
+      for (const Job *Cmd : State.getJobsRunBy(SignalledCmd))
+        llvm::errs() << State.getBatchDiagnostics(Cmd, SignalledCmd);
+
+      // ...and send the buffered output to stderr, though only if we
       // support getting buffered output.
       if (TaskQueue::supportsBufferingOutput())
         llvm::errs() << Output;
@@ -562,6 +786,7 @@ int Compilation::performJobsImpl() {
       State.ScheduledCommands.insert(Cmd);
       markFinished(Cmd);
     }
+    schedulePendingBatchCommands();
 
     // ...which may allow us to go on and do later tasks.
   } while (Result == 0 && TQ->hasRemainingTasks());
@@ -597,6 +822,11 @@ int Compilation::performJobsImpl() {
     checkForOutOfDateInputs(Diags, InputInfo);
     writeCompilationRecord(CompilationRecordPath, ArgsHash, BuildStartTime,
                            InputInfo);
+    if (getIncrementalBuildEnabled()) {
+      // FIXME: How should we report this error?
+      (void)DepGraph.writeSummaryCache(
+          getDependencySummaryPath(CompilationRecordPath));
+    }
   }
 
   if (Result == 0)
@@ -676,6 +906,24 @@ int Compilation::performJobs() {
   
   int result = performJobsImpl();
 
+  // Combine the timelines of the individual jobs. Jobs that did not run,
+  // e.g. because an incremental build skipped them, did not write one.
+  if (!TraceEventsOutputPath.empty()) {
+    SmallVector<std::string, 16> TracePaths;
+    for (auto &Cmd : Jobs) {
+      const std::string &Path =
+          Cmd->getOutput().getAdditionalOutputForType(types::TY_TraceEvents);
+      if (!Path.empty())
+        TracePaths.push_back(Path);
+    }
+    if (mergeTraceEventFiles(TracePaths, TraceEventsOutputPath)) {
+      Diags.diagnose(SourceLoc(), diag::error_opening_output,
+                     TraceEventsOutputPath, "could not write trace events");
+      if (result == EXIT_SUCCESS)
+        result = EXIT_FAILURE;
+    }
+  }
+
   if (!SaveTemps) {
     // FIXME: Do we want to be deleting temporaries even when a child process
     // crashes?
@@ -16,6 +16,9 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
@@ -46,14 +49,79 @@ DependencyGraphImpl::MarkTracerImpl::~MarkTracerImpl() = default;
 
 using LoadResult = DependencyGraphImpl::LoadResult;
 using DependencyKind = DependencyGraphImpl::DependencyKind;
-using DependencyCallbackTy = LoadResult(StringRef, DependencyKind, bool);
-using InterfaceHashCallbackTy = LoadResult(StringRef);
 
+using FileSummary = DependencyGraphImpl::FileSummary;
+
+/// The contents of one dependency file, independent of the node it was
+/// loaded for.
+///
+/// Strings refer either into a memory-mapped summary cache or into storage
+/// owned by the graph.
+struct DependencyGraphImpl::FileSummary {
+  /// A single "provides" or "depends" entry.
+  struct Entry {
+    StringRef Name;
+    DependencyKind Kind;
+    bool IsProvides;
+    bool IsCascading;
+  };
+
+  uint64_t Size = 0;
+  uint64_t ModSeconds = 0;
+  uint32_t ModNanoseconds = 0;
+  bool HasInterfaceHash = false;
+  StringRef InterfaceHash;
+  std::vector<Entry> Entries;
+
+  /// Whether this summary was loaded during the current build, and so should
+  /// be written back out.
+  bool WasUsed = false;
+
+  bool matches(const llvm::sys::fs::file_status &status) const {
+    llvm::sys::TimeValue modTime = status.getLastModificationTime();
+    return Size == status.getSize() &&
+           ModSeconds == static_cast<uint64_t>(modTime.seconds()) &&
+           ModNanoseconds == static_cast<uint32_t>(modTime.nanoseconds());
+  }
+
+  void setStatus(const llvm::sys::fs::file_status &status) {
+    llvm::sys::TimeValue modTime = status.getLastModificationTime();
+    Size = status.getSize();
+    ModSeconds = modTime.seconds();
+    ModNanoseconds = modTime.nanoseconds();
+  }
+};
+
+class DependencyGraphImpl::SummaryCache {
+public:
+  /// The memory-mapped summary read by loadSummaryCache, if any.
+  std::unique_ptr<llvm::MemoryBuffer> Buffer;
+
+  /// Storage for strings from dependency files parsed during this build.
+  llvm::BumpPtrAllocator Allocator;
+
+  llvm::StringMap<FileSummary> Files;
+
+  StringRef copyString(StringRef str) {
+    if (str.empty())
+      return StringRef();
+    char *mem = Allocator.Allocate<char>(str.size());
+    memcpy(mem, str.data(), str.size());
+    return StringRef(mem, str.size());
+  }
+};
+
+DependencyGraphImpl::DependencyGraphImpl() : Summaries(new SummaryCache()) {}
+DependencyGraphImpl::~DependencyGraphImpl() = default;
+
+/// Parses a YAML dependency file into \p summary.
+///
+/// Returns either LoadResult::HadError or LoadResult::UpToDate; whether the
+/// file affects anything downstream depends on the graph it is applied to.
 static LoadResult
 parseDependencyFile(llvm::MemoryBuffer &buffer,
-                    llvm::function_ref<DependencyCallbackTy> providesCallback,
-                    llvm::function_ref<DependencyCallbackTy> dependsCallback,
-                    llvm::function_ref<InterfaceHashCallbackTy> interfaceHashCallback) {
+                    FileSummary &summary,
+                    llvm::function_ref<StringRef(StringRef)> copyString) {
   namespace yaml = llvm::yaml;
 
   // FIXME: Switch to a format other than YAML.
@@ -70,22 +138,8 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
     return LoadResult::HadError;
   }
 
-  LoadResult result = LoadResult::UpToDate;
   SmallString<64> scratch;
 
-  // After an entry, we know more about the node as a whole.
-  // Update the "result" variable above.
-  // This is a macro rather than a lambda because it contains a return.
-#define UPDATE_RESULT(update) switch (update) {\
-    case LoadResult::HadError: \
-      return LoadResult::HadError; \
-    case LoadResult::UpToDate: \
-      break; \
-    case LoadResult::AffectsDownstream: \
-      result = LoadResult::AffectsDownstream; \
-      break; \
-    } \
-
   // FIXME: LLVM's YAML support does incremental parsing in such a way that
   // for-range loops break.
   for (auto i = topLevelMap->begin(), e = topLevelMap->end(); i != e; ++i) {
@@ -102,8 +156,8 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
       if (!value)
         return LoadResult::HadError;
 
-      StringRef valueString = value->getValue(scratch);
-      UPDATE_RESULT(interfaceHashCallback(valueString));
+      summary.HasInterfaceHash = true;
+      summary.InterfaceHash = copyString(value->getValue(scratch));
 
     } else {
       enum class DependencyDirection : bool {
@@ -149,6 +203,8 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
       if (!entries)
         return LoadResult::HadError;
 
+      bool isProvides = dirAndKind.second == DependencyDirection::Provides;
+
       if (dirAndKind.first == DependencyKind::NominalTypeMember) {
         // Handle member dependencies specially. Rather than being a single
         // string, they come in the form ["{MangledBaseName}", "memberName"].
@@ -174,9 +230,6 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
           // iterators.
           assert(!(iter != entry->end()));
 
-          bool isDepends = dirAndKind.second == DependencyDirection::Depends;
-          auto &callback = isDepends ? dependsCallback : providesCallback;
-
           // Smash the type and member names together so we can continue using
           // StringMap.
           SmallString<64> appended;
@@ -184,8 +237,9 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
           appended.push_back('\0');
           appended += member->getValue(scratch);
 
-          UPDATE_RESULT(callback(appended.str(), dirAndKind.first,
-                                 isCascading));
+          summary.Entries.push_back({copyString(appended.str()),
+                                     dirAndKind.first, isProvides,
+                                     isCascading});
         }
       } else {
         for (const yaml::Node &rawEntry : *entries) {
@@ -193,24 +247,52 @@ parseDependencyFile(llvm::MemoryBuffer &buffer,
           if (!entry)
             return LoadResult::HadError;
 
-          bool isDepends = dirAndKind.second == DependencyDirection::Depends;
-          auto &callback = isDepends ? dependsCallback : providesCallback;
-
-          UPDATE_RESULT(callback(entry->getValue(scratch), dirAndKind.first,
-                                 entry->getRawTag() != "!private"));
+          summary.Entries.push_back({copyString(entry->getValue(scratch)),
+                                     dirAndKind.first, isProvides,
+                                     entry->getRawTag() != "!private"});
         }
       }
     }
   }
 
-  return result;
+  return LoadResult::UpToDate;
 }
 
 LoadResult DependencyGraphImpl::loadFromPath(const void *node, StringRef path) {
+  // Stat the file before reading it, so that a change made while we read it
+  // shows up as a mismatch next time rather than being missed.
+  llvm::sys::fs::file_status status;
+  if (llvm::sys::fs::status(path, status))
+    return LoadResult::HadError;
+
+  // A file loaded a second time in the same build was rewritten by a job that
+  // just finished; always reparse it.
+  auto &summary = Summaries->Files[path];
+  if (!summary.WasUsed && summary.matches(status)) {
+    summary.WasUsed = true;
+    return loadFromSummary(node, summary);
+  }
+
   auto buffer = llvm::MemoryBuffer::getFile(path);
-  if (!buffer)
+  if (!buffer) {
+    Summaries->Files.erase(path);
     return LoadResult::HadError;
-  return loadFromBuffer(node, *buffer.get());
+  }
+
+  FileSummary newSummary;
+  newSummary.setStatus(status);
+  auto copyString = [this](StringRef str) {
+    return Summaries->copyString(str);
+  };
+  if (parseDependencyFile(*buffer.get(), newSummary, copyString) ==
+        LoadResult::HadError) {
+    Summaries->Files.erase(path);
+    return LoadResult::HadError;
+  }
+
+  newSummary.WasUsed = true;
+  summary = std::move(newSummary);
+  return loadFromSummary(node, summary);
 }
 
 LoadResult
@@ -221,6 +303,24 @@ DependencyGraphImpl::loadFromString(const void *node, StringRef data) {
 
 LoadResult DependencyGraphImpl::loadFromBuffer(const void *node,
                                                llvm::MemoryBuffer &buffer) {
+  // The graph copies everything it keeps, so the strings only need to live
+  // until the summary has been applied.
+  llvm::BumpPtrAllocator scratchAlloc;
+  auto copyString = [&scratchAlloc](StringRef str) -> StringRef {
+    char *mem = scratchAlloc.Allocate<char>(str.size());
+    memcpy(mem, str.data(), str.size());
+    return StringRef(mem, str.size());
+  };
+
+  FileSummary summary;
+  if (parseDependencyFile(buffer, summary, copyString) == LoadResult::HadError)
+    return LoadResult::HadError;
+  return loadFromSummary(node, summary);
+}
+
+LoadResult
+DependencyGraphImpl::loadFromSummary(const void *node,
+                                     const FileSummary &summary) {
   auto &provides = Provides[node];
 
   auto dependsCallback = [this, node](StringRef name, DependencyKind kind,
@@ -251,8 +351,8 @@ LoadResult DependencyGraphImpl::loadFromBuffer(const void *node,
   };
 
   auto providesCallback =
-      [this, node, &provides](StringRef name, DependencyKind kind,
-                              bool isCascading) -> LoadResult {
+      [&provides](StringRef name, DependencyKind kind,
+                  bool isCascading) -> LoadResult {
     assert(isCascading);
     auto iter = std::find_if(provides.begin(), provides.end(),
                              [name](const ProvidesEntryTy &entry) -> bool {
@@ -285,8 +385,254 @@ LoadResult DependencyGraphImpl::loadFromBuffer(const void *node,
     return LoadResult::UpToDate;
   };
 
-  return parseDependencyFile(buffer, providesCallback, dependsCallback,
-                             interfaceHashCallback);
+  LoadResult result = LoadResult::UpToDate;
+
+  // After an entry, we know more about the node as a whole.
+  // Update the "result" variable above.
+  // This is a macro rather than a lambda because it contains a return.
+#define UPDATE_RESULT(update) switch (update) {\
+    case LoadResult::HadError: \
+      return LoadResult::HadError; \
+    case LoadResult::UpToDate: \
+      break; \
+    case LoadResult::AffectsDownstream: \
+      result = LoadResult::AffectsDownstream; \
+      break; \
+    } \
+
+  if (summary.HasInterfaceHash)
+    UPDATE_RESULT(interfaceHashCallback(summary.InterfaceHash));
+
+  for (const FileSummary::Entry &entry : summary.Entries) {
+    if (entry.IsProvides) {
+      UPDATE_RESULT(providesCallback(entry.Name, entry.Kind,
+                                     entry.IsCascading));
+    } else {
+      UPDATE_RESULT(dependsCallback(entry.Name, entry.Kind,
+                                    entry.IsCascading));
+    }
+  }
+
+#undef UPDATE_RESULT
+
+  return result;
+}
+
+//===----------------------------------------------------------------------===//
+// Summary cache serialization
+//===----------------------------------------------------------------------===//
+//
+// The summary cache is a flat little-endian file:
+//
+//   magic        "SDGS"
+//   version      u32
+//   write time   u64 seconds since the epoch
+//   file count   u32
+//   files...
+//
+// Each file is:
+//
+//   path length, size, mod seconds, mod nanoseconds,
+//   hash length (~0 if the file has no interface hash), entry count
+//                u32, u64, u64, u32, u32, u32
+//   path bytes, hash bytes
+//   entries...
+//
+// and each entry is a u8 DependencyKind, a u8 of SummaryEntryFlags, a u32
+// name length, and the name bytes. Strings are not NUL-terminated, and member
+// names contain an embedded NUL.
+
+static const char SummaryCacheMagic[4] = {'S', 'D', 'G', 'S'};
+static const uint32_t SummaryCacheVersion = 1;
+static const uint32_t NoInterfaceHash = ~0U;
+
+enum SummaryEntryFlags : uint8_t {
+  IsProvidesEntry = 1 << 0,
+  IsCascadingEntry = 1 << 1,
+};
+
+namespace {
+/// A bounds-checked cursor over a summary cache buffer.
+class SummaryReader {
+  const char *Ptr;
+  const char *End;
+  bool Failed = false;
+
+  bool ensure(size_t bytes) {
+    if (Failed || static_cast<size_t>(End - Ptr) < bytes)
+      Failed = true;
+    return !Failed;
+  }
+
+public:
+  explicit SummaryReader(StringRef data)
+    : Ptr(data.begin()), End(data.end()) {}
+
+  bool hadError() const { return Failed; }
+  bool atEnd() const { return Ptr == End; }
+
+  template <typename T>
+  T read() {
+    using namespace llvm::support;
+    if (!ensure(sizeof(T)))
+      return T();
+    return endian::readNext<T, little, unaligned>(Ptr);
+  }
+
+  StringRef readString(size_t length) {
+    if (!ensure(length))
+      return StringRef();
+    StringRef result(Ptr, length);
+    Ptr += length;
+    return result;
+  }
+};
+} // end anonymous namespace
+
+static bool isValidSummaryKind(uint8_t rawKind) {
+  switch (static_cast<DependencyKind>(rawKind)) {
+  case DependencyKind::TopLevelName:
+  case DependencyKind::DynamicLookupName:
+  case DependencyKind::NominalType:
+  case DependencyKind::NominalTypeMember:
+  case DependencyKind::ExternalFile:
+    return true;
+  }
+  return false;
+}
+
+bool DependencyGraphImpl::loadSummaryCache(StringRef path) {
+  // Large summaries are memory-mapped, so loading one costs little more than
+  // walking its entries.
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (!buffer)
+    return false;
+
+  SummaryReader reader(buffer.get()->getBuffer());
+  if (reader.readString(sizeof(SummaryCacheMagic)) !=
+        StringRef(SummaryCacheMagic, sizeof(SummaryCacheMagic)))
+    return false;
+  if (reader.read<uint32_t>() != SummaryCacheVersion)
+    return false;
+
+  // A dependency file modified in the same second the summary was written
+  // might be modified again without its size or timestamp changing, if the
+  // file system only records whole seconds. Don't trust those entries.
+  uint64_t writeSeconds = reader.read<uint64_t>();
+
+  llvm::StringMap<FileSummary> files;
+  uint32_t fileCount = reader.read<uint32_t>();
+  for (uint32_t i = 0; i < fileCount && !reader.hadError(); ++i) {
+    FileSummary summary;
+    uint32_t pathLength = reader.read<uint32_t>();
+    summary.Size = reader.read<uint64_t>();
+    summary.ModSeconds = reader.read<uint64_t>();
+    summary.ModNanoseconds = reader.read<uint32_t>();
+    uint32_t hashLength = reader.read<uint32_t>();
+    uint32_t entryCount = reader.read<uint32_t>();
+    StringRef filePath = reader.readString(pathLength);
+    if (hashLength != NoInterfaceHash) {
+      summary.HasInterfaceHash = true;
+      summary.InterfaceHash = reader.readString(hashLength);
+    }
+
+    summary.Entries.reserve(std::min<uint32_t>(entryCount, 1 << 16));
+    for (uint32_t j = 0; j < entryCount && !reader.hadError(); ++j) {
+      uint8_t rawKind = reader.read<uint8_t>();
+      uint8_t flags = reader.read<uint8_t>();
+      StringRef name = reader.readString(reader.read<uint32_t>());
+      if (!isValidSummaryKind(rawKind))
+        return false;
+      summary.Entries.push_back({name, static_cast<DependencyKind>(rawKind),
+                                 (flags & IsProvidesEntry) != 0,
+                                 (flags & IsCascadingEntry) != 0});
+    }
+
+    if (summary.ModSeconds >= writeSeconds)
+      continue;
+    files[filePath] = std::move(summary);
+  }
+
+  if (reader.hadError() || !reader.atEnd())
+    return false;
+
+  // Don't replace anything already loaded during this build.
+  for (auto &entry : files)
+    Summaries->Files.insert(std::make_pair(entry.getKey(),
+                                           std::move(entry.getValue())));
+  Summaries->Buffer = std::move(buffer.get());
+  return true;
+}
+
+bool DependencyGraphImpl::writeSummaryCache(StringRef path) const {
+  // Write to a temporary file and rename it into place. The summary from the
+  // previous build may still be mapped into memory, and truncating it would
+  // pull strings out from under us.
+  SmallString<128> tempPath;
+  int fd;
+  if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%%%", fd, tempPath))
+    return false;
+
+  {
+    using namespace llvm::support;
+    llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+    endian::Writer<little> writer(out);
+
+    uint32_t fileCount = 0;
+    for (auto &entry : Summaries->Files)
+      if (entry.getValue().WasUsed)
+        ++fileCount;
+
+    out.write(SummaryCacheMagic, sizeof(SummaryCacheMagic));
+    writer.write<uint32_t>(SummaryCacheVersion);
+    writer.write<uint64_t>(llvm::sys::TimeValue::now().seconds());
+    writer.write<uint32_t>(fileCount);
+
+    for (auto &entry : Summaries->Files) {
+      const FileSummary &summary = entry.getValue();
+      if (!summary.WasUsed)
+        continue;
+
+      writer.write<uint32_t>(entry.getKey().size());
+      writer.write<uint64_t>(summary.Size);
+      writer.write<uint64_t>(summary.ModSeconds);
+      writer.write<uint32_t>(summary.ModNanoseconds);
+      if (summary.HasInterfaceHash)
+        writer.write<uint32_t>(summary.InterfaceHash.size());
+      else
+        writer.write<uint32_t>(NoInterfaceHash);
+      writer.write<uint32_t>(summary.Entries.size());
+      out << entry.getKey();
+      if (summary.HasInterfaceHash)
+        out << summary.InterfaceHash;
+
+      for (const FileSummary::Entry &dep : summary.Entries) {
+        uint8_t flags = 0;
+        if (dep.IsProvides)
+          flags |= IsProvidesEntry;
+        if (dep.IsCascading)
+          flags |= IsCascadingEntry;
+        writer.write<uint8_t>(static_cast<uint8_t>(dep.Kind));
+        writer.write<uint8_t>(flags);
+        writer.write<uint32_t>(dep.Name.size());
+        out << dep.Name;
+      }
+    }
+
+    out.close();
+    if (out.has_error()) {
+      out.clear_error();
+      llvm::sys::fs::remove(tempPath);
+      return false;
+    }
+  }
+
+  if (llvm::sys::fs::rename(tempPath, path)) {
+    llvm::sys::fs::remove(tempPath);
+    return false;
+  }
+  return true;
 }
 
 void DependencyGraphImpl::markExternal(SmallVectorImpl<const void *> &visited,
@@ -53,6 +53,7 @@
 #include "llvm/Support/raw_ostream.h"
 
 #include <memory>
+#include <thread>
 
 using namespace swift;
 using namespace swift::driver;
@@ -472,6 +473,10 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
     return nullptr;
   }
 
+  // Batch mode only applies to compiling files one primary at a time.
+  bool BatchMode = ArgList->hasArg(options::OPT_enable_batch_mode) &&
+                   OI.CompilerMode == OutputInfo::Mode::StandardCompile;
+
   unsigned NumberOfParallelCommands = 1;
   if (const Arg *A = ArgList->getLastArg(options::OPT_j)) {
     if (StringRef(A->getValue()).getAsInteger(10, NumberOfParallelCommands)) {
@@ -479,6 +484,19 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
                      A->getAsString(*ArgList), A->getValue());
       return nullptr;
     }
+  } else if (BatchMode) {
+    // Batches are sized to keep every core busy.
+    NumberOfParallelCommands =
+        std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  unsigned JobMemoryLimitMB = 0;
+  if (const Arg *A = ArgList->getLastArg(options::OPT_driver_job_memory_limit)) {
+    if (StringRef(A->getValue()).getAsInteger(10, JobMemoryLimitMB)) {
+      Diags.diagnose(SourceLoc(), diag::error_invalid_arg_value,
+                     A->getAsString(*ArgList), A->getValue());
+      return nullptr;
+    }
   }
 
   OutputLevel Level = OutputLevel::Normal;
@@ -502,6 +520,11 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
                                                  DriverSkipExecution,
                                                  SaveTemps));
 
+  C->setJobMemoryLimit(uint64_t(JobMemoryLimitMB) << 20);
+
+  if (BatchMode)
+    C->setBatchModeEnabled();
+
   buildJobs(Actions, OI, OFM.get(), *TC, *C);
 
   // For updating code we need to go through all the files and pick up changes,
@@ -514,6 +537,9 @@ std::unique_ptr<Compilation> Driver::buildCompilation(
   if (ShowIncrementalBuildDecisions)
     C->setShowsIncrementalBuildDecisions();
 
+  if (const Arg *A = C->getArgs().getLastArg(options::OPT_trace_events_output))
+    C->setTraceEventsOutputPath(A->getValue());
+
   // This has to happen after building jobs, because otherwise we won't even
   // emit .swiftdeps files for the next build.
   if (rebuildEverything)
@@ -1068,7 +1094,9 @@ void Driver::buildOutputInfo(const ToolChain &TC, const DerivedArgList &Args,
                         [&OI](sys::ProcessId PID,
                               int returnCode,
                               StringRef output,
-                              void *unused) -> sys::TaskFinishedResponse {
+                              void *unused,
+                              Optional<sys::TaskResourceUsage> usage)
+                            -> sys::TaskFinishedResponse {
             if (returnCode == 0) {
               output = output.rtrim();
               auto lastLineStart = output.find_last_of("\n\r");
@@ -1183,6 +1211,7 @@ void Driver::buildActions(const ToolChain &TC,
       case types::TY_LLVM_IR:
       case types::TY_LLVM_BC:
       case types::TY_SerializedDiagnostics:
+      case types::TY_TraceEvents:
       case types::TY_ObjCHeader:
       case types::TY_ClangModuleFile:
       case types::TY_SwiftDeps:
@@ -1827,6 +1856,23 @@ Job *Driver::buildJobsForAction(Compilation &C, const JobAction *JA,
         llvm::sys::fs::remove(OutputPath);
     }
 
+    // Each frontend job writes its trace events to a temporary file, which
+    // the Compilation merges into the -trace-events-output file.
+    if (C.getArgs().hasArg(options::OPT_trace_events_output)) {
+      llvm::SmallString<128> Path;
+      std::error_code EC = llvm::sys::fs::createTemporaryFile(
+          llvm::sys::path::stem(BaseInput),
+          types::getTypeTempSuffix(types::TY_TraceEvents), Path);
+      if (EC) {
+        Diags.diagnose(SourceLoc(),
+                       diag::error_unable_to_make_temporary_file,
+                       EC.message());
+      } else {
+        C.addTemporaryFile(Path);
+        Output->setAdditionalOutputForType(types::TY_TraceEvents, Path);
+      }
+    }
+
     // Choose the dependencies file output path.
     if (C.getArgs().hasArg(options::OPT_emit_dependencies)) {
       addAuxiliaryOutput(C, *Output, types::TY_Dependencies, OI, OutputMap);
@@ -61,6 +61,16 @@ namespace json {
     }
   };
 
+  template<>
+  struct ObjectTraits<sys::TaskResourceUsage> {
+    static void mapping(Output &out, sys::TaskResourceUsage &value) {
+      out.mapRequired("wall-time-us", value.WallTimeMicroseconds);
+      out.mapRequired("user-time-us", value.UserTimeMicroseconds);
+      out.mapRequired("system-time-us", value.SystemTimeMicroseconds);
+      out.mapRequired("max-rss", value.MaxResidentSetBytes);
+    }
+  };
+
   template<typename T, unsigned N>
   struct ArrayTraits<SmallVector<T, N>> {
     static size_t size(Output &out, SmallVector<T, N> &seq) {
@@ -174,14 +184,17 @@ public:
 
 class TaskOutputMessage : public TaskBasedMessage {
   std::string Output;
+  Optional<sys::TaskResourceUsage> Usage;
 public:
   TaskOutputMessage(StringRef Kind, const Job &Cmd, ProcessId Pid,
-                    StringRef Output) : TaskBasedMessage(Kind, Cmd, Pid),
-                                        Output(Output) {}
+                    StringRef Output, Optional<sys::TaskResourceUsage> Usage)
+      : TaskBasedMessage(Kind, Cmd, Pid), Output(Output), Usage(Usage) {}
 
   virtual void provideMapping(swift::json::Output &out) {
     TaskBasedMessage::provideMapping(out);
     out.mapOptional("output", Output, std::string());
+    if (Usage)
+      out.mapRequired("usage", *Usage);
   }
 };
 
@@ -189,9 +202,9 @@ class FinishedMessage : public TaskOutputMessage {
   int ExitStatus;
 public:
   FinishedMessage(const Job &Cmd, ProcessId Pid, StringRef Output,
-                  int ExitStatus) : TaskOutputMessage("finished", Cmd, Pid,
-                                                      Output),
-                                    ExitStatus(ExitStatus) {}
+                  int ExitStatus, Optional<sys::TaskResourceUsage> Usage)
+      : TaskOutputMessage("finished", Cmd, Pid, Output, Usage),
+        ExitStatus(ExitStatus) {}
 
   virtual void provideMapping(swift::json::Output &out) {
     TaskOutputMessage::provideMapping(out);
@@ -203,9 +216,9 @@ class SignalledMessage : public TaskOutputMessage {
   std::string ErrorMsg;
 public:
   SignalledMessage(const Job &Cmd, ProcessId Pid, StringRef Output,
-                   StringRef ErrorMsg) : TaskOutputMessage("signalled", Cmd,
-                                                           Pid, Output),
-                                         ErrorMsg(ErrorMsg) {}
+                   StringRef ErrorMsg, Optional<sys::TaskResourceUsage> Usage)
+      : TaskOutputMessage("signalled", Cmd, Pid, Output, Usage),
+        ErrorMsg(ErrorMsg) {}
 
   virtual void provideMapping(swift::json::Output &out) {
     TaskOutputMessage::provideMapping(out);
@@ -252,16 +265,18 @@ void parseable_output::emitBeganMessage(raw_ostream &os,
 
 void parseable_output::emitFinishedMessage(raw_ostream &os,
                                            const Job &Cmd, ProcessId Pid,
-                                           int ExitStatus, StringRef Output) {
-  FinishedMessage msg(Cmd, Pid, Output, ExitStatus);
+                                           int ExitStatus, StringRef Output,
+                                    Optional<sys::TaskResourceUsage> Usage) {
+  FinishedMessage msg(Cmd, Pid, Output, ExitStatus, Usage);
   emitMessage(os, msg);
 }
 
 void parseable_output::emitSignalledMessage(raw_ostream &os,
                                             const Job &Cmd, ProcessId Pid,
                                             StringRef ErrorMsg,
-                                            StringRef Output) {
-  SignalledMessage msg(Cmd, Pid, Output, ErrorMsg);
+                                            StringRef Output,
+                                    Optional<sys::TaskResourceUsage> Usage) {
+  SignalledMessage msg(Cmd, Pid, Output, ErrorMsg, Usage);
   emitMessage(os, msg);
 }
 
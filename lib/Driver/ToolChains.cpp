@@ -214,6 +214,7 @@ ToolChain::constructInvocation(const CompileJobAction &job,
     case types::TY_SwiftModuleDocFile:
     case types::TY_ClangModuleFile:
     case types::TY_SerializedDiagnostics:
+    case types::TY_TraceEvents:
     case types::TY_ObjCHeader:
     case types::TY_Image:
     case types::TY_SwiftDeps:
@@ -335,6 +336,13 @@ ToolChain::constructInvocation(const CompileJobAction &job,
     Arguments.push_back(SerializedDiagnosticsPath.c_str());
   }
 
+  const std::string &TraceEventsPath =
+    context.Output.getAdditionalOutputForType(types::TY_TraceEvents);
+  if (!TraceEventsPath.empty()) {
+    Arguments.push_back("-trace-events-output");
+    Arguments.push_back(TraceEventsPath.c_str());
+  }
+
   const std::string &DependenciesPath =
     context.Output.getAdditionalOutputForType(types::TY_Dependencies);
   if (!DependenciesPath.empty()) {
@@ -471,6 +479,7 @@ ToolChain::constructInvocation(const BackendJobAction &job,
     case types::TY_SwiftModuleDocFile:
     case types::TY_ClangModuleFile:
     case types::TY_SerializedDiagnostics:
+    case types::TY_TraceEvents:
     case types::TY_ObjCHeader:
     case types::TY_Image:
     case types::TY_SwiftDeps:
@@ -772,7 +781,9 @@ static bool findXcodeClangPath(llvm::SmallVectorImpl<char> &path) {
                   [&path](sys::ProcessId PID,
                           int returnCode,
                           StringRef output,
-                          void *unused) -> sys::TaskFinishedResponse {
+                          void *unused,
+                          Optional<sys::TaskResourceUsage> usage)
+                      -> sys::TaskFinishedResponse {
       if (returnCode == 0) {
         output = output.rtrim();
         path.append(output.begin(), output.end());
@@ -74,6 +74,7 @@ bool types::isTextual(ID Id) {
   case types::TY_LLVM_IR:
   case types::TY_ObjCHeader:
   case types::TY_AutolinkFile:
+  case types::TY_TraceEvents:
     return true;
   case types::TY_Image:
   case types::TY_Object:
@@ -114,6 +115,7 @@ bool types::isAfterLLVM(ID Id) {
   case types::TY_SwiftModuleFile:
   case types::TY_SwiftModuleDocFile:
   case types::TY_SerializedDiagnostics:
+  case types::TY_TraceEvents:
   case types::TY_ClangModuleFile:
   case types::TY_SwiftDeps:
   case types::TY_Nothing:
@@ -144,6 +146,7 @@ bool types::isPartOfSwiftCompilation(ID Id) {
   case types::TY_SwiftModuleFile:
   case types::TY_SwiftModuleDocFile:
   case types::TY_SerializedDiagnostics:
+  case types::TY_TraceEvents:
   case types::TY_ClangModuleFile:
   case types::TY_SwiftDeps:
   case types::TY_Nothing:
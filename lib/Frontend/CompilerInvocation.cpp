@@ -161,6 +161,14 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
     }
   }
 
+  if (const Arg *A = Args.getLastArg(OPT_batch_jobs_file)) {
+    Opts.BatchJobsFilePath = A->getValue();
+  }
+
+  if (const Arg *A = Args.getLastArg(OPT_batch_diagnostics_output)) {
+    Opts.BatchDiagnosticsOutputPath = A->getValue();
+  }
+
   if (const Arg *A = Args.getLastArg(OPT_dump_api_path)) {
     Opts.DumpAPIPath = A->getValue();
   }
@@ -179,7 +187,10 @@ static bool ParseFrontendArgs(FrontendOptions &Opts, ArgList &Args,
   Opts.PrintStats |= Args.hasArg(OPT_print_stats);
   Opts.PrintClangStats |= Args.hasArg(OPT_print_clang_stats);
   Opts.DebugTimeFunctionBodies |= Args.hasArg(OPT_debug_time_function_bodies);
+  Opts.DebugTimeModuleLoading |= Args.hasArg(OPT_debug_time_module_loading);
   Opts.DebugTimeCompilation |= Args.hasArg(OPT_debug_time_compilation);
+  if (const Arg *A = Args.getLastArg(OPT_trace_events_output))
+    Opts.TraceEventsOutputPath = A->getValue();
 
   Opts.PlaygroundTransform |= Args.hasArg(OPT_playground);
   if (Args.hasArg(OPT_disable_playground_transform))
@@ -1069,6 +1080,8 @@ static bool ParseSILArgs(SILOptions &Opts, ArgList &Args,
   Opts.PrintInstCounts |= Args.hasArg(OPT_print_inst_counts);
   if (const Arg *A = Args.getLastArg(OPT_external_pass_pipeline_filename))
     Opts.ExternalPassPipelineFilename = A->getValue();
+  if (const Arg *A = Args.getLastArg(OPT_sil_pass_profile))
+    Opts.PassProfileFilename = A->getValue();
 
   Opts.GenerateProfile |= Args.hasArg(OPT_profile_generate);
   Opts.EmitProfileCoverageMapping |= Args.hasArg(OPT_profile_coverage_mapping);
@@ -52,6 +52,58 @@ void CompilerInstance::setPrimarySourceFile(SourceFile *SF) {
   PrimarySourceFile->setReferencedNameTracker(NameTracker);
 }
 
+void CompilerInstance::noteAdditionalPrimarySourceFile(SourceFile *SF,
+                                                       unsigned BufferID) {
+  for (auto &Additional : AdditionalPrimaryInputs) {
+    if (Additional.BufferID != BufferID)
+      continue;
+    assert(!Additional.File && "already has a source file");
+    Additional.File = SF;
+    SF->setReferencedNameTracker(Additional.NameTracker);
+  }
+}
+
+bool CompilerInstance::isPrimaryBuffer(unsigned BufferID) const {
+  if (BufferID == PrimaryBufferID)
+    return true;
+  for (auto &Additional : AdditionalPrimaryInputs)
+    if (Additional.BufferID == BufferID)
+      return true;
+  return false;
+}
+
+bool CompilerInstance::isPrimarySourceFile(const SourceFile *SF) const {
+  if (SF == PrimarySourceFile)
+    return true;
+  for (auto &Additional : AdditionalPrimaryInputs)
+    if (Additional.File == SF)
+      return true;
+  return false;
+}
+
+/// Hands the dependencies picked up since the last call out to the
+/// per-primary trackers of a batch: to the tracker of \p SF if it is a
+/// primary file, or to all of them if \p SF is null.
+void CompilerInstance::distributeDependencies(const SourceFile *SF) {
+  if (!DepTracker)
+    return;
+  ArrayRef<std::string> NewDependencies =
+      DepTracker->getDependencies().slice(NumDistributedDependencies);
+  NumDistributedDependencies += NewDependencies.size();
+
+  auto addTo = [&](DependencyTracker *Tracker) {
+    if (!Tracker)
+      return;
+    for (const std::string &Path : NewDependencies)
+      Tracker->addDependency(Path);
+  };
+  if (!SF || SF == PrimarySourceFile)
+    addTo(PrimaryDepTracker);
+  for (auto &Additional : AdditionalPrimaryInputs)
+    if (!SF || SF == Additional.File)
+      addTo(Additional.DepTracker);
+}
+
 bool CompilerInstance::setup(const CompilerInvocation &Invok) {
   Invocation = Invok;
 
@@ -95,6 +147,8 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
   }
   
   auto SML = SerializedModuleLoader::create(*Context, DepTracker);
+  if (Invocation.getFrontendOptions().DebugTimeModuleLoading)
+    SML->enableDebugTimeModuleLoading();
   this->SML = SML.get();
   Context->addModuleLoader(std::move(SML));
 
@@ -169,6 +223,9 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
       if (PrimaryInput && PrimaryInput->isFilename() &&
           PrimaryInput->Index == i)
         PrimaryBufferID = ExistingBufferID.getValue();
+      for (auto &Additional : AdditionalPrimaryInputs)
+        if (Additional.InputIndex == i)
+          Additional.BufferID = ExistingBufferID.getValue();
 
       continue; // replaced by a memory buffer.
     }
@@ -211,6 +268,9 @@ bool CompilerInstance::setup(const CompilerInvocation &Invok) {
 
     if (PrimaryInput && PrimaryInput->isFilename() && PrimaryInput->Index == i)
       PrimaryBufferID = BufferID;
+    for (auto &Additional : AdditionalPrimaryInputs)
+      if (Additional.InputIndex == i)
+        Additional.BufferID = BufferID;
   }
 
   // Set the primary file to the code-completion point if one exists.
@@ -375,12 +435,15 @@ void CompilerInstance::performSema() {
     return;
   }
 
-  std::unique_ptr<DelayedParsingCallbacks> DelayedCB;
+  std::unique_ptr<DelayedParsingCallbacks> OwnedDelayedCB;
+  DelayedParsingCallbacks *DelayedCB = Invocation.getDelayedParsingCallbacks();
   if (Invocation.isCodeCompletion()) {
-    DelayedCB.reset(
+    OwnedDelayedCB.reset(
         new CodeCompleteDelayedCallbacks(SourceMgr.getCodeCompletionLoc()));
-  } else if (Invocation.isDelayedFunctionBodyParsing()) {
-    DelayedCB.reset(new AlwaysDelayedCallbacks);
+    DelayedCB = OwnedDelayedCB.get();
+  } else if (!DelayedCB && Invocation.isDelayedFunctionBodyParsing()) {
+    OwnedDelayedCB.reset(new AlwaysDelayedCallbacks);
+    DelayedCB = OwnedDelayedCB.get();
   }
 
   PersistentParserState PersistentState;
@@ -403,6 +466,8 @@ void CompilerInstance::performSema() {
 
     if (MainBufferID == PrimaryBufferID)
       setPrimarySourceFile(MainFile);
+    else
+      noteAdditionalPrimarySourceFile(MainFile, MainBufferID);
   }
 
   bool hadLoadError = false;
@@ -429,13 +494,15 @@ void CompilerInstance::performSema() {
 
     if (BufferID == PrimaryBufferID)
       setPrimarySourceFile(NextInput);
+    else
+      noteAdditionalPrimarySourceFile(NextInput, BufferID);
 
     bool Done;
     do {
       // Parser may stop at some erroneous constructions like #else, #endif
       // or '}' in some cases, continue parsing until we are done
       parseIntoSourceFile(*NextInput, BufferID, &Done, nullptr,
-                          &PersistentState, DelayedCB.get());
+                          &PersistentState, DelayedCB);
     } while (!Done);
 
     performNameBinding(*NextInput);
@@ -449,6 +516,9 @@ void CompilerInstance::performSema() {
     Diagnostics.diagnose(SourceLoc(), diag::error_doing_code_completion);
   }
 
+  // Everything imported so far would have been imported for any primary file.
+  distributeDependencies(nullptr);
+
   if (hadLoadError)
     return;
 
@@ -467,7 +537,7 @@ void CompilerInstance::performSema() {
   // Parse the main file last.
   if (MainBufferID != NO_SUCH_BUFFER) {
     bool mainIsPrimary =
-      (PrimaryBufferID == NO_SUCH_BUFFER || MainBufferID == PrimaryBufferID);
+      (PrimaryBufferID == NO_SUCH_BUFFER || isPrimaryBuffer(MainBufferID));
 
     SourceFile &MainFile =
       MainModule->getMainSourceFile(Invocation.getSourceFileKind());
@@ -481,7 +551,7 @@ void CompilerInstance::performSema() {
       // with 'sil' definitions.
       parseIntoSourceFile(MainFile, MainFile.getBufferID().getValue(), &Done,
                           TheSILModule ? &SILContext : nullptr,
-                          &PersistentState, DelayedCB.get());
+                          &PersistentState, DelayedCB);
       if (mainIsPrimary) {
         performTypeChecking(MainFile, PersistentState.getTopLevelContext(),
                             TypeCheckOptions, CurTUElem);
@@ -495,13 +565,18 @@ void CompilerInstance::performSema() {
     if (!mainIsPrimary)
       performNameBinding(MainFile);
   }
+  // The main file is type-checked as it is parsed, so what it picks up can't
+  // be told apart from its imports.
+  distributeDependencies(nullptr);
 
   // Type-check each top-level input besides the main source file.
   for (auto File : MainModule->getFiles())
     if (auto SF = dyn_cast<SourceFile>(File))
-      if (PrimaryBufferID == NO_SUCH_BUFFER || SF == PrimarySourceFile)
+      if (PrimaryBufferID == NO_SUCH_BUFFER || isPrimarySourceFile(SF)) {
         performTypeChecking(*SF, PersistentState.getTopLevelContext(),
                             TypeCheckOptions);
+        distributeDependencies(SF);
+      }
 
   // Even if there were no source files, we should still record known
   // protocols.
@@ -519,11 +594,14 @@ void CompilerInstance::performSema() {
       if (auto SF = dyn_cast<SourceFile>(File))
         performWholeModuleTypeChecking(*SF);
   }
+  distributeDependencies(nullptr);
 
   for (auto File : MainModule->getFiles())
     if (auto SF = dyn_cast<SourceFile>(File))
-      if (PrimaryBufferID == NO_SUCH_BUFFER || SF == PrimarySourceFile)
+      if (PrimaryBufferID == NO_SUCH_BUFFER || isPrimarySourceFile(SF)) {
         finishTypeChecking(*SF);
+        distributeDependencies(SF);
+      }
 }
 
 void CompilerInstance::performParseOnly() {
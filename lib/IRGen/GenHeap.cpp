@@ -1112,6 +1112,18 @@ void IRGenFunction::emitNativeStrongRelease(llvm::Value *value) {
   emitUnaryRefCountCall(*this, IGM.getNativeStrongReleaseFn(), value);
 }
 
+/// Emit a call to swift_nonatomic_retain.
+void IRGenFunction::emitNativeNonAtomicStrongRetain(llvm::Value *value) {
+  if (doesNotRequireRefCounting(value)) return;
+  emitUnaryRefCountCall(*this, IGM.getNativeNonAtomicStrongRetainFn(), value);
+}
+
+/// Emit a call to swift_nonatomic_release.
+void IRGenFunction::emitNativeNonAtomicStrongRelease(llvm::Value *value) {
+  if (doesNotRequireRefCounting(value)) return;
+  emitUnaryRefCountCall(*this, IGM.getNativeNonAtomicStrongReleaseFn(), value);
+}
+
 void IRGenFunction::emitNativeSetDeallocating(llvm::Value *value) {
   if (doesNotRequireRefCounting(value)) return;
   emitUnaryRefCountCall(*this, IGM.getNativeSetDeallocatingFn(), value);
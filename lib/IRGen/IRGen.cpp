@@ -24,6 +24,7 @@
 #include "swift/Basic/Dwarf.h"
 #include "swift/Basic/Platform.h"
 #include "swift/Basic/Timer.h"
+#include "swift/Basic/TraceEvents.h"
 #include "swift/Basic/Version.h"
 #include "swift/ClangImporter/ClangImporter.h"
 #include "swift/LLVMPasses/PassesFwd.h"
@@ -626,6 +627,7 @@ static std::unique_ptr<llvm::Module> performIRGeneration(IRGenOptions &Opts,
 
   embedBitcode(IGM.getModule(), Opts);
 
+  TraceScope Trace("llvm", IGM.OutputFilename.str());
   if (performLLVM(IGM.Opts, IGM.Context.Diags, nullptr, IGM.ModuleHash,
                   IGM.getModule(), IGM.TargetMachine, IGM.OutputFilename))
     return nullptr;
@@ -641,6 +643,7 @@ static void ThreadEntryPoint(IRGenModuleDispatcher *dispatcher,
           "\n";
       DiagMutex->unlock();
     );
+    TraceScope Trace("llvm", IGM->OutputFilename.str());
     embedBitcode(IGM->getModule(), IGM->Opts);
     performLLVM(IGM->Opts, IGM->Context.Diags, DiagMutex, IGM->ModuleHash,
                 IGM->getModule(), IGM->TargetMachine, IGM->OutputFilename);
@@ -807,6 +810,11 @@ static void performParallelIRGeneration(IRGenOptions &Opts,
   // Bail out if there are any errors.
   if (Ctx.hadError()) return;
 
+  dispatcher.orderQueueByCost();
+
+  // There is no point in having more threads than LLVM modules.
+  numThreads = std::min(numThreads, (int)dispatcher.getQueueSize());
+
   std::vector<std::thread> Threads;
   llvm::sys::Mutex DiagMutex;
 
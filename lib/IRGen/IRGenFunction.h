@@ -284,6 +284,8 @@ public:
   void emitNativeStrongInit(llvm::Value *value, Address addr);
   void emitNativeStrongRetain(llvm::Value *value);
   void emitNativeStrongRelease(llvm::Value *value);
+  void emitNativeNonAtomicStrongRetain(llvm::Value *value);
+  void emitNativeNonAtomicStrongRelease(llvm::Value *value);
   void emitNativeSetDeallocating(llvm::Value *value);
   //   - unowned references
   void emitNativeUnownedRetain(llvm::Value *value);
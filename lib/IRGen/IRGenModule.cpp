@@ -39,6 +39,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/ADT/PointerUnion.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MD5.h"
 
@@ -48,6 +49,7 @@
 #include "IRGenDebugInfo.h"
 #include "Linking.h"
 
+#include <algorithm>
 #include <initializer_list>
 
 using namespace swift;
@@ -1023,6 +1025,34 @@ void IRGenModuleDispatcher::addGenModule(SourceFile *SF, IRGenModule *IGM) {
   Queue.push_back(IGM);
 }
 
+/// Estimates the cost of running the LLVM passes on \p M by its number of
+/// instructions.
+static uint64_t getCodeGenCost(const llvm::Module &M) {
+  uint64_t Cost = 0;
+  for (const llvm::Function &F : M)
+    for (const llvm::BasicBlock &BB : F)
+      Cost += BB.size();
+  return Cost;
+}
+
+void IRGenModuleDispatcher::orderQueueByCost() {
+  assert(QueueIndex == 0 && "queue is already being processed");
+
+  // Starting with the largest modules keeps a large file which happens to
+  // come last from running alone at the end. The sort is stable, so the
+  // order only depends on the input.
+  SmallVector<std::pair<uint64_t, IRGenModule *>, 8> ByCost;
+  for (IRGenModule *IGM : Queue)
+    ByCost.push_back({getCodeGenCost(*IGM->getModule()), IGM});
+  std::stable_sort(ByCost.begin(), ByCost.end(),
+                   [](const std::pair<uint64_t, IRGenModule *> &LHS,
+                      const std::pair<uint64_t, IRGenModule *> &RHS) {
+                     return LHS.first > RHS.first;
+                   });
+  for (unsigned i = 0, e = Queue.size(); i != e; ++i)
+    Queue[i] = ByCost[i].second;
+}
+
 IRGenModule *IRGenModuleDispatcher::getGenModule(DeclContext *ctxt) {
   if (GenModules.size() == 1 || !ctxt) {
     return getPrimaryIGM();
@@ -251,6 +251,16 @@ public:
     return it->second;
   }
   
+  /// Orders the queue of IRGenModules so that the modules which are the most
+  /// expensive to optimize and emit are fetched first.
+  ///
+  /// Must be called after all modules are finalized and before the first
+  /// call of fetchFromQueue().
+  void orderQueueByCost();
+
+  /// Returns the number of IRGenModules in the queue.
+  unsigned getQueueSize() const { return Queue.size(); }
+
   /// In multi-threaded compilation fetch the next IRGenModule from the queue.
   IRGenModule *fetchFromQueue() {
     int idx = QueueIndex++;
@@ -3346,15 +3346,35 @@ void IRGenSILFunction::visitStrongUnpinInst(swift::StrongUnpinInst *i) {
   emitNativeUnpin(pinHandle);
 }
 
+/// Returns true if a non-atomic reference counting operation on a value of the
+/// given type can use the native Swift entry points.
+///
+/// Other reference counting schemes (ObjC, blocks, unknown) have no
+/// non-atomic variant, so operations on them stay atomic.
+static bool canUseNonAtomicRefCounting(const ReferenceTypeInfo &ti) {
+  ReferenceCounting refcounting;
+  return ti.isSingleRetainablePointer(ResilienceExpansion::Maximal,
+                                      &refcounting) &&
+         refcounting == ReferenceCounting::Native;
+}
+
 void IRGenSILFunction::visitStrongRetainInst(swift::StrongRetainInst *i) {
   Explosion lowered = getLoweredExplosion(i->getOperand());
   auto &ti = cast<ReferenceTypeInfo>(getTypeInfo(i->getOperand()->getType()));
+  if (i->isNonAtomic() && canUseNonAtomicRefCounting(ti)) {
+    emitNativeNonAtomicStrongRetain(lowered.claimNext());
+    return;
+  }
   ti.strongRetain(*this, lowered);
 }
 
 void IRGenSILFunction::visitStrongReleaseInst(swift::StrongReleaseInst *i) {
   Explosion lowered = getLoweredExplosion(i->getOperand());
   auto &ti = cast<ReferenceTypeInfo>(getTypeInfo(i->getOperand()->getType()));
+  if (i->isNonAtomic() && canUseNonAtomicRefCounting(ti)) {
+    emitNativeNonAtomicStrongRelease(lowered.claimNext());
+    return;
+  }
   ti.strongRelease(*this, lowered);
 }
 
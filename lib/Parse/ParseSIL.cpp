@@ -1904,8 +1904,6 @@ bool SILParser::parseSILInstruction(SILBasicBlock *BB) {
   UNARY_INSTRUCTION(FixLifetime)
   UNARY_INSTRUCTION(CopyBlock)
   UNARY_INSTRUCTION(StrongPin)
-  UNARY_INSTRUCTION(StrongRetain)
-  UNARY_INSTRUCTION(StrongRelease)
   UNARY_INSTRUCTION(StrongUnpin)
   UNARY_INSTRUCTION(StrongRetainUnowned)
   UNARY_INSTRUCTION(UnownedRetain)
@@ -1935,6 +1933,25 @@ bool SILParser::parseSILInstruction(SILBasicBlock *BB) {
    break;
  }
 
+ case ValueKind::StrongRetainInst:
+ case ValueKind::StrongReleaseInst: {
+   bool isNonAtomic = false;
+   if (parseSILOptional(isNonAtomic, *this, "nonatomic") ||
+       parseTypedValueRef(Val, B) ||
+       parseSILDebugLocation(InstLoc, B))
+     return true;
+
+   RefCountingInst *RCI;
+   if (Opcode == ValueKind::StrongRetainInst)
+     RCI = B.createStrongRetain(InstLoc, Val);
+   else
+     RCI = B.createStrongRelease(InstLoc, Val);
+   if (isNonAtomic)
+     RCI->setNonAtomic();
+   ResultVal = RCI;
+   break;
+ }
+
  case ValueKind::LoadUnownedInst:
  case ValueKind::LoadWeakInst: {
    bool isTake = false;
@@ -259,11 +259,13 @@ namespace {
     }
 
     bool visitStrongReleaseInst(const StrongReleaseInst *RHS) {
-      return true;
+      return cast<StrongReleaseInst>(LHS)->getAtomicity() ==
+             RHS->getAtomicity();
     }
 
     bool visitStrongRetainInst(const StrongRetainInst *RHS) {
-      return true;
+      return cast<StrongRetainInst>(LHS)->getAtomicity() ==
+             RHS->getAtomicity();
     }
 
     bool visitStrongRetainUnownedInst(const StrongRetainUnownedInst *RHS) {
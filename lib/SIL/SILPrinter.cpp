@@ -1372,11 +1372,19 @@ public:
   void visitCopyBlockInst(CopyBlockInst *RI) {
     *this << "copy_block " << getIDAndType(RI->getOperand());
   }
+  void printAtomicity(RefCountingInst *RCI) {
+    if (RCI->isNonAtomic())
+      *this << "[nonatomic] ";
+  }
   void visitStrongRetainInst(StrongRetainInst *RI) {
-    *this << "strong_retain " << getIDAndType(RI->getOperand());
+    *this << "strong_retain ";
+    printAtomicity(RI);
+    *this << getIDAndType(RI->getOperand());
   }
   void visitStrongReleaseInst(StrongReleaseInst *RI) {
-    *this << "strong_release " << getIDAndType(RI->getOperand());
+    *this << "strong_release ";
+    printAtomicity(RI);
+    *this << getIDAndType(RI->getOperand());
   }
   void visitStrongPinInst(StrongPinInst *PI) {
     *this << "strong_pin " << getIDAndType(PI->getOperand());
@@ -78,3 +78,42 @@ void BottomUpFunctionOrder::FindSCCs(SILModule &M) {
   for (auto &F : M)
     DFS(&F);
 }
+
+void BottomUpFunctionOrder::FindLevels() {
+  // Map each function to the index of its SCC.
+  auto SCCs = getSCCs();
+  llvm::DenseMap<SILFunction *, unsigned> SCCIndex;
+  for (unsigned i = 0, e = SCCs.size(); i != e; ++i)
+    for (auto *F : SCCs[i])
+      SCCIndex[F] = i;
+
+  // SCCs are in bottom-up order, so the level of every callee SCC is known
+  // by the time we visit its callers.
+  llvm::SmallVector<unsigned, 32> SCCLevel(SCCs.size(), 0);
+  for (unsigned i = 0, e = SCCs.size(); i != e; ++i) {
+    unsigned Level = 0;
+    for (auto *F : SCCs[i]) {
+      for (auto &B : *F) {
+        for (auto &I : B) {
+          auto FAS = FullApplySite::isa(&I);
+          if (!FAS)
+            continue;
+
+          for (auto *CalleeFn : BCA->getCalleeList(FAS)) {
+            auto Found = SCCIndex.find(CalleeFn);
+            if (Found == SCCIndex.end() || Found->second == i)
+              continue;
+            assert(Found->second < i && "callee SCC is not below its caller");
+            Level = std::max(Level, SCCLevel[Found->second] + 1);
+          }
+        }
+      }
+    }
+    SCCLevel[i] = Level;
+
+    if (TheLevels.size() <= Level)
+      TheLevels.resize(Level + 1);
+    for (auto *F : SCCs[i])
+      TheLevels[Level].push_back(F);
+  }
+}
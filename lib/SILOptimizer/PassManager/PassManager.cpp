@@ -13,7 +13,9 @@
 #define DEBUG_TYPE "sil-passmanager"
 
 #include "swift/Basic/DemangleWrappers.h"
+#include "swift/Basic/TraceEvents.h"
 #include "swift/SILOptimizer/PassManager/PassManager.h"
+#include "swift/SILOptimizer/PassManager/PassProfile.h"
 #include "swift/SIL/SILFunction.h"
 #include "swift/SIL/SILModule.h"
 #include "swift/SILOptimizer/PassManager/PrettyStackTrace.h"
@@ -27,6 +29,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/TimeValue.h"
 #include "llvm/Support/GraphWriter.h"
+#include <chrono>
 
 using namespace swift;
 
@@ -164,7 +167,8 @@ static void printModule(SILModule *Mod, bool EmitVerboseSIL) {
 }
 
 SILPassManager::SILPassManager(SILModule *M, llvm::StringRef Stage) :
-  Mod(M), StageName(Stage) {
+  Mod(M), StageName(Stage),
+  ProfilePasses(!M->getOptions().PassProfileFilename.empty()) {
   
 #define ANALYSIS(NAME) \
   Analysis.push_back(create##NAME##Analysis(Mod));
@@ -215,6 +219,8 @@ void SILPassManager::runPassesOnFunction(PassList FuncTransforms,
 
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
 
+  TraceScope FunctionTrace("sil-function", F->getName());
+
   for (auto SFT : FuncTransforms) {
     PrettyStackTraceSILFunctionTransform X(SFT);
     SFT->injectPassManager(this);
@@ -238,7 +244,7 @@ void SILPassManager::runPassesOnFunction(PassList FuncTransforms,
       continue;
     }
 
-    CurrentPassHasInvalidated = false;
+    resetCurrentPassInvalidations();
 
     if (SILPrintPassName)
       llvm::dbgs() << "#" << NumPassesRun << " Stage: " << StageName
@@ -252,14 +258,32 @@ void SILPassManager::runPassesOnFunction(PassList FuncTransforms,
       F->dump(Options.EmitVerboseSIL);
     }
 
+    unsigned InstsBefore = 0;
+    if (ProfilePasses)
+      InstsBefore = SILPassProfile::countInstructions(F);
+    auto ProfileStartTime = std::chrono::steady_clock::now();
+
     llvm::sys::TimeValue StartTime = llvm::sys::TimeValue::now();
     Mod->registerDeleteNotificationHandler(SFT);
     if (breakBeforeRunning(F->getName(), SFT->getName()))
       LLVM_BUILTIN_DEBUGTRAP;
-    SFT->run();
+    {
+      TraceScope PassTrace("sil-pass", SFT->getName());
+      SFT->run();
+    }
     assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
     Mod->removeDeleteNotificationHandler(SFT);
 
+    if (ProfilePasses) {
+      auto Nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - ProfileStartTime).count();
+      SILPassProfile &Profile = SILPassProfile::get();
+      Profile.recordFunctionPass(
+          Profile.getPassID(StageName, SFT->getName(), false), F, Nanoseconds,
+          InstsBefore, SILPassProfile::countInstructions(F),
+          CurrentPassHasInvalidated, NumInvalidationsInCurrentPass);
+    }
+
     // Did running the transform result in new functions being added
     // to the top of our worklist?
     bool newFunctionsAdded = (F != FunctionWorklist.back());
@@ -310,6 +334,12 @@ void SILPassManager::runFunctionPasses(PassList FuncTransforms) {
   BottomUpFunctionOrder BottomUpOrder(*Mod, BCA);
   auto BottomUpFunctions = BottomUpOrder.getFunctions();
 
+  // FIXME: Functions are optimized one at a time. The functions within one
+  // of BottomUpOrder.getLevels() don't call each other and could run on a
+  // thread pool, but passes share the module's allocator, its delete
+  // notification handlers, the analysis caches and type lowering, none of
+  // which are synchronized yet.
+
   assert(FunctionWorklist.empty() && "Expected empty function worklist!");
 
   FunctionWorklist.reserve(BottomUpFunctions.size());
@@ -414,7 +444,7 @@ void SILPassManager::runModulePass(SILModuleTransform *SMT) {
   SMT->injectPassManager(this);
   SMT->injectModule(Mod);
 
-  CurrentPassHasInvalidated = false;
+  resetCurrentPassInvalidations();
 
   if (SILPrintPassName)
     llvm::dbgs() << "#" << NumPassesRun << " Stage: " << StageName
@@ -427,13 +457,35 @@ void SILPassManager::runModulePass(SILModuleTransform *SMT) {
     printModule(Mod, Options.EmitVerboseSIL);
   }
 
+  uint64_t InstsBefore = 0;
+  if (ProfilePasses)
+    InstsBefore = SILPassProfile::countInstructions(Mod);
+  auto ProfileStartTime = std::chrono::steady_clock::now();
+
   llvm::sys::TimeValue StartTime = llvm::sys::TimeValue::now();
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
   Mod->registerDeleteNotificationHandler(SMT);
-  SMT->run();
+  {
+    TraceScope PassTrace("sil-pass", SMT->getName());
+    SMT->run();
+  }
   Mod->removeDeleteNotificationHandler(SMT);
   assert(analysesUnlocked() && "Expected all analyses to be unlocked!");
 
+  if (ProfilePasses) {
+    auto Nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - ProfileStartTime).count();
+    unsigned NumFunctionsChanged =
+        CurrentPassInvalidatedModule
+            ? std::distance(Mod->begin(), Mod->end())
+            : FunctionsInvalidatedByCurrentPass.size();
+    SILPassProfile &Profile = SILPassProfile::get();
+    Profile.recordModulePass(
+        Profile.getPassID(StageName, SMT->getName(), true), Nanoseconds,
+        InstsBefore, SILPassProfile::countInstructions(Mod),
+        NumFunctionsChanged, NumInvalidationsInCurrentPass);
+  }
+
   if (SILPrintPassTime) {
     auto Delta = llvm::sys::TimeValue::now().nanoseconds() -
       StartTime.nanoseconds();
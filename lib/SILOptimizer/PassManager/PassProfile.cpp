@@ -0,0 +1,208 @@
+//===--- PassProfile.cpp - Optimizer profiling report ---------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/SILOptimizer/PassManager/PassProfile.h"
+#include "swift/Basic/JSONSerialization.h"
+#include "swift/SIL/SILFunction.h"
+#include "swift/SIL/SILModule.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace swift;
+
+llvm::cl::opt<unsigned> SILPassProfileTopN(
+    "sil-pass-profile-top", llvm::cl::init(20),
+    llvm::cl::desc("The number of most expensive (pass, function) pairs to "
+                   "list in the SIL pass profile"));
+
+namespace {
+  /// One entry of the list of most expensive (pass, function) pairs.
+  struct FunctionReport {
+    std::string Stage;
+    std::string Pass;
+    std::string Function;
+    SILPassProfile::FunctionStats Stats;
+  };
+
+  /// The whole report, in the shape it is serialized.
+  struct Report {
+    std::vector<SILPassProfile::PassStats> Passes;
+    std::vector<FunctionReport> TopFunctions;
+  };
+}
+
+namespace swift {
+namespace json {
+  template<>
+  struct ObjectTraits<SILPassProfile::PassStats> {
+    static void mapping(Output &out, SILPassProfile::PassStats &value) {
+      out.mapRequired("stage", value.Stage);
+      out.mapRequired("pass", value.Pass);
+      out.mapRequired("module-pass", value.IsModulePass);
+      out.mapRequired("runs", value.NumRuns);
+      out.mapRequired("wall-time-ns", value.Nanoseconds);
+      out.mapRequired("insts-before", value.InstsBefore);
+      out.mapRequired("insts-after", value.InstsAfter);
+      out.mapRequired("functions-changed", value.NumFunctionsChanged);
+      out.mapRequired("invalidations", value.NumInvalidations);
+    }
+  };
+
+  template<>
+  struct ObjectTraits<FunctionReport> {
+    static void mapping(Output &out, FunctionReport &value) {
+      out.mapRequired("stage", value.Stage);
+      out.mapRequired("pass", value.Pass);
+      out.mapRequired("function", value.Function);
+      out.mapRequired("runs", value.Stats.NumRuns);
+      out.mapRequired("wall-time-ns", value.Stats.Nanoseconds);
+      out.mapRequired("insts-before", value.Stats.InstsBefore);
+      out.mapRequired("insts-after", value.Stats.InstsAfter);
+    }
+  };
+
+  template<>
+  struct ObjectTraits<Report> {
+    static void mapping(Output &out, Report &value) {
+      out.mapRequired("passes", value.Passes);
+      out.mapRequired("top-functions", value.TopFunctions);
+    }
+  };
+}
+}
+
+SILPassProfile &SILPassProfile::get() {
+  static SILPassProfile Profile;
+  return Profile;
+}
+
+unsigned SILPassProfile::getPassID(StringRef Stage, StringRef Pass,
+                                   bool IsModulePass) {
+  llvm::SmallString<64> Key(Stage);
+  Key.push_back('\0');
+  Key.append(Pass);
+
+  auto Inserted = PassIDs.insert({Key, Passes.size()});
+  if (Inserted.second) {
+    Passes.emplace_back();
+    Passes.back().Stage = Stage.str();
+    Passes.back().Pass = Pass.str();
+    Passes.back().IsModulePass = IsModulePass;
+  }
+  return Inserted.first->second;
+}
+
+void SILPassProfile::recordFunctionPass(unsigned PassID, SILFunction *F,
+                                        uint64_t Nanoseconds,
+                                        unsigned InstsBefore,
+                                        unsigned InstsAfter, bool Changed,
+                                        unsigned NumInvalidations) {
+  PassStats &Stats = Passes[PassID];
+  ++Stats.NumRuns;
+  Stats.Nanoseconds += Nanoseconds;
+  Stats.InstsBefore += InstsBefore;
+  Stats.InstsAfter += InstsAfter;
+  Stats.NumFunctionsChanged += Changed;
+  Stats.NumInvalidations += NumInvalidations;
+
+  auto Inserted = FunctionIDs.insert({F->getName(), FunctionNames.size()});
+  if (Inserted.second)
+    FunctionNames.push_back(Inserted.first->getKey());
+
+  FunctionStats &Pair = PairStats[{PassID, Inserted.first->second}];
+  ++Pair.NumRuns;
+  Pair.Nanoseconds += Nanoseconds;
+  Pair.InstsBefore += InstsBefore;
+  Pair.InstsAfter += InstsAfter;
+}
+
+void SILPassProfile::recordModulePass(unsigned PassID, uint64_t Nanoseconds,
+                                      uint64_t InstsBefore,
+                                      uint64_t InstsAfter,
+                                      unsigned NumFunctionsChanged,
+                                      unsigned NumInvalidations) {
+  PassStats &Stats = Passes[PassID];
+  ++Stats.NumRuns;
+  Stats.Nanoseconds += Nanoseconds;
+  Stats.InstsBefore += InstsBefore;
+  Stats.InstsAfter += InstsAfter;
+  Stats.NumFunctionsChanged += NumFunctionsChanged;
+  Stats.NumInvalidations += NumInvalidations;
+}
+
+void SILPassProfile::print(llvm::raw_ostream &OS, unsigned TopN) const {
+  Report R;
+  R.Passes = Passes;
+
+  // Pick the most expensive pairs, breaking ties by pass and function so
+  // that the report does not depend on hash table order.
+  using PairEntry = std::pair<std::pair<unsigned, unsigned>, FunctionStats>;
+  std::vector<PairEntry> Pairs(PairStats.begin(), PairStats.end());
+  auto MoreExpensive = [&](const PairEntry &LHS, const PairEntry &RHS) {
+    if (LHS.second.Nanoseconds != RHS.second.Nanoseconds)
+      return LHS.second.Nanoseconds > RHS.second.Nanoseconds;
+    return LHS.first < RHS.first;
+  };
+  size_t NumListed = std::min<size_t>(TopN, Pairs.size());
+  std::partial_sort(Pairs.begin(), Pairs.begin() + NumListed, Pairs.end(),
+                    MoreExpensive);
+
+  for (size_t i = 0; i != NumListed; ++i) {
+    const PassStats &Pass = Passes[Pairs[i].first.first];
+    R.TopFunctions.push_back({Pass.Stage, Pass.Pass,
+                              FunctionNames[Pairs[i].first.second].str(),
+                              Pairs[i].second});
+  }
+
+  json::Output Out(OS);
+  Out << R;
+  OS << '\n';
+}
+
+bool SILPassProfile::write(StringRef Path) const {
+  std::error_code EC;
+  llvm::raw_fd_ostream OS(Path, EC, llvm::sys::fs::F_None);
+  if (EC)
+    return true;
+  print(OS, SILPassProfileTopN);
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    return true;
+  }
+  return false;
+}
+
+void SILPassProfile::clear() {
+  Passes.clear();
+  PassIDs.clear();
+  FunctionIDs.clear();
+  FunctionNames.clear();
+  PairStats.clear();
+}
+
+unsigned SILPassProfile::countInstructions(SILFunction *F) {
+  unsigned Count = 0;
+  for (auto &BB : *F)
+    Count += std::distance(BB.begin(), BB.end());
+  return Count;
+}
+
+uint64_t SILPassProfile::countInstructions(SILModule *M) {
+  uint64_t Count = 0;
+  for (auto &F : *M)
+    Count += countInstructions(&F);
+  return Count;
+}
@@ -372,6 +372,10 @@ void swift::runSILOptimizationPasses(SILModule &Module) {
   PM.addDCE();
   PM.addSimplifyCFG();
 
+  // Must run after the last ARC optimization, which may move or create
+  // retains and releases without the non-atomic flag.
+  PM.addNonAtomicRC();
+
   PM.runOneIteration();
 
   PM.resetAndRemoveTransformations();
@@ -0,0 +1,89 @@
+//===--- NonAtomicRC.cpp - Use non-atomic RC for thread-local objects -----===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "nonatomic-rc"
+#include "swift/SILOptimizer/PassManager/Passes.h"
+#include "swift/SILOptimizer/PassManager/Transforms.h"
+#include "swift/SILOptimizer/Analysis/EscapeAnalysis.h"
+#include "swift/SIL/SILInstruction.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Debug.h"
+
+STATISTIC(NumNonAtomicRC, "Number of retains/releases made non-atomic");
+
+using namespace swift;
+
+namespace {
+
+/// Marks strong_retain and strong_release instructions as [nonatomic] if the
+/// referenced object cannot be visible to any other thread.
+///
+/// An object is thread-local if escape analysis proves that neither the
+/// reference nor the object itself escapes the function: it is not passed to
+/// a call, stored to global or argument memory, or returned. Such an object
+/// was necessarily allocated in this function and dies in it, so no other
+/// thread can ever observe its reference count.
+class NonAtomicRC : public SILFunctionTransform {
+
+public:
+  NonAtomicRC() {}
+
+private:
+  /// Returns true if the object referenced by \p V is known to be confined
+  /// to the current thread.
+  bool isThreadLocalObject(SILValue V, EscapeAnalysis::ConnectionGraph *ConGraph,
+                           EscapeAnalysis *EA) {
+    auto *Node = ConGraph->getNodeOrNull(V, EA);
+    if (!Node || Node->escapes())
+      return false;
+    auto *Content = Node->getContentNodeOrNull();
+    return Content && !Content->escapes();
+  }
+
+  /// The entry point to the transformation.
+  void run() override {
+    DEBUG(llvm::dbgs() << "** NonAtomicRC **\n");
+
+    auto *EA = PM->getAnalysis<EscapeAnalysis>();
+    SILFunction *F = getFunction();
+    auto *ConGraph = EA->getConnectionGraph(F);
+    if (!ConGraph)
+      return;
+
+    bool Changed = false;
+    for (auto &BB : *F) {
+      for (auto &I : BB) {
+        if (!isa<StrongRetainInst>(&I) && !isa<StrongReleaseInst>(&I))
+          continue;
+        auto *RCI = cast<RefCountingInst>(&I);
+        if (RCI->isNonAtomic())
+          continue;
+        if (!isThreadLocalObject(RCI->getOperand(0), ConGraph, EA))
+          continue;
+        DEBUG(llvm::dbgs() << "  make non-atomic: " << *RCI);
+        RCI->setNonAtomic();
+        NumNonAtomicRC++;
+        Changed = true;
+      }
+    }
+    if (Changed)
+      invalidateAnalysis(SILAnalysis::InvalidationKind::Instructions);
+  }
+
+  StringRef getName() override { return "NonAtomicRC"; }
+};
+
+} // end anonymous namespace
+
+SILTransform *swift::createNonAtomicRC() {
+  return new NonAtomicRC();
+}
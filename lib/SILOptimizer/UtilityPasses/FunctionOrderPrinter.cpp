@@ -55,6 +55,18 @@ class FunctionOrderPrinterPass : public SILModuleTransform {
       }
     }
     llvm::outs() << "\n";
+
+    llvm::outs() << "Function levels:\n";
+    auto Levels = Orderer.getLevels();
+    for (unsigned i = 0, e = Levels.size(); i != e; ++i) {
+      llvm::outs() << "Level " << i << ":\n";
+      for (auto *F : Levels[i]) {
+        llvm::outs() << "  "
+                     << demangle_wrappers::demangleSymbolAsString(F->getName())
+                     << "\n";
+      }
+    }
+    llvm::outs() << "\n";
   }
 
   StringRef getName() override { return "Function Order Printer"; }
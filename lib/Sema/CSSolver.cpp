@@ -15,6 +15,7 @@
 //===----------------------------------------------------------------------===//
 #include "ConstraintSystem.h"
 #include "ConstraintGraph.h"
+#include "swift/Basic/TraceEvents.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/SaveAndRestore.h"
@@ -1253,6 +1254,8 @@ ConstraintSystem::solveSingle(FreeTypeVariableBinding allowFreeTypeVariables) {
 bool ConstraintSystem::solve(SmallVectorImpl<Solution> &solutions,
                              FreeTypeVariableBinding allowFreeTypeVariables) {
   assert(!solverState && "use solveRec for recursive calls");
+  TraceScope trace("solve", "solve");
+
   // Set up solver state.
   SolverState state(*this);
   this->solverState = &state;
@@ -1260,6 +1263,13 @@ bool ConstraintSystem::solve(SmallVectorImpl<Solution> &solutions,
   // Solve the system.
   solveRec(solutions, allowFreeTypeVariables);
 
+  // Record the solver statistics for this system in the trace.
+  if (trace.isRecording()) {
+    trace.addArg("solutions", solutions.size());
+    #define CS_STATISTIC(Name, Description) trace.addArg(#Name, state.Name);
+    #include "ConstraintSolverStats.def"
+  }
+
   // If there is more than one viable system, attempt to pick the best
   // solution.
   auto size = solutions.size();
@@ -1583,6 +1593,94 @@ static bool shortCircuitDisjunctionAt(Constraint *constraint,
   return false;
 }
 
+bool ConstraintSystem::isDisjunctionTermKnownToFail(Constraint *term) {
+  // Fixes can make an otherwise inapplicable overload work.
+  if (shouldAttemptFixes())
+    return false;
+
+  if (term->getKind() != ConstraintKind::BindOverload ||
+      term->getOverloadChoice().getKind() != OverloadChoiceKind::Decl)
+    return false;
+
+  // Only operators are considered; see the check of the application's
+  // anchor below. Rule out everything else before searching for it.
+  auto decl = term->getOverloadChoice().getDecl();
+  if (!decl->isOperator())
+    return false;
+
+  auto typeVar = term->getFirstType()->getAs<TypeVariableType>();
+  if (!typeVar)
+    return false;
+  typeVar = getRepresentative(typeVar);
+
+  // Find the application of the overloaded function.
+  Constraint *application = nullptr;
+  for (auto constraint : CG[typeVar].getConstraints()) {
+    if (constraint->getKind() != ConstraintKind::ApplicableFunction)
+      continue;
+    auto fnTypeVar =
+      simplifyType(constraint->getSecondType())->getAs<TypeVariableType>();
+    if (fnTypeVar && getRepresentative(fnTypeVar) == typeVar) {
+      application = constraint;
+      break;
+    }
+  }
+  if (!application)
+    return false;
+
+  // Only operators are considered. Matching the arguments of other calls
+  // also depends on the shape of the call, e.g. on trailing closures.
+  ConstraintLocatorBuilder locator = application->getLocator();
+  SmallVector<LocatorPathElt, 2> parts;
+  Expr *anchor = locator.getLocatorParts(parts);
+  if (!anchor || parts.empty() ||
+      (!isa<PrefixUnaryExpr>(anchor) && !isa<PostfixUnaryExpr>(anchor) &&
+       !isa<BinaryExpr>(anchor)))
+    return false;
+
+  // The arguments must be fully resolved for the outcome to be independent
+  // of the rest of the system.
+  auto argType = simplifyType(
+      application->getFirstType()->castTo<FunctionType>()->getInput());
+  if (argType->hasTypeVariable())
+    return false;
+
+  // Match the arguments the same way simplifyApplicableFnConstraint() will.
+  parts.pop_back();
+  ConstraintLocatorBuilder outerLocator =
+    getConstraintLocator(anchor, parts, locator.getSummaryFlags());
+
+  auto key = std::make_pair(decl, argType->getCanonicalType());
+  auto known = TC.OverloadApplicabilityCache.find(key);
+  if (known != TC.OverloadApplicabilityCache.end()) {
+    ++solverState->NumOverloadApplicabilityHits;
+    return !known->second;
+  }
+  ++solverState->NumOverloadApplicabilityMisses;
+
+  // Bind the overload and try to match the arguments against it, undoing
+  // both afterwards. Overloads whose opened type still involves type
+  // variables, such as generic ones, are always treated as applicable.
+  bool applicable = true;
+  {
+    SolverScope scope(*this);
+    if (simplifyConstraint(*term) != SolutionKind::Error) {
+      auto fnType = simplifyType(typeVar)->getAs<FunctionType>();
+      if (fnType && !fnType->hasTypeVariable()) {
+        applicable = matchTypes(argType, fnType->getInput(),
+                                TypeMatchKind::OperatorArgumentTupleConversion,
+                                TMF_GenerateConstraints,
+                                outerLocator.withPathElement(
+                                  ConstraintLocator::ApplyArgument))
+                       != SolutionKind::Error;
+      }
+    }
+  }
+
+  TC.OverloadApplicabilityCache[key] = applicable;
+  return !applicable;
+}
+
 bool ConstraintSystem::solveSimplified(
        SmallVectorImpl<Solution> &solutions,
        FreeTypeVariableBinding allowFreeTypeVariables) {
@@ -1707,6 +1805,19 @@ bool ConstraintSystem::solveSimplified(
     if (getExpressionTooComplex())
       break;
 
+    // Skip overloads that are already known not to accept the arguments.
+    if (isDisjunctionTermKnownToFail(constraint)) {
+      ++solverState->NumDisjunctionTermsPruned;
+      if (TC.getLangOpts().DebugConstraintSolver) {
+        auto &log = getASTContext().TypeCheckerDebug->getStream();
+        log.indent(solverState->depth)
+          << "(skipping inapplicable ";
+        constraint->print(log, &TC.Context.SourceMgr);
+        log << ")\n";
+      }
+      continue;
+    }
+
     // Try to solve the system with this option in the disjunction.
     SolverScope scope(*this);
     ++solverState->NumDisjunctionTerms;
@@ -1944,6 +1944,16 @@ private:
   /// \returns true if an error occurred, false otherwise.
   bool solveSimplified(SmallVectorImpl<Solution> &solutions,
                        FreeTypeVariableBinding allowFreeTypeVariables);
+
+  /// \brief Determine whether the given term of an operator's overload
+  /// disjunction is already known to fail, because the overload it binds
+  /// cannot accept the arguments it is about to be applied to.
+  ///
+  /// Only applications whose argument types are fully resolved and whose
+  /// overload has a concrete function type are considered; the outcome for
+  /// those does not depend on the rest of the system, so it is remembered
+  /// in the type checker and shared with every later constraint system.
+  bool isDisjunctionTermKnownToFail(Constraint *term);
  public:
   /// \brief Solve the system of constraints.
   ///
@@ -35,6 +35,7 @@
 #include "swift/Serialization/SerializedModuleLoader.h"
 #include "swift/Strings.h"
 #include "swift/Basic/Defer.h"
+#include "swift/Basic/TraceEvents.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/APSInt.h"
@@ -6156,6 +6157,16 @@ void TypeChecker::validateDecl(ValueDecl *D, bool resolveTypeParams) {
   if (hasEnabledForbiddenTypecheckPrefix())
     checkForForbiddenPrefix(D);
 
+  // Only trace the validation of declarations that have not been given a
+  // type yet; validateDecl() is called again and again for the others.
+  Optional<TraceScope> trace;
+  if (TraceScope::isTracingEnabled() && !D->hasType()) {
+    trace.emplace("validate-decl", [&](llvm::raw_ostream &OS) {
+      OS << D->getFullName() << " at ";
+      D->getLoc().print(OS, Context.SourceMgr);
+    });
+  }
+
   validateAccessibility(D);
 
   // Validate the context. We don't do this for generic parameters,
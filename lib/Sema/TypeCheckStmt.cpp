@@ -26,6 +26,7 @@
 #include "swift/Basic/Range.h"
 #include "swift/Basic/STLExtras.h"
 #include "swift/Basic/SourceManager.h"
+#include "swift/Basic/TraceEvents.h"
 #include "swift/Parse/Lexer.h"
 #include "swift/Parse/LocalContext.h"
 #include "llvm/ADT/DenseMap.h"
@@ -1173,6 +1174,10 @@ bool TypeChecker::typeCheckAbstractFunctionBody(AbstractFunctionDecl *AFD) {
   Optional<FunctionBodyTimer> timer;
   if (DebugTimeFunctionBodies)
     timer.emplace(AFD);
+  TraceScope trace("function-body", [&](llvm::raw_ostream &OS) {
+    OS << AFD->getFullName() << " at ";
+    AFD->getLoc().print(OS, Context.SourceMgr);
+  });
 
   if (typeCheckAbstractFunctionBodyUntil(AFD, SourceLoc()))
     return true;
@@ -1415,6 +1420,10 @@ void TypeChecker::typeCheckClosureBody(ClosureExpr *closure) {
   Optional<FunctionBodyTimer> timer;
   if (DebugTimeFunctionBodies)
     timer.emplace(closure);
+  TraceScope trace("function-body", [&](llvm::raw_ostream &OS) {
+    OS << "closure at ";
+    closure->getLoc().print(OS, Context.SourceMgr);
+  });
 
   StmtChecker(*this, closure).typeCheckBody(body);
   if (body) {
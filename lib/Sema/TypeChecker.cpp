@@ -504,6 +504,12 @@ void swift::typeCheckExternalDefinitions(SourceFile &SF) {
   typeCheckFunctionsAndExternalDecls(TC);
 }
 
+void swift::typeCheckAbstractFunctionBody(AbstractFunctionDecl *AFD) {
+  TypeChecker TC(AFD->getASTContext());
+  TC.definedFunctions.push_back(AFD);
+  typeCheckFunctionsAndExternalDecls(TC);
+}
+
 void swift::performTypeChecking(SourceFile &SF, TopLevelContext &TLC,
                                 OptionSet<TypeCheckingFlags> Options,
                                 unsigned StartElem) {
@@ -467,6 +467,12 @@ public:
   // Caches whether a given declaration is "as specialized" as another.
   llvm::DenseMap<std::pair<ValueDecl*, ValueDecl*>, bool> 
     specializedOverloadComparisonCache;
+
+  /// Caches whether a given operator overload can accept arguments of a
+  /// given, fully-resolved type, as computed by the constraint solver for
+  /// the terms of overload disjunctions.
+  llvm::DenseMap<std::pair<ValueDecl *, CanType>, bool>
+    OverloadApplicabilityCache;
   
   // We delay validation of C and Objective-C type-bridging functions in the
   // standard library until we encounter a declaration that requires one. This
@@ -1213,8 +1213,6 @@ bool SILDeserializer::readSILInstruction(SILFunction *Fn, SILBasicBlock *BB,
   UNARY_INSTRUCTION(CopyBlock)
   UNARY_INSTRUCTION(StrongPin)
   UNARY_INSTRUCTION(StrongUnpin)
-  UNARY_INSTRUCTION(StrongRetain)
-  UNARY_INSTRUCTION(StrongRelease)
   UNARY_INSTRUCTION(StrongRetainUnowned)
   UNARY_INSTRUCTION(UnownedRetain)
   UNARY_INSTRUCTION(UnownedRelease)
@@ -1224,6 +1222,23 @@ bool SILDeserializer::readSILInstruction(SILFunction *Fn, SILBasicBlock *BB,
   UNARY_INSTRUCTION(DebugValueAddr)
 #undef UNARY_INSTRUCTION
 
+  case ValueKind::StrongRetainInst:
+  case ValueKind::StrongReleaseInst: {
+    assert(RecordKind == SIL_ONE_OPERAND &&
+           "Layout should be OneOperand.");
+    SILValue Operand = getLocalValue(ValID,
+        getSILType(MF->getType(TyID), (SILValueCategory)TyCategory));
+    RefCountingInst *RCI;
+    if ((ValueKind)OpCode == ValueKind::StrongRetainInst)
+      RCI = Builder.createStrongRetain(Loc, Operand);
+    else
+      RCI = Builder.createStrongRelease(Loc, Operand);
+    if (Attr)
+      RCI->setNonAtomic();
+    ResultVal = RCI;
+    break;
+  }
+
   case ValueKind::LoadUnownedInst: {
     auto Ty = MF->getType(TyID);
     bool isTake = (Attr > 0);
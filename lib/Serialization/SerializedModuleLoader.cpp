@@ -17,10 +17,18 @@
 #include "swift/AST/DiagnosticsSema.h"
 #include "swift/Basic/STLExtras.h"
 #include "swift/Basic/SourceManager.h"
+#include "swift/Basic/TraceEvents.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Timer.h"
+#include <memory>
+#include <mutex>
 #include <system_error>
 
 using namespace swift;
@@ -35,18 +43,129 @@ SerializedModuleLoader::SerializedModuleLoader(ASTContext &ctx,
   : ModuleLoader(tracker), Ctx(ctx) {}
 SerializedModuleLoader::~SerializedModuleLoader() = default;
 
+namespace {
+/// A read-only view of a module file mapping owned by the process-wide
+/// ModuleFileCache.
+class SharedModuleBuffer final : public llvm::MemoryBuffer {
+  std::shared_ptr<llvm::MemoryBuffer> Mapping;
+
+public:
+  explicit SharedModuleBuffer(std::shared_ptr<llvm::MemoryBuffer> mapping)
+    : Mapping(std::move(mapping)) {
+    init(Mapping->getBufferStart(), Mapping->getBufferEnd(),
+         /*RequiresNullTerminator=*/false);
+  }
+
+  const char *getBufferIdentifier() const override {
+    return Mapping->getBufferIdentifier();
+  }
+
+  BufferKind getBufferKind() const override {
+    return Mapping->getBufferKind();
+  }
+};
+
+/// Maps module and module documentation files into memory, sharing one
+/// mapping among all SerializedModuleLoaders in the process (several
+/// CompilerInstances in SourceKit or LLDB, for example) for as long as any
+/// of them keeps the module loaded.
+///
+/// Files are mapped read-only without requiring a null terminator, so even
+/// files whose size is a multiple of the page size are mapped rather than
+/// read. ModuleFile only ever reads from the buffer, and its on-disk hash
+/// tables point straight into it, so untouched parts of a large module are
+/// never paged in, and the pages that are come from the OS page cache that
+/// concurrent frontend jobs importing the same module share.
+class ModuleFileCache {
+  struct Entry {
+    llvm::sys::fs::file_status Status;
+    std::weak_ptr<llvm::MemoryBuffer> Mapping;
+  };
+
+  std::mutex Lock;
+  llvm::StringMap<Entry> Entries;
+
+  static bool isSameFile(const llvm::sys::fs::file_status &lhs,
+                         const llvm::sys::fs::file_status &rhs) {
+    return llvm::sys::fs::equivalent(lhs, rhs) &&
+           lhs.getSize() == rhs.getSize() &&
+           lhs.getLastModificationTime() == rhs.getLastModificationTime();
+  }
+
+public:
+  static ModuleFileCache &get() {
+    static ModuleFileCache Cache;
+    return Cache;
+  }
+
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> getFile(StringRef path);
+};
+} // end unnamed namespace
+
+llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>>
+ModuleFileCache::getFile(StringRef path) {
+  std::lock_guard<std::mutex> guard(Lock);
+
+  auto found = Entries.find(path);
+  if (found != Entries.end()) {
+    // Reuse the existing mapping if the file hasn't changed since.
+    llvm::sys::fs::file_status currentStatus;
+    if (auto mapping = found->second.Mapping.lock()) {
+      if (!llvm::sys::fs::status(path, currentStatus) &&
+          isSameFile(currentStatus, found->second.Status)) {
+        return std::unique_ptr<llvm::MemoryBuffer>(
+            new SharedModuleBuffer(std::move(mapping)));
+      }
+    }
+
+    // The file has changed, or nothing uses its mapping any more.
+    Entries.erase(found);
+  }
+
+  // Take the status from the descriptor that is mapped, so that a file
+  // replaced in the meantime can't be mistaken for the mapped one.
+  int FD;
+  if (std::error_code err = llvm::sys::fs::openFileForRead(path, FD))
+    return err;
+  llvm::sys::fs::file_status status;
+  std::error_code err = llvm::sys::fs::status(FD, status);
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> bufferOrErr = err;
+  if (!err) {
+    bufferOrErr = llvm::MemoryBuffer::getOpenFile(
+        FD, path, status.getSize(), /*RequiresNullTerminator=*/false);
+  }
+  llvm::sys::Process::SafelyCloseFileDescriptor(FD);
+  if (!bufferOrErr)
+    return bufferOrErr.getError();
+
+  // Drop the entries of other files that are no longer mapped, so that the
+  // cache doesn't grow with every module ever loaded.
+  for (auto i = Entries.begin(), e = Entries.end(); i != e;) {
+    auto current = i++;
+    if (current->second.Mapping.expired())
+      Entries.erase(current);
+  }
+
+  std::shared_ptr<llvm::MemoryBuffer> mapping(std::move(bufferOrErr.get()));
+  Entries[path] = Entry{status, mapping};
+  return std::unique_ptr<llvm::MemoryBuffer>(
+      new SharedModuleBuffer(std::move(mapping)));
+}
+
 static std::error_code
 openModuleFiles(StringRef DirName, StringRef ModuleFilename,
                 StringRef ModuleDocFilename,
                 std::unique_ptr<llvm::MemoryBuffer> &ModuleBuffer,
                 std::unique_ptr<llvm::MemoryBuffer> &ModuleDocBuffer,
                 llvm::SmallVectorImpl<char> &Scratch) {
+  auto &Cache = ModuleFileCache::get();
+
   // Try to open the module file first.  If we fail, don't even look for the
   // module documentation file.
   Scratch.clear();
   llvm::sys::path::append(Scratch, DirName, ModuleFilename);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> ModuleOrErr =
-    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()));
+    Cache.getFile(StringRef(Scratch.data(), Scratch.size()));
   if (!ModuleOrErr)
     return ModuleOrErr.getError();
 
@@ -55,7 +174,7 @@ openModuleFiles(StringRef DirName, StringRef ModuleFilename,
   Scratch.clear();
   llvm::sys::path::append(Scratch, DirName, ModuleDocFilename);
   llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> ModuleDocOrErr =
-    llvm::MemoryBuffer::getFile(StringRef(Scratch.data(), Scratch.size()));
+    Cache.getFile(StringRef(Scratch.data(), Scratch.size()));
   if (!ModuleDocOrErr &&
       ModuleDocOrErr.getError() != std::errc::no_such_file_or_directory) {
     return ModuleDocOrErr.getError();
@@ -331,6 +450,59 @@ FileUnit *SerializedModuleLoader::loadAST(
   return nullptr;
 }
 
+namespace {
+  /// Measures the loading of one module for -debug-time-module-loading and
+  /// the trace written for -trace-events-output.
+  ///
+  /// This covers finding and mapping the files and deserializing what is
+  /// needed up front; declarations are deserialized lazily afterwards and
+  /// are accounted to whatever needed them.
+  class ModuleLoadTimer {
+    Identifier Name;
+    bool PrintTime;
+    TraceScope Trace;
+    llvm::TimeRecord StartTime = llvm::TimeRecord::getCurrentTime();
+    size_t StartMallocUsage = llvm::sys::Process::GetMallocUsage();
+    std::string Path;
+    uint64_t MappedBytes = 0;
+
+  public:
+    ModuleLoadTimer(Identifier name, bool printTime)
+      : Name(name), PrintTime(printTime), Trace("module-load", name.str()) {}
+
+    /// Records the files the module is loaded from.
+    void setFiles(const llvm::MemoryBuffer &module,
+                  const llvm::MemoryBuffer *moduleDoc) {
+      Path = module.getBufferIdentifier();
+      MappedBytes = module.getBufferSize();
+      if (moduleDoc)
+        MappedBytes += moduleDoc->getBufferSize();
+    }
+
+    ~ModuleLoadTimer() {
+      if (!PrintTime && !Trace.isRecording())
+        return;
+
+      size_t mallocUsage = llvm::sys::Process::GetMallocUsage();
+      size_t heapBytes = mallocUsage > StartMallocUsage ?
+                           mallocUsage - StartMallocUsage : 0;
+      Trace.addArg("mapped-bytes", MappedBytes);
+      Trace.addArg("heap-bytes", heapBytes);
+
+      // Don't report modules that this loader didn't find.
+      if (!PrintTime || Path.empty())
+        return;
+
+      llvm::TimeRecord endTime = llvm::TimeRecord::getCurrentTime(false);
+      auto elapsed = endTime.getWallTime() - StartTime.getWallTime();
+      llvm::errs() << llvm::format("%0.1f", elapsed * 1000) << "ms\t"
+                   << (heapBytes + 1023) / 1024 << "KB heap\t"
+                   << (MappedBytes + 1023) / 1024 << "KB mapped\t"
+                   << Name << "\t" << Path << "\n";
+    }
+  };
+} // end unnamed namespace
+
 Module *SerializedModuleLoader::loadModule(SourceLoc importLoc,
                                            Module::AccessPathTy path) {
   // FIXME: Swift submodules?
@@ -340,6 +512,8 @@ Module *SerializedModuleLoader::loadModule(SourceLoc importLoc,
   auto moduleID = path[0];
   bool isFramework = false;
 
+  ModuleLoadTimer timer(moduleID.first, DebugTimeModuleLoading);
+
   std::unique_ptr<llvm::MemoryBuffer> moduleInputBuffer;
   std::unique_ptr<llvm::MemoryBuffer> moduleDocInputBuffer;
   // First see if we find it in the registered memory buffers.
@@ -371,6 +545,7 @@ Module *SerializedModuleLoader::loadModule(SourceLoc importLoc,
   }
 
   assert(moduleInputBuffer);
+  timer.setFiles(*moduleInputBuffer, moduleDocInputBuffer.get());
 
   auto M = Module::create(moduleID.first, Ctx);
   Ctx.LoadedModules[moduleID.first] = M;
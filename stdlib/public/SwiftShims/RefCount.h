@@ -100,6 +100,14 @@ class StrongRefCount {
     __atomic_fetch_add(&refCount, n << RC_FLAGS_COUNT, __ATOMIC_RELAXED);
   }
 
+  // Increment the reference count without an atomic read-modify-write.
+  //
+  // Precondition: no other thread can access the object.
+  void incrementNonAtomic() {
+    uint32_t val = __atomic_load_n(&refCount, __ATOMIC_RELAXED);
+    __atomic_store_n(&refCount, val + RC_ONE, __ATOMIC_RELAXED);
+  }
+
   // Try to simultaneously set the pinned flag and increment the
   // reference count.  If the flag is already set, don't increment the
   // reference count.
@@ -158,6 +166,32 @@ class StrongRefCount {
     return doDecrementShouldDeallocateN<false>(n);
   }
 
+  // Decrement the reference count without an atomic read-modify-write.
+  // Return true if the caller should now deallocate the object.
+  //
+  // Precondition: no other thread can access the object.
+  bool decrementShouldDeallocateNonAtomic() {
+    uint32_t oldval = __atomic_load_n(&refCount, __ATOMIC_RELAXED);
+    uint32_t newval = oldval - RC_ONE;
+
+    assert(oldval >= RC_ONE &&
+           "releasing reference with a refcount of zero");
+
+    // As in doDecrementShouldDeallocate, a nonzero result under this mask
+    // means we must not start deallocation.
+    if ((newval & (RC_COUNT_MASK | RC_PINNED_FLAG | RC_DEALLOCATING_FLAG))
+          != 0) {
+      __atomic_store_n(&refCount, newval, __ATOMIC_RELAXED);
+      return false;
+    }
+
+    // Nobody else can see the object, so there is no weak retain to race
+    // with and no other thread's writes to acquire.
+    __atomic_store_n(&refCount, (uint32_t)RC_DEALLOCATING_FLAG,
+                     __ATOMIC_RELAXED);
+    return true;
+  }
+
   // Set the RC_DEALLOCATING_FLAG flag non-atomically.
   //
   // Precondition: the reference count must be 1
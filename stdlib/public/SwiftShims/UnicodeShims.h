@@ -17,8 +17,13 @@
 #ifndef SWIFT_STDLIB_SHIMS_UNICODESHIMS_H_
 #define SWIFT_STDLIB_SHIMS_UNICODESHIMS_H_
 
+#include "SwiftStdint.h"
 #include "Visibility.h"
 
+#ifdef __cplusplus
+namespace swift { extern "C" {
+#endif
+
 SWIFT_RUNTIME_STDLIB_INTERFACE
 extern const __swift_uint8_t *_swift_stdlib_GraphemeClusterBreakPropertyTrie;
 
@@ -80,6 +85,38 @@ __attribute__((pure))
 __swift_intptr_t _swift_stdlib_unicode_hash_ascii(
   const char *Str, __swift_int32_t Length);
 
+/// The state of hashing a string that is stored in several chunks, which
+/// gives the same result as _swift_stdlib_unicode_hash() on the whole string.
+///
+/// The chunks are hashed in place as they are appended, except for the
+/// code units near their ends that a combining mark in the next chunk could
+/// change; those are copied to \c Pending until the next chunk is appended.
+typedef struct _swift_stdlib_unicode_hasher {
+  __swift_intptr_t HashState;
+  __swift_uint16_t *Pending;
+  __swift_int32_t PendingLength;
+  __swift_int32_t PendingCapacity;
+} _swift_stdlib_unicode_hasher;
+
+SWIFT_RUNTIME_STDLIB_INTERFACE
+void _swift_stdlib_unicode_hasher_init(_swift_stdlib_unicode_hasher *Hasher);
+
+SWIFT_RUNTIME_STDLIB_INTERFACE
+void _swift_stdlib_unicode_hasher_append(
+  _swift_stdlib_unicode_hasher *Hasher,
+  const __swift_uint16_t *Str, __swift_int32_t Length);
+
+SWIFT_RUNTIME_STDLIB_INTERFACE
+void _swift_stdlib_unicode_hasher_append_ascii(
+  _swift_stdlib_unicode_hasher *Hasher,
+  const char *Str, __swift_int32_t Length);
+
+/// Returns the hash of the appended chunks and releases the hasher's
+/// memory; it must be initialized again before it is reused.
+SWIFT_RUNTIME_STDLIB_INTERFACE
+__swift_intptr_t _swift_stdlib_unicode_hasher_finish(
+  _swift_stdlib_unicode_hasher *Hasher);
+
 SWIFT_RUNTIME_STDLIB_INTERFACE
 __swift_int32_t _swift_stdlib_unicode_strToUpper(
   __swift_uint16_t *Destination, __swift_int32_t DestinationCapacity,
@@ -90,5 +127,8 @@ __swift_int32_t _swift_stdlib_unicode_strToLower(
   __swift_uint16_t *Destination, __swift_int32_t DestinationCapacity,
   const __swift_uint16_t *Source, __swift_int32_t SourceLength);
 
+#ifdef __cplusplus
+}} // extern "C", namespace swift
+#endif
 
 #endif
@@ -16,17 +16,99 @@
 
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Heap.h"
+#include "swift/Runtime/Once.h"
+#include "HeapCache.h"
 #include "Private.h"
 #include "swift/Runtime/Debug.h"
 #include <stdlib.h>
+#include <string.h>
 
 using namespace swift;
 
+std::atomic<heapcache::AllocatorKind>
+swift::heapcache::SelectedAllocator{heapcache::AllocatorKind::Unknown};
+pthread_key_t swift::heapcache::ThreadCacheKey;
+
+static_assert(heapcache::NumSizeClasses == 16,
+              "update the counts of TornDownThreadCache");
+heapcache::ThreadCache swift::heapcache::TornDownThreadCache = {
+  {},
+  {
+    MaxBlocksPerClass, MaxBlocksPerClass, MaxBlocksPerClass, MaxBlocksPerClass,
+    MaxBlocksPerClass, MaxBlocksPerClass, MaxBlocksPerClass, MaxBlocksPerClass,
+    MaxBlocksPerClass, MaxBlocksPerClass, MaxBlocksPerClass, MaxBlocksPerClass,
+    MaxBlocksPerClass, MaxBlocksPerClass, MaxBlocksPerClass, MaxBlocksPerClass,
+  },
+};
+
+/// Returns every cached block to malloc when a thread exits.
+static void destroyThreadCache(void *value) {
+  auto cache = static_cast<heapcache::ThreadCache *>(value);
+
+  // Keep the placeholder installed for as long as destructors run, so that
+  // later ones don't create a new cache. This costs at most
+  // PTHREAD_DESTRUCTOR_ITERATIONS extra calls.
+  if (cache == &heapcache::TornDownThreadCache) {
+    pthread_setspecific(heapcache::ThreadCacheKey, cache);
+    return;
+  }
+
+  for (size_t i = 0; i < heapcache::NumSizeClasses; ++i) {
+    auto block = cache->FreeLists[i];
+    while (block) {
+      auto next = block->Next;
+      free(block);
+      block = next;
+    }
+  }
+  free(cache);
+  pthread_setspecific(heapcache::ThreadCacheKey,
+                      &heapcache::TornDownThreadCache);
+}
+
+/// Set by requestThreadCache() to turn the cache on regardless of the
+/// environment.
+static bool ThreadCacheRequested = false;
+
+static void initializeAllocator(void *) {
+  auto kind = heapcache::AllocatorKind::Malloc;
+  const char *name = getenv("SWIFT_RUNTIME_ALLOCATOR");
+  bool wantCache = ThreadCacheRequested ||
+                   (name && strcmp(name, "thread-cache") == 0);
+  if (wantCache &&
+      pthread_key_create(&heapcache::ThreadCacheKey, destroyThreadCache) == 0)
+    kind = heapcache::AllocatorKind::ThreadCache;
+  heapcache::SelectedAllocator.store(kind, std::memory_order_release);
+}
+
+heapcache::AllocatorKind swift::heapcache::selectAllocator() {
+  static swift_once_t Predicate;
+  swift_once(&Predicate, initializeAllocator);
+  return SelectedAllocator.load(std::memory_order_acquire);
+}
+
+bool swift::heapcache::requestThreadCache() {
+  ThreadCacheRequested = true;
+  return selectAllocator() == AllocatorKind::ThreadCache;
+}
+
+heapcache::ThreadCache *swift::heapcache::createThreadCache() {
+  auto cache = static_cast<ThreadCache *>(calloc(1, sizeof(ThreadCache)));
+  if (!cache) swift::crash("Could not allocate memory.");
+  pthread_setspecific(ThreadCacheKey, cache);
+  return cache;
+}
+
 SWIFT_RT_ENTRY_VISIBILITY
 void *swift::swift_slowAlloc(size_t size, size_t alignMask)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
-  // FIXME: use posix_memalign if alignMask is larger than the system guarantee.
-  void *p = malloc(size);
+  void *p;
+  if (heapcache::isCacheable(size, alignMask) && heapcache::isEnabled())
+    p = heapcache::allocate(size);
+  else
+    // FIXME: use posix_memalign if alignMask is larger than the system
+    // guarantee.
+    p = malloc(size);
   if (!p) swift::crash("Could not allocate memory.");
   return p;
 }
@@ -34,5 +116,8 @@ void *swift::swift_slowAlloc(size_t size, size_t alignMask)
 SWIFT_RT_ENTRY_VISIBILITY
 void swift::swift_slowDealloc(void *ptr, size_t bytes, size_t alignMask)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
-  free(ptr);
+  if (heapcache::isCacheable(bytes, alignMask) && heapcache::isEnabled())
+    heapcache::deallocate(ptr, bytes);
+  else
+    free(ptr);
 }
@@ -0,0 +1,159 @@
+//===--- HeapCache.h - Thread-caching size-class allocator ------*- C++ -*-===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// An optional front end to malloc for the small, fixed-size allocations that
+// make up most Swift objects, closure contexts and boxes.
+//
+// Each thread keeps a free list per 16-byte size class. Freed blocks are
+// pushed onto the freeing thread's list and popped by the next allocation of
+// the same class on that thread, with no atomic operations. Every block is
+// still an ordinary malloc allocation of its class size, so blocks may move
+// between threads, be released with free(), and report a sensible
+// malloc_size(); the cache only delays returning them to malloc.
+//
+// The cache is off by default. Setting SWIFT_RUNTIME_ALLOCATOR=thread-cache
+// in the environment turns it on for the lifetime of the process.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SWIFT_RUNTIME_HEAPCACHE_H
+#define SWIFT_RUNTIME_HEAPCACHE_H
+
+#include "llvm/Support/Compiler.h"
+#include <atomic>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+namespace swift {
+namespace heapcache {
+
+/// Cached allocations are rounded up to a multiple of this size. It is also
+/// the strongest alignment the cache promises, which matches what malloc
+/// guarantees on the platforms we support.
+constexpr size_t SizeClassGranule = 16;
+
+/// The number of size classes. Allocations larger than
+/// SizeClassGranule * NumSizeClasses bytes go straight to malloc.
+constexpr size_t NumSizeClasses = 16;
+
+constexpr size_t MaxCachedSize = SizeClassGranule * NumSizeClasses;
+constexpr size_t MaxCachedAlignMask = SizeClassGranule - 1;
+
+/// The most blocks a thread keeps on any one free list. Beyond this, freed
+/// blocks go back to malloc, so an idle thread holds at most a few hundred
+/// kilobytes.
+constexpr unsigned MaxBlocksPerClass = 64;
+
+struct FreeBlock {
+  FreeBlock *Next;
+};
+
+struct ThreadCache {
+  FreeBlock *FreeLists[NumSizeClasses];
+  unsigned Counts[NumSizeClasses];
+};
+
+enum class AllocatorKind : uint8_t {
+  /// The environment has not been checked yet.
+  Unknown,
+  Malloc,
+  ThreadCache,
+};
+
+extern std::atomic<AllocatorKind> SelectedAllocator;
+extern pthread_key_t ThreadCacheKey;
+
+/// The cache of a thread whose own cache has already been destroyed because
+/// the thread is exiting. It has no free blocks and every list is full, so
+/// allocations and deallocations that happen later in the thread's teardown,
+/// such as in other thread-specific data destructors, go straight to malloc
+/// and free instead of creating a cache that would never be destroyed.
+extern ThreadCache TornDownThreadCache;
+
+/// Checks the environment and records which allocator to use.
+AllocatorKind selectAllocator();
+
+/// Turns the cache on as if the environment had asked for it, for tests
+/// that must not depend on the environment. The choice is made only once,
+/// at the first allocation, so this must be called before it; a process
+/// that has already allocated keeps its allocator.
+///
+/// \returns whether the cache is on.
+bool requestThreadCache();
+
+/// Creates and registers the current thread's cache.
+ThreadCache *createThreadCache();
+
+/// Whether allocations should go through the thread caches.
+static inline bool isEnabled() {
+  auto kind = SelectedAllocator.load(std::memory_order_acquire);
+  if (LLVM_UNLIKELY(kind == AllocatorKind::Unknown))
+    kind = selectAllocator();
+  return kind == AllocatorKind::ThreadCache;
+}
+
+/// Whether an allocation of the given size and alignment can be served
+/// from the thread caches.
+static inline bool isCacheable(size_t size, size_t alignMask) {
+  return size <= MaxCachedSize && alignMask <= MaxCachedAlignMask;
+}
+
+static inline size_t getSizeClass(size_t size) {
+  return size == 0 ? 0 : (size - 1) / SizeClassGranule;
+}
+
+static inline size_t getSizeOfClass(size_t sizeClass) {
+  return (sizeClass + 1) * SizeClassGranule;
+}
+
+static inline ThreadCache *getThreadCache() {
+  auto cache = static_cast<ThreadCache *>(pthread_getspecific(ThreadCacheKey));
+  if (LLVM_LIKELY(cache != nullptr))
+    return cache;
+  return createThreadCache();
+}
+
+/// Allocates a cacheable block. May return null if malloc fails.
+static inline void *allocate(size_t size) {
+  size_t sizeClass = getSizeClass(size);
+  ThreadCache *cache = getThreadCache();
+  if (FreeBlock *block = cache->FreeLists[sizeClass]) {
+    cache->FreeLists[sizeClass] = block->Next;
+    --cache->Counts[sizeClass];
+    return block;
+  }
+  return malloc(getSizeOfClass(sizeClass));
+}
+
+/// Frees a cacheable block.
+///
+/// \p size may be smaller than the size the block was allocated with, as it
+/// is for objects with tail-allocated storage. The block then goes onto a
+/// smaller class's list, which it is still large enough to serve.
+static inline void deallocate(void *ptr, size_t size) {
+  size_t sizeClass = getSizeClass(size);
+  ThreadCache *cache = getThreadCache();
+  if (LLVM_UNLIKELY(cache->Counts[sizeClass] == MaxBlocksPerClass)) {
+    free(ptr);
+    return;
+  }
+  auto block = static_cast<FreeBlock *>(ptr);
+  block->Next = cache->FreeLists[sizeClass];
+  cache->FreeLists[sizeClass] = block;
+  ++cache->Counts[sizeClass];
+}
+
+} // end namespace heapcache
+} // end namespace swift
+
+#endif
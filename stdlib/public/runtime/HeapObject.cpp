@@ -20,6 +20,7 @@
 #include "swift/Runtime/Metadata.h"
 #include "swift/ABI/System.h"
 #include "llvm/Support/MathExtras.h"
+#include "HeapCache.h"
 #include "MetadataCache.h"
 #include "Private.h"
 #include "swift/Runtime/Debug.h"
@@ -60,9 +61,16 @@ SWIFT_RT_ENTRY_IMPL(swift_allocObject)(HeapMetadata const *metadata,
                                        size_t requiredAlignmentMask)
     SWIFT_CC(RegisterPreservingCC_IMPL) {
   assert(isAlignmentMask(requiredAlignmentMask));
-  auto object = reinterpret_cast<HeapObject *>(
-      SWIFT_RT_ENTRY_CALL(swift_slowAlloc)(requiredSize,
-                                           requiredAlignmentMask));
+  HeapObject *object;
+  if (heapcache::isCacheable(requiredSize, requiredAlignmentMask) &&
+      heapcache::isEnabled()) {
+    object = static_cast<HeapObject *>(heapcache::allocate(requiredSize));
+    if (!object) swift::crash("Could not allocate memory.");
+  } else {
+    object = reinterpret_cast<HeapObject *>(
+        SWIFT_RT_ENTRY_CALL(swift_slowAlloc)(requiredSize,
+                                             requiredAlignmentMask));
+  }
   // FIXME: this should be a placement new but that adds a null check
   object->metadata = metadata;
   object->refCount.init();
@@ -215,6 +223,10 @@ public:
     return "BoxCache";
   }
 
+  static MetadataAllocationKind getAllocationKind() {
+    return MetadataAllocationKind::BoxCache;
+  }
+
   FullMetadata<GenericBoxHeapMetadata> *getData() {
     return &Metadata;
   }
@@ -344,6 +356,21 @@ void SWIFT_RT_ENTRY_IMPL(swift_release_n)(HeapObject *object, uint32_t n)
   }
 }
 
+SWIFT_RT_ENTRY_VISIBILITY
+void swift::swift_nonatomic_retain(HeapObject *object)
+    SWIFT_CC(RegisterPreservingCC_IMPL) {
+  if (object)
+    object->refCount.incrementNonAtomic();
+}
+
+SWIFT_RT_ENTRY_VISIBILITY
+void swift::swift_nonatomic_release(HeapObject *object)
+    SWIFT_CC(RegisterPreservingCC_IMPL) {
+  if (object && object->refCount.decrementShouldDeallocateNonAtomic()) {
+    _swift_release_dealloc(object);
+  }
+}
+
 void swift::swift_setDeallocating(HeapObject *object) {
   object->refCount.decrementFromOneAndDeallocateNonAtomic();
 }
@@ -689,9 +716,16 @@ void swift::swift_deallocObject(HeapObject *object,
   // atomic decrement (and has the ability to reconstruct
   // allocatedSize and allocatedAlignMask).
   if (object->weakRefCount.getCount() == 1) {
-    SWIFT_RT_ENTRY_CALL(swift_slowDealloc)
-         (object, allocatedSize,
-          allocatedAlignMask);
+    // Compiler-emitted deallocations of boxes, closure contexts and most
+    // class instances pass a constant size, so this is usually a direct push
+    // onto the thread's free list.
+    if (heapcache::isCacheable(allocatedSize, allocatedAlignMask) &&
+        heapcache::isEnabled())
+      heapcache::deallocate(object, allocatedSize);
+    else
+      SWIFT_RT_ENTRY_CALL(swift_slowDealloc)
+           (object, allocatedSize,
+            allocatedAlignMask);
   } else {
     SWIFT_RT_ENTRY_CALL(swift_unownedRelease)(object);
   }
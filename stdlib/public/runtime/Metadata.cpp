@@ -22,6 +22,7 @@
 #include "swift/Runtime/HeapObject.h"
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Mutex.h"
+#include "swift/Runtime/Once.h"
 #include "swift/Strings.h"
 #include "MetadataCache.h"
 #include <algorithm>
@@ -56,40 +57,311 @@
 using namespace swift;
 using namespace metadataimpl;
 
-void *MetadataAllocator::alloc(size_t size) {
+namespace {
+  /// A run of pages that was mapped at once and is handed out one page at a
+  /// time.
+  struct MetadataPageChunk {
+    char *Base;
+    size_t NumPages;
+    std::atomic<size_t> NextPage;
+
+    MetadataPageChunk(char *base, size_t numPages, size_t nextPage)
+      : Base(base), NumPages(numPages), NextPage(nextPage) {}
+  };
+
+  /// The page a thread is currently carving metadata allocations out of.
+  struct MetadataArena {
+    char *Next;
+    char *End;
+
+    /// This arena's share of the allocation statistics. Only the thread
+    /// that owns the arena updates them; they are atomic so that
+    /// swift_getMetadataAllocationStats can read them from other threads.
+    std::atomic<uint64_t> AllocationCounts[NumMetadataAllocationKinds];
+    std::atomic<uint64_t> AllocationBytes[NumMetadataAllocationKinds];
+
+    /// Links in the list of live thread arenas.
+    MetadataArena *PrevArena;
+    MetadataArena *NextArena;
+
+    void recordAllocation(MetadataAllocationKind kind, size_t size) {
+      auto &count = AllocationCounts[size_t(kind)];
+      auto &bytes = AllocationBytes[size_t(kind)];
+      count.store(count.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+      bytes.store(bytes.load(std::memory_order_relaxed) + size,
+                  std::memory_order_relaxed);
+    }
+  };
+
+  /// Every live thread arena, so that their statistics can be collected.
+  struct MetadataArenaList {
+    Mutex Lock;
+    MetadataArena *First;
+
+    /// The arena used when a thread cannot have its own. Its statistics
+    /// also include those of the thread arenas that have been destroyed.
+    MetadataArena Shared;
+  };
+}
+
+/// The number of pages mapped at a time to feed the thread arenas.
+static constexpr size_t MetadataPagesPerChunk = 16;
+
+/// The chunk that free pages are taken from. Chunks are never released,
+/// because a thread may still be claiming a page from one that has just
+/// been replaced.
+static std::atomic<MetadataPageChunk *> CurrentMetadataPageChunk{nullptr};
+
+static Lazy<MetadataArenaList> MetadataArenas;
+
+static std::atomic<uint64_t> MetadataBytesMapped{0};
+
+static const char *const
+MetadataAllocationKindNames[NumMetadataAllocationKinds] = {
+  "GenericCache",
+  "ObjCClassCache",
+  "FunctionCache",
+  "TupleCache",
+  "MetatypeCache",
+  "ExistentialMetatypeCache",
+  "ExistentialCache",
+  "WitnessTableCache",
+  "BoxCache",
+  "ResilientClassLayout",
+};
+
+static uintptr_t getMetadataPageSizeMask() {
 #if defined(__APPLE__)
-  const uintptr_t pagesizeMask = vm_page_mask;
+  return vm_page_mask;
 #else
   static const uintptr_t pagesizeMask = sysconf(_SC_PAGESIZE) - 1;
+  return pagesizeMask;
 #endif
+}
+
+static char *mapMetadataPages(size_t size) {
+  auto mem = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_ANON|MAP_PRIVATE,
+                  VM_TAG_FOR_SWIFT_METADATA, 0);
+  if (mem == MAP_FAILED)
+    crash("unable to allocate memory for metadata cache");
+  MetadataBytesMapped.fetch_add(size, std::memory_order_relaxed);
+  return static_cast<char *>(mem);
+}
+
+/// Take an unused page for a thread arena.
+///
+/// Pages are claimed from the current chunk with a single atomic increment.
+/// When the chunk runs out, the thread that notices maps a new one, keeps
+/// its first page and publishes the rest.
+static char *takeMetadataPage(size_t pageSize) {
+  while (true) {
+    auto chunk = CurrentMetadataPageChunk.load(std::memory_order_acquire);
+    if (chunk) {
+      size_t index = chunk->NextPage.fetch_add(1, std::memory_order_relaxed);
+      if (index < chunk->NumPages)
+        return chunk->Base + index * pageSize;
+    }
+
+    size_t chunkSize = MetadataPagesPerChunk * pageSize;
+    char *base = mapMetadataPages(chunkSize);
+    auto newChunk = new MetadataPageChunk(base, MetadataPagesPerChunk, 1);
+    if (CurrentMetadataPageChunk.compare_exchange_strong(
+          chunk, newChunk, std::memory_order_acq_rel,
+          std::memory_order_acquire))
+      return base;
+
+    // Another thread published a chunk first. Use that one instead.
+    delete newChunk;
+    munmap(base, chunkSize);
+    MetadataBytesMapped.fetch_sub(chunkSize, std::memory_order_relaxed);
+  }
+}
+
+static void *allocateFromArena(MetadataArena &arena,
+                               MetadataAllocationKind kind, size_t size,
+                               uintptr_t pagesizeMask) {
+  arena.recordAllocation(kind, size);
+
   // If the requested size is a page or larger, map page(s) for it
   // specifically.
-  if (LLVM_UNLIKELY(size > pagesizeMask)) {
-    auto mem = mmap(nullptr, (size + pagesizeMask) & ~pagesizeMask,
-                    PROT_READ|PROT_WRITE, MAP_ANON|MAP_PRIVATE,
-                    VM_TAG_FOR_SWIFT_METADATA, 0);
-    if (mem == MAP_FAILED)
-      crash("unable to allocate memory for metadata cache");
-    return mem;
+  if (LLVM_UNLIKELY(size > pagesizeMask))
+    return mapMetadataPages((size + pagesizeMask) & ~pagesizeMask);
+
+  size_t pageSize = pagesizeMask + 1;
+  if (LLVM_UNLIKELY(!arena.Next || size_t(arena.End - arena.Next) < size)) {
+    // The rest of the current page is abandoned.
+    arena.Next = takeMetadataPage(pageSize);
+    arena.End = arena.Next + pageSize;
   }
-  
-  char *end = next + size;
-  
-  // Allocate a new page if we need one.
-  if (LLVM_UNLIKELY(((uintptr_t)next & ~pagesizeMask)
-                      != (((uintptr_t)end & ~pagesizeMask)))){
-    next = (char*)
-      mmap(nullptr, pagesizeMask+1, PROT_READ|PROT_WRITE,
-           MAP_ANON|MAP_PRIVATE, VM_TAG_FOR_SWIFT_METADATA, 0);
+  char *addr = arena.Next;
+  arena.Next += size;
+  return addr;
+}
 
-    if (next == MAP_FAILED)
-      crash("unable to allocate memory for metadata cache");
-    end = next + size;
+static pthread_key_t MetadataArenaKey;
+static bool MetadataArenaKeyIsValid = false;
+
+/// Folds a thread's arena statistics into the shared ones when the thread
+/// exits.
+static void destroyMetadataArena(void *value) {
+  auto arena = static_cast<MetadataArena *>(value);
+  auto &arenas = MetadataArenas.get();
+  {
+    ScopedLock guard(arenas.Lock);
+    for (size_t i = 0; i < NumMetadataAllocationKinds; ++i) {
+      arenas.Shared.AllocationCounts[i].fetch_add(
+        arena->AllocationCounts[i].load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+      arenas.Shared.AllocationBytes[i].fetch_add(
+        arena->AllocationBytes[i].load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+    }
+    if (arena->PrevArena)
+      arena->PrevArena->NextArena = arena->NextArena;
+    else
+      arenas.First = arena->NextArena;
+    if (arena->NextArena)
+      arena->NextArena->PrevArena = arena->PrevArena;
   }
-  
-  char *addr = next;
-  next = end;
-  return addr;
+  delete arena;
+}
+
+static void createMetadataArenaKey(void *) {
+  MetadataArenaKeyIsValid =
+    pthread_key_create(&MetadataArenaKey, destroyMetadataArena) == 0;
+}
+
+/// Returns the current thread's arena, or null if it cannot be created.
+static MetadataArena *getMetadataArena() {
+  static swift_once_t Predicate;
+  swift_once(&Predicate, createMetadataArenaKey);
+  if (!MetadataArenaKeyIsValid)
+    return nullptr;
+
+  auto arena =
+    static_cast<MetadataArena *>(pthread_getspecific(MetadataArenaKey));
+  if (LLVM_LIKELY(arena != nullptr))
+    return arena;
+
+  arena = new (std::nothrow) MetadataArena();
+  if (!arena)
+    return nullptr;
+  if (pthread_setspecific(MetadataArenaKey, arena) != 0) {
+    delete arena;
+    return nullptr;
+  }
+
+  auto &arenas = MetadataArenas.get();
+  ScopedLock guard(arenas.Lock);
+  arena->NextArena = arenas.First;
+  if (arenas.First)
+    arenas.First->PrevArena = arena;
+  arenas.First = arena;
+  return arena;
+}
+
+void *MetadataAllocator::alloc(size_t size) {
+  const uintptr_t pagesizeMask = getMetadataPageSizeMask();
+  size = llvm::alignTo(size, alignof(void*));
+
+  if (auto arena = getMetadataArena())
+    return allocateFromArena(*arena, Kind, size, pagesizeMask);
+
+  // Without thread-local storage, fall back to one shared arena.
+  auto &arenas = MetadataArenas.get();
+  ScopedLock guard(arenas.Lock);
+  return allocateFromArena(arenas.Shared, Kind, size, pagesizeMask);
+}
+
+size_t swift::swift_getMetadataAllocationStats(MetadataAllocationStats *stats,
+                                               size_t count,
+                                               uint64_t *bytesMapped) {
+  auto &arenas = MetadataArenas.get();
+  ScopedLock guard(arenas.Lock);
+  for (size_t i = 0; i < count && i < NumMetadataAllocationKinds; ++i) {
+    stats[i].Kind = MetadataAllocationKindNames[i];
+    stats[i].NumAllocations =
+      arenas.Shared.AllocationCounts[i].load(std::memory_order_relaxed);
+    stats[i].BytesAllocated =
+      arenas.Shared.AllocationBytes[i].load(std::memory_order_relaxed);
+    for (auto arena = arenas.First; arena; arena = arena->NextArena) {
+      stats[i].NumAllocations +=
+        arena->AllocationCounts[i].load(std::memory_order_relaxed);
+      stats[i].BytesAllocated +=
+        arena->AllocationBytes[i].load(std::memory_order_relaxed);
+    }
+  }
+  if (bytesMapped)
+    *bytesMapped = MetadataBytesMapped.load(std::memory_order_relaxed);
+  return NumMetadataAllocationKinds;
+}
+
+void swift::swift_dumpMetadataAllocationStats() {
+  MetadataAllocationStats stats[NumMetadataAllocationKinds];
+  uint64_t bytesMapped;
+  swift_getMetadataAllocationStats(stats, NumMetadataAllocationKinds,
+                                   &bytesMapped);
+
+  uint64_t totalBytes = 0;
+  fprintf(stderr, "%-26s %12s %14s\n", "Metadata cache", "Allocations",
+          "Bytes");
+  for (auto &stat : stats) {
+    fprintf(stderr, "%-26s %12llu %14llu\n", stat.Kind,
+            (unsigned long long)stat.NumAllocations,
+            (unsigned long long)stat.BytesAllocated);
+    totalBytes += stat.BytesAllocated;
+  }
+  fprintf(stderr, "%-26s %12s %14llu\n", "Total", "",
+          (unsigned long long)totalBytes);
+  fprintf(stderr, "%-26s %12s %14llu\n", "Mapped", "",
+          (unsigned long long)bytesMapped);
+}
+
+pthread_key_t swift::MetadataFrontCacheKey;
+std::atomic<bool> swift::MetadataFrontCacheKeyIsValid{false};
+
+static void destroyMetadataFrontCache(void *value) {
+  free(value);
+}
+
+static void createMetadataFrontCacheKey(void *) {
+  if (pthread_key_create(&MetadataFrontCacheKey,
+                         destroyMetadataFrontCache) == 0)
+    MetadataFrontCacheKeyIsValid.store(true, std::memory_order_release);
+}
+
+MetadataFrontCache *swift::createMetadataFrontCache() {
+  static swift_once_t Predicate;
+  swift_once(&Predicate, createMetadataFrontCacheKey);
+  if (!MetadataFrontCacheKeyIsValid.load(std::memory_order_acquire))
+    return nullptr;
+
+  auto cache =
+    static_cast<MetadataFrontCache *>(calloc(1, sizeof(MetadataFrontCache)));
+  if (!cache)
+    return nullptr;
+  if (pthread_setspecific(MetadataFrontCacheKey, cache) != 0) {
+    free(cache);
+    return nullptr;
+  }
+  return cache;
+}
+
+namespace {
+  struct MetadataWaitStripes {
+    static constexpr size_t NumStripes = 64;
+    MetadataWaitStripe Stripes[NumStripes];
+  };
+}
+
+static Lazy<MetadataWaitStripes> WaitStripes;
+
+MetadataWaitStripe &swift::getMetadataWaitStripe(const void *owner,
+                                                 size_t hash) {
+  size_t mixed = (hash >> 4) ^ (reinterpret_cast<uintptr_t>(owner) >> 4);
+  return WaitStripes->Stripes[
+    (mixed ^ (mixed >> 8)) & (MetadataWaitStripes::NumStripes - 1)];
 }
 
 namespace {
@@ -105,6 +377,9 @@ namespace {
       : CacheEntry<GenericCacheEntry, GenericCacheEntryHeader> {
 
     static const char *getName() { return "GenericCache"; }
+    static MetadataAllocationKind getAllocationKind() {
+      return MetadataAllocationKind::GenericCache;
+    }
 
     GenericCacheEntry(unsigned numArguments) {
       NumArguments = numArguments;
@@ -275,6 +550,9 @@ namespace {
 
   public:
     static const char *getName() { return "ObjCClassCache"; }
+    static MetadataAllocationKind getAllocationKind() {
+      return MetadataAllocationKind::ObjCClassCache;
+    }
 
     ObjCClassCacheEntry(size_t numArguments) {}
 
@@ -339,6 +617,9 @@ namespace {
     FullMetadata<FunctionTypeMetadata> Metadata;
 
     static const char *getName() { return "FunctionCache"; }
+    static MetadataAllocationKind getAllocationKind() {
+      return MetadataAllocationKind::FunctionCache;
+    }
 
     FunctionCacheEntry(size_t numArguments) {
       NumArguments = numArguments;
@@ -490,6 +771,9 @@ namespace {
     FullMetadata<TupleTypeMetadata> Metadata;
 
     static const char *getName() { return "TupleCache"; }
+    static MetadataAllocationKind getAllocationKind() {
+      return MetadataAllocationKind::TupleCache;
+    }
 
     TupleCacheEntry(size_t numArguments) {
       NumArguments = numArguments;
@@ -1558,7 +1842,8 @@ static ClassMetadata *_swift_initializeSuperclass(ClassMetadata *theClass,
 
 static MetadataAllocator &getResilientMetadataAllocator() {
   // This should be constant-initialized, but this is safe.
-  static MetadataAllocator allocator;
+  static MetadataAllocator allocator(
+    MetadataAllocationKind::ResilientClassLayout);
   return allocator;
 }
 
@@ -1762,6 +2047,9 @@ namespace {
 
   public:
     static const char *getName() { return "MetatypeCache"; }
+    static MetadataAllocationKind getAllocationKind() {
+      return MetadataAllocationKind::MetatypeCache;
+    }
 
     MetatypeCacheEntry(size_t numArguments) {}
 
@@ -1823,6 +2111,9 @@ namespace {
 
   public:
     static const char *getName() { return "ExistentialMetatypeCache"; }
+    static MetadataAllocationKind getAllocationKind() {
+      return MetadataAllocationKind::ExistentialMetatypeCache;
+    }
 
     ExistentialMetatypeCacheEntry(size_t numArguments) {}
 
@@ -1945,6 +2236,9 @@ namespace {
     FullMetadata<ExistentialTypeMetadata> Metadata;
 
     static const char *getName() { return "ExistentialCache"; }
+    static MetadataAllocationKind getAllocationKind() {
+      return MetadataAllocationKind::ExistentialCache;
+    }
 
     ExistentialCacheEntry(size_t numArguments) {
       Metadata.Protocols.NumProtocols = numArguments;
@@ -2499,6 +2793,9 @@ namespace {
   class WitnessTableCacheEntry : public CacheEntry<WitnessTableCacheEntry> {
   public:
     static const char *getName() { return "WitnessTableCache"; }
+    static MetadataAllocationKind getAllocationKind() {
+      return MetadataAllocationKind::WitnessTableCache;
+    }
 
     WitnessTableCacheEntry(size_t numArguments) {
       assert(numArguments == getNumArguments());
@@ -17,7 +17,9 @@
 #include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Mutex.h"
+#include <atomic>
 #include <condition_variable>
+#include <pthread.h>
 #include <thread>
 
 #ifndef SWIFT_DEBUG_RUNTIME
@@ -26,28 +28,51 @@
 
 namespace swift {
 
+/// The kinds of metadata cache that allocate memory, for statistics.
+enum class MetadataAllocationKind : uint8_t {
+  GenericCache,
+  ObjCClassCache,
+  FunctionCache,
+  TupleCache,
+  MetatypeCache,
+  ExistentialMetatypeCache,
+  ExistentialCache,
+  WitnessTableCache,
+  BoxCache,
+  ResilientClassLayout,
+};
+
+constexpr size_t NumMetadataAllocationKinds =
+  size_t(MetadataAllocationKind::ResilientClassLayout) + 1;
+
 /// A bump pointer for metadata allocations. Since metadata is (currently)
-/// never released, it does not support deallocation. This allocator by itself
-/// is not thread-safe; in concurrent uses, allocations must be guarded by
-/// a lock, such as the per-metadata-cache lock used to guard metadata
-/// instantiations. All allocations are pointer-aligned.
+/// never released, it does not support deallocation. All allocations are
+/// pointer-aligned.
+///
+/// Allocations are carved out of a page owned by the allocating thread, so
+/// the allocator is thread-safe and normally takes no lock. Pages are handed
+/// out from a global list without locking. Because a type's metadata,
+/// witness tables and ivar lists are all allocated by the thread
+/// instantiating it, they end up next to each other in memory rather than
+/// interleaved with other caches' allocations.
+///
+/// The allocator itself only records which kind of cache it allocates for,
+/// so that memory use can be reported per kind through
+/// swift_getMetadataAllocationStats.
 class MetadataAllocator {
-  /// Address of the next available space. The allocator grabs a page at a time,
-  /// so the need for a new page can be determined by page alignment.
-  ///
-  /// Initializing to -1 instead of nullptr ensures that the first allocation
-  /// triggers a page allocation since it will always span a "page" boundary.
-  char *next = (char*)(~(uintptr_t)0U);
-  
+  MetadataAllocationKind Kind;
+
 public:
-  constexpr MetadataAllocator() = default;
+  constexpr MetadataAllocator(MetadataAllocationKind kind) : Kind(kind) {}
 
   // Don't copy or move, please.
   MetadataAllocator(const MetadataAllocator &) = delete;
   MetadataAllocator(MetadataAllocator &&) = delete;
   MetadataAllocator &operator=(const MetadataAllocator &) = delete;
   MetadataAllocator &operator=(MetadataAllocator &&) = delete;
-  
+
+  MetadataAllocationKind getKind() const { return Kind; }
+
   void *alloc(size_t size);
 };
 
@@ -186,6 +211,65 @@ public:
   }
 };
 
+/// A small direct-mapped cache of recently found metadata cache entries,
+/// private to one thread.
+///
+/// Hot lookups such as the metadata for Array<Int> are served from here
+/// without touching any memory another thread writes. Slots only ever point
+/// at entries whose value has been published, and entries are never freed,
+/// so a slot can be trusted once its owner and key match.
+struct MetadataFrontCache {
+  /// The number of slots. Must be a power of two.
+  static constexpr size_t NumSlots = 256;
+
+  struct Slot {
+    /// The MetadataCache that owns Entry, or null for an empty slot.
+    const void *Owner;
+    const void *Entry;
+  };
+  Slot Slots[NumSlots];
+
+  static size_t getSlotIndex(const void *owner, size_t hash) {
+    size_t mixed = hash ^ (reinterpret_cast<uintptr_t>(owner) >> 4);
+    return (mixed ^ (mixed >> 8)) & (NumSlots - 1);
+  }
+};
+
+/// The key for the current thread's MetadataFrontCache. Only valid once
+/// MetadataFrontCacheKeyIsValid is set.
+extern pthread_key_t MetadataFrontCacheKey;
+extern std::atomic<bool> MetadataFrontCacheKeyIsValid;
+
+/// Creates and registers the current thread's front cache. Returns null if
+/// the cache cannot be created, in which case lookups skip it.
+MetadataFrontCache *createMetadataFrontCache();
+
+static inline MetadataFrontCache *getMetadataFrontCache() {
+  if (LLVM_LIKELY(MetadataFrontCacheKeyIsValid.load(
+                    std::memory_order_acquire))) {
+    auto cache = static_cast<MetadataFrontCache *>(
+                   pthread_getspecific(MetadataFrontCacheKey));
+    if (LLVM_LIKELY(cache != nullptr))
+      return cache;
+  }
+  return createMetadataFrontCache();
+}
+
+/// A lock that threads waiting for a metadata cache entry to be initialized
+/// block on.
+struct MetadataWaitStripe {
+  Mutex Lock;
+  Condition Queue;
+};
+
+/// Get the wait stripe for the entry with the given hash in the metadata
+/// cache \p owner.
+///
+/// All metadata caches share one fixed-size table of stripes. A thread only
+/// waits behind, and is only woken by, initializations of entries that map
+/// to the same stripe.
+MetadataWaitStripe &getMetadataWaitStripe(const void *owner, size_t hash);
+
 /// The implementation of a metadata cache.  Note that all-zero must
 /// be a valid state for the cache.
 template <class ValueTy> class MetadataCache {
@@ -240,10 +324,18 @@ template <class ValueTy> class MetadataCache {
       return Hash;
     }
 
+    size_t getHash() const {
+      return Hash;
+    }
+
     static size_t getExtraAllocationSize(const Key &key) {
       return key.KeyData.size() * sizeof(void*);
     }
 
+    static size_t getKeyHash(const Key &key) {
+      return key.Hash;
+    }
+
     int compareWithKey(const Key &key) const {
       // Order by hash first, then by the actual key data.
       if (key.Hash != Hash) {
@@ -275,19 +367,45 @@ template <class ValueTy> class MetadataCache {
   /// The head of a linked list connecting all the metadata cache entries.
   /// TODO: Remove this when LLDB is able to understand the final data
   /// structure for the metadata cache.
-  const ValueTy *Head;
-
-  struct ConcurrencyControl {
-    Mutex Lock;
-    Condition Queue;
-  };
-  std::unique_ptr<ConcurrencyControl> Concurrency;
+  std::atomic<const ValueTy *> Head;
 
   /// Allocator for entries of this cache.
   MetadataAllocator Allocator;
-  
+
+  /// Look for a published entry in the current thread's front cache.
+  ValueTy *findInFrontCache(MetadataFrontCache *frontCache, const Key &key) {
+    auto &slot = frontCache->Slots[
+      MetadataFrontCache::getSlotIndex(this, key.Hash)];
+    if (slot.Owner != this)
+      return nullptr;
+    auto entry = static_cast<const Entry *>(slot.Entry);
+    if (entry->getHash() != key.Hash || entry->compareWithKey(key) != 0)
+      return nullptr;
+    return entry->getValue();
+  }
+
+  /// Remember an entry whose value has been published in the current
+  /// thread's front cache.
+  void addToFrontCache(MetadataFrontCache *frontCache, const Entry *entry) {
+    auto &slot = frontCache->Slots[
+      MetadataFrontCache::getSlotIndex(this, entry->getHash())];
+    slot.Owner = this;
+    slot.Entry = entry;
+  }
+
+  /// Link a newly created value into the list that LLDB walks.
+  void addToList(ValueTy *value) {
+    auto head = Head.load(std::memory_order_relaxed);
+    do {
+      value->Next = head;
+    } while (!Head.compare_exchange_weak(head, value,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+  }
+
 public:
-  MetadataCache() : Concurrency(new ConcurrencyControl()) {}
+  MetadataCache()
+    : Head(nullptr), Allocator(ValueTy::getAllocationKind()) {}
   ~MetadataCache() {}
 
   /// Caches are not copyable.
@@ -295,8 +413,6 @@ public:
   MetadataCache &operator=(const MetadataCache &other) = delete;
 
   /// Get the allocator for metadata in this cache.
-  /// The allocator can only be safely used while the cache is locked during
-  /// an addMetadataEntry call.
   MetadataAllocator &getAllocator() { return Allocator; }
 
   /// Look up a cached metadata entry. If a cache match exists, return it.
@@ -319,6 +435,13 @@ public:
            ValueTy::getName(), this, key.Hash);
 #endif
 
+    // Most lookups find an entry this thread has already seen.
+    auto frontCache = getMetadataFrontCache();
+    if (LLVM_LIKELY(frontCache != nullptr)) {
+      if (auto value = findInFrontCache(frontCache, key))
+        return value;
+    }
+
     // Ensure the existence of a map entry.
     auto insertResult = Map.getOrInsert(key);
     Entry *entry = insertResult.first;
@@ -330,14 +453,16 @@ public:
       // If the entry is already initialized, great.
       auto value = entry->getValue();
       if (value) {
+        if (frontCache)
+          addToFrontCache(frontCache, entry);
         return value;
       }
 
       // Otherwise, we have to grab the lock and wait for the value to
       // appear there.  Note that we have to check again immediately
       // after acquiring the lock to prevent a race.
-      auto concurrency = Concurrency.get();
-      concurrency->Lock.lockOrWait(concurrency->Queue, [&value, &entry, this] {
+      auto &concurrency = getMetadataWaitStripe(this, key.Hash);
+      concurrency.Lock.lockOrWait(concurrency.Queue, [&value, &entry, this] {
         if ((value = entry->getValue())) {
           return false; // found a value, done waiting
         }
@@ -355,6 +480,8 @@ public:
         return true; // don't have a value, continue waiting
       });
 
+      if (frontCache)
+        addToFrontCache(frontCache, entry);
       return value;
     }
 
@@ -363,8 +490,7 @@ public:
     auto value = builder();
 
     // Update the linked list.
-    value->Next = Head;
-    Head = value;
+    addToList(value);
 
 #if SWIFT_DEBUG_RUNTIME
         printf("%s(%p): created %p\n",
@@ -372,11 +498,13 @@ public:
 #endif
 
     // Acquire the lock, set the value, and notify any waiters.
-    auto concurrency = Concurrency.get();
-    concurrency->Lock.lockAndNotifyAll(concurrency->Queue, [&entry, &value] {
+    auto &concurrency = getMetadataWaitStripe(this, key.Hash);
+    concurrency.Lock.lockAndNotifyAll(concurrency.Queue, [&entry, &value] {
       entry->setValue(value);
     });
 
+    if (frontCache)
+      addToFrontCache(frontCache, entry);
     return value;
   }
 };
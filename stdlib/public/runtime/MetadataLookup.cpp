@@ -84,6 +84,12 @@ namespace {
       return aName.compare(Name);
     }
 
+    static size_t getKeyHash(llvm::StringRef aName) {
+      // llvm::hash_value(StringRef) is defined out of line in LLVMSupport,
+      // which the runtime does not link.
+      return llvm::hash_combine_range(aName.begin(), aName.end());
+    }
+
     template <class... T>
     static size_t getExtraAllocationSize(T &&... ignored) {
       return 0;
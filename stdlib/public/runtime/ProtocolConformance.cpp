@@ -19,6 +19,7 @@
 #include "swift/Runtime/Concurrent.h"
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Mutex.h"
+#include "llvm/ADT/Hashing.h"
 #include "Private.h"
 
 #if defined(__APPLE__) && defined(__MACH__)
@@ -30,6 +31,7 @@
 #endif
 
 #include <dlfcn.h>
+#include <stdlib.h>
 
 using namespace swift;
 
@@ -193,6 +195,10 @@ namespace {
       }
     }
 
+    static size_t getKeyHash(const ConformanceCacheKey &key) {
+      return llvm::hash_combine(key.Type, key.Proto);
+    }
+
     template <class... Args>
     static size_t getExtraAllocationSize(Args &&... ignored) {
       return 0;
@@ -223,6 +229,43 @@ namespace {
       return FailureGeneration.load(std::memory_order_relaxed);
     }
   };
+
+  /// An entry in the index of conformance records, mapping a type-protocol
+  /// pair to the first record that declares it.
+  struct ConformanceRecordEntry {
+  private:
+    const void *Type;
+    const ProtocolDescriptor *Proto;
+    const ProtocolConformanceRecord *Record;
+
+  public:
+    ConformanceRecordEntry(ConformanceCacheKey key,
+                           const ProtocolConformanceRecord *record)
+      : Type(key.Type), Proto(key.Proto), Record(record) {}
+
+    int compareWithKey(const ConformanceCacheKey &key) const {
+      if (key.Type != Type) {
+        return (uintptr_t(key.Type) < uintptr_t(Type) ? -1 : 1);
+      } else if (key.Proto != Proto) {
+        return (uintptr_t(key.Proto) < uintptr_t(Proto) ? -1 : 1);
+      } else {
+        return 0;
+      }
+    }
+
+    static size_t getKeyHash(const ConformanceCacheKey &key) {
+      return llvm::hash_combine(key.Type, key.Proto);
+    }
+
+    template <class... Args>
+    static size_t getExtraAllocationSize(Args &&... ignored) {
+      return 0;
+    }
+
+    const ProtocolConformanceRecord *getRecord() const {
+      return Record;
+    }
+  };
 }
 
 // Conformance Cache.
@@ -240,11 +283,38 @@ static void _addImageProtocolConformancesBlock(const uint8_t *conformances,
 #endif
 
 struct ConformanceState {
+  /// Resolved lookups, both successful and failed.
   ConcurrentMap<ConformanceCacheEntry> Cache;
+
+  /// Every conformance record from the sections indexed so far, keyed by
+  /// the metadata or nominal type descriptor it applies to and its protocol.
+  ConcurrentMap<ConformanceRecordEntry> Records;
+
   std::vector<ConformanceSection> SectionsToScan;
   Mutex SectionsToScanLock;
-  
-  ConformanceState() {
+
+  /// The number of sections at the front of SectionsToScan whose records
+  /// have been added to Records. Only modified under SectionsToScanLock.
+  std::atomic<size_t> IndexedSections;
+
+  /// The number of sections in SectionsToScan, which may not have been
+  /// indexed yet. A cached failure is definitive as long as its generation
+  /// matches this count. Only modified under SectionsToScanLock.
+  std::atomic<size_t> RegisteredSections;
+
+  /// Statistics reported by swift_getConformanceCacheStatistics. Cache
+  /// hits are only counted if SWIFT_DEBUG_CONFORMANCE_STATISTICS is set in
+  /// the environment, so that the fast path does not write shared memory.
+  bool CountCacheHits;
+  std::atomic<size_t> CacheHits;
+  std::atomic<size_t> CacheMisses;
+  std::atomic<size_t> SectionScans;
+  std::atomic<size_t> RecordsIndexed;
+
+  ConformanceState()
+    : IndexedSections(0), RegisteredSections(0),
+      CountCacheHits(getenv("SWIFT_DEBUG_CONFORMANCE_STATISTICS") != nullptr),
+      CacheHits(0), CacheMisses(0), SectionScans(0), RecordsIndexed(0) {
     SectionsToScan.reserve(16);
 #if defined(__APPLE__) && defined(__MACH__)
     _initializeCallbacksToInspectDylib();
@@ -266,15 +336,20 @@ struct ConformanceState {
     }
   }
 
-  void cacheFailure(const void *type, const ProtocolDescriptor *proto) {
-    uintptr_t failureGeneration = SectionsToScan.size();
+  void cacheFailure(const void *type, const ProtocolDescriptor *proto,
+                    uintptr_t failureGeneration) {
     auto result = Cache.getOrInsert(ConformanceCacheKey(type, proto),
                                     (const WitnessTable *) nullptr,
                                     failureGeneration);
 
-    // If the entry was already present, we may need to update it.
+    // If the entry was already present, we may need to update it. Another
+    // thread may have found a conformance in a newer image in the meantime,
+    // or recorded a failure against a later generation; don't regress either.
     if (!result.second) {
-      result.first->updateFailureGeneration(failureGeneration);
+      auto entry = result.first;
+      if (!entry->isSuccessful() &&
+          entry->getFailureGeneration() < failureGeneration)
+        entry->updateFailureGeneration(failureGeneration);
     }
   }
 
@@ -282,16 +357,69 @@ struct ConformanceState {
                                     const ProtocolDescriptor *proto) {
     return Cache.find(ConformanceCacheKey(type, proto));
   }
+
+  const ProtocolConformanceRecord *findRecord(const void *type,
+                                              const ProtocolDescriptor *proto) {
+    if (auto entry = Records.find(ConformanceCacheKey(type, proto)))
+      return entry->getRecord();
+    return nullptr;
+  }
+
+  /// Add the records of every section that has been registered since the
+  /// last call to the record index, and return the number of indexed
+  /// sections.
+  size_t indexNewSections();
 };
 
 static Lazy<ConformanceState> Conformances;
 
+size_t ConformanceState::indexNewSections() {
+  ScopedLock guard(SectionsToScanLock);
+
+  size_t sectionIdx = IndexedSections.load(std::memory_order_relaxed);
+  size_t endSectionIdx = SectionsToScan.size();
+
+  for (; sectionIdx < endSectionIdx; ++sectionIdx) {
+    auto &section = SectionsToScan[sectionIdx];
+    ++SectionScans;
+
+    for (const auto &record : section) {
+      auto P = record.getProtocol();
+
+      // If the record applies to a specific type, index it by the
+      // canonical metadata.
+      if (auto metadata = record.getCanonicalTypeMetadata()) {
+        Records.getOrInsert(ConformanceCacheKey(metadata, P), &record);
+        ++RecordsIndexed;
+
+      // If the record provides a nondependent witness table for all instances
+      // of a generic type, index it by the nominal type descriptor.
+      // TODO: "Nondependent witness table" probably deserves its own flag.
+      // An accessor function might still be necessary even if the witness table
+      // can be shared.
+      } else if (record.getTypeKind()
+                   == TypeMetadataRecordKind::UniqueNominalTypeDescriptor
+                 && record.getConformanceKind()
+                   == ProtocolConformanceReferenceKind::WitnessTable) {
+        Records.getOrInsert(
+          ConformanceCacheKey(record.getNominalTypeDescriptor(), P), &record);
+        ++RecordsIndexed;
+      }
+    }
+  }
+
+  IndexedSections.store(endSectionIdx, std::memory_order_release);
+  return endSectionIdx;
+}
+
 static void
 _registerProtocolConformances(ConformanceState &C,
                               const ProtocolConformanceRecord *begin,
                               const ProtocolConformanceRecord *end) {
   ScopedLock guard(C.SectionsToScanLock);
   C.SectionsToScan.push_back(ConformanceSection{begin, end});
+  C.RegisteredSections.store(C.SectionsToScan.size(),
+                             std::memory_order_release);
 }
 
 static void _addImageProtocolConformancesBlock(const uint8_t *conformances,
@@ -425,10 +553,6 @@ void swift::_swift_initializeCallbacksToInspectDylib(
 # error No known mechanism to inspect dynamic libraries on this platform.
 #endif
 
-// This variable is used to signal when a cache was generated and
-// it is correct to avoid a new scan.
-static unsigned ConformanceCacheGeneration = 0;
-
 void
 swift::swift_registerProtocolConformances(const ProtocolConformanceRecord *begin,
                                           const ProtocolConformanceRecord *end){
@@ -443,12 +567,13 @@ swift::swift_registerProtocolConformances(const ProtocolConformanceRecord *begin
 static
 std::pair<const WitnessTable *, bool>
 searchInConformanceCache(const Metadata *type,
-                         const ProtocolDescriptor *protocol,
-                         ConformanceCacheEntry *&foundEntry) {
+                         const ProtocolDescriptor *protocol) {
   auto &C = Conformances.get();
   auto origType = type;
-
-  foundEntry = nullptr;
+  // A failure cached before the last image was registered may be out of
+  // date, even if that image hasn't been indexed yet.
+  auto registeredSections =
+    C.RegisteredSections.load(std::memory_order_acquire);
 
 recur_inside_cache_lock:
 
@@ -460,13 +585,12 @@ recur_inside_cache_lock:
       if (Value->isSuccessful())
         return std::make_pair(Value->getWitnessTable(), true);
 
-      // If we're still looking up for the original type, remember that
-      // we found an exact match.
-      if (type == origType)
-        foundEntry = Value;
-
-      // If we got a cached negative response, check the generation number.
-      if (Value->getFailureGeneration() == C.SectionsToScan.size()) {
+      // If we got a cached negative response for the original type, check
+      // the generation number. A failure is only recorded after the type
+      // and all of its superclasses have been looked up, so an up-to-date
+      // failure for the original type is definitive.
+      if (type == origType &&
+          Value->getFailureGeneration() == registeredSections) {
         // We found an entry with a negative value.
         return std::make_pair(nullptr, true);
       }
@@ -501,27 +625,33 @@ recur_inside_cache_lock:
   return std::make_pair(nullptr, false);
 }
 
-/// Checks if a given candidate is a type itself, one of its
-/// superclasses or a related generic type.
+/// Search the record index for a conformance of the given type, one of its
+/// superclasses or its generic pattern, caching the result of each record
+/// that is found.
 ///
 /// This check is supposed to use the same logic that is used
 /// by searchInConformanceCache.
-///
-/// \param candidate Pointer to a Metadata or a NominalTypeDescriptor.
-///
-static
-bool isRelatedType(const Metadata *type, const void *candidate,
-                   bool candidateIsMetadata) {
-
+static const WitnessTable *
+searchInConformanceRecords(ConformanceState &C, const Metadata *type,
+                           const ProtocolDescriptor *protocol) {
   while (true) {
-    if (type == candidate && candidateIsMetadata)
-      return true;
+    if (auto record = C.findRecord(type, protocol)) {
+      // Instantiating the witness table may run arbitrary code, including
+      // other conformance lookups, so we must not be holding any locks here.
+      if (auto witness = record->getWitnessTable(type)) {
+        C.cacheSuccess(type, protocol, witness);
+        return witness;
+      }
+    }
 
     // If the type is resilient or generic, see if there's a witness table
     // keyed off the nominal type descriptor.
     auto *description = type->getNominalTypeDescriptor().get();
-    if (description == candidate && !candidateIsMetadata)
-      return true;
+    if (auto record = C.findRecord(description, protocol)) {
+      auto witness = record->getStaticWitnessTable();
+      C.cacheSuccess(description, protocol, witness);
+      return witness;
+    }
 
     // If the type is a class, try its superclass.
     if (const ClassMetadata *classType = type->getClassObject()) {
@@ -531,120 +661,50 @@ bool isRelatedType(const Metadata *type, const void *candidate,
       }
     }
 
-    break;
+    return nullptr;
   }
-
-  return false;
 }
 
 const WitnessTable *
 swift::swift_conformsToProtocol(const Metadata *type,
                                 const ProtocolDescriptor *protocol) {
   auto &C = Conformances.get();
-  auto origType = type;
-  unsigned numSections = 0;
-  ConformanceCacheEntry *foundEntry;
 
-recur:
   // See if we have a cached conformance. The ConcurrentMap data structure
   // allows us to insert and search the map concurrently without locking.
-  // We do lock the slow path because the SectionsToScan data structure is not
-  // concurrent.
-  auto FoundConformance = searchInConformanceCache(type, protocol, foundEntry);
   // The negative answer does not always mean that there is no conformance,
-  // unless it is an exact match on the type. If it is not an exact match,
-  // it may mean that all of the superclasses do not have this conformance,
-  // but the actual type may still have this conformance.
+  // unless it is an exact match on the type with an up-to-date generation.
+  // Otherwise it may only mean that some of the superclasses do not have
+  // this conformance, while the actual type may still have it.
+  auto FoundConformance = searchInConformanceCache(type, protocol);
   if (FoundConformance.second) {
-    if (FoundConformance.first || foundEntry)
-      return FoundConformance.first;
+    if (C.CountCacheHits)
+      ++C.CacheHits;
+    return FoundConformance.first;
   }
 
-  unsigned failedGeneration = ConformanceCacheGeneration;
-
-  // If we didn't have an up-to-date cache entry, scan the conformance records.
-  C.SectionsToScanLock.lock();
-
-  // If we have no new information to pull in (and nobody else pulled in
-  // new information while we waited on the lock), we're done.
-  if (C.SectionsToScan.size() == numSections) {
-    if (failedGeneration != ConformanceCacheGeneration) {
-      // Someone else pulled in new conformances while we were waiting.
-      // Start over with our newly-populated cache.
-      C.SectionsToScanLock.unlock();
-      type = origType;
-      goto recur;
-    }
+  ++C.CacheMisses;
 
+  // Make sure that every registered image has been indexed. This only
+  // scans the records of images loaded since the last lookup that missed.
+  size_t indexedSections = C.indexNewSections();
 
-    // Save the failure for this type-protocol pair in the cache.
-    C.cacheFailure(type, protocol);
-
-    C.SectionsToScanLock.unlock();
-    return nullptr;
-  }
-
-  // Update the last known number of sections to scan.
-  numSections = C.SectionsToScan.size();
-
-  // Scan only sections that were not scanned yet.
-  unsigned sectionIdx = foundEntry ? foundEntry->getFailureGeneration() : 0;
-  unsigned endSectionIdx = C.SectionsToScan.size();
+  if (auto witness = searchInConformanceRecords(C, type, protocol))
+    return witness;
 
-  for (; sectionIdx < endSectionIdx; ++sectionIdx) {
-    auto &section = C.SectionsToScan[sectionIdx];
-    // Eagerly pull records for nondependent witnesses into our cache.
-    for (const auto &record : section) {
-      // If the record applies to a specific type, cache it.
-      if (auto metadata = record.getCanonicalTypeMetadata()) {
-        auto P = record.getProtocol();
-
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
-
-        if (!isRelatedType(type, metadata, /*isMetadata=*/true))
-          continue;
-
-        // Store the type-protocol pair in the cache.
-        auto witness = record.getWitnessTable(metadata);
-        if (witness) {
-          C.cacheSuccess(metadata, P, witness);
-        } else {
-          C.cacheFailure(metadata, P);
-        }
-
-      // If the record provides a nondependent witness table for all instances
-      // of a generic type, cache it for the generic pattern.
-      // TODO: "Nondependent witness table" probably deserves its own flag.
-      // An accessor function might still be necessary even if the witness table
-      // can be shared.
-      } else if (record.getTypeKind()
-                   == TypeMetadataRecordKind::UniqueNominalTypeDescriptor
-                 && record.getConformanceKind()
-                   == ProtocolConformanceReferenceKind::WitnessTable) {
-
-        auto R = record.getNominalTypeDescriptor();
-        auto P = record.getProtocol();
-
-        // Look for an exact match.
-        if (protocol != P)
-          continue;
-
-        if (!isRelatedType(type, R, /*isMetadata=*/false))
-          continue;
-
-        // Store the type-protocol pair in the cache.
-        C.cacheSuccess(R, P, record.getStaticWitnessTable());
-      }
-    }
-  }
-  ++ConformanceCacheGeneration;
+  // Remember the failure. It stays valid until another image is indexed,
+  // at which point only the records of the new images need to be consulted.
+  C.cacheFailure(type, protocol, indexedSections);
+  return nullptr;
+}
 
-  C.SectionsToScanLock.unlock();
-  // Start over with our newly-populated cache.
-  type = origType;
-  goto recur;
+void
+swift::swift_getConformanceCacheStatistics(ConformanceCacheStatistics *stats) {
+  auto &C = Conformances.get();
+  stats->CacheHits = C.CacheHits.load(std::memory_order_relaxed);
+  stats->CacheMisses = C.CacheMisses.load(std::memory_order_relaxed);
+  stats->SectionScans = C.SectionScans.load(std::memory_order_relaxed);
+  stats->RecordsIndexed = C.RecordsIndexed.load(std::memory_order_relaxed);
 }
 
 const Metadata *
@@ -16,16 +16,26 @@
 
 #include "swift/Runtime/Config.h"
 #include "swift/Runtime/Debug.h"
+#include "../SwiftShims/UnicodeShims.h"
 
 #include <algorithm>
 #include <mutex>
 #include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <unicode/ustring.h>
 #include <unicode/ucol.h>
 #include <unicode/ucoleitr.h>
 #include <unicode/uiter.h>
 
+using swift::_swift_stdlib_unicode_hasher;
+
 /// Zero weight 0-8, 14-31, 127.
 const int8_t _swift_stdlib_unicode_ascii_collation_table_impl[128] = {
     0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  2,  3,  4,  5,  0,   0,  0,  0,  0,
@@ -122,6 +132,172 @@ private:
   ASCIICollation(const ASCIICollation &) = delete;
 };
 
+// Most strings that are compared and hashed are mostly ASCII. Each ASCII
+// character has a single collation element in the root locale, which
+// ASCIICollation caches, and never combines with the characters around it.
+// So the ASCII parts of a string can be handled without ICU, as long as the
+// string is only split between two ASCII characters; a combining mark after
+// an ASCII character changes that character's collation elements.
+
+static bool isASCII(char c) { return (c & 0x80) == 0; }
+static bool isASCII(uint16_t c) { return c < 0x80; }
+
+/// Returns the number of ASCII code units at the start of the string.
+static int32_t countLeadingASCII(const char *Str, int32_t Length) {
+  int32_t Pos = 0;
+#if defined(__SSE2__)
+  for (; Pos + 16 <= Length; Pos += 16) {
+    __m128i Block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(Str + Pos));
+    if (int Mask = _mm_movemask_epi8(Block))
+      return Pos + __builtin_ctz(Mask);
+  }
+#endif
+  while (Pos < Length && isASCII(Str[Pos]))
+    ++Pos;
+  return Pos;
+}
+
+/// Returns the number of ASCII code units at the start of the string.
+static int32_t countLeadingASCII(const uint16_t *Str, int32_t Length) {
+  int32_t Pos = 0;
+#if defined(__SSE2__)
+  const __m128i NonASCIIBits = _mm_set1_epi16(static_cast<short>(0xFF80));
+  for (; Pos + 8 <= Length; Pos += 8) {
+    __m128i Block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(Str + Pos));
+    __m128i IsASCII = _mm_cmpeq_epi16(_mm_and_si128(Block, NonASCIIBits),
+                                      _mm_setzero_si128());
+    int Mask = _mm_movemask_epi8(IsASCII) ^ 0xFFFF;
+    if (Mask)
+      return Pos + __builtin_ctz(Mask) / 2;
+  }
+#endif
+  while (Pos < Length && isASCII(Str[Pos]))
+    ++Pos;
+  return Pos;
+}
+
+/// Returns the length of the longest common prefix of the strings that
+/// consists of ASCII code units only.
+static int32_t countCommonASCIIPrefix(const char *Left, const char *Right,
+                                      int32_t Length) {
+  int32_t Pos = 0;
+#if defined(__SSE2__)
+  for (; Pos + 16 <= Length; Pos += 16) {
+    __m128i L = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Left + Pos));
+    __m128i R = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Right + Pos));
+    // A byte ends the prefix if it differs or has its high bit set.
+    int Mask = (_mm_movemask_epi8(_mm_cmpeq_epi8(L, R)) ^ 0xFFFF) |
+               _mm_movemask_epi8(L);
+    if (Mask)
+      return Pos + __builtin_ctz(Mask);
+  }
+#endif
+  while (Pos < Length && Left[Pos] == Right[Pos] && isASCII(Left[Pos]))
+    ++Pos;
+  return Pos;
+}
+
+/// Returns the length of the longest common prefix of the strings that
+/// consists of ASCII code units only.
+static int32_t countCommonASCIIPrefix(const uint16_t *Left,
+                                      const uint16_t *Right, int32_t Length) {
+  int32_t Pos = 0;
+#if defined(__SSE2__)
+  const __m128i NonASCIIBits = _mm_set1_epi16(static_cast<short>(0xFF80));
+  for (; Pos + 8 <= Length; Pos += 8) {
+    __m128i L = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Left + Pos));
+    __m128i R = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Right + Pos));
+    __m128i IsASCII = _mm_cmpeq_epi16(_mm_and_si128(L, NonASCIIBits),
+                                      _mm_setzero_si128());
+    __m128i Continues = _mm_and_si128(_mm_cmpeq_epi16(L, R), IsASCII);
+    int Mask = _mm_movemask_epi8(Continues) ^ 0xFFFF;
+    if (Mask)
+      return Pos + __builtin_ctz(Mask) / 2;
+  }
+#endif
+  while (Pos < Length && Left[Pos] == Right[Pos] && isASCII(Left[Pos]))
+    ++Pos;
+  return Pos;
+}
+
+static int32_t countCommonASCIIPrefix(const char *Left, const uint16_t *Right,
+                                      int32_t Length) {
+  int32_t Pos = 0;
+  while (Pos < Length && isASCII(Left[Pos]) &&
+         static_cast<uint16_t>(Left[Pos]) == Right[Pos])
+    ++Pos;
+  return Pos;
+}
+
+/// Returns the length of a common ASCII prefix of the strings that can be
+/// skipped without changing the result of comparing them: each string must
+/// end or continue with an ASCII character after it.
+template <typename LeftCodeUnit, typename RightCodeUnit>
+static int32_t getSkippablePrefix(const LeftCodeUnit *Left, int32_t LeftLength,
+                                  const RightCodeUnit *Right,
+                                  int32_t RightLength) {
+  int32_t Prefix = countCommonASCIIPrefix(Left, Right,
+                                          std::min(LeftLength, RightLength));
+  // The prefix is ASCII, so stepping back one character always suffices.
+  if (Prefix > 0 &&
+      ((Prefix < LeftLength && !isASCII(Left[Prefix])) ||
+       (Prefix < RightLength && !isASCII(Right[Prefix]))))
+    --Prefix;
+  return Prefix;
+}
+
+/// Compares two ASCII strings the way ucol_strcoll() does at tertiary
+/// strength: first by the primary weights of their collation elements, then
+/// by the secondary weights, then by the tertiary weights, skipping zero
+/// weights at each level.
+template <typename LeftCodeUnit, typename RightCodeUnit>
+static int32_t compareASCII(const LeftCodeUnit *Left, int32_t LeftLength,
+                            const RightCodeUnit *Right, int32_t RightLength) {
+  const ASCIICollation *Table = ASCIICollation::getTable();
+  static const int Shifts[] = { 16, 8, 0 };
+  static const uint32_t Masks[] = { 0xFFFF, 0xFF, 0x3F };
+  for (unsigned Level = 0; Level != 3; ++Level) {
+    int32_t L = 0, R = 0;
+    while (true) {
+      uint32_t LeftWeight = 0, RightWeight = 0;
+      while (L < LeftLength && LeftWeight == 0)
+        LeftWeight = (uint32_t(Table->map(Left[L++])) >> Shifts[Level]) &
+                     Masks[Level];
+      while (R < RightLength && RightWeight == 0)
+        RightWeight = (uint32_t(Table->map(Right[R++])) >> Shifts[Level]) &
+                      Masks[Level];
+      if (LeftWeight != RightWeight)
+        return LeftWeight < RightWeight ? -1 : 1;
+      if (LeftWeight == 0)
+        break;
+    }
+  }
+  return 0;
+}
+
+/// Compares the parts of two strings that follow their skippable common
+/// prefix without ICU if both are ASCII.
+///
+/// \returns true and sets \p Result if it could, false otherwise; \p Prefix
+/// is set to the length of the prefix either way.
+template <typename LeftCodeUnit, typename RightCodeUnit>
+static bool compareWithoutICU(const LeftCodeUnit *Left, int32_t LeftLength,
+                              const RightCodeUnit *Right, int32_t RightLength,
+                              int32_t &Prefix, int32_t &Result) {
+  Prefix = getSkippablePrefix(Left, LeftLength, Right, RightLength);
+  Left += Prefix;
+  LeftLength -= Prefix;
+  Right += Prefix;
+  RightLength -= Prefix;
+  if (countLeadingASCII(Left, LeftLength) != LeftLength ||
+      countLeadingASCII(Right, RightLength) != RightLength)
+    return false;
+  Result = compareASCII(Left, LeftLength, Right, RightLength);
+  return true;
+}
+
 /// Compares the strings via the Unicode Collation Algorithm on the root locale.
 /// Results are the usual string comparison results:
 ///  <0 the left string is less than the right string.
@@ -129,10 +305,20 @@ private:
 ///  >0 the left string is greater than the right string.
 SWIFT_RUNTIME_STDLIB_INTERFACE
 extern "C"
-int32_t _swift_stdlib_unicode_compare_utf16_utf16(const uint16_t *LeftString,
-                                                  int32_t LeftLength,
-                                                  const uint16_t *RightString,
-                                                  int32_t RightLength) {
+__swift_int32_t
+_swift_stdlib_unicode_compare_utf16_utf16(const __swift_uint16_t *LeftString,
+                                          __swift_int32_t LeftLength,
+                                          const __swift_uint16_t *RightString,
+                                          __swift_int32_t RightLength) {
+  int32_t Prefix, Result;
+  if (compareWithoutICU(LeftString, LeftLength, RightString, RightLength,
+                        Prefix, Result))
+    return Result;
+  LeftString += Prefix;
+  LeftLength -= Prefix;
+  RightString += Prefix;
+  RightLength -= Prefix;
+
 #if defined(__CYGWIN__)
   // ICU UChar type is platform dependent. In Cygwin, it is defined
   // as wchar_t which size is 2. It seems that the underlying binary
@@ -154,10 +340,20 @@ int32_t _swift_stdlib_unicode_compare_utf16_utf16(const uint16_t *LeftString,
 ///  >0 the left string is greater than the right string.
 SWIFT_RUNTIME_STDLIB_INTERFACE
 extern "C"
-int32_t _swift_stdlib_unicode_compare_utf8_utf16(const char *LeftString,
-                                                 int32_t LeftLength,
-                                                 const uint16_t *RightString,
-                                                 int32_t RightLength) {
+__swift_int32_t
+_swift_stdlib_unicode_compare_utf8_utf16(const char *LeftString,
+                                         __swift_int32_t LeftLength,
+                                         const __swift_uint16_t *RightString,
+                                         __swift_int32_t RightLength) {
+  int32_t Prefix, Result;
+  if (compareWithoutICU(LeftString, LeftLength, RightString, RightLength,
+                        Prefix, Result))
+    return Result;
+  LeftString += Prefix;
+  LeftLength -= Prefix;
+  RightString += Prefix;
+  RightLength -= Prefix;
+
   UCharIterator LeftIterator;
   UCharIterator RightIterator;
   UErrorCode ErrorCode = U_ZERO_ERROR;
@@ -185,10 +381,20 @@ int32_t _swift_stdlib_unicode_compare_utf8_utf16(const char *LeftString,
 ///  >0 the left string is greater than the right string.
 SWIFT_RUNTIME_STDLIB_INTERFACE
 extern "C"
-int32_t _swift_stdlib_unicode_compare_utf8_utf8(const char *LeftString,
-                                                int32_t LeftLength,
-                                                const char *RightString,
-                                                int32_t RightLength) {
+__swift_int32_t
+_swift_stdlib_unicode_compare_utf8_utf8(const char *LeftString,
+                                        __swift_int32_t LeftLength,
+                                        const char *RightString,
+                                        __swift_int32_t RightLength) {
+  int32_t Prefix, Result;
+  if (compareWithoutICU(LeftString, LeftLength, RightString, RightLength,
+                        Prefix, Result))
+    return Result;
+  LeftString += Prefix;
+  LeftLength -= Prefix;
+  RightString += Prefix;
+  RightLength -= Prefix;
+
   UCharIterator LeftIterator;
   UCharIterator RightIterator;
   UErrorCode ErrorCode = U_ZERO_ERROR;
@@ -218,16 +424,55 @@ int32_t _swift_stdlib_unicode_compare_utf8_utf8(const char *LeftString,
 #define HASH_R 47
 #endif
 
-static intptr_t hashChunk(const UCollator *Collator, intptr_t HashState,
-                          const uint16_t *Str, uint32_t Length,
-                          UErrorCode *ErrorCode) {
+static void destroyCollationElements(void *Value) {
+  ucol_closeElements(static_cast<UCollationElements *>(Value));
+}
+
+static bool makeCollationElementsKey(pthread_key_t *Key) {
+  return pthread_key_create(Key, destroyCollationElements) == 0;
+}
+
+/// Returns a collation element iterator over the string that is reused by
+/// every call on the current thread, so that hashing does not open and
+/// close one each time.
+///
+/// \returns null on failure, or if the iterator could not be stored for the
+/// thread; in that case \p Owned is set to true and the caller must close
+/// the iterator.
+static UCollationElements *getCollationElements(const uint16_t *Str,
+                                                int32_t Length, bool &Owned,
+                                                UErrorCode *ErrorCode) {
+  static pthread_key_t Key;
+  static bool KeyIsValid = makeCollationElementsKey(&Key);
+
 #if defined(__CYGWIN__)
-  UCollationElements *CollationIterator = ucol_openElements(
-    Collator, reinterpret_cast<const UChar *>(Str), Length, ErrorCode);
+  auto Text = reinterpret_cast<const UChar *>(Str);
 #else
-  UCollationElements *CollationIterator = ucol_openElements(
-    Collator, Str, Length, ErrorCode);
+  auto Text = Str;
 #endif
+  Owned = false;
+  if (KeyIsValid) {
+    if (auto Elements =
+            static_cast<UCollationElements *>(pthread_getspecific(Key))) {
+      ucol_setText(Elements, Text, Length, ErrorCode);
+      return Elements;
+    }
+  }
+
+  UCollationElements *Elements =
+      ucol_openElements(GetRootCollator(), Text, Length, ErrorCode);
+  if (U_FAILURE(*ErrorCode))
+    return nullptr;
+  if (!KeyIsValid || pthread_setspecific(Key, Elements) != 0)
+    Owned = true;
+  return Elements;
+}
+
+static intptr_t hashChunk(intptr_t HashState, const uint16_t *Str,
+                          uint32_t Length, UErrorCode *ErrorCode) {
+  bool Owned;
+  UCollationElements *CollationIterator =
+      getCollationElements(Str, Length, Owned, ErrorCode);
   while (U_SUCCESS(*ErrorCode)) {
     intptr_t Elem = ucol_next(CollationIterator, ErrorCode);
     // Ignore zero valued collation elements. They don't participate in the
@@ -245,10 +490,66 @@ static intptr_t hashChunk(const UCollator *Collator, intptr_t HashState,
       break;
     }
   }
-  ucol_closeElements(CollationIterator);
+  if (Owned)
+    ucol_closeElements(CollationIterator);
+  return HashState;
+}
+
+/// Hashes the collation elements of an ASCII string.
+template <typename CodeUnit>
+static intptr_t hashASCIIChunk(intptr_t HashState, const CodeUnit *Str,
+                               int32_t Length) {
+  const ASCIICollation *Table = ASCIICollation::getTable();
+  for (int32_t Pos = 0; Pos < Length; ++Pos) {
+    assert(isASCII(Str[Pos]) && "This table only exists for the ASCII subset");
+    intptr_t Elem = Table->map(Str[Pos]);
+    // Ignore zero valued collation elements. They don't participate in the
+    // ordering relation.
+    if (Elem == 0)
+      continue;
+    Elem *= HASH_M;
+    Elem ^= Elem >> HASH_R;
+    Elem *= HASH_M;
+
+    HashState *= HASH_M;
+    HashState ^= Elem;
+  }
+  return HashState;
+}
+
+/// Hashes the collation elements of a part of a string that begins and ends
+/// either at an end of the string or between two ASCII characters.
+static intptr_t hashUTF16Chunk(intptr_t HashState, const uint16_t *Str,
+                               int32_t Length) {
+  // Hash the leading ASCII characters with the table, except for the last
+  // one if a combining mark could follow it.
+  int32_t ASCIILength = countLeadingASCII(Str, Length);
+  if (ASCIILength == Length)
+    return hashASCIIChunk(HashState, Str, Length);
+  if (ASCIILength > 0)
+    --ASCIILength;
+  HashState = hashASCIIChunk(HashState, Str, ASCIILength);
+
+  UErrorCode ErrorCode = U_ZERO_ERROR;
+  HashState = hashChunk(HashState, Str + ASCIILength, Length - ASCIILength,
+                        &ErrorCode);
+
+  if (U_FAILURE(ErrorCode)) {
+    swift::crash("hashChunk: Unexpected error hashing unicode string.");
+  }
   return HashState;
 }
 
+static intptr_t hashAnyChunk(intptr_t HashState, const char *Str,
+                             int32_t Length) {
+  return hashASCIIChunk(HashState, Str, Length);
+}
+
+static intptr_t hashAnyChunk(intptr_t HashState, const uint16_t *Str,
+                             int32_t Length) {
+  return hashUTF16Chunk(HashState, Str, Length);
+}
+
 static intptr_t hashFinish(intptr_t HashState) {
   HashState ^= HashState >> HASH_R;
   HashState *= HASH_M;
@@ -258,38 +559,130 @@ static intptr_t hashFinish(intptr_t HashState) {
 
 SWIFT_RUNTIME_STDLIB_INTERFACE
 extern "C"
-intptr_t _swift_stdlib_unicode_hash(const uint16_t *Str, int32_t Length) {
-  UErrorCode ErrorCode = U_ZERO_ERROR;
-  intptr_t HashState = HASH_SEED;
-  HashState = hashChunk(GetRootCollator(), HashState, Str, Length, &ErrorCode);
+__swift_intptr_t _swift_stdlib_unicode_hash(const __swift_uint16_t *Str,
+                                            __swift_int32_t Length) {
+  return hashFinish(hashUTF16Chunk(HASH_SEED, Str, Length));
+}
 
-  if (U_FAILURE(ErrorCode)) {
-    swift::crash("hashChunk: Unexpected error hashing unicode string.");
+SWIFT_RUNTIME_STDLIB_INTERFACE
+extern "C"
+__swift_intptr_t _swift_stdlib_unicode_hash_ascii(const char *Str,
+                                                  __swift_int32_t Length) {
+  return hashFinish(hashASCIIChunk(HASH_SEED, Str, Length));
+}
+
+// A string stored in several chunks is hashed as the chunks are appended.
+// Like above, a string can only be split between two ASCII characters. The
+// hasher keeps the code units after the last such split point it has seen
+// in its pending buffer, and each appended chunk is hashed in place from its
+// first split point to its last.
+
+static void appendPending(_swift_stdlib_unicode_hasher *Hasher,
+                          const char *Str, int32_t Length) {
+  for (int32_t Pos = 0; Pos < Length; ++Pos)
+    Hasher->Pending[Hasher->PendingLength + Pos] =
+        static_cast<unsigned char>(Str[Pos]);
+}
+
+static void appendPending(_swift_stdlib_unicode_hasher *Hasher,
+                          const uint16_t *Str, int32_t Length) {
+  memcpy(Hasher->Pending + Hasher->PendingLength, Str,
+         Length * sizeof(uint16_t));
+}
+
+template <typename CodeUnit>
+static void addToPending(_swift_stdlib_unicode_hasher *Hasher,
+                         const CodeUnit *Str, int32_t Length) {
+  if (Length == 0)
+    return;
+  int32_t Needed = Hasher->PendingLength + Length;
+  if (Needed > Hasher->PendingCapacity) {
+    int32_t Capacity = std::max(Needed, 2 * Hasher->PendingCapacity);
+    auto Pending = static_cast<__swift_uint16_t *>(
+        realloc(Hasher->Pending, Capacity * sizeof(uint16_t)));
+    if (!Pending)
+      swift::crash("Could not allocate memory.");
+    Hasher->Pending = Pending;
+    Hasher->PendingCapacity = Capacity;
   }
-  return hashFinish(HashState);
+  appendPending(Hasher, Str, Length);
+  Hasher->PendingLength = Needed;
+}
+
+template <typename CodeUnit>
+static void appendToHasher(_swift_stdlib_unicode_hasher *Hasher,
+                           const CodeUnit *Str, int32_t Length) {
+  // Find the first and the last point in the chunk where it can be split.
+  int32_t First = -1, Last = -1;
+  if (Hasher->PendingLength == 0 ||
+      (Length > 0 && isASCII(Hasher->Pending[Hasher->PendingLength - 1]) &&
+       isASCII(Str[0])))
+    First = 0;
+  if (First < 0) {
+    for (int32_t Pos = 1; Pos < Length; ++Pos) {
+      if (isASCII(Str[Pos - 1]) && isASCII(Str[Pos])) {
+        First = Pos;
+        break;
+      }
+    }
+  }
+  if (First < 0) {
+    addToPending(Hasher, Str, Length);
+    return;
+  }
+  for (int32_t Pos = Length - 1; Pos > First; --Pos) {
+    if (isASCII(Str[Pos - 1]) && isASCII(Str[Pos])) {
+      Last = Pos;
+      break;
+    }
+  }
+  if (Last < 0)
+    Last = First;
+
+  // Hash the pending code units up to the first split point, then the chunk
+  // up to the last one, and keep the rest.
+  addToPending(Hasher, Str, First);
+  Hasher->HashState = hashUTF16Chunk(Hasher->HashState, Hasher->Pending,
+                                     Hasher->PendingLength);
+  Hasher->PendingLength = 0;
+  Hasher->HashState =
+      hashAnyChunk(Hasher->HashState, Str + First, Last - First);
+  addToPending(Hasher, Str + Last, Length - Last);
 }
 
 SWIFT_RUNTIME_STDLIB_INTERFACE
-extern "C" intptr_t _swift_stdlib_unicode_hash_ascii(const char *Str,
-                                                     int32_t Length) {
-  const ASCIICollation *Table = ASCIICollation::getTable();
-  intptr_t HashState = HASH_SEED;
-  int32_t Pos = 0;
-  while (Pos < Length) {
-    const char c = Str[Pos++];
-    assert((c & 0x80) == 0 && "This table only exists for the ASCII subset");
-    intptr_t Elem = Table->map(c);
-    // Ignore zero valued collation elements. They don't participate in the
-    // ordering relation.
-    if (Elem == 0)
-      continue;
-    Elem *= HASH_M;
-    Elem ^= Elem >> HASH_R;
-    Elem *= HASH_M;
+extern "C"
+void _swift_stdlib_unicode_hasher_init(_swift_stdlib_unicode_hasher *Hasher) {
+  Hasher->HashState = HASH_SEED;
+  Hasher->Pending = nullptr;
+  Hasher->PendingLength = 0;
+  Hasher->PendingCapacity = 0;
+}
 
-    HashState *= HASH_M;
-    HashState ^= Elem;
-  }
+SWIFT_RUNTIME_STDLIB_INTERFACE
+extern "C"
+void _swift_stdlib_unicode_hasher_append(_swift_stdlib_unicode_hasher *Hasher,
+                                         const __swift_uint16_t *Str,
+                                         __swift_int32_t Length) {
+  appendToHasher(Hasher, Str, Length);
+}
+
+SWIFT_RUNTIME_STDLIB_INTERFACE
+extern "C"
+void _swift_stdlib_unicode_hasher_append_ascii(
+    _swift_stdlib_unicode_hasher *Hasher, const char *Str,
+    __swift_int32_t Length) {
+  appendToHasher(Hasher, Str, Length);
+}
+
+SWIFT_RUNTIME_STDLIB_INTERFACE
+extern "C"
+__swift_intptr_t _swift_stdlib_unicode_hasher_finish(
+    _swift_stdlib_unicode_hasher *Hasher) {
+  intptr_t HashState = hashUTF16Chunk(Hasher->HashState, Hasher->Pending,
+                                      Hasher->PendingLength);
+  free(Hasher->Pending);
+  _swift_stdlib_unicode_hasher_init(Hasher);
   return hashFinish(HashState);
 }
 
@@ -299,10 +692,11 @@ extern "C" intptr_t _swift_stdlib_unicode_hash_ascii(const char *Str,
 /// the required length to get an uppercase version of the string.
 SWIFT_RUNTIME_STDLIB_INTERFACE
 extern "C"
-int32_t _swift_stdlib_unicode_strToUpper(uint16_t *Destination,
-                                         int32_t DestinationCapacity,
-                                         const uint16_t *Source,
-                                         int32_t SourceLength) {
+__swift_int32_t
+_swift_stdlib_unicode_strToUpper(__swift_uint16_t *Destination,
+                                 __swift_int32_t DestinationCapacity,
+                                 const __swift_uint16_t *Source,
+                                 __swift_int32_t SourceLength) {
   UErrorCode ErrorCode = U_ZERO_ERROR;
 #if defined(__CYGWIN__)
   uint32_t OutputLength = u_strToUpper(reinterpret_cast<UChar *>(Destination),
@@ -327,10 +721,11 @@ int32_t _swift_stdlib_unicode_strToUpper(uint16_t *Destination,
 /// the required length to get a lowercase version of the string.
 SWIFT_RUNTIME_STDLIB_INTERFACE
 extern "C"
-int32_t _swift_stdlib_unicode_strToLower(uint16_t *Destination,
-                                         int32_t DestinationCapacity,
-                                         const uint16_t *Source,
-                                         int32_t SourceLength) {
+__swift_int32_t
+_swift_stdlib_unicode_strToLower(__swift_uint16_t *Destination,
+                                 __swift_int32_t DestinationCapacity,
+                                 const __swift_uint16_t *Source,
+                                 __swift_int32_t SourceLength) {
   UErrorCode ErrorCode = U_ZERO_ERROR;
 #if defined(__CYGWIN__)
   uint32_t OutputLength = u_strToLower(reinterpret_cast<UChar *>(Destination),
@@ -81,6 +81,18 @@ let comparisonTests = [
   ComparisonTest(.lt, "a", "a\u{301}"),
   ComparisonTest(.lt, "a", "\u{e1}"),
 
+  // Long common ASCII prefixes are skipped, but not the character before a
+  // combining mark.
+  ComparisonTest(.eq, "abcdefghijklmnopqrstuvwxyza\u{301}",
+                      "abcdefghijklmnopqrstuvwxyz\u{e1}"),
+  ComparisonTest(.lt, "abcdefghijklmnopqrstuvwxyzA",
+                      "abcdefghijklmnopqrstuvwxyza\u{301}"),
+  ComparisonTest(.lt, "abcdefghijklmnopqrstuvwxyzab",
+                      "abcdefghijklmnopqrstuvwxyzac"),
+
+  // Primary differences come before case differences.
+  ComparisonTest(.lt, "Ab", "ac"),
+
   // U+304B HIRAGANA LETTER KA
   // U+304C HIRAGANA LETTER GA
   // U+3099 COMBINING KATAKANA-HIRAGANA VOICED SOUND MARK
@@ -190,6 +202,32 @@ for test in comparisonTests {
   }
 }
 
+StringTests.test("String.hashValue/ASCIIPrefix") {
+  // Hashing handles the leading ASCII run separately from the rest, which
+  // must not change the hash of canonically equivalent strings.
+  let prefixes = [
+    "", "a", "abcdefghijklmnopqrstuvwxyz",
+    String(repeating: "x" as Character, count: 100),
+  ]
+  let equivalentSuffixes = [
+    ("a\u{301}", "\u{e1}"),
+    ("a\u{301}bc", "\u{e1}bc"),
+    ("\u{304b}\u{3099}", "\u{304c}"),
+    ("A\u{30a}", "\u{212b}"),
+    ("s\u{307}\u{323}", "\u{1e69}"),
+    ("\u{1100}\u{1161}\u{11a8}", "\u{ac01}"),
+  ]
+  for prefix in prefixes {
+    for (lhs, rhs) in equivalentSuffixes {
+      let lhsString = prefix + lhs
+      let rhsString = prefix + rhs
+      expectEqual(lhsString, rhsString)
+      expectEqual(lhsString.hashValue, rhsString.hashValue,
+                  "\(lhsString.debugDescription)")
+    }
+  }
+}
+
 func checkCharacterComparison(
   expected: ExpectedComparisonResult,
   _ lhs: Character, _ rhs: Character, _ stackTrace: SourceLocStack
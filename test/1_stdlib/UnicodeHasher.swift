@@ -0,0 +1,148 @@
+// RUN: %target-run-stdlib-swift
+// REQUIRES: executable_test
+
+// The ICU-based hashing stubs are only used without the Objective-C runtime.
+// UNSUPPORTED: objc_interop
+
+import Swift
+import StdlibUnittest
+import SwiftShims
+
+// Also import modules which are used by StdlibUnittest internally. This
+// workaround is needed to link all required libraries in case we compile
+// StdlibUnittest with -sil-serialize-all.
+import SwiftPrivate
+
+var UnicodeHasher = TestSuite("UnicodeHasher")
+
+let longASCII = String(repeating: "x" as Character, count: 100)
+
+let samples: [String] = [
+  "",
+  "a",
+  "abc",
+  "a\u{301}",
+  "\u{e1}",
+  "ab\u{301}c\u{302}\u{303}d",
+  "e\u{301}\u{302}e\u{302}\u{301}",
+  longASCII + "a\u{301}",
+  longASCII + "\u{e1}" + longASCII,
+  // Hangul syllables, both composed and as conjoining jamo.
+  "\u{ac01}",
+  "\u{1100}\u{1161}\u{11a8}",
+  "xy\u{1112}\u{1161}\u{11ab}z\u{d55c}",
+  // Characters outside the BMP.
+  "a\u{1f600}b\u{1d15e}\u{1d165}c",
+]
+
+/// Hashes `codeUnits` in chunks that end before each of `splits`. ASCII
+/// chunks are appended as ASCII if the corresponding bit of `asciiMask` is
+/// set.
+func hashChunked(
+  codeUnits: [UInt16], splits: [Int], asciiMask: Int
+) -> Int {
+  var hasher = _swift_stdlib_unicode_hasher()
+  _swift_stdlib_unicode_hasher_init(&hasher)
+  var start = 0
+  for (i, end) in (splits + [codeUnits.count]).enumerated() {
+    let chunk = Array(codeUnits[start..<end])
+    if asciiMask & (1 << i) != 0 && !chunk.contains({ $0 >= 0x80 }) {
+      let ascii = chunk.map { Int8($0) }
+      ascii.withUnsafeBufferPointer {
+        _swift_stdlib_unicode_hasher_append_ascii(
+          &hasher, $0.baseAddress, Int32($0.count))
+      }
+    } else {
+      chunk.withUnsafeBufferPointer {
+        _swift_stdlib_unicode_hasher_append(
+          &hasher, $0.baseAddress, Int32($0.count))
+      }
+    }
+    start = end
+  }
+  return _swift_stdlib_unicode_hasher_finish(&hasher)
+}
+
+func hashWhole(codeUnits: [UInt16]) -> Int {
+  return codeUnits.withUnsafeBufferPointer {
+    _swift_stdlib_unicode_hash($0.baseAddress, Int32($0.count))
+  }
+}
+
+UnicodeHasher.test("OneSplit") {
+  for s in samples {
+    let codeUnits = Array(s.utf16)
+    let expected = hashWhole(codeUnits)
+    for split in 0...codeUnits.count {
+      for asciiMask in 0..<4 {
+        expectEqual(
+          expected,
+          hashChunked(codeUnits, splits: [split], asciiMask: asciiMask),
+          "\(s.debugDescription) split at \(split)")
+      }
+    }
+  }
+}
+
+UnicodeHasher.test("TwoSplits") {
+  for s in samples where s.utf16.count < 20 {
+    let codeUnits = Array(s.utf16)
+    let expected = hashWhole(codeUnits)
+    for first in 0...codeUnits.count {
+      for second in first...codeUnits.count {
+        for asciiMask in 0..<8 {
+          expectEqual(
+            expected,
+            hashChunked(codeUnits, splits: [first, second],
+                        asciiMask: asciiMask),
+            "\(s.debugDescription) split at \(first), \(second)")
+        }
+      }
+    }
+  }
+}
+
+UnicodeHasher.test("EveryCodeUnit") {
+  // Append one code unit at a time, so that every combining mark and jamo
+  // arrives in a different chunk from the character it attaches to.
+  for s in samples {
+    let codeUnits = Array(s.utf16)
+    let splits = Array(codeUnits.indices)
+    expectEqual(
+      hashWhole(codeUnits),
+      hashChunked(codeUnits, splits: splits, asciiMask: -1),
+      s.debugDescription)
+  }
+}
+
+UnicodeHasher.test("CanonicalEquivalence") {
+  // "a" and U+0301 in separate chunks hash like the precomposed U+00E1.
+  let decomposed = Array((longASCII + "a\u{301}").utf16)
+  let precomposed = Array((longASCII + "\u{e1}").utf16)
+  expectEqual(
+    hashWhole(precomposed),
+    hashChunked(decomposed, splits: [decomposed.count - 1], asciiMask: 1))
+
+  let jamo = Array("\u{1100}\u{1161}\u{11a8}".utf16)
+  let syllable = Array("\u{ac01}".utf16)
+  expectEqual(
+    hashWhole(syllable),
+    hashChunked(jamo, splits: [1, 2], asciiMask: 0))
+}
+
+UnicodeHasher.test("Reuse") {
+  // finish() leaves the hasher ready to be initialized and used again.
+  var hasher = _swift_stdlib_unicode_hasher()
+  for s in samples {
+    let codeUnits = Array(s.utf16)
+    _swift_stdlib_unicode_hasher_init(&hasher)
+    codeUnits.withUnsafeBufferPointer {
+      _swift_stdlib_unicode_hasher_append(
+        &hasher, $0.baseAddress, Int32($0.count))
+    }
+    expectEqual(hashWhole(codeUnits),
+                _swift_stdlib_unicode_hasher_finish(&hasher))
+  }
+}
+
+runAllTests()
@@ -0,0 +1,51 @@
+// RUN: %target-parse-verify-swift
+// RUN: %target-swift-frontend -parse -verify %s -print-stats 2>&1 | FileCheck %s
+// REQUIRES: asserts
+
+// The solver remembers which operator overloads cannot accept arguments of
+// a given type and skips them in later expressions. Make sure the same
+// operand shapes resolve, and fail, the same way every time they appear.
+
+struct A {}
+struct B {}
+struct C {}
+
+infix operator <+> { associativity left precedence 140 }
+infix operator <*> { associativity left precedence 150 }
+
+func <+>(lhs: A, rhs: A) -> A { return lhs }
+func <+>(lhs: B, rhs: B) -> B { return lhs }
+func <+>(lhs: A, rhs: B) -> C { return C() }
+
+func <*>(lhs: A, rhs: A) -> B { return B() }
+func <*>(lhs: B, rhs: B) -> A { return A() }
+
+func firstUse(a: A, b: B) {
+  let _: A = a <+> a
+  let _: B = b <+> b
+  let _: C = a <+> b
+  let _: C = a <+> a <*> a
+  let _: A = a <+> b <*> b
+  let _: A = (a <+> a) <+> (b <*> b)
+}
+
+func secondUse(a: A, b: B) {
+  let _: A = a <+> a
+  let _: B = b <+> b
+  let _: C = a <+> b
+  let _: C = a <+> a <*> a
+  let _: A = a <+> b <*> b
+  let _: A = (a <+> a) <+> (b <*> b)
+}
+
+func invalid(a: A, b: B) {
+  _ = b <+> a // expected-error{{binary operator '<+>' cannot be applied to operands of type 'B' and 'A'}} expected-note{{overloads for '<+>' exist}}
+  _ = b <+> a // expected-error{{binary operator '<+>' cannot be applied to operands of type 'B' and 'A'}} expected-note{{overloads for '<+>' exist}}
+}
+
+// The uses in secondUse() and invalid() repeat operand types seen before, so
+// their inapplicable overloads are found in the cache and skipped.
+// CHECK: Statistics Collected
+// CHECK-DAG: {{^ *[1-9][0-9]*}} Constraint solver overall {{ *}}- # of disjunction terms skipped as known failures
+// CHECK-DAG: {{^ *[1-9][0-9]*}} Constraint solver overall {{ *}}- # of overload applicability cache hits
+// CHECK-DAG: {{^ *[1-9][0-9]*}} Constraint solver overall {{ *}}- # of overload applicability cache misses
@@ -9,6 +9,15 @@ RUN: sed -ne '/--->/s/^.*---> *//p' < %S/Inputs/manglings.txt > %t.check
 RUN: swift-demangle < %t.input > %t.output
 RUN: diff %t.check %t.output
 
+Batch mode must produce the same output, however the input is split up.
+RUN: swift-demangle -batch < %t.input > %t.batch.output
+RUN: diff %t.check %t.batch.output
+RUN: swift-demangle -batch -j 4 -batch-block-size 7 < %t.input > %t.batch.output
+RUN: diff %t.check %t.batch.output
+
+RUN: swift-demangle -batch -print-throughput < %t.input 2>&1 > /dev/null | FileCheck %s -check-prefix=THROUGHPUT
+THROUGHPUT: {{[0-9.]+}} MB in {{[0-9.]+}} s ({{[0-9.]+}} MB/s)
+
 ; RUN: swift-demangle __TtSi | FileCheck %s -check-prefix=DOUBLE
 ; DOUBLE: _TtSi ---> Swift.Int
 
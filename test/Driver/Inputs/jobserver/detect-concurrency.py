@@ -0,0 +1,60 @@
+#!/usr/bin/env python
+# detect-concurrency.py - Fake frontend that reports overlapping jobs -*- python -*-
+#
+# This source file is part of the Swift.org open source project
+#
+# Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+# Licensed under Apache License v2.0 with Runtime Library Exception
+#
+# See http://swift.org/LICENSE.txt for license information
+# See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+#
+# ----------------------------------------------------------------------------
+#
+# Emulates a -c frontend job that waits for another job to run at the same
+# time as it, and reports whether one did.
+#
+# Every job leaves a marker next to its output: "<name>.running" while it
+# runs, renamed to "<name>.overlapped" or "<name>.alone" when it is done.
+# A job has overlapped with another if it sees another job's running or
+# overlapped marker before DETECT_CONCURRENCY_TIMEOUT seconds have passed.
+#
+# ----------------------------------------------------------------------------
+
+from __future__ import print_function
+
+import glob
+import os
+import sys
+import time
+
+assert sys.argv[1] == '-frontend'
+
+primaryFile = sys.argv[sys.argv.index('-primary-file') + 1]
+outputFile = sys.argv[sys.argv.index('-o') + 1]
+name = os.path.basename(primaryFile)
+markerDir = os.path.dirname(os.path.abspath(outputFile))
+marker = os.path.join(markerDir, name)
+timeout = float(os.environ.get('DETECT_CONCURRENCY_TIMEOUT', '60'))
+
+open(marker + '.running', 'w').close()
+
+
+def otherJobsMarkers():
+    found = (glob.glob(os.path.join(markerDir, '*.running')) +
+             glob.glob(os.path.join(markerDir, '*.overlapped')))
+    return [f for f in found if not f.startswith(marker + '.')]
+
+deadline = time.time() + timeout
+overlapped = bool(otherJobsMarkers())
+while not overlapped and time.time() < deadline:
+    time.sleep(0.05)
+    overlapped = bool(otherJobsMarkers())
+
+os.rename(marker + '.running',
+          marker + ('.overlapped' if overlapped else '.alone'))
+
+with open(outputFile, 'a'):
+    os.utime(outputFile, None)
+
+print("Handled", name, "overlapped" if overlapped else "alone")
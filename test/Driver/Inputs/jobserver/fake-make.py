@@ -0,0 +1,58 @@
+#!/usr/bin/env python
+# fake-make.py - Run a command under a GNU make style jobserver -*- python -*-
+#
+# This source file is part of the Swift.org open source project
+#
+# Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+# Licensed under Apache License v2.0 with Runtime Library Exception
+#
+# See http://swift.org/LICENSE.txt for license information
+# See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+#
+# ----------------------------------------------------------------------------
+#
+# Usage: fake-make.py <tokens> <makeflags> <command>...
+#
+# Creates a jobserver pipe holding <tokens> tokens and runs <command> with the
+# pipe's descriptors inherited and MAKEFLAGS set to <makeflags>, in which
+# "R,W" is replaced by the read and write descriptors. Afterwards, prints how
+# many tokens are left in the pipe.
+#
+# ----------------------------------------------------------------------------
+
+from __future__ import print_function
+
+import fcntl
+import os
+import re
+import subprocess
+import sys
+
+tokens = int(sys.argv[1])
+makeflags = sys.argv[2]
+command = sys.argv[3:]
+
+read_fd, write_fd = os.pipe()
+for fd in (read_fd, write_fd):
+    if hasattr(os, 'set_inheritable'):
+        os.set_inheritable(fd, True)
+
+os.write(write_fd, b'+' * tokens)
+
+os.environ['MAKEFLAGS'] = re.sub(
+    r'\bR,W\b', '%d,%d' % (read_fd, write_fd), makeflags)
+
+sys.stdout.flush()
+status = subprocess.call(command, close_fds=False)
+
+fcntl.fcntl(read_fd, fcntl.F_SETFL,
+            fcntl.fcntl(read_fd, fcntl.F_GETFL) | os.O_NONBLOCK)
+left = 0
+try:
+    while os.read(read_fd, 1):
+        left += 1
+except OSError:
+    pass
+print("Tokens left:", left)
+
+sys.exit(status)
@@ -1,3 +1,4 @@
-// Used by multiple_input.swift and emit-objc-header.swift tests.
+// Used by multiple_input.swift, emit-objc-header.swift and trace-events.swift
+// tests.
 
 func libraryFunction() {}
@@ -0,0 +1,65 @@
+// RUN: %swiftc_driver -enable-batch-mode -j2 -driver-skip-execution -v -c %s %S/Inputs/lib.swift %S/Inputs/main.swift %S/Inputs/single_int.swift -module-name main 2>&1 | FileCheck -check-prefix=TWO %s
+
+// TWO: {{.*}}swift{{c?}} -frontend -batch-jobs-file {{[^ ]*}}batch-{{[^ ]*}}.yaml
+// TWO: {{.*}}swift{{c?}} -frontend -batch-jobs-file {{[^ ]*}}batch-{{[^ ]*}}.yaml
+// TWO-NOT: -primary-file
+
+// RUN: %swiftc_driver -enable-batch-mode -j1 -driver-skip-execution -parseable-output -c %s %S/Inputs/lib.swift -module-name main 2>&1 | FileCheck -check-prefix=PARSEABLE %s
+
+// PARSEABLE: "kind": "began",
+// PARSEABLE: "command": "{{.*}}-primary-file {{.*}}batch-mode.swift
+// PARSEABLE: "kind": "began",
+// PARSEABLE: "command": "{{.*}}-primary-file {{.*}}lib.swift
+// PARSEABLE: "kind": "finished",
+// PARSEABLE: "output": "Output placeholder\n"
+// PARSEABLE: "kind": "finished",
+// PARSEABLE-NOT: "output"
+
+// Jobs that serialize their diagnostics are not batched.
+// RUN: %swiftc_driver -enable-batch-mode -j1 -driver-skip-execution -v -c %s %S/Inputs/lib.swift -module-name main -serialize-diagnostics 2>&1 | FileCheck -check-prefix=UNBATCHED %s
+
+// UNBATCHED-NOT: -batch-jobs-file
+// UNBATCHED: -primary-file {{.*}}batch-mode.swift
+// UNBATCHED: -primary-file {{.*}}lib.swift
+// UNBATCHED-NOT: -batch-jobs-file
+
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: cd %t && %target-swiftc_driver -enable-batch-mode -j1 -c %s %S/Inputs/lib.swift -module-name main -emit-dependencies
+// RUN: ls %t/batch-mode.o %t/lib.o
+// RUN: FileCheck -check-prefix=DEPS %s < %t/lib.d
+
+// DEPS: lib.o :
+// DEPS-SAME: lib.swift
+
+// Each job of a batch writes the same dependencies files and reports the same
+// diagnostics as when it is run on its own.
+// RUN: rm -rf %t && mkdir -p %t/single
+// RUN: cp %s %t/batch-mode.swift && cp %S/Inputs/lib.swift %t/lib.swift
+// RUN: cd %t && %target-swiftc_driver -incremental -j1 -c ./batch-mode.swift ./lib.swift -module-name main -emit-dependencies -output-file-map %S/Inputs/batch-mode-ofm.json 2> %t/single/diagnostics.txt
+// RUN: cp %t/batch-mode.d %t/batch-mode.swiftdeps %t/lib.d %t/lib.swiftdeps %t/single/
+// RUN: rm %t/*.o %t/*.d %t/*.swiftdeps
+// RUN: cd %t && %target-swiftc_driver -enable-batch-mode -incremental -j1 -c ./batch-mode.swift ./lib.swift -module-name main -emit-dependencies -output-file-map %S/Inputs/batch-mode-ofm.json 2> %t/diagnostics.txt
+// RUN: diff %t/single/batch-mode.d %t/batch-mode.d
+// RUN: diff %t/single/lib.d %t/lib.d
+// RUN: diff %t/single/batch-mode.swiftdeps %t/batch-mode.swiftdeps
+// RUN: diff %t/single/lib.swiftdeps %t/lib.swiftdeps
+// RUN: diff %t/single/diagnostics.txt %t/diagnostics.txt
+// RUN: FileCheck -check-prefix=WARNING %s < %t/diagnostics.txt
+
+// WARNING: batch-mode.swift:{{[0-9]+}}:{{[0-9]+}}: warning: initialization of immutable value 'unused' was never used
+// WARNING-NOT: lib.swift:{{.*}}: warning:
+
+// RUN: cd %t && %target-swiftc_driver -enable-batch-mode -j1 -parseable-output -c ./batch-mode.swift ./lib.swift -module-name main 2>&1 | FileCheck -check-prefix=PARSEABLE-DIAGS %s
+
+// PARSEABLE-DIAGS: "kind": "finished",
+// PARSEABLE-DIAGS: "output": "{{[^"]*}}batch-mode.swift:{{[0-9]+}}:{{[0-9]+}}: warning: initialization of immutable value 'unused' was never used
+// PARSEABLE-DIAGS: "kind": "finished",
+// PARSEABLE-DIAGS-NOT: "output"
+
+func useLibrary() {
+  libraryFunction()
+}
+
+func unusedValue() {
+  let unused = 42
+}
@@ -0,0 +1,33 @@
+// The driver joins a GNU make jobserver advertised in MAKEFLAGS. Every job
+// beyond the first needs a token from it, so with no tokens to hand out the
+// jobs run one at a time even with -j2.
+
+// Only Linux can read the inherited jobserver pipe without blocking.
+// REQUIRES: OS=linux-gnu
+
+// RUN: rm -rf %t && mkdir -p %t/auth-none %t/auth-one %t/fds-none %t/last-wins %t/closed %t/garbage %t/no-jobserver %t/no-makeflags
+// RUN: touch %t/a.swift %t/b.swift
+
+// RUN: (cd %t/auth-none && env DETECT_CONCURRENCY_TIMEOUT=1 %{python} %S/Inputs/jobserver/fake-make.py 0 "-j --jobserver-auth=R,W" %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/detect-concurrency.py -c ../a.swift ../b.swift -module-name main -j2 2>&1 | FileCheck -check-prefix=SERIAL -check-prefix=TOKENS-0 %s)
+// RUN: (cd %t/fds-none && env DETECT_CONCURRENCY_TIMEOUT=1 %{python} %S/Inputs/jobserver/fake-make.py 0 "-j --jobserver-fds=R,W" %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/detect-concurrency.py -c ../a.swift ../b.swift -module-name main -j2 2>&1 | FileCheck -check-prefix=SERIAL -check-prefix=TOKENS-0 %s)
+
+// SERIAL-DAG: Handled a.swift alone
+// SERIAL-DAG: Handled b.swift alone
+// TOKENS-0: Tokens left: 0
+
+// A token lets the second job run alongside the first, and is given back
+// when the build is done.
+// RUN: (cd %t/auth-one && %{python} %S/Inputs/jobserver/fake-make.py 1 "-j --jobserver-auth=R,W" %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/detect-concurrency.py -c ../a.swift ../b.swift -module-name main -j2 2>&1 | FileCheck -check-prefix=PARALLEL -check-prefix=TOKENS-1 %s)
+
+// PARALLEL-DAG: Handled a.swift overlapped
+// PARALLEL-DAG: Handled b.swift overlapped
+// TOKENS-1: Tokens left: 1
+
+// The last jobserver option wins, whichever way it is spelled.
+// RUN: (cd %t/last-wins && env DETECT_CONCURRENCY_TIMEOUT=1 %{python} %S/Inputs/jobserver/fake-make.py 0 "--jobserver-auth=x,y -j --jobserver-fds=R,W" %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/detect-concurrency.py -c ../a.swift ../b.swift -module-name main -j2 2>&1 | FileCheck -check-prefix=SERIAL -check-prefix=TOKENS-0 %s)
+
+// Without a usable jobserver, -j alone limits the number of jobs.
+// RUN: (cd %t/closed && %{python} %S/Inputs/jobserver/fake-make.py 0 "-j --jobserver-auth=98,99" %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/detect-concurrency.py -c ../a.swift ../b.swift -module-name main -j2 2>&1 | FileCheck -check-prefix=PARALLEL -check-prefix=TOKENS-0 %s)
+// RUN: (cd %t/garbage && %{python} %S/Inputs/jobserver/fake-make.py 0 "-j --jobserver-auth=R" %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/detect-concurrency.py -c ../a.swift ../b.swift -module-name main -j2 2>&1 | FileCheck -check-prefix=PARALLEL -check-prefix=TOKENS-0 %s)
+// RUN: (cd %t/no-jobserver && %{python} %S/Inputs/jobserver/fake-make.py 0 "-k -j4" %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/detect-concurrency.py -c ../a.swift ../b.swift -module-name main -j2 2>&1 | FileCheck -check-prefix=PARALLEL -check-prefix=TOKENS-0 %s)
+// RUN: (cd %t/no-makeflags && env -u MAKEFLAGS %swiftc_driver_plain -driver-use-frontend-path %S/Inputs/jobserver/detect-concurrency.py -c ../a.swift ../b.swift -module-name main -j2 2>&1 | FileCheck -check-prefix=PARALLEL %s)
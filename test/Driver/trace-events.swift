@@ -0,0 +1,18 @@
+// RUN: %swiftc_driver -driver-print-jobs -c %s %S/Inputs/lib.swift -trace-events-output %t.json 2>&1 | FileCheck -check-prefix=JOBS %s
+
+// JOBS: {{.*}}swift{{c?}} -frontend -c -primary-file {{.*}}trace-events.swift {{.*}}-trace-events-output {{[^ ]*}}trace-events-{{[^ ]*}}.trace.json
+// JOBS: {{.*}}swift{{c?}} -frontend -c {{.*}}-primary-file {{.*}}lib.swift {{.*}}-trace-events-output {{[^ ]*}}lib-{{[^ ]*}}.trace.json
+
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: cd %t && %target-swiftc_driver -c %s %S/Inputs/lib.swift -module-name main -trace-events-output %t/trace.json
+// RUN: FileCheck -check-prefix=MERGED %s < %t/trace.json
+
+// MERGED: {"displayTimeUnit":"ms","traceEvents":
+// MERGED-DAG: "name":"process_name",{{.*}}"args":{"name":"swift -frontend {{.*}}trace-events.swift"}
+// MERGED-DAG: "name":"process_name",{{.*}}"args":{"name":"swift -frontend {{.*}}lib.swift"}
+// MERGED-DAG: "cat":"function-body","name":"useLibrary() at {{.*}}trace-events.swift:16:6"
+// MERGED-DAG: "cat":"function-body","name":"libraryFunction() at {{.*}}lib.swift:4:6"
+
+func useLibrary() {
+  libraryFunction()
+}
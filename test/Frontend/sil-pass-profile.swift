@@ -0,0 +1,15 @@
+// RUN: rm -f %t.json
+// RUN: %target-swift-frontend -O -emit-sil %s -sil-pass-profile %t.json -o /dev/null
+// RUN: FileCheck %s < %t.json
+
+// CHECK: "passes": [
+// CHECK-NOT: "stage": "Onone"
+// CHECK: "stage": "HighLevel+EarlyLoopOpt"
+// CHECK: "stage": "LateLoopOpt"
+// CHECK-NOT: "stage": "Onone"
+// CHECK: "top-functions": [
+// CHECK: "function": "{{.*}}"
+
+public func add(_ x: Int, _ y: Int) -> Int {
+  return x + y
+}
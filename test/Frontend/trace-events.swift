@@ -0,0 +1,22 @@
+// RUN: rm -f %t.json
+// RUN: %target-swift-frontend -O -emit-sil %s -trace-events-output %t.json -o /dev/null
+// RUN: FileCheck %s < %t.json
+
+// CHECK: {"displayTimeUnit":"ms","traceEvents":
+// CHECK-NEXT: [
+// CHECK-NEXT: {"ph":"M","name":"process_name",{{.*}}"args":{"name":"swift -frontend {{.*}}trace-events.swift"}}
+// CHECK-DAG: "cat":"phase","name":"Parsing"
+// CHECK-DAG: "cat":"phase","name":"Type checking / Semantic analysis"
+// CHECK-DAG: "cat":"validate-decl","name":"add(_:_:) at {{.*}}trace-events.swift:20:13"
+// CHECK-DAG: "cat":"function-body","name":"add(_:_:) at {{.*}}trace-events.swift:20:13"
+// CHECK-DAG: "cat":"expr","name":"expression at {{.*}}trace-events.swift:21:10"
+// CHECK-DAG: "cat":"solve","name":"solve",{{.*}}"args":{"solutions":1,"NumTypeVariablesBound":{{[0-9]+}}
+// CHECK-DAG: "cat":"phase","name":"SILGen"
+// CHECK-DAG: "cat":"sil-function","name":"_TF12trace_events3add{{[^"]*}}"
+// CHECK-DAG: "cat":"sil-pass","name":"Simplify CFG"
+// CHECK: ]
+// CHECK-NEXT: }
+
+public func add(_ x: Int, _ y: Int) -> Int {
+  return x + y
+}
@@ -0,0 +1,22 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %target-build-swift -lswiftSwiftReflectionTest -Xfrontend -enable-reflection-metadata %s -o %t/reflect_benchmark
+// RUN: %target-run %target-swift-reflection-test %t/reflect_benchmark -benchmark 3 | FileCheck %s
+
+// SwiftReflectionTest only supports Darwin so far.
+// REQUIRES: objc_interop
+// REQUIRES: executable_test
+
+import SwiftReflectionTest
+
+class Node {
+  var name: String = "node"
+  var value: Int = 0
+  var children: [Node] = []
+  var parent: Node? = nil
+}
+
+reflect(instance: Node())
+
+// CHECK: Decoding type reference ...
+// CHECK: Uncached: {{[0-9]+}} reads, {{[0-9]+}} bytes, {{[0-9]+}} us per decoding
+// CHECK-NEXT: Page cache: {{[0-9]+}} reads, {{[0-9]+}} bytes, {{[0-9]+}} us per decoding
@@ -0,0 +1,10 @@
+// RUN: rm -rf %t
+// RUN: mkdir %t
+// RUN: %target-swift-frontend -emit-module -o %t %S/Inputs/def_func.swift -module-name new_module
+// RUN: %target-swift-frontend %s -parse -I %t -debug-time-module-loading 2>&1 | FileCheck %s
+
+// CHECK: {{[0-9.]+}}ms{{[[:space:]]+}}{{[0-9]+}}KB heap{{[[:space:]]+}}{{[0-9]+}}KB mapped{{[[:space:]]+}}new_module{{[[:space:]]+}}{{.*}}new_module.swiftmodule
+
+import new_module
+
+_ = getZero()
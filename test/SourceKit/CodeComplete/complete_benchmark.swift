@@ -0,0 +1,23 @@
+// REQUIRES: objc_interop
+
+import Foundation
+
+func test() {
+  #^GLOBAL,,s,st,str,NSStr,NSString,uni,withUnsafe^#
+}
+
+// Global completion over the stdlib and Foundation, which has a large enough
+// result set to exercise parallel matching and partial sorting.
+
+// RUN: %complete-test -tok=GLOBAL -time -repeat=3 -limit=100 %s | FileCheck %s
+// CHECK: open: {{[0-9]+}} results, min {{[0-9.]+}}ms, avg {{[0-9.]+}}ms over 1 requests
+// CHECK: update 's': 100 results, min {{[0-9.]+}}ms, avg {{[0-9.]+}}ms over 3 requests
+// CHECK: update 'st': 100 results,
+// CHECK: update 'str': 100 results,
+// CHECK: update 'NSStr': {{[0-9]+}} results,
+// CHECK: update 'NSString': {{[0-9]+}} results,
+// CHECK: update 'uni': {{[0-9]+}} results,
+// CHECK: update 'withUnsafe': {{[0-9]+}} results,
+
+// RUN: %complete-test -tok=GLOBAL -time -repeat=3 %s | FileCheck %s -check-prefix=NOLIMIT
+// NOLIMIT: update 's': {{[0-9][0-9][0-9][0-9]+}} results,
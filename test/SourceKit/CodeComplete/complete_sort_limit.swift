@@ -0,0 +1,40 @@
+struct A {}
+struct B {}
+
+func aaa() {}
+func aaa(x: A) {}
+func aaa(x: B) {}
+func aab() {}
+
+func test(x: Int) {
+  let y = x
+  let z = x
+  let zzz = x
+  (#^EXPR^#)
+}
+
+// With -limit, only the requested page is sorted. Check that it still
+// matches the start of the fully sorted results, including the literals and
+// the top non-literal results pulled above them.
+
+// RUN: %complete-test -tok=EXPR -top=3 %s > %t.full
+// RUN: %complete-test -tok=EXPR -top=3 -limit=5 %s > %t.5
+// RUN: %complete-test -tok=EXPR -top=3 -limit=20 %s > %t.20
+// RUN: awk '/^[^ ]/ { if (++n > 5) exit } { print }' %t.full | diff -u - %t.5
+// RUN: awk '/^[^ ]/ { if (++n > 20) exit } { print }' %t.full | diff -u - %t.20
+
+// RUN: %complete-test -tok=EXPR -top=3 -group=overloads %s > %t.group.full
+// RUN: %complete-test -tok=EXPR -top=3 -group=overloads -limit=5 %s > %t.group.5
+// RUN: %complete-test -tok=EXPR -top=3 -group=overloads -limit=20 %s > %t.group.20
+// RUN: awk '/^[^ ]/ { if (++n > 5) exit } { print }' %t.group.full | diff -u - %t.group.5
+// RUN: awk '/^[^ ]/ { if (++n > 20) exit } { print }' %t.group.full | diff -u - %t.group.20
+
+// RUN: %complete-test -tok=EXPR -top=3 -sort=name %s > %t.name.full
+// RUN: %complete-test -tok=EXPR -top=3 -sort=name -limit=5 %s > %t.name.5
+// RUN: %complete-test -tok=EXPR -top=3 -sort=name -limit=20 %s > %t.name.20
+// RUN: awk '/^[^ ]/ { if (++n > 5) exit } { print }' %t.name.full | diff -u - %t.name.5
+// RUN: awk '/^[^ ]/ { if (++n > 20) exit } { print }' %t.name.full | diff -u - %t.name.20
+
+// RUN: %complete-test -tok=EXPR -top=3 -group=overloads -sort=name %s > %t.both.full
+// RUN: %complete-test -tok=EXPR -top=3 -group=overloads -sort=name -limit=20 %s > %t.both.20
+// RUN: awk '/^[^ ]/ { if (++n > 20) exit } { print }' %t.both.full | diff -u - %t.both.20
@@ -0,0 +1,23 @@
+func first() -> Int {
+}
+
+func second() {
+
+}
+
+// A type-checking error switches off the SIL diagnostics of a full build.
+// An edit confined to second() only re-checks that body, so the missing
+// return in first() is carried over from the previous AST.
+
+// RUN: %sourcekitd-test -req=open %s -- %s == -req=print-diags %s == \
+// RUN:    -req=edit -pos=5:1 -replace="  missingInSecond()" -length=0 %s == \
+// RUN:    -req=print-diags %s | FileCheck %s
+
+// CHECK:      key.line: 2,
+// CHECK:      key.description: "missing return in a function expected to return 'Int'",
+// CHECK-NOT:  missingInSecond
+
+// CHECK:      key.line: 2,
+// CHECK:      key.description: "missing return in a function expected to return 'Int'",
+// CHECK:      key.line: 5,
+// CHECK:      key.description: "use of unresolved identifier 'missingInSecond'",
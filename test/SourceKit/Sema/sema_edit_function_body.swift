@@ -0,0 +1,60 @@
+class MyClass {}
+
+func first() {
+  let _ = MyClass()
+  missingInFirst()
+}
+
+func second() {
+  let _ = MyClass()
+
+}
+
+// An edit inside one function body re-checks only that body; the diagnostics
+// and annotations of the other bodies are kept. The first print-diags makes
+// sure there is a previous AST to take them from.
+
+// RUN: %sourcekitd-test -req=open %s -- %s == -req=print-diags %s == \
+// RUN:    -req=edit -pos=10:1 -replace="  missingInSecond()" -length=0 %s == \
+// RUN:    -req=print-diags %s | FileCheck -check-prefix=CHECK-DIAG %s
+
+// CHECK-DIAG:      key.line: 5,
+// CHECK-DIAG:      key.description: "use of unresolved identifier 'missingInFirst'",
+// CHECK-DIAG:      key.line: 10,
+// CHECK-DIAG:      key.description: "use of unresolved identifier 'missingInSecond'",
+
+// RUN: %sourcekitd-test -req=open %s -- %s == -req=print-diags %s == \
+// RUN:    -req=edit -pos=10:1 -replace="  missingInSecond()" -length=0 %s == \
+// RUN:    -req=edit -pos=10:3 -replace="" -length=17 %s == \
+// RUN:    -req=print-diags %s | FileCheck -check-prefix=CHECK-FIXED %s
+
+// CHECK-FIXED:     key.description: "use of unresolved identifier 'missingInFirst'",
+// CHECK-FIXED-NOT: missingInSecond
+
+// RUN: %sourcekitd-test -req=open %s -- %s == -req=print-diags %s == \
+// RUN:    -req=edit -pos=10:1 -replace="  missingInSecond()" -length=0 %s == \
+// RUN:    -req=print-annotations %s | FileCheck -check-prefix=CHECK-ANNOT %s
+
+// CHECK-ANNOT:      key.kind: source.lang.swift.ref.class,
+// CHECK-ANNOT-NEXT: key.offset: 43,
+// CHECK-ANNOT:      key.kind: source.lang.swift.ref.class,
+// CHECK-ANNOT-NEXT: key.offset: 101,
+
+// An edit that changes the extent of the body is checked as a whole.
+
+// RUN: %sourcekitd-test -req=open %s -- %s == -req=print-diags %s == \
+// RUN:    -req=edit -pos=10:1 -replace="} func third() { missingInThird()" -length=0 %s == \
+// RUN:    -req=print-diags %s | FileCheck -check-prefix=CHECK-SPLIT %s
+
+// CHECK-SPLIT: missingInFirst
+// CHECK-SPLIT: missingInThird
+
+// Requests other than the editor's still get a fully type-checked AST, so
+// cursor info works inside the bodies that the partial AST skipped.
+
+// RUN: %sourcekitd-test -req=open %s -- %s == -req=print-diags %s == \
+// RUN:    -req=edit -pos=10:1 -replace="  missingInSecond()" -length=0 %s == \
+// RUN:    -req=cursor -pos=4:11 %s -- %s | FileCheck -check-prefix=CHECK-CURSOR %s
+
+// CHECK-CURSOR:      source.lang.swift.ref.class (1:7-1:14)
+// CHECK-CURSOR-NEXT: MyClass
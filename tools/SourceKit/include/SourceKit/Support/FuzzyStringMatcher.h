@@ -32,6 +32,9 @@ class FuzzyStringMatcher {
   double maxScore; ///< The maximum possible raw score for this pattern.
   /// If (and only if) c is in pattern, charactersInPattern[c] == 1
   llvm::BitVector charactersInPattern;
+  /// The character classes (see getCharacterClassMask) of the pattern, used to
+  /// quickly reject candidates before doing the in-order match.
+  uint64_t patternClassMask = 0;
 
 public:
   bool normalize = false; ///< Whether to normalize scores to [0, 1].
@@ -39,6 +42,20 @@ public:
 public:
   FuzzyStringMatcher(StringRef pattern);
 
+  /// Returns a case-insensitive summary of the characters in \p str.
+  ///
+  /// A candidate can only match if its mask contains every bit of the
+  /// pattern's mask.  matchesCandidate() does not check this itself; clients
+  /// that filter the same candidates repeatedly should compute the mask once
+  /// per candidate and check mayMatchCandidateMask() first.
+  static uint64_t getCharacterClassMask(StringRef str);
+
+  /// Whether a candidate with the character class mask \p candidateMask can
+  /// possibly match the pattern.
+  bool mayMatchCandidateMask(uint64_t candidateMask) const {
+    return (patternClassMask & ~candidateMask) == 0;
+  }
+
   /// Whether \p candidate matches the pattern.
   ///
   /// This operation is much simpler/faster than calculating
@@ -0,0 +1,396 @@
+//===--- Concurrency-Linux.cpp --------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+//
+// WorkQueue on top of a process-wide pool of threads, for platforms without
+// libdispatch.
+//
+// Work that is ready to run waits in one list per priority; idle threads
+// take it from the highest priority list first. Low and background priority
+// work never occupies every thread, so that a request from the user does not
+// wait for indexing to finish. A queue hands its work to the pool one item
+// at a time if it is serial, and until it reaches a barrier otherwise.
+//
+// The pool starts with one thread per core. A thread blocked in
+// dispatchSync() may start another one so that the work it waits for can
+// run; once the pool is back to more idle threads than it needs, the extra
+// threads exit.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SourceKit/Support/Concurrency.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Threading.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <pthread.h>
+
+using namespace SourceKit;
+
+static const size_t ThreadStackSize = 8 << 20; // 8 MB.
+
+/// How long a thread beyond the pool's width waits for work before exiting.
+static const std::chrono::seconds SurplusThreadIdleTimeout(5);
+
+namespace {
+
+/// Signals a thread blocked in dispatchSync() that its work may run.
+struct SyncWaiter {
+  std::condition_variable Condition;
+  bool CanRun = false;
+};
+
+struct WorkItem {
+  void *Context;
+  WorkQueue::DispatchFn Fn;
+  bool IsBarrier;
+  /// Set for dispatchSync(), which runs the item on the calling thread.
+  SyncWaiter *Waiter;
+};
+
+class Queue {
+public:
+  std::atomic<unsigned> RefCount{1};
+  const bool IsSerial;
+  const std::string Label;
+
+  // The following are guarded by the pool's lock.
+  WorkQueue::Priority Prio;
+  std::deque<WorkItem> Pending;
+  unsigned NumRunning = 0;
+  bool RunningBarrier = false;
+  unsigned SuspendCount = 0;
+
+  Queue(bool IsSerial, llvm::StringRef Label, WorkQueue::Priority Prio)
+    : IsSerial(IsSerial), Label(Label), Prio(Prio) {}
+
+  void retain() { ++RefCount; }
+  void release() {
+    if (--RefCount == 0)
+      delete this;
+  }
+};
+
+struct Task {
+  /// The queue the work came from, or null for dispatchConcurrent().
+  Queue *Q;
+  WorkItem Item;
+  WorkQueue::Priority Prio;
+};
+
+class ThreadPool {
+  static const unsigned NumPriorities = 4;
+
+  std::mutex Lock;
+  std::condition_variable WorkAvailable;
+  std::deque<Task> Ready[NumPriorities];
+
+  unsigned NumThreads = 0;
+  unsigned NumIdle = 0;
+  unsigned NumRunningLowPriority = 0;
+  /// The number of threads that work is expected to keep busy.
+  const unsigned Width;
+
+  static bool isLowPriority(WorkQueue::Priority Prio) {
+    return Prio == WorkQueue::Priority::Low ||
+           Prio == WorkQueue::Priority::Background;
+  }
+
+  unsigned getMaxRunningLowPriority() const {
+    return std::max(1U, Width - 1);
+  }
+
+  bool takeTaskLocked(Task &Result);
+  void startThreadLocked();
+  void pumpLocked(Queue *Q);
+  void finishLocked(Queue *Q, WorkQueue::Priority Prio);
+  static void *workerMain(void *Pool);
+
+public:
+  ThreadPool()
+    : Width(std::max(2U, std::thread::hardware_concurrency())) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    for (unsigned i = 0; i != Width; ++i)
+      startThreadLocked();
+  }
+
+  static ThreadPool &get() {
+    // Leaked, so that worker threads can outlive static destructors.
+    static ThreadPool *Pool = new ThreadPool();
+    return *Pool;
+  }
+
+  void dispatch(Queue *Q, WorkItem Item);
+  void dispatchSync(Queue *Q, WorkItem Item, bool IsStackDeep);
+  void dispatchConcurrent(WorkQueue::Priority Prio, WorkItem Item);
+  void suspend(Queue *Q);
+  void resume(Queue *Q);
+  void setPriority(Queue *Q, WorkQueue::Priority Prio);
+};
+
+} // end anonymous namespace
+
+static LLVM_THREAD_LOCAL bool IsPoolThread = false;
+
+void ThreadPool::startThreadLocked() {
+  pthread_attr_t Attr;
+  pthread_attr_init(&Attr);
+  pthread_attr_setstacksize(&Attr, ThreadStackSize);
+  pthread_attr_setdetachstate(&Attr, PTHREAD_CREATE_DETACHED);
+  pthread_t Thread;
+  if (pthread_create(&Thread, &Attr, workerMain, this) == 0)
+    ++NumThreads;
+  pthread_attr_destroy(&Attr);
+  if (NumThreads == 0)
+    llvm::report_fatal_error("could not start a WorkQueue thread");
+}
+
+bool ThreadPool::takeTaskLocked(Task &Result) {
+  for (unsigned P = 0; P != NumPriorities; ++P) {
+    if (Ready[P].empty())
+      continue;
+    if (isLowPriority(Ready[P].front().Prio) &&
+        NumRunningLowPriority >= getMaxRunningLowPriority())
+      continue;
+    Result = Ready[P].front();
+    Ready[P].pop_front();
+    if (isLowPriority(Result.Prio))
+      ++NumRunningLowPriority;
+    return true;
+  }
+  return false;
+}
+
+void *ThreadPool::workerMain(void *Ctx) {
+  auto &Pool = *static_cast<ThreadPool *>(Ctx);
+  IsPoolThread = true;
+  std::unique_lock<std::mutex> Guard(Pool.Lock);
+  while (true) {
+    Task T;
+    auto TakeTask = [&] { return Pool.takeTaskLocked(T); };
+    bool GotTask = true;
+    ++Pool.NumIdle;
+    if (Pool.NumThreads > Pool.Width)
+      GotTask = Pool.WorkAvailable.wait_for(Guard, SurplusThreadIdleTimeout,
+                                            TakeTask);
+    else
+      Pool.WorkAvailable.wait(Guard, TakeTask);
+    --Pool.NumIdle;
+
+    if (!GotTask) {
+      // Nothing needed this thread for a while, so give its stack back
+      // unless other surplus threads have already exited.
+      if (Pool.NumThreads > Pool.Width) {
+        --Pool.NumThreads;
+        break;
+      }
+      continue;
+    }
+
+    Guard.unlock();
+    T.Item.Fn(T.Item.Context);
+    Guard.lock();
+
+    Pool.finishLocked(T.Q, T.Prio);
+    if (T.Q) {
+      // Drop the reference dispatch() took without holding the lock, since
+      // this may destroy the queue.
+      Guard.unlock();
+      T.Q->release();
+      Guard.lock();
+    }
+  }
+  return nullptr;
+}
+
+/// Hands the items at the front of \p Q that may start now to the pool.
+void ThreadPool::pumpLocked(Queue *Q) {
+  while (!Q->SuspendCount && !Q->Pending.empty()) {
+    WorkItem &Item = Q->Pending.front();
+    bool Exclusive = Q->IsSerial || Item.IsBarrier;
+    if (Exclusive ? Q->NumRunning != 0 : Q->RunningBarrier)
+      break;
+
+    ++Q->NumRunning;
+    Q->RunningBarrier = Exclusive;
+    if (Item.Waiter) {
+      Item.Waiter->CanRun = true;
+      Item.Waiter->Condition.notify_one();
+    } else {
+      Ready[unsigned(Q->Prio)].push_back({ Q, Item, Q->Prio });
+      WorkAvailable.notify_one();
+    }
+    Q->Pending.pop_front();
+  }
+}
+
+void ThreadPool::finishLocked(Queue *Q, WorkQueue::Priority Prio) {
+  // Low priority work that was held back can start on this thread once it
+  // goes back to waiting.
+  if (isLowPriority(Prio))
+    --NumRunningLowPriority;
+
+  if (!Q)
+    return;
+  if (--Q->NumRunning == 0)
+    Q->RunningBarrier = false;
+  pumpLocked(Q);
+}
+
+void ThreadPool::dispatch(Queue *Q, WorkItem Item) {
+  // Released by the thread that runs the item.
+  Q->retain();
+  std::lock_guard<std::mutex> Guard(Lock);
+  Q->Pending.push_back(Item);
+  pumpLocked(Q);
+}
+
+void ThreadPool::dispatchSync(Queue *Q, WorkItem Item, bool IsStackDeep) {
+  SyncWaiter Waiter;
+  Item.Waiter = &Waiter;
+
+  std::unique_lock<std::mutex> Guard(Lock);
+  Q->Pending.push_back(Item);
+  pumpLocked(Q);
+  if (!Waiter.CanRun) {
+    // The work this thread waits for may itself be waiting for a thread.
+    if (IsPoolThread && NumIdle == 0)
+      startThreadLocked();
+    Waiter.Condition.wait(Guard, [&] { return Waiter.CanRun; });
+  }
+  Guard.unlock();
+
+  if (IsStackDeep)
+    llvm::llvm_execute_on_thread(Item.Fn, Item.Context, ThreadStackSize);
+  else
+    Item.Fn(Item.Context);
+
+  Guard.lock();
+  if (--Q->NumRunning == 0)
+    Q->RunningBarrier = false;
+  pumpLocked(Q);
+}
+
+void ThreadPool::dispatchConcurrent(WorkQueue::Priority Prio, WorkItem Item) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  Ready[unsigned(Prio)].push_back({ nullptr, Item, Prio });
+  WorkAvailable.notify_one();
+}
+
+void ThreadPool::suspend(Queue *Q) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  ++Q->SuspendCount;
+}
+
+void ThreadPool::resume(Queue *Q) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  assert(Q->SuspendCount > 0 && "resuming a queue that is not suspended");
+  --Q->SuspendCount;
+  pumpLocked(Q);
+}
+
+void ThreadPool::setPriority(Queue *Q, WorkQueue::Priority Prio) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  Q->Prio = Prio;
+}
+
+static WorkItem makeItem(void *Context, WorkQueue::DispatchFn Fn,
+                         bool IsBarrier) {
+  return WorkItem{ Context, Fn, IsBarrier, nullptr };
+}
+
+static void dispatchAsync(Queue *Q, void *Context, WorkQueue::DispatchFn Fn,
+                          bool IsBarrier) {
+  ThreadPool::get().dispatch(Q, makeItem(Context, Fn, IsBarrier));
+}
+
+static Queue *getMainQueue() {
+  static Queue *Main = new Queue(/*IsSerial=*/true, "main",
+                                 WorkQueue::Priority::Default);
+  return Main;
+}
+
+void *WorkQueue::Impl::create(Dequeuing DeqKind, Priority Prio,
+                              llvm::StringRef Label) {
+  return new Queue(DeqKind == Dequeuing::Serial, Label, Prio);
+}
+
+// Pool threads run on large stacks, so isStackDeep only matters for work
+// that runs on the calling thread.
+
+void WorkQueue::Impl::dispatch(Ty Obj, const DispatchData &Fn) {
+  dispatchAsync(static_cast<Queue *>(Obj), Fn.getContext(), Fn.getFunction(),
+                /*IsBarrier=*/false);
+}
+
+void WorkQueue::Impl::dispatchSync(Ty Obj, const DispatchData &Fn) {
+  ThreadPool::get().dispatchSync(
+      static_cast<Queue *>(Obj),
+      makeItem(Fn.getContext(), Fn.getFunction(), /*IsBarrier=*/false),
+      Fn.isStackDeep());
+}
+
+void WorkQueue::Impl::dispatchBarrier(Ty Obj, const DispatchData &Fn) {
+  dispatchAsync(static_cast<Queue *>(Obj), Fn.getContext(), Fn.getFunction(),
+                /*IsBarrier=*/true);
+}
+
+void WorkQueue::Impl::dispatchBarrierSync(Ty Obj, const DispatchData &Fn) {
+  ThreadPool::get().dispatchSync(
+      static_cast<Queue *>(Obj),
+      makeItem(Fn.getContext(), Fn.getFunction(), /*IsBarrier=*/true),
+      Fn.isStackDeep());
+}
+
+void WorkQueue::Impl::dispatchOnMain(const DispatchData &Fn) {
+  // There is no main run loop to hand the work to; a serial queue keeps
+  // the ordering guarantee.
+  dispatchAsync(getMainQueue(), Fn.getContext(), Fn.getFunction(),
+                /*IsBarrier=*/false);
+}
+
+void WorkQueue::Impl::dispatchConcurrent(Priority Prio,
+                                         const DispatchData &Fn) {
+  ThreadPool::get().dispatchConcurrent(
+      Prio, makeItem(Fn.getContext(), Fn.getFunction(), /*IsBarrier=*/false));
+}
+
+void WorkQueue::Impl::suspend(Ty Obj) {
+  ThreadPool::get().suspend(static_cast<Queue *>(Obj));
+}
+
+void WorkQueue::Impl::resume(Ty Obj) {
+  ThreadPool::get().resume(static_cast<Queue *>(Obj));
+}
+
+void WorkQueue::Impl::setPriority(Ty Obj, Priority Prio) {
+  ThreadPool::get().setPriority(static_cast<Queue *>(Obj), Prio);
+}
+
+llvm::StringRef WorkQueue::Impl::getLabel(const Ty Obj) {
+  return static_cast<const Queue *>(Obj)->Label;
+}
+
+void WorkQueue::Impl::retain(Ty Obj) {
+  static_cast<Queue *>(Obj)->retain();
+}
+
+void WorkQueue::Impl::release(Ty Obj) {
+  static_cast<Queue *>(Obj)->release();
+}
@@ -21,6 +21,33 @@ using clang::toLowercase;
 using clang::isUppercase;
 using clang::isLowercase;
 
+/// Maps \p c to one of 64 buckets: one per letter (ignoring case), one per
+/// digit, and the rest shared by everything else.
+static uint64_t getCharacterClassBit(char c) {
+  unsigned char lower = static_cast<unsigned char>(toLowercase(c));
+  if (lower >= 'a' && lower <= 'z')
+    return uint64_t(1) << (lower - 'a');
+  if (lower >= '0' && lower <= '9')
+    return uint64_t(1) << (26 + lower - '0');
+  return uint64_t(1) << (36 + lower % 28);
+}
+
+uint64_t FuzzyStringMatcher::getCharacterClassMask(StringRef str) {
+  // Accumulate into a few independent masks so the loop doesn't serialize on
+  // a single register.
+  uint64_t masks[4] = {0, 0, 0, 0};
+  size_t i = 0, e = str.size();
+  for (; i + 4 <= e; i += 4) {
+    masks[0] |= getCharacterClassBit(str[i]);
+    masks[1] |= getCharacterClassBit(str[i + 1]);
+    masks[2] |= getCharacterClassBit(str[i + 2]);
+    masks[3] |= getCharacterClassBit(str[i + 3]);
+  }
+  for (; i < e; ++i)
+    masks[0] |= getCharacterClassBit(str[i]);
+  return masks[0] | masks[1] | masks[2] | masks[3];
+}
+
 FuzzyStringMatcher::FuzzyStringMatcher(StringRef pattern_)
     : pattern(pattern_), charactersInPattern(1 << (sizeof(char) * 8)) {
   lowercasePattern.reserve(pattern.size());
@@ -32,6 +59,7 @@ FuzzyStringMatcher::FuzzyStringMatcher(StringRef pattern_)
     charactersInPattern.set(static_cast<unsigned char>(lower));
     charactersInPattern.set(static_cast<unsigned char>(toUppercase(c)));
   }
+  patternClassMask = getCharacterClassMask(pattern);
   assert(pattern.size() == lowercasePattern.size());
 
   // FIXME: pull out the magic constants.
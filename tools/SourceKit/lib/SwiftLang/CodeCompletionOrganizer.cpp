@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "CodeCompletionOrganizer.h"
+#include "SourceKit/Support/Concurrency.h"
 #include "SourceKit/Support/FuzzyStringMatcher.h"
 #include "swift/AST/ASTContext.h"
 #include "swift/AST/Module.h"
@@ -191,6 +192,8 @@ class CodeCompletionOrganizer::Impl {
   std::unique_ptr<Group> rootGroup;
   CompletionKind completionKind;
   bool completionHasExpectedTypes;
+  unsigned numCandidates = 0;
+  unsigned numMatches = 0;
 
   void groupStemsRecursive(Group *group, bool recurseIntoNewGroups,
                            StringRef(getStem)(StringRef));
@@ -203,7 +206,10 @@ public:
                                 const FilterRules &rules,
                                 Completion *&exactMatch);
 
-  void sort(Options options);
+  void sort(Options options, unsigned numResultsNeeded);
+
+  unsigned getNumCandidates() const { return numCandidates; }
+  unsigned getNumMatches() const { return numMatches; }
 
   void groupOverloads() {
     groupStemsRecursive(
@@ -281,13 +287,22 @@ void CodeCompletionOrganizer::addCompletionsWithFilter(
                                 exactMatch);
 }
 
-void CodeCompletionOrganizer::groupAndSort(const Options &options) {
+void CodeCompletionOrganizer::groupAndSort(const Options &options,
+                                           unsigned numResultsNeeded) {
   if (options.groupStems)
     impl.groupStems();
   else if (options.groupOverloads)
     impl.groupOverloads();
 
-  impl.sort(options);
+  impl.sort(options, numResultsNeeded);
+}
+
+unsigned CodeCompletionOrganizer::getNumCandidates() const {
+  return impl.getNumCandidates();
+}
+
+unsigned CodeCompletionOrganizer::getNumMatches() const {
+  return impl.getNumMatches();
 }
 
 CodeCompletionViewRef CodeCompletionOrganizer::takeResultsView() {
@@ -382,6 +397,36 @@ static std::unique_ptr<Result> make_result(Completion *result) {
   return r;
 }
 
+namespace {
+struct MatchResult {
+  double score = 0.0;
+  bool match = false;
+  bool isExactMatch = false;
+};
+} // end anonymous namespace
+
+/// Calls \p body on consecutive chunks of [0, count), splitting the chunks
+/// across threads when there are enough of them to be worth it.  Returns once
+/// every chunk is done.
+static void matchInParallel(size_t count,
+                            llvm::function_ref<void(size_t, size_t)> body) {
+  const size_t chunkSize = 1024;
+  if (count <= 4 * chunkSize) {
+    body(0, count);
+    return;
+  }
+
+  WorkQueue queue(WorkQueue::Dequeuing::Concurrent,
+                  "sourcekit.swift.CodeCompletionMatching");
+  for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+    size_t end = std::min(count, begin + chunkSize);
+    queue.dispatch([body, begin, end] { body(begin, end); });
+  }
+  body(0, chunkSize);
+
+  // Wait for the other chunks.
+  queue.dispatchBarrierSync([] {});
+}
 
 //===----------------------------------------------------------------------===//
 // CodeCompletionOrganizer::Impl implementation
@@ -541,12 +586,19 @@ void CodeCompletionOrganizer::Impl::addCompletionsWithFilter(
 
       // Build wrapper and add to results.
       contents.push_back(make_result(completion));
+      ++numMatches;
     }
+    numCandidates += completions.size();
     return;
   }
 
   FuzzyStringMatcher pattern(filterText);
   pattern.normalize = true;
+  bool useFuzzyMatching =
+      options.fuzzyMatching && filterText.size() >= options.minFuzzyLength;
+
+  std::vector<Completion *> candidates;
+  candidates.reserve(completions.size());
   for (Completion *completion : completions) {
     if (rules.hideCompletion(completion))
       continue;
@@ -561,14 +613,37 @@ void CodeCompletionOrganizer::Impl::addCompletionsWithFilter(
         completion->getLiteralKind() != CodeCompletionLiteralKind::NilLiteral)
       continue;
 
-    bool match = false;
-    if (options.fuzzyMatching && filterText.size() >= options.minFuzzyLength) {
-      match = pattern.matchesCandidate(completion->getName());
-    } else {
-      match = completion->getName().startswith_lower(filterText);
+    candidates.push_back(completion);
+  }
+
+  // Matching and scoring only look at the candidate's name, so they can be
+  // done out of order.
+  std::vector<MatchResult> matches(candidates.size());
+  matchInParallel(candidates.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i != end; ++i) {
+      StringRef name = candidates[i]->getName();
+      MatchResult &result = matches[i];
+      if (useFuzzyMatching) {
+        result.match =
+            pattern.mayMatchCandidateMask(candidates[i]->getNameClassMask()) &&
+            pattern.matchesCandidate(name);
+      } else {
+        result.match = name.startswith_lower(filterText);
+      }
+      if (!result.match)
+        continue;
+
+      result.isExactMatch = name.equals_lower(filterText);
+      if (options.fuzzyMatching)
+        result.score = pattern.scoreCandidate(name);
     }
+  });
 
-    bool isExactMatch = match && completion->getName().equals_lower(filterText);
+  numCandidates += completions.size();
+  for (size_t i = 0, e = candidates.size(); i != e; ++i) {
+    Completion *completion = candidates[i];
+    bool match = matches[i].match;
+    bool isExactMatch = matches[i].isExactMatch;
 
     if (isExactMatch) {
       if (!exactMatch)
@@ -581,12 +656,11 @@ void CodeCompletionOrganizer::Impl::addCompletionsWithFilter(
     // Build wrapper and add to results.
     if (match) {
       auto wrapper = make_result(completion);
-      if (options.fuzzyMatching) {
-        wrapper->matchScore = pattern.scoreCandidate(completion->getName());
-      }
+      wrapper->matchScore = matches[i].score;
       wrapper->isExactMatch = isExactMatch;
 
       contents.push_back(std::move(wrapper));
+      ++numMatches;
     }
   }
 }
@@ -836,14 +910,30 @@ static void sortTopN(const Options &options, Group *group,
   }
 }
 
+/// Sorts the first \p numSorted items of \p contents, leaving the rest in an
+/// unspecified order.
+template <typename Compare>
+static void sortPrefix(std::vector<std::unique_ptr<Item>> &contents,
+                       size_t numSorted, Compare comp) {
+  if (numSorted == contents.size())
+    std::sort(contents.begin(), contents.end(), comp);
+  else
+    std::partial_sort(contents.begin(), contents.begin() + numSorted,
+                      contents.end(), comp);
+}
+
+/// Sorts \p group and its subgroups.  If \p numResultsNeeded is non-zero,
+/// only that many items at the start of \p group itself are guaranteed to be
+/// in order; subgroups are always fully sorted.
 static void sortRecursive(const Options &options, Group *group,
-                          bool hasExpectedTypes) {
+                          bool hasExpectedTypes, unsigned numResultsNeeded) {
   // Sort all of the subgroups first, and fill in the bucket for each result.
   auto &contents = group->contents;
   double best = -1.0;
+  size_t numLiterals = 0;
   for (auto &item : contents) {
     if (Group *g = dyn_cast<Group>(item.get())) {
-      sortRecursive(options, g, hasExpectedTypes);
+      sortRecursive(options, g, hasExpectedTypes, /*numResultsNeeded=*/0);
     } else {
       Result *r = cast<Result>(item.get());
       item->finalScore = combinedScore(options, item->matchScore, r->value);
@@ -851,21 +941,35 @@ static void sortRecursive(const Options &options, Group *group,
 
     if (item->finalScore > best)
       best = item->finalScore;
+
+    if (numResultsNeeded) {
+      auto bucket = getResultBucket(*item, hasExpectedTypes);
+      if (bucket == ResultBucket::Literal ||
+          bucket == ResultBucket::LiteralTypeMatch)
+        ++numLiterals;
+    }
   }
 
   group->finalScore = best;
 
-  // Now sort the group itself.
+  // Now sort the group itself.  sortTopN() may move results from just after
+  // the literals to the front, so those need to be in order too.  When sorting
+  // by name the literals aren't contiguous, so sort everything.
+  size_t numSorted = contents.size();
+  if (numResultsNeeded &&
+      !(options.sortByName && options.showTopNonLiteralResults != 0))
+    numSorted = std::min(numSorted, std::max<size_t>(numResultsNeeded,
+        numLiterals + options.showTopNonLiteralResults));
 
   if (options.sortByName) {
-    llvm::array_pod_sort(contents.begin(), contents.end(),
-        [](const std::unique_ptr<Item> *a, const std::unique_ptr<Item> *b) {
-      return compareResultName(**a, **b);
+    sortPrefix(contents, numSorted,
+        [](const std::unique_ptr<Item> &a, const std::unique_ptr<Item> &b) {
+      return compareResultName(*a, *b) < 0;
     });
     return;
   }
 
-  std::sort(contents.begin(), contents.end(), [=](const std::unique_ptr<Item> &a_, const std::unique_ptr<Item> &b_) {
+  sortPrefix(contents, numSorted, [=](const std::unique_ptr<Item> &a_, const std::unique_ptr<Item> &b_) {
     Item &a = *a_;
     Item &b = *b_;
 
@@ -897,8 +1001,10 @@ static void sortRecursive(const Options &options, Group *group,
   });
 }
 
-void CodeCompletionOrganizer::Impl::sort(Options options) {
-  sortRecursive(options, rootGroup.get(), completionHasExpectedTypes);
+void CodeCompletionOrganizer::Impl::sort(Options options,
+                                         unsigned numResultsNeeded) {
+  sortRecursive(options, rootGroup.get(), completionHasExpectedTypes,
+                numResultsNeeded);
   if (options.showTopNonLiteralResults != 0)
     sortTopN(options, rootGroup.get(), completionHasExpectedTypes);
 }
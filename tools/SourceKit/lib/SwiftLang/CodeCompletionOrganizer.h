@@ -91,7 +91,16 @@ public:
                                 StringRef filterText, const FilterRules &rules,
                                 Completion *&exactMatch);
 
-  void groupAndSort(const Options &options);
+  /// Groups and sorts the results added so far.
+  ///
+  /// If \p numResultsNeeded is non-zero, only that many top-level results are
+  /// guaranteed to be in order; the ones after them are left unsorted.
+  void groupAndSort(const Options &options, unsigned numResultsNeeded = 0);
+
+  /// The number of completions considered by addCompletionsWithFilter().
+  unsigned getNumCandidates() const;
+  /// The number of completions that passed the filter.
+  unsigned getNumMatches() const;
 
   /// Finishes the results and returns them.
   /// For convenience, this returns a shared_ptr, but it is uniquely referenced.
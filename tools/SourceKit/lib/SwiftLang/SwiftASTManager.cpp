@@ -161,6 +161,12 @@ namespace SourceKit {
     CompilerInstance CompInst;
     OwnedResolver TypeResolver{ nullptr, nullptr };
     WorkQueue Queue{ WorkQueue::Dequeuing::Serial, "sourcekit.swift.ConsumeAST" };
+    /// The '{' and '}' offsets of the function bodies in the primary file,
+    /// sorted by offset. Used to tell whether a later edit stays inside one.
+    std::vector<std::pair<unsigned, unsigned>> FunctionBodyRanges;
+    /// The bodies that were skipped when building a partial AST.
+    std::vector<std::pair<unsigned, unsigned>> SkippedBodyRanges;
+    bool IsPartial = false;
 
     Implementation(uint64_t Generation) : Generation(Generation) {}
 
@@ -209,6 +215,15 @@ namespace SourceKit {
   EditorDiagConsumer &ASTUnit::getEditorDiagConsumer() const {
     return Impl.CollectDiagConsumer;
   }
+
+  bool ASTUnit::isPartial() const {
+    return Impl.IsPartial;
+  }
+
+  ArrayRef<std::pair<unsigned, unsigned>>
+  ASTUnit::getSkippedBodyRanges() const {
+    return Impl.SkippedBodyRanges;
+  }
 }
 
 namespace {
@@ -235,6 +250,10 @@ class ASTProducer : public ThreadSafeRefCountedBase<ASTProducer> {
   SmallVector<std::pair<std::string, BufferStamp>, 8> DependencyStamps;
   std::vector<std::pair<SwiftASTConsumerRef, const void*>> QueuedConsumers;
   llvm::sys::Mutex Mtx;
+  /// Builds of this AST run one at a time; builds of different ASTs can run
+  /// concurrently.
+  WorkQueue BuildQueue{ WorkQueue::Dequeuing::Serial,
+                        "sourcekit.swift.ASTBuilding" };
 
 public:
   explicit ASTProducer(SwiftInvocationRef InvokRef)
@@ -253,7 +272,12 @@ public:
                      ArrayRef<ImmutableTextSnapshotRef> Snapshots);
 
   void enqueueConsumer(SwiftASTConsumerRef Consumer, const void *OncePerASTToken);
-  std::vector<SwiftASTConsumerRef> popQueuedConsumers();
+
+  /// Hands \p Unit, or \p Error if there is no AST, to the queued consumers.
+  /// If \p Unit is partial, the consumers that can't use it stay queued.
+  ///
+  /// \returns true if any consumers are still queued.
+  bool consumeQueued(ASTUnitRef Unit, StringRef Error);
 
   size_t getMemoryCost() const {
     // FIXME: Report the memory cost of the overall CompilerInstance.
@@ -265,11 +289,14 @@ public:
 private:
   ASTUnitRef getASTUnitImpl(SwiftASTManager::Implementation &MgrImpl,
                             ArrayRef<ImmutableTextSnapshotRef> Snapshots,
-                            std::string &Error);
+                            bool AllowPartial, std::string &Error);
+
+  /// Whether every queued consumer can handle a partial AST.
+  bool queuedConsumersAcceptPartialAST();
 
   ASTUnitRef createASTUnit(SwiftASTManager::Implementation &MgrImpl,
                            ArrayRef<ImmutableTextSnapshotRef> Snapshots,
-                           std::string &Error);
+                           bool AllowIncremental, std::string &Error);
 };
 
 typedef IntrusiveRefCntPtr<ASTProducer> ASTProducerRef;
@@ -310,9 +337,6 @@ struct SwiftASTManager::Implementation {
   Cache<ASTKey, ASTProducerRef> ASTCache{ "sourcekit.swift.ASTCache" };
   llvm::sys::Mutex CacheMtx;
 
-  WorkQueue ASTBuildQueue{ WorkQueue::Dequeuing::Serial,
-                           "sourcekit.swift.ASTBuilding" };
-
   ASTProducerRef getASTProducer(SwiftInvocationRef InvokRef);
   FileContent getFileContent(StringRef FilePath, std::string &Error);
   BufferStamp getBufferStamp(StringRef FilePath);
@@ -465,6 +489,23 @@ SwiftASTManager::getInvocation(ArrayRef<const char *> OrigArgs,
       *new SwiftInvocation::Implementation(std::move(Opts)));
 }
 
+/// Builds the AST of \p Producer and hands it to its queued consumers. If the
+/// AST turned out partial and some consumers need a full one, which can
+/// happen when they were queued during the build, builds again for them.
+static void
+buildASTForQueuedConsumers(ASTProducerRef Producer,
+                           SwiftASTManager::Implementation &MgrImpl,
+                           ArrayRef<ImmutableTextSnapshotRef> Snaps) {
+  SmallVector<ImmutableTextSnapshotRef, 4> Snapshots;
+  Snapshots.append(Snaps.begin(), Snaps.end());
+
+  Producer->getASTUnitAsync(MgrImpl, Snapshots,
+    [Producer, &MgrImpl, Snapshots](ASTUnitRef Unit, StringRef Error) {
+      if (Producer->consumeQueued(Unit, Error))
+        buildASTForQueuedConsumers(Producer, MgrImpl, Snapshots);
+    });
+}
+
 void SwiftASTManager::processASTAsync(SwiftInvocationRef InvokRef,
                                       SwiftASTConsumerRef ASTConsumer,
                                       const void *OncePerASTToken,
@@ -472,25 +513,15 @@ void SwiftASTManager::processASTAsync(SwiftInvocationRef InvokRef,
   ASTProducerRef Producer = Impl.getASTProducer(InvokRef);
 
   if (ASTUnitRef Unit = Producer->getExistingAST()) {
-    if (ASTConsumer->canUseASTWithSnapshots(Unit->getSnapshots())) {
+    if ((!Unit->isPartial() || ASTConsumer->canUsePartialAST()) &&
+        ASTConsumer->canUseASTWithSnapshots(Unit->getSnapshots())) {
       Unit->Impl.consumeAsync(std::move(ASTConsumer), Unit);
       return;
     }
   }
 
   Producer->enqueueConsumer(std::move(ASTConsumer), OncePerASTToken);
-
-  Producer->getASTUnitAsync(Impl, Snapshots,
-    [Producer](ASTUnitRef Unit, StringRef Error) {
-      auto Consumers = Producer->popQueuedConsumers();
-
-      for (auto &Consumer : Consumers) {
-        if (Unit)
-          Unit->Impl.consumeAsync(std::move(Consumer), Unit);
-        else
-          Consumer->failed(Error);
-      }
-    });
+  buildASTForQueuedConsumers(Producer, Impl, Snapshots);
 }
 
 void SwiftASTManager::removeCachedAST(SwiftInvocationRef Invok) {
@@ -564,17 +595,20 @@ void ASTProducer::getASTUnitAsync(SwiftASTManager::Implementation &MgrImpl,
   SmallVector<ImmutableTextSnapshotRef, 4> Snapshots;
   Snapshots.append(Snaps.begin(), Snaps.end());
 
-  MgrImpl.ASTBuildQueue.dispatch([ThisProducer, &MgrImpl, Snapshots, Receiver] {
+  BuildQueue.dispatch([ThisProducer, &MgrImpl, Snapshots, Receiver] {
     std::string Error;
-    ASTUnitRef Unit = ThisProducer->getASTUnitImpl(MgrImpl, Snapshots, Error);
+    bool AllowPartial = ThisProducer->queuedConsumersAcceptPartialAST();
+    ASTUnitRef Unit = ThisProducer->getASTUnitImpl(MgrImpl, Snapshots,
+                                                   AllowPartial, Error);
     Receiver(Unit, Error);
   }, /*isStackDeep=*/true);
 }
 
 ASTUnitRef ASTProducer::getASTUnitImpl(SwiftASTManager::Implementation &MgrImpl,
                                    ArrayRef<ImmutableTextSnapshotRef> Snapshots,
-                                   std::string &Error) {
-  if (!AST || shouldRebuild(MgrImpl, Snapshots)) {
+                                   bool AllowPartial, std::string &Error) {
+  if (!AST || shouldRebuild(MgrImpl, Snapshots) ||
+      (AST->isPartial() && !AllowPartial)) {
     bool IsRebuild = AST != nullptr;
     const InvocationOptions &Opts = InvokRef->Impl.Opts;
 
@@ -588,7 +622,8 @@ ASTUnitRef ASTProducer::getASTUnitImpl(SwiftASTManager::Implementation &MgrImpl,
       Log->getOS() << Opts.Invok.getModuleName() << '/' << Opts.PrimaryFile;
     }
 
-    auto NewAST = createASTUnit(MgrImpl, Snapshots, Error);
+    auto NewAST = createASTUnit(MgrImpl, Snapshots,
+                                /*AllowIncremental=*/AllowPartial, Error);
     {
       // FIXME: ThreadSafeRefCntPtr is racy.
       llvm::sys::ScopedLock L(Mtx);
@@ -622,14 +657,38 @@ void ASTProducer::enqueueConsumer(SwiftASTConsumerRef Consumer,
   QueuedConsumers.push_back({ std::move(Consumer), OncePerASTToken });
 }
 
-std::vector<SwiftASTConsumerRef> ASTProducer::popQueuedConsumers() {
+bool ASTProducer::queuedConsumersAcceptPartialAST() {
   llvm::sys::ScopedLock L(Mtx);
+  for (auto &C : QueuedConsumers) {
+    if (!C.first->canUsePartialAST())
+      return false;
+  }
+  return true;
+}
+
+bool ASTProducer::consumeQueued(ASTUnitRef Unit, StringRef Error) {
   std::vector<SwiftASTConsumerRef> Consumers;
-  Consumers.reserve(QueuedConsumers.size());
-  for (auto &C : QueuedConsumers)
-    Consumers.push_back(std::move(C.first));
-  QueuedConsumers.clear();
-  return Consumers;
+  bool HasRemaining;
+  {
+    llvm::sys::ScopedLock L(Mtx);
+    std::vector<std::pair<SwiftASTConsumerRef, const void*>> Remaining;
+    for (auto &C : QueuedConsumers) {
+      if (Unit && Unit->isPartial() && !C.first->canUsePartialAST())
+        Remaining.push_back(std::move(C));
+      else
+        Consumers.push_back(std::move(C.first));
+    }
+    QueuedConsumers = std::move(Remaining);
+    HasRemaining = !QueuedConsumers.empty();
+  }
+
+  for (auto &Consumer : Consumers) {
+    if (Unit)
+      Unit->Impl.consumeAsync(std::move(Consumer), Unit);
+    else
+      Consumer->failed(Error);
+  }
+  return HasRemaining;
 }
 
 bool ASTProducer::shouldRebuild(SwiftASTManager::Implementation &MgrImpl,
@@ -712,11 +771,189 @@ static void collectModuleDependencies(Module *TopMod,
   }
 }
 
+static void collectFunctionBodies(Decl *D,
+                            SmallVectorImpl<AbstractFunctionDecl *> &Bodies) {
+  if (auto AFD = dyn_cast<AbstractFunctionDecl>(D)) {
+    // Accessor bodies are found through their storage declaration; leave
+    // them to a full rebuild.
+    auto FD = dyn_cast<FuncDecl>(AFD);
+    if (!AFD->isImplicit() && !(FD && FD->isAccessor()) &&
+        AFD->getBodySourceRange().isValid())
+      Bodies.push_back(AFD);
+    return;
+  }
+
+  if (auto NTD = dyn_cast<NominalTypeDecl>(D)) {
+    for (auto Member : NTD->getMembers())
+      collectFunctionBodies(Member, Bodies);
+  } else if (auto ED = dyn_cast<ExtensionDecl>(D)) {
+    for (auto Member : ED->getMembers())
+      collectFunctionBodies(Member, Bodies);
+  }
+}
+
+/// Collects the functions of \p SF whose bodies an edit can be confined to,
+/// in source order. Local functions and closures are part of the body that
+/// contains them.
+static void collectFunctionBodies(SourceFile &SF,
+                            SmallVectorImpl<AbstractFunctionDecl *> &Bodies) {
+  for (auto D : SF.Decls)
+    collectFunctionBodies(D, Bodies);
+}
+
+static std::pair<unsigned, unsigned>
+getBodyOffsets(AbstractFunctionDecl *AFD, SourceManager &SM,
+               unsigned BufferID) {
+  SourceRange Range = AFD->getBodySourceRange();
+  return { SM.getLocOffsetInBuffer(Range.Start, BufferID),
+           SM.getLocOffsetInBuffer(Range.End, BufferID) };
+}
+
+namespace {
+/// An edit of the primary file that only touched the inside of one function
+/// body. The offsets are those of the body's braces in the edited text.
+struct FunctionBodyEdit {
+  unsigned LBraceOffset;
+  unsigned RBraceOffset;
+};
+
+/// Skips the function bodies of the primary file, except for the edited one,
+/// which is delayed. The bodies of the other files are delayed too, which
+/// means they are parsed as usual.
+class EditedBodyDelayedCallbacks : public DelayedParsingCallbacks {
+  StringRef PrimaryBufferName;
+  unsigned EditedBodyOffset;
+
+public:
+  std::vector<std::pair<unsigned, unsigned>> SkippedBodyRanges;
+
+  EditedBodyDelayedCallbacks(StringRef PrimaryBufferName,
+                             unsigned EditedBodyOffset)
+    : PrimaryBufferName(PrimaryBufferName),
+      EditedBodyOffset(EditedBodyOffset) {}
+
+  bool shouldDelayFunctionBodyParsing(Parser &TheParser,
+                                      AbstractFunctionDecl *AFD,
+                                      const DeclAttributes &Attrs,
+                                      SourceRange BodyRange) override {
+    SourceManager &SM = TheParser.SourceMgr;
+    unsigned BufferID = SM.findBufferContainingLoc(BodyRange.Start);
+    if (SM.getIdentifierForBuffer(BufferID) != PrimaryBufferName)
+      return true;
+    unsigned Begin = SM.getLocOffsetInBuffer(BodyRange.Start, BufferID);
+    if (Begin == EditedBodyOffset)
+      return true;
+    SkippedBodyRanges.push_back(
+        { Begin, SM.getLocOffsetInBuffer(BodyRange.End, BufferID) });
+    return false;
+  }
+};
+} // anonymous namespace.
+
+/// Checks whether the only change since \p OldAST was built is an edit
+/// inside a single function body of the primary file.
+static Optional<FunctionBodyEdit>
+findFunctionBodyEdit(SwiftASTManager::Implementation &MgrImpl,
+                     ASTUnitRef OldAST,
+                     ArrayRef<BufferStamp> OldStamps,
+                     ArrayRef<std::pair<std::string, BufferStamp>> OldDeps,
+                     ArrayRef<std::string> InputFiles,
+                     ArrayRef<FileContent> Contents,
+                     StringRef PrimaryFile) {
+  if (!OldAST || OldStamps.size() != Contents.size())
+    return None;
+
+  ImmutableTextSnapshotRef NewSnap;
+  for (unsigned i = 0, e = Contents.size(); i != e; ++i) {
+    if (InputFiles[i] == PrimaryFile)
+      NewSnap = Contents[i].Snapshot;
+    else if (Contents[i].Stamp != OldStamps[i])
+      return None;
+  }
+  for (auto &Dependency : OldDeps) {
+    if (Dependency.second != MgrImpl.getBufferStamp(Dependency.first))
+      return None;
+  }
+
+  ImmutableTextSnapshotRef OldSnap;
+  for (auto &Snap : OldAST->getSnapshots()) {
+    if (Snap->getFilename() == PrimaryFile)
+      OldSnap = Snap;
+  }
+  if (!OldSnap || !NewSnap || !OldSnap->isFromSameBuffer(NewSnap) ||
+      OldSnap->getStamp() == NewSnap->getStamp() ||
+      !OldSnap->precedesOrSame(NewSnap))
+    return None;
+
+  // Follow the body through the edits, which must all stay strictly between
+  // its braces.
+  ArrayRef<std::pair<unsigned, unsigned>> Bodies =
+      OldAST->Impl.FunctionBodyRanges;
+  Optional<FunctionBodyEdit> Edit;
+  bool Contained = true;
+  OldSnap->foreachReplaceUntil(NewSnap,
+    [&](ReplaceImmutableTextUpdateRef Upd) -> bool {
+      unsigned Begin = Upd->getByteOffset();
+      unsigned End = Begin + Upd->getLength();
+      if (!Edit) {
+        auto I = std::upper_bound(Bodies.begin(), Bodies.end(),
+                                  std::make_pair(Begin, ~0U));
+        if (I == Bodies.begin()) {
+          Contained = false;
+          return false;
+        }
+        --I;
+        Edit = FunctionBodyEdit{ I->first, I->second };
+      }
+      if (Begin <= Edit->LBraceOffset || End > Edit->RBraceOffset) {
+        Contained = false;
+        return false;
+      }
+      Edit->RBraceOffset += Upd->getText().size();
+      Edit->RBraceOffset -= Upd->getLength();
+      return true;
+    });
+
+  if (!Contained)
+    return None;
+  return Edit;
+}
+
+/// Type-checks the body that \p Edit applies to, after the rest of the
+/// primary file was type-checked without it.
+///
+/// \returns false if the edit changed the extent of the body, which means it
+/// may have changed the declarations around it.
+static bool typeCheckEditedBody(CompilerInstance &CompIns,
+                                const FunctionBodyEdit &Edit) {
+  SourceFile &SF = *CompIns.getPrimarySourceFile();
+  SourceManager &SM = CompIns.getSourceMgr();
+  unsigned BufferID = SF.getBufferID().getValue();
+
+  SmallVector<AbstractFunctionDecl *, 32> Bodies;
+  collectFunctionBodies(SF, Bodies);
+  for (auto AFD : Bodies) {
+    if (AFD->getBodyKind() != AbstractFunctionDecl::BodyKind::Parsed)
+      continue;
+    auto Offsets = getBodyOffsets(AFD, SM, BufferID);
+    if (Offsets.first != Edit.LBraceOffset)
+      continue;
+    if (Offsets.second != Edit.RBraceOffset)
+      return false;
+    typeCheckAbstractFunctionBody(AFD);
+    return true;
+  }
+  return false;
+}
+
 static std::atomic<uint64_t> ASTUnitGeneration{ 0 };
 
 ASTUnitRef ASTProducer::createASTUnit(SwiftASTManager::Implementation &MgrImpl,
                                       ArrayRef<ImmutableTextSnapshotRef> Snapshots,
+                                      bool AllowIncremental,
                                       std::string &Error) {
+  auto OldStamps = std::move(Stamps);
+  auto OldDependencyStamps = std::move(DependencyStamps);
   Stamps.clear();
   DependencyStamps.clear();
 
@@ -748,6 +985,12 @@ ASTUnitRef ASTProducer::createASTUnit(SwiftASTManager::Implementation &MgrImpl,
   for (auto &Content : Contents)
     Stamps.push_back(Content.Stamp);
 
+  Optional<FunctionBodyEdit> Edit;
+  if (AllowIncremental)
+    Edit = findFunctionBodyEdit(MgrImpl, AST, OldStamps, OldDependencyStamps,
+                                Opts.Invok.getInputFilenames(), Contents,
+                                Opts.PrimaryFile);
+
   trace::SwiftInvocation TraceInfo;
 
   if (trace::enabled()) {
@@ -778,6 +1021,18 @@ ASTUnitRef ASTProducer::createASTUnit(SwiftASTManager::Implementation &MgrImpl,
   for (auto &Content : Contents)
     Invocation.addInputBuffer(Content.Buffer.get());
 
+  std::unique_ptr<EditedBodyDelayedCallbacks> DelayedCB;
+  if (Edit) {
+    StringRef PrimaryBufferName;
+    for (unsigned i = 0, e = Contents.size(); i != e; ++i) {
+      if (Opts.Invok.getInputFilenames()[i] == Opts.PrimaryFile)
+        PrimaryBufferName = Contents[i].Buffer->getBufferIdentifier();
+    }
+    DelayedCB.reset(new EditedBodyDelayedCallbacks(PrimaryBufferName,
+                                                   Edit->LBraceOffset));
+    Invocation.setDelayedParsingCallbacks(DelayedCB.get());
+  }
+
   if (CompIns.setup(Invocation)) {
     // FIXME: Report the diagnostic.
     LOG_WARN_FUNC("Compilation setup failed!!!");
@@ -795,6 +1050,37 @@ ASTUnitRef ASTProducer::createASTUnit(SwiftASTManager::Implementation &MgrImpl,
   Consumer.setInputBufferIDs(ASTRef->getCompilerInstance().getInputBufferIDs());
   CompIns.performSema();
 
+  // The instance keeps a copy of the invocation, which must not point at
+  // DelayedCB once it is gone.
+  CompIns.getInvocation().setDelayedParsingCallbacks(nullptr);
+
+  if (Edit) {
+    if (!CompIns.getPrimarySourceFile() ||
+        !typeCheckEditedBody(CompIns, *Edit)) {
+      LOG_INFO_FUNC(High, "edit is not confined to a function body: "
+                    << Opts.PrimaryFile);
+      TracedOp.finish();
+      return createASTUnit(MgrImpl, Snapshots, /*AllowIncremental=*/false,
+                           Error);
+    }
+    ASTRef->Impl.IsPartial = true;
+    ASTRef->Impl.SkippedBodyRanges = std::move(DelayedCB->SkippedBodyRanges);
+    std::sort(ASTRef->Impl.SkippedBodyRanges.begin(),
+              ASTRef->Impl.SkippedBodyRanges.end());
+  }
+
+  if (auto SF = CompIns.getPrimarySourceFile()) {
+    SmallVector<AbstractFunctionDecl *, 32> Bodies;
+    collectFunctionBodies(*SF, Bodies);
+    for (auto AFD : Bodies) {
+      ASTRef->Impl.FunctionBodyRanges.push_back(
+          getBodyOffsets(AFD, CompIns.getSourceMgr(),
+                         SF->getBufferID().getValue()));
+    }
+    std::sort(ASTRef->Impl.FunctionBodyRanges.begin(),
+              ASTRef->Impl.FunctionBodyRanges.end());
+  }
+
   llvm::SmallPtrSet<Module *, 16> Visited;
   SmallVector<std::string, 8> Filenames;
   collectModuleDependencies(CompIns.getMainModule(), Visited, Filenames);
@@ -807,7 +1093,9 @@ ASTUnitRef ASTProducer::createASTUnit(SwiftASTManager::Implementation &MgrImpl,
 
   // Since we only typecheck the primary file (plus referenced constructs
   // from other files), any error is likely to break SIL generation.
-  if (!Consumer.hadAnyError()) {
+  // A partial AST is missing most function bodies, so skip the SIL
+  // diagnostics too; the next full build brings them back.
+  if (!ASTRef->Impl.IsPartial && !Consumer.hadAnyError()) {
     // FIXME: Any error anywhere in the SourceFile will switch off SIL
     // diagnostics. This means that this can happen:
     //   - The user sees a SIL diagnostic in one function
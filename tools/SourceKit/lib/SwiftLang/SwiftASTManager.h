@@ -55,6 +55,15 @@ public:
   ArrayRef<ImmutableTextSnapshotRef> getSnapshots() const;
   EditorDiagConsumer &getEditorDiagConsumer() const;
   swift::SourceFile &getPrimarySourceFile() const;
+
+  /// Whether the AST was built incrementally after an edit inside a function
+  /// body, so that other function bodies of the primary file were skipped.
+  bool isPartial() const;
+
+  /// The byte ranges of the function bodies in the primary file that were
+  /// neither parsed nor type-checked, sorted by offset. Each range goes from
+  /// the '{' to the '}' of the body.
+  ArrayRef<std::pair<unsigned, unsigned>> getSkippedBodyRanges() const;
 };
 
 typedef IntrusiveRefCntPtr<ASTUnit> ASTUnitRef;
@@ -72,6 +81,12 @@ public:
       ArrayRef<ImmutableTextSnapshotRef> Snapshots) {
     return false;
   }
+  /// Whether the consumer can handle an AST for which \c isPartial() is true.
+  /// An AST is only built incrementally if all consumers waiting for it
+  /// accept that.
+  virtual bool canUsePartialAST() {
+    return false;
+  }
   virtual void failed(StringRef Error);
   virtual void handlePrimaryAST(ASTUnitRef AstUnit) = 0;
 };
@@ -20,7 +20,9 @@
 #include "swift/Frontend/PrintingDiagnosticConsumer.h"
 #include "swift/IDE/CodeCompletionCache.h"
 
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Timer.h"
 
 using namespace SourceKit;
 using namespace swift;
@@ -908,6 +910,10 @@ static void transformAndForwardResults(
     CodeCompletion::Options options, unsigned offset, StringRef filterText,
     unsigned resultOffset, unsigned maxResults) {
 
+  llvm::TimeRecord startTime = llvm::TimeRecord::getCurrentTime();
+  // Only the results up to the end of the requested page need to be sorted.
+  unsigned numResultsNeeded = maxResults ? resultOffset + maxResults : 0;
+
   CodeCompletion::CompletionSink innerSink;
   Completion *exactMatch = nullptr;
   auto buildInnerResult = [&](ArrayRef<CodeCompletionString::Chunk> chunks) {
@@ -977,7 +983,7 @@ static void transformAndForwardResults(
                                        session->getFilterRules(), exactMatch);
   }
 
-  organizer.groupAndSort(options);
+  organizer.groupAndSort(options, numResultsNeeded);
 
   if ((options.addInnerResults || options.addInnerOperators) &&
       exactMatch && exactMatch->getKind() == Completion::Declaration) {
@@ -1035,7 +1041,7 @@ static void transformAndForwardResults(
     CodeCompletion::Options noGroupOpts = options;
     noGroupOpts.groupStems = false;
     noGroupOpts.groupOverloads = false;
-    organizer.groupAndSort(noGroupOpts);
+    organizer.groupAndSort(noGroupOpts, numResultsNeeded);
   }
 
   // Build the final results view.
@@ -1047,6 +1053,13 @@ static void transformAndForwardResults(
   SwiftGroupedCodeCompletionConsumer groupedConsumer(consumer);
   limitedResults.walk(groupedConsumer);
   consumer.setNextRequestStart(limitedResults.getNextOffset());
+
+  double elapsed = llvm::TimeRecord::getCurrentTime().getWallTime() -
+                   startTime.getWallTime();
+  LOG_INFO_FUNC(High, "filtered " << organizer.getNumCandidates()
+                << " completions to " << organizer.getNumMatches() << " for '"
+                << filterText << "' in " << llvm::format("%.2f", elapsed * 1000)
+                << "ms");
 }
 
 void SwiftLangSupport::codeCompleteOpen(
@@ -399,6 +399,11 @@ class SwiftDocumentSemanticInfo :
   ImmutableTextSnapshotRef TokSnapshot;
   std::vector<SwiftSemanticToken> SemaToks;
 
+  /// The tokens of the last update, which SemaToks hands out only once. A
+  /// partial AST takes the tokens of the bodies it skipped from here.
+  ImmutableTextSnapshotRef RetainedTokSnapshot;
+  std::vector<SwiftSemanticToken> RetainedToks;
+
   ImmutableTextSnapshotRef DiagSnapshot;
   std::vector<DiagnosticEntryInfo> SemaDiags;
 
@@ -431,6 +436,18 @@ public:
                           std::vector<DiagnosticEntryInfo> Diags,
                           ImmutableTextSnapshotRef Snapshot,
                           uint64_t ASTGeneration);
+
+  /// Like \c updateSemanticInfo(), for an AST that skipped the function
+  /// bodies in \p SkippedBodyRanges; the information for those is carried
+  /// over from the previous update.
+  ///
+  /// \returns false if there is no previous information to carry over.
+  bool updatePartialSemanticInfo(std::vector<SwiftSemanticToken> Toks,
+                                 std::vector<DiagnosticEntryInfo> Diags,
+                                 ImmutableTextSnapshotRef Snapshot,
+                                 uint64_t ASTGeneration,
+                                 ArrayRef<std::pair<unsigned, unsigned>>
+                                     SkippedBodyRanges);
   void removeCachedAST() {
     if (InvokRef)
       ASTMgr.removeCachedAST(InvokRef);
@@ -541,17 +558,12 @@ void SwiftDocumentSemanticInfo::readSemanticInfo(
   Diags = getSemanticDiagnostics(NewSnapshot, ParserDiags);
 }
 
-std::vector<SwiftSemanticToken>
-SwiftDocumentSemanticInfo::takeSemanticTokens(
-    ImmutableTextSnapshotRef NewSnapshot) {
-
-  llvm::sys::ScopedLock L(Mtx);
-
-  if (SemaToks.empty())
-    return {};
-
-  // Adjust the position of the tokens.
-  TokSnapshot->foreachReplaceUntil(NewSnapshot,
+/// Moves \p SemaToks from \p FromSnapshot to \p ToSnapshot, dropping the
+/// tokens that were edited.
+static void adjustSemanticTokens(std::vector<SwiftSemanticToken> &SemaToks,
+                                 ImmutableTextSnapshotRef FromSnapshot,
+                                 ImmutableTextSnapshotRef ToSnapshot) {
+  FromSnapshot->foreachReplaceUntil(ToSnapshot,
     [&](ReplaceImmutableTextUpdateRef Upd) -> bool {
       if (SemaToks.empty())
         return false;
@@ -583,6 +595,19 @@ SwiftDocumentSemanticInfo::takeSemanticTokens(
       SemaToks.erase(ReplaceBegin, ReplaceEnd);
       return true;
     });
+}
+
+std::vector<SwiftSemanticToken>
+SwiftDocumentSemanticInfo::takeSemanticTokens(
+    ImmutableTextSnapshotRef NewSnapshot) {
+
+  llvm::sys::ScopedLock L(Mtx);
+
+  if (SemaToks.empty())
+    return {};
+
+  // Adjust the position of the tokens.
+  adjustSemanticTokens(SemaToks, TokSnapshot, NewSnapshot);
 
   return std::move(SemaToks);
 }
@@ -747,9 +772,10 @@ void SwiftDocumentSemanticInfo::updateSemanticInfo(
   {
     llvm::sys::ScopedLock L(Mtx);
     if(ASTGeneration > this->ASTGeneration) {
+      RetainedToks = Toks;
       SemaToks = std::move(Toks);
       SemaDiags = std::move(Diags);
-      TokSnapshot = DiagSnapshot = std::move(Snapshot);
+      TokSnapshot = DiagSnapshot = RetainedTokSnapshot = std::move(Snapshot);
       this->ASTGeneration = ASTGeneration;
     }
   }
@@ -758,6 +784,86 @@ void SwiftDocumentSemanticInfo::updateSemanticInfo(
   NotificationCtr.postDocumentUpdateNotification(Filename);
 }
 
+static bool
+isInSkippedBody(unsigned Offset,
+                ArrayRef<std::pair<unsigned, unsigned>> SkippedBodyRanges) {
+  auto I = std::upper_bound(SkippedBodyRanges.begin(), SkippedBodyRanges.end(),
+                            std::make_pair(Offset, ~0U));
+  if (I == SkippedBodyRanges.begin())
+    return false;
+  --I;
+  // Diagnostics on the closing brace, such as a missing return, belong to
+  // the body.
+  return I->first < Offset && Offset <= I->second;
+}
+
+bool SwiftDocumentSemanticInfo::updatePartialSemanticInfo(
+    std::vector<SwiftSemanticToken> Toks,
+    std::vector<DiagnosticEntryInfo> Diags,
+    ImmutableTextSnapshotRef Snapshot,
+    uint64_t ASTGeneration,
+    ArrayRef<std::pair<unsigned, unsigned>> SkippedBodyRanges) {
+
+  {
+    llvm::sys::ScopedLock L(Mtx);
+    if (ASTGeneration <= this->ASTGeneration)
+      return true;
+
+    if (!SkippedBodyRanges.empty()) {
+      if (!RetainedTokSnapshot || !DiagSnapshot ||
+          !RetainedTokSnapshot->precedesOrSame(Snapshot) ||
+          !DiagSnapshot->precedesOrSame(Snapshot))
+        return false;
+
+      adjustSemanticTokens(RetainedToks, RetainedTokSnapshot, Snapshot);
+      for (auto &Tok : RetainedToks) {
+        if (isInSkippedBody(Tok.ByteOffset, SkippedBodyRanges))
+          Toks.push_back(Tok);
+      }
+      std::sort(Toks.begin(), Toks.end(),
+                [](const SwiftSemanticToken &LHS,
+                   const SwiftSemanticToken &RHS) {
+                  return LHS.ByteOffset < RHS.ByteOffset;
+                });
+
+      DiagSnapshot->foreachReplaceUntil(Snapshot,
+        [&](ReplaceImmutableTextUpdateRef Upd) -> bool {
+          unsigned RemoveLen = Upd->getLength();
+          int Delta = Upd->getText().size() - RemoveLen;
+          SemaDiags = adjustDiagnostics(std::move(SemaDiags), Filename,
+                                        Upd->getByteOffset(), RemoveLen, Delta);
+          return true;
+        });
+      for (auto &Diag : SemaDiags) {
+        if (isInSkippedBody(Diag.Offset, SkippedBodyRanges))
+          Diags.push_back(std::move(Diag));
+      }
+      std::stable_sort(Diags.begin(), Diags.end(),
+                       [](const DiagnosticEntryInfo &LHS,
+                          const DiagnosticEntryInfo &RHS) {
+                         return LHS.Offset < RHS.Offset;
+                       });
+      if (!Diags.empty()) {
+        auto ImmBuf = Snapshot->getBuffer();
+        for (auto &Diag : Diags) {
+          std::tie(Diag.Line, Diag.Column) =
+              ImmBuf->getLineAndColumn(Diag.Offset);
+        }
+      }
+    }
+
+    RetainedToks = Toks;
+    SemaToks = std::move(Toks);
+    SemaDiags = std::move(Diags);
+    TokSnapshot = DiagSnapshot = RetainedTokSnapshot = std::move(Snapshot);
+    this->ASTGeneration = ASTGeneration;
+  }
+
+  LOG_INFO_FUNC(High, "posted document update notification for: " << Filename);
+  NotificationCtr.postDocumentUpdateNotification(Filename);
+  return true;
+}
+
 namespace {
 
 class SemanticAnnotator : public SourceEntityWalker {
@@ -820,6 +926,10 @@ public:
     LOG_WARN_FUNC("sema annotations failed: " << Error);
   }
 
+  bool canUsePartialAST() override {
+    return true;
+  }
+
   void handlePrimaryAST(ASTUnitRef AstUnit) override {
     auto Generation = AstUnit->getGeneration();
     auto &CompIns = AstUnit->getCompilerInstance();
@@ -876,11 +986,24 @@ public:
 
     TracedOp.finish();
 
-    SemaInfoRef->
-      updateSemanticInfo(std::move(SemaToks),
-                     std::move(Consumer.getDiagnosticsForBuffer(BufferID)),
-                         DocSnapshot,
-                         Generation);
+    if (AstUnit->isPartial()) {
+      if (!SemaInfoRef->updatePartialSemanticInfo(std::move(SemaToks),
+                          Consumer.getDiagnosticsForBuffer(BufferID),
+                          DocSnapshot, Generation,
+                          AstUnit->getSkippedBodyRanges())) {
+        // There is nothing to fill in the skipped bodies with; ask for the
+        // whole file to be type-checked.
+        SemaInfoRef->removeCachedAST();
+        SemaInfoRef->processLatestSnapshotAsync(EditableBuffer);
+        return;
+      }
+    } else {
+      SemaInfoRef->
+        updateSemanticInfo(std::move(SemaToks),
+                       std::move(Consumer.getDiagnosticsForBuffer(BufferID)),
+                           DocSnapshot,
+                           Generation);
+    }
 
     if (DocSnapshot->getStamp() != EditableBuffer->getSnapshot()->getStamp()) {
       // Handle edits that occurred after we processed the AST.
@@ -19,6 +19,8 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
 #include <fstream>
 #include <regex>
 #include <unistd.h>
@@ -55,6 +57,8 @@ struct TestOptions {
   StringRef filterRulesJSON;
   bool rawOutput = false;
   bool structureOutput = false;
+  bool timeRequests = false;
+  unsigned repeatCount = 1;
   ArrayRef<const char *> compilerArgs;
 };
 }
@@ -201,6 +205,15 @@ static bool parseOptions(ArrayRef<const char *> args, TestOptions &options,
       options.rawOutput = true;
     } else if (opt == "structure") {
       options.structureOutput = true;
+    } else if (opt == "time") {
+      options.timeRequests = true;
+    } else if (opt == "repeat") {
+      unsigned uval;
+      if (value.getAsInteger(10, uval) || uval == 0) {
+        error = "unrecognized integer value for -repeat=";
+        return false;
+      }
+      options.repeatCount = uval;
     } else if (opt == "hide-underscores") {
       unsigned uval;
       if (value.getAsInteger(10, uval)) {
@@ -675,6 +688,40 @@ static bool codeCompleteRequest(sourcekitd_uid_t requestUID, const char *name,
   return result;
 }
 
+static unsigned getNumResults(sourcekitd_response_t resp) {
+  auto results = sourcekitd_variant_dictionary_get_value(
+      sourcekitd_response_get_value(resp), KeyResults);
+  return sourcekitd_variant_array_get_count(results);
+}
+
+namespace {
+/// Collects the wall time of a (possibly repeated) request for -time.
+class RequestTimer {
+  llvm::TimeRecord start;
+  double total = 0.0;
+  double best = 0.0;
+  unsigned count = 0;
+
+public:
+  void startRequest() { start = llvm::TimeRecord::getCurrentTime(); }
+  void endRequest() {
+    double elapsed = llvm::TimeRecord::getCurrentTime().getWallTime() -
+                     start.getWallTime();
+    if (count == 0 || elapsed < best)
+      best = elapsed;
+    total += elapsed;
+    ++count;
+  }
+  void print(StringRef label, unsigned numResults) const {
+    llvm::outs() << label << ": " << numResults << " results, min "
+                 << llvm::format("%.3f", best * 1000) << "ms, avg "
+                 << llvm::format("%.3f", total / count * 1000) << "ms over "
+                 << count << " requests\n";
+    llvm::outs().flush();
+  }
+};
+} // end anonymous namespace
+
 static bool readPopularAPIList(StringRef filename,
                                std::vector<std::string> &result) {
   std::ifstream in(filename);
@@ -763,15 +810,25 @@ static int handleTestInvocation(TestOptions &options) {
     return 1;
 
   // Open the connection and get the first set of results.
+  RequestTimer openTimer;
+  unsigned numResults = 0;
+  openTimer.startRequest();
   bool isError = codeCompleteRequest(
       RequestCodeCompleteOpen, SourceFilename.data(), CodeCompletionOffset,
       CleanFile.c_str(), /*filterText*/ nullptr, options,
       [&](sourcekitd_object_t response) -> bool {
+        openTimer.endRequest();
         if (sourcekitd_response_is_error(response)) {
           sourcekitd_response_description_dump(response);
           return true;
         }
 
+        // With -time only the timings are printed.
+        if (options.timeRequests) {
+          numResults = getNumResults(response);
+          return false;
+        }
+
         // If there are no prefixes, just dump all the results.
         if (prefixes.empty())
           printResponse(response, options.rawOutput, options.structureOutput,
@@ -782,25 +839,42 @@ static int handleTestInvocation(TestOptions &options) {
   if (isError)
     return isError;
 
+  if (options.timeRequests)
+    openTimer.print("open", numResults);
+
   for (auto &prefix : prefixes) {
-    isError |= codeCompleteRequest(
-        RequestCodeCompleteUpdate, SourceFilename.data(), CodeCompletionOffset,
-        CleanFile.c_str(), prefix.c_str(), options,
-        [&](sourcekitd_object_t response) -> bool {
-          if (sourcekitd_response_is_error(response)) {
-            sourcekitd_response_description_dump(response);
-            return true;
-          }
-          llvm::outs() << "Results for filterText: " << prefix << " [\n";
-          llvm::outs().flush();
-          printResponse(response, options.rawOutput, options.structureOutput,
-                        /*indentation*/ 4);
-          llvm::outs() << "]\n";
-          llvm::outs().flush();
-          return false;
-        });
+    // Only updates are repeated, since they reuse the completion session.
+    RequestTimer updateTimer;
+    for (unsigned i = 0; i < options.repeatCount && !isError; ++i) {
+      updateTimer.startRequest();
+      isError |= codeCompleteRequest(
+          RequestCodeCompleteUpdate, SourceFilename.data(),
+          CodeCompletionOffset, CleanFile.c_str(), prefix.c_str(), options,
+          [&](sourcekitd_object_t response) -> bool {
+            updateTimer.endRequest();
+            if (sourcekitd_response_is_error(response)) {
+              sourcekitd_response_description_dump(response);
+              return true;
+            }
+            if (options.timeRequests) {
+              numResults = getNumResults(response);
+              return false;
+            }
+            if (i != 0)
+              return false;
+            llvm::outs() << "Results for filterText: " << prefix << " [\n";
+            llvm::outs().flush();
+            printResponse(response, options.rawOutput,
+                          options.structureOutput, /*indentation*/ 4);
+            llvm::outs() << "]\n";
+            llvm::outs().flush();
+            return false;
+          });
+    }
     if (isError)
       break;
+    if (options.timeRequests)
+      updateTimer.print("update '" + prefix + "'", numResults);
   }
 
   // Close the code completion connection.
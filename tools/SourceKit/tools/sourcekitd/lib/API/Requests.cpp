@@ -632,8 +632,14 @@ void handleRequestImpl(sourcekitd_object_t ReqObj, ResponseReceiver Rec) {
 
   static WorkQueue SemaQueue{ WorkQueue::Dequeuing::Concurrent,
                               "sourcekit.request.semantic" };
+  // Indexing is not waited on by the editor; let interactive requests go
+  // first.
+  static WorkQueue IndexQueue{ WorkQueue::Dequeuing::Concurrent,
+                               "sourcekit.request.index",
+                               WorkQueue::Priority::Background };
+  WorkQueue &Queue = ReqUID == RequestIndex ? IndexQueue : SemaQueue;
   sourcekitd_request_retain(ReqObj);
-  SemaQueue.dispatch(
+  Queue.dispatch(
     [ReqObj, Rec, ReqUID, SourceFile, SourceText, Args] {
       RequestDict Req(ReqObj);
       handleSemanticRequest(Req, Rec, ReqUID, SourceFile, SourceText, Args);
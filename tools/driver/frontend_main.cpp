@@ -30,6 +30,7 @@
 #include "swift/Basic/FileSystem.h"
 #include "swift/Basic/SourceManager.h"
 #include "swift/Basic/Timer.h"
+#include "swift/Basic/TraceEvents.h"
 #include "swift/Frontend/DiagnosticVerifier.h"
 #include "swift/Frontend/Frontend.h"
 #include "swift/Frontend/PrintingDiagnosticConsumer.h"
@@ -38,12 +39,14 @@
 #include "swift/Option/Options.h"
 #include "swift/PrintAsObjC/PrintAsObjC.h"
 #include "swift/Serialization/SerializationOptions.h"
+#include "swift/SILOptimizer/PassManager/PassProfile.h"
 #include "swift/SILOptimizer/PassManager/Passes.h"
 
 // FIXME: We're just using CompilerInstance::createOutputFile.
 // This API should be sunk down to LLVM.
 #include "clang/Frontend/CompilerInstance.h"
 
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -51,8 +54,10 @@
 #include "llvm/Option/Option.h"
 #include "llvm/Option/OptTable.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/YAMLParser.h"
@@ -606,6 +611,12 @@ static void debugFailWithCrash() {
   LLVM_BUILTIN_TRAP;
 }
 
+static bool performCompileStepsPostSema(CompilerInstance &Instance,
+                                        CompilerInvocation &Invocation,
+                                        SourceFile *PrimarySourceFile,
+                                        DependencyTracker *DepTracker,
+                                        int &ReturnValue);
+
 /// Performs the compile requested by the user.
 /// \returns true on error
 static bool performCompile(CompilerInstance &Instance,
@@ -710,13 +721,33 @@ static bool performCompile(CompilerInstance &Instance,
   if (opts.PrintClangStats && Context.getClangModuleLoader())
     Context.getClangModuleLoader()->printStatistics();
 
+  return performCompileStepsPostSema(Instance, Invocation, PrimarySourceFile,
+                                     Instance.getDependencyTracker(),
+                                     ReturnValue);
+}
+
+/// Emits the outputs of a compile whose inputs have been type-checked.
+///
+/// \p PrimarySourceFile is the file to produce outputs for, or null to
+/// produce them for the whole module. \p DepTracker holds the dependencies
+/// to list in the dependencies files.
+/// \returns true on error
+static bool performCompileStepsPostSema(CompilerInstance &Instance,
+                                        CompilerInvocation &Invocation,
+                                        SourceFile *PrimarySourceFile,
+                                        DependencyTracker *DepTracker,
+                                        int &ReturnValue) {
+  FrontendOptions opts = Invocation.getFrontendOptions();
+  FrontendOptions::ActionType Action = opts.RequestedAction;
+  IRGenOptions &IRGenOpts = Invocation.getIRGenOptions();
+  ASTContext &Context = Instance.getASTContext();
+
   if (!opts.DependenciesFilePath.empty())
-    (void)emitMakeDependencies(Context.Diags, *Instance.getDependencyTracker(),
-                               opts);
+    (void)emitMakeDependencies(Context.Diags, *DepTracker, opts);
 
-  if (shouldTrackReferences)
-    emitReferenceDependencies(Context.Diags, Instance.getPrimarySourceFile(),
-                              *Instance.getDependencyTracker(), opts);
+  if (!opts.ReferenceDependenciesFilePath.empty())
+    emitReferenceDependencies(Context.Diags, PrimarySourceFile, *DepTracker,
+                              opts);
 
   if (Context.hadError())
     return true;
@@ -825,6 +856,18 @@ static bool performCompile(CompilerInstance &Instance,
     performSILInstCount(&*SM);
   }
 
+  // Write the optimizer profile if we are asked to do so.
+  const std::string &PassProfilePath = SM->getOptions().PassProfileFilename;
+  if (!PassProfilePath.empty()) {
+    if (SILPassProfile::get().write(PassProfilePath)) {
+      Context.Diags.diagnose(SourceLoc(), diag::error_opening_output,
+                             PassProfilePath,
+                             "could not write SIL pass profile");
+    }
+    // Start over for the next primary file of a batch.
+    SILPassProfile::get().clear();
+  }
+
   // Get the main source file's private discriminator and attach it to
   // the compile unit's flags.
   if (PrimarySourceFile) {
@@ -993,6 +1036,266 @@ static bool dumpAPI(Module *Mod, StringRef OutDir) {
   return false;
 }
 
+static void setDWARFVersion(CompilerInvocation &Invocation) {
+  // Setting DWARF Version depend on platform
+  IRGenOptions &IRGenOpts = Invocation.getIRGenOptions();
+  IRGenOpts.DWARFVersion = swift::GenericDWARFVersion;
+  if (Invocation.getLangOptions().Target.isWindowsCygwinEnvironment())
+    IRGenOpts.DWARFVersion = swift::CygwinDWARFVersion;
+}
+
+/// Reads a batch jobs file written by the driver: a YAML sequence holding
+/// the frontend arguments of each job as a sequence of strings.
+///
+/// \returns true on error
+static bool readBatchJobsFile(StringRef Path, DiagnosticEngine &Diags,
+                              std::vector<std::vector<std::string>> &Jobs) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> BufferOrErr =
+    llvm::MemoryBuffer::getFile(Path);
+  if (!BufferOrErr) {
+    Diags.diagnose(SourceLoc(), diag::error_open_input_file, Path,
+                   BufferOrErr.getError().message());
+    return true;
+  }
+
+  llvm::SourceMgr SM;
+  llvm::yaml::Stream YAMLStream(BufferOrErr.get()->getMemBufferRef(), SM);
+  auto malformed = [&]() -> bool {
+    Diags.diagnose(SourceLoc(), diag::error_malformed_batch_jobs_file, Path);
+    return true;
+  };
+
+  auto I = YAMLStream.begin();
+  if (I == YAMLStream.end())
+    return malformed();
+  auto *JobsNode = dyn_cast_or_null<llvm::yaml::SequenceNode>(I->getRoot());
+  if (!JobsNode)
+    return malformed();
+
+  for (llvm::yaml::Node &JobNode : *JobsNode) {
+    auto *ArgsNode = dyn_cast<llvm::yaml::SequenceNode>(&JobNode);
+    if (!ArgsNode)
+      return malformed();
+
+    Jobs.emplace_back();
+    for (llvm::yaml::Node &ArgNode : *ArgsNode) {
+      auto *Arg = dyn_cast<llvm::yaml::ScalarNode>(&ArgNode);
+      if (!Arg)
+        return malformed();
+      SmallString<128> Storage;
+      Jobs.back().push_back(Arg->getValue(Storage).str());
+    }
+  }
+
+  if (Jobs.empty())
+    return malformed();
+  return false;
+}
+
+/// Returns the arguments of a batch job that must be the same for all jobs
+/// of a batch, which are all but those naming the job's primary file and
+/// its outputs.
+static std::vector<std::string>
+getSharedBatchArguments(const llvm::opt::OptTable &Table,
+                        ArrayRef<const char *> Args) {
+  using namespace options;
+
+  unsigned MissingIndex, MissingCount;
+  llvm::opt::InputArgList ParsedArgs =
+      Table.ParseArgs(Args, MissingIndex, MissingCount, FrontendOption);
+
+  std::vector<std::string> Shared;
+  for (const llvm::opt::Arg *A : ParsedArgs) {
+    switch (A->getOption().getID()) {
+    case OPT_primary_file:
+    case OPT_o:
+    case OPT_output_filelist:
+    case OPT_emit_module_path:
+    case OPT_emit_module_doc_path:
+    case OPT_emit_dependencies_path:
+    case OPT_emit_reference_dependencies_path:
+    case OPT_trace_events_output:
+    case OPT_batch_diagnostics_output:
+      continue;
+    default:
+      Shared.push_back(A->getAsString(ParsedArgs));
+    }
+  }
+  return Shared;
+}
+
+/// Returns why the job \p Invocation cannot be part of a batch, or an empty
+/// string if it can.
+static StringRef getReasonNotBatchable(const CompilerInvocation &Invocation) {
+  const FrontendOptions &Opts = Invocation.getFrontendOptions();
+  if (!Opts.PrimaryInput || !Opts.PrimaryInput->isFilename())
+    return "it has no primary file";
+
+  if (Invocation.getInputKind() != InputFileKind::IFK_Swift &&
+      Invocation.getInputKind() != InputFileKind::IFK_Swift_Library)
+    return "it does not compile Swift source files";
+
+  switch (Opts.RequestedAction) {
+  case FrontendOptions::Parse:
+  case FrontendOptions::EmitSILGen:
+  case FrontendOptions::EmitSIL:
+  case FrontendOptions::EmitModuleOnly:
+  case FrontendOptions::EmitAssembly:
+  case FrontendOptions::EmitIR:
+  case FrontendOptions::EmitBC:
+  case FrontendOptions::EmitObject:
+    break;
+  default:
+    return "its action is not supported in batch mode";
+  }
+
+  // These are written by process-wide diagnostic consumers or after
+  // everything else, so they can't be split up by primary file.
+  if (!Opts.SerializedDiagnosticsPath.empty() ||
+      !Opts.FixitsOutputPath.empty() ||
+      !Opts.DumpAPIPath.empty() ||
+      Invocation.getDiagnosticOptions().VerifyDiagnostics)
+    return "it has outputs that cannot be split by primary file";
+
+  return StringRef();
+}
+
+/// Parses the jobs listed in the batch jobs file at \p Path into
+/// \p Invocations, checking that they can share one CompilerInstance.
+///
+/// \returns true on error
+static bool
+parseBatchJobs(StringRef Path, DiagnosticEngine &Diags,
+               StringRef MainExecutablePath, StringRef WorkingDirectory,
+               std::vector<std::vector<std::string>> &JobArgs,
+               std::vector<CompilerInvocation> &Invocations) {
+  if (readBatchJobsFile(Path, Diags, JobArgs))
+    return true;
+
+  std::unique_ptr<llvm::opt::OptTable> Table(createSwiftOptTable());
+  std::vector<std::string> FirstSharedArgs;
+  Invocations.resize(JobArgs.size());
+  for (unsigned i = 0, e = JobArgs.size(); i != e; ++i) {
+    SmallVector<const char *, 64> Args;
+    for (auto &Arg : JobArgs[i])
+      Args.push_back(Arg.c_str());
+
+    CompilerInvocation &Invocation = Invocations[i];
+    Invocation.setMainExecutablePath(MainExecutablePath);
+    if (Invocation.parseArgs(Args, Diags, WorkingDirectory))
+      return true;
+    setDWARFVersion(Invocation);
+
+    StringRef Reason = getReasonNotBatchable(Invocation);
+    if (Reason.empty()) {
+      // Everything but the primary file and outputs is shared, so it has to
+      // be the same for all jobs.
+      auto SharedArgs = getSharedBatchArguments(*Table, Args);
+      if (i == 0)
+        FirstSharedArgs = std::move(SharedArgs);
+      else if (SharedArgs != FirstSharedArgs)
+        Reason = "its options differ from those of the first job";
+    }
+    if (!Reason.empty()) {
+      Diags.diagnose(SourceLoc(), diag::error_incompatible_batch_job, i + 1,
+                     Path, Reason);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+namespace {
+/// Sends each diagnostic of a batch compile to the jobs it belongs to, so
+/// that each job reports what it would have reported if it had been run on
+/// its own.
+///
+/// A diagnostic in a job's primary file belongs to that job. Any other
+/// diagnostic belongs to the job whose outputs are being emitted, or, while
+/// all primary files are parsed and type-checked together, to every job.
+/// Notes go where the diagnostic they are attached to went.
+class BatchDiagnosticRouter : public DiagnosticConsumer {
+  struct JobDiagnostics {
+    std::string PrimaryFilename;
+    DiagnosticConsumer *Consumer;
+  };
+
+  std::vector<JobDiagnostics> Jobs;
+  Optional<unsigned> CurrentJob;
+  llvm::SmallSetVector<DiagnosticConsumer *, 4> LastConsumers;
+
+public:
+  /// Adds the next job of the batch, whose diagnostics go to \p Consumer.
+  void addJob(StringRef PrimaryFilename, DiagnosticConsumer &Consumer) {
+    Jobs.push_back({PrimaryFilename, &Consumer});
+  }
+
+  /// Makes the job at \p Index the one whose outputs are being emitted.
+  void setCurrentJob(unsigned Index) {
+    CurrentJob = Index;
+  }
+
+  void handleDiagnostic(SourceManager &SM, SourceLoc Loc,
+                        DiagnosticKind Kind, StringRef Text,
+                        const DiagnosticInfo &Info) override {
+    if (Kind != DiagnosticKind::Note) {
+      LastConsumers.clear();
+      StringRef Filename;
+      if (Loc.isValid())
+        Filename = SM.getIdentifierForBuffer(SM.findBufferContainingLoc(Loc));
+      for (auto &Job : Jobs)
+        if (Job.PrimaryFilename == Filename)
+          LastConsumers.insert(Job.Consumer);
+
+      if (LastConsumers.empty()) {
+        if (CurrentJob)
+          LastConsumers.insert(Jobs[*CurrentJob].Consumer);
+        else
+          for (auto &Job : Jobs)
+            LastConsumers.insert(Job.Consumer);
+      }
+    }
+
+    for (DiagnosticConsumer *Consumer : LastConsumers)
+      Consumer->handleDiagnostic(SM, Loc, Kind, Text, Info);
+  }
+};
+} // end anonymous namespace
+
+/// Performs the compile jobs of a batch in \p Instance, whose additional
+/// primary inputs are the primary files of all jobs but the first, in order.
+///
+/// All primary files are type-checked together, then each job emits its
+/// outputs in turn, listing the dependencies in its entry of \p DepTrackers.
+/// If \p Router is non-null, it is told which job is emitting its outputs.
+/// \returns true on error
+static bool performBatchCompile(CompilerInstance &Instance,
+                                MutableArrayRef<CompilerInvocation> Invocations,
+                                MutableArrayRef<DependencyTracker> DepTrackers,
+                                BatchDiagnosticRouter *Router,
+                                int &ReturnValue) {
+  Instance.performSema();
+
+  const FrontendOptions &opts = Invocations.front().getFrontendOptions();
+  ASTContext &Context = Instance.getASTContext();
+  if (opts.PrintClangStats && Context.getClangModuleLoader())
+    Context.getClangModuleLoader()->printStatistics();
+
+  bool HadError = false;
+  for (unsigned i = 0, e = Invocations.size(); i != e; ++i) {
+    SourceFile *PrimarySourceFile =
+        i == 0 ? Instance.getPrimarySourceFile()
+               : Instance.getAdditionalPrimarySourceFile(i - 1);
+    if (Router)
+      Router->setCurrentJob(i);
+    HadError |= performCompileStepsPostSema(Instance, Invocations[i],
+                                            PrimarySourceFile, &DepTrackers[i],
+                                            ReturnValue);
+  }
+  return HadError;
+}
+
 int frontend_main(ArrayRef<const char *>Args,
                   const char *Argv0, void *MainAddr) {
   llvm::InitializeAllTargets();
@@ -1022,11 +1325,53 @@ int frontend_main(ArrayRef<const char *>Args,
     return 1;
   }
 
-  // Setting DWARF Version depend on platform
-  IRGenOptions &IRGenOpts = Invocation.getIRGenOptions();
-  IRGenOpts.DWARFVersion = swift::GenericDWARFVersion;
-  if (Invocation.getLangOptions().Target.isWindowsCygwinEnvironment())
-    IRGenOpts.DWARFVersion = swift::CygwinDWARFVersion;
+  setDWARFVersion(Invocation);
+
+  // In batch mode, the first job's invocation sets up the CompilerInstance.
+  std::vector<std::vector<std::string>> BatchJobArgs;
+  std::vector<CompilerInvocation> BatchInvocations;
+  if (!Invocation.getFrontendOptions().BatchJobsFilePath.empty()) {
+    if (parseBatchJobs(Invocation.getFrontendOptions().BatchJobsFilePath,
+                       Instance.getDiags(), MainExecutablePath,
+                       workingDirectory, BatchJobArgs, BatchInvocations))
+      return 1;
+    Invocation = BatchInvocations.front();
+  }
+
+  // Jobs that have a file of their own for their diagnostics get the
+  // diagnostics that belong to them there; the others share stderr.
+  std::vector<std::unique_ptr<llvm::raw_fd_ostream>> BatchDiagnosticStreams;
+  std::vector<std::unique_ptr<PrintingDiagnosticConsumer>> BatchPrinters;
+  std::unique_ptr<BatchDiagnosticRouter> BatchRouter;
+  if (!BatchInvocations.empty()) {
+    BatchRouter.reset(new BatchDiagnosticRouter);
+    for (const CompilerInvocation &JobInvocation : BatchInvocations) {
+      const FrontendOptions &JobOpts = JobInvocation.getFrontendOptions();
+      StringRef PrimaryFilename =
+          JobOpts.InputFilenames[JobOpts.PrimaryInput->Index];
+      const std::string &OutputPath = JobOpts.BatchDiagnosticsOutputPath;
+      if (OutputPath.empty()) {
+        BatchRouter->addJob(PrimaryFilename, PDC);
+        continue;
+      }
+
+      std::error_code EC;
+      BatchDiagnosticStreams.emplace_back(
+          new llvm::raw_fd_ostream(OutputPath, EC, llvm::sys::fs::F_None));
+      if (EC) {
+        Instance.getDiags().diagnose(SourceLoc(), diag::error_opening_output,
+                                     OutputPath, EC.message());
+        return 1;
+      }
+      BatchPrinters.emplace_back(
+          new PrintingDiagnosticConsumer(*BatchDiagnosticStreams.back()));
+      if (JobInvocation.getDiagnosticOptions().UseColor)
+        BatchPrinters.back()->forceColors();
+      BatchRouter->addJob(PrimaryFilename, *BatchPrinters.back());
+    }
+    (void)Instance.getDiags().takeConsumers();
+    Instance.addDiagnosticConsumer(BatchRouter.get());
+  }
 
   if (Invocation.getFrontendOptions().PrintHelp ||
       Invocation.getFrontendOptions().PrintHelpHidden) {
@@ -1104,6 +1449,9 @@ int frontend_main(ArrayRef<const char *>Args,
   if (Invocation.getFrontendOptions().DebugTimeCompilation)
     SharedTimer::enableCompilationTimers();
 
+  if (!Invocation.getFrontendOptions().TraceEventsOutputPath.empty())
+    TraceScope::enableTracing();
+
   if (Invocation.getFrontendOptions().PrintStats) {
     llvm::EnableStatistics();
   }
@@ -1118,13 +1466,44 @@ int frontend_main(ArrayRef<const char *>Args,
     Instance.setDependencyTracker(&depTracker);
   }
 
+  // Each job of a batch records the names its own primary file references
+  // and the dependencies it would have picked up on its own.
+  std::vector<ReferencedNameTracker> BatchNameTrackers(BatchInvocations.size());
+  std::vector<DependencyTracker> BatchDepTrackers(BatchInvocations.size());
+  for (unsigned i = 0, e = BatchInvocations.size(); i != e; ++i) {
+    const FrontendOptions &JobOpts = BatchInvocations[i].getFrontendOptions();
+    ReferencedNameTracker *Tracker = nullptr;
+    if (!JobOpts.ReferenceDependenciesFilePath.empty())
+      Tracker = &BatchNameTrackers[i];
+    DependencyTracker *DepTracker = nullptr;
+    if (!JobOpts.DependenciesFilePath.empty() ||
+        !JobOpts.ReferenceDependenciesFilePath.empty()) {
+      Instance.setDependencyTracker(&depTracker);
+      DepTracker = &BatchDepTrackers[i];
+    }
+
+    if (i == 0) {
+      Instance.setReferencedNameTracker(Tracker);
+      Instance.setPrimaryDependencyTracker(DepTracker);
+    } else {
+      Instance.addAdditionalPrimaryInput(JobOpts.PrimaryInput->Index, Tracker,
+                                         DepTracker);
+    }
+  }
+
   if (Instance.setup(Invocation)) {
     return 1;
   }
 
   int ReturnValue = 0;
-  bool HadError = performCompile(Instance, Invocation, Args, ReturnValue) ||
-                  Instance.getASTContext().hadError();
+  bool HadError;
+  if (!BatchInvocations.empty())
+    HadError = performBatchCompile(Instance, BatchInvocations,
+                                   BatchDepTrackers, BatchRouter.get(),
+                                   ReturnValue);
+  else
+    HadError = performCompile(Instance, Invocation, Args, ReturnValue);
+  HadError |= Instance.getASTContext().hadError();
 
   if (!HadError && !Invocation.getFrontendOptions().DumpAPIPath.empty()) {
     HadError = dumpAPI(Instance.getMainModule(),
@@ -1143,5 +1522,29 @@ int frontend_main(ArrayRef<const char *>Args,
     }
   }
 
+  // Write the compilation timeline if we are asked to do so.
+  const FrontendOptions &FEOpts = Invocation.getFrontendOptions();
+  if (!FEOpts.TraceEventsOutputPath.empty()) {
+    // Name the process after its primary file, so that the jobs of a
+    // multi-file build can be told apart once the driver merges them.
+    std::string ProcessName = "swift -frontend ";
+    if (FEOpts.PrimaryInput && FEOpts.PrimaryInput->isFilename())
+      ProcessName += FEOpts.InputFilenames[FEOpts.PrimaryInput->Index];
+    else
+      ProcessName += Invocation.getModuleName();
+    if (BatchInvocations.size() > 1) {
+      ProcessName += " and ";
+      ProcessName += std::to_string(BatchInvocations.size() - 1);
+      ProcessName += " more";
+    }
+
+    if (TraceScope::writeTrace(FEOpts.TraceEventsOutputPath, ProcessName)) {
+      Instance.getDiags().diagnose(SourceLoc(), diag::error_opening_output,
+                                   FEOpts.TraceEventsOutputPath,
+                                   "could not write trace events");
+      HadError = true;
+    }
+  }
+
   return (HadError ? 1 : ReturnValue);
 }
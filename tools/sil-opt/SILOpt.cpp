@@ -26,6 +26,7 @@
 #include "swift/SILOptimizer/Analysis/Analysis.h"
 #include "swift/SILOptimizer/PassManager/Passes.h"
 #include "swift/SILOptimizer/PassManager/PassManager.h"
+#include "swift/SILOptimizer/PassManager/PassProfile.h"
 #include "swift/Serialization/SerializedModuleLoader.h"
 #include "swift/Serialization/SerializedSILLoader.h"
 #include "swift/Serialization/SerializationOptions.h"
@@ -160,6 +161,11 @@ ASTVerifierProcessId("ast-verifier-process-id", llvm::cl::Hidden,
 static llvm::cl::opt<bool>
 PerformWMO("wmo", llvm::cl::desc("Enable whole-module optimizations"));
 
+static llvm::cl::opt<std::string>
+PassProfileFilename("sil-pass-profile",
+                    llvm::cl::desc("Write a JSON profile of every SIL pass "
+                                   "to this file"));
+
 static void runCommandLineSelectedPasses(SILModule *Module) {
   SILPassManager PM(Module);
 
@@ -226,6 +232,7 @@ int main(int argc, char **argv) {
   SILOpts.AssertConfig = AssertConfId;
   if (OptimizationGroup != OptGroup::Diagnostics)
     SILOpts.Optimization = SILOptions::SILOptMode::Optimize;
+  SILOpts.PassProfileFilename = PassProfileFilename;
 
 
   // Load the input file.
@@ -310,6 +317,13 @@ int main(int argc, char **argv) {
     runCommandLineSelectedPasses(CI.getSILModule());
   }
 
+  if (!PassProfileFilename.empty() &&
+      SILPassProfile::get().write(PassProfileFilename)) {
+    fprintf(stderr, "Error! Failed to write SIL pass profile: %s\n",
+            PassProfileFilename.c_str());
+    exit(-1);
+  }
+
   if (EmitSIB) {
     llvm::SmallString<128> OutputFile;
     if (OutputFilename.size()) {
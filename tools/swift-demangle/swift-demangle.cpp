@@ -15,15 +15,26 @@
 //===----------------------------------------------------------------------===//
 
 #include "swift/Basic/DemangleWrappers.h"
+#include "swift/Basic/PrettyStackTrace.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
-#include "llvm/Support/Regex.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 static llvm::cl::opt<bool>
 ExpandMode("expand",
@@ -49,51 +60,240 @@ static llvm::cl::opt<bool>
 Simplified("simplified",
            llvm::cl::desc("Don't display module names or implicit self types"));
 
+static llvm::cl::opt<bool>
+BatchMode("batch",
+          llvm::cl::desc("Batch mode (read standard input in large blocks and "
+                         "demangle them on several threads)"));
+
+static llvm::cl::opt<unsigned>
+NumThreads("j", llvm::cl::init(0),
+           llvm::cl::desc("Number of threads to use in batch mode "
+                          "(default: one per core)"));
+
+static llvm::cl::opt<unsigned>
+BatchBlockSize("batch-block-size", llvm::cl::init(4 << 20), llvm::cl::Hidden,
+               llvm::cl::desc("Number of bytes to read at a time in batch "
+                              "mode"));
+
+static llvm::cl::opt<bool>
+PrintThroughput("print-throughput",
+                llvm::cl::desc("Print the amount of input read from standard "
+                               "input and the throughput to stderr"));
+
 static llvm::cl::list<std::string>
 InputNames(llvm::cl::Positional, llvm::cl::desc("[mangled name...]"),
                llvm::cl::ZeroOrMore);
 
 static void demangle(llvm::raw_ostream &os, llvm::StringRef name,
-                     const swift::Demangle::DemangleOptions &options) {
+                     const swift::Demangle::DemangleOptions &options,
+                     swift::Demangle::Demangler &demangler) {
   bool hadLeadingUnderscore = false;
   if (name.startswith("__")) {
     hadLeadingUnderscore = true;
     name = name.substr(1);
   }
-  swift::Demangle::NodePointer pointer =
-      swift::demangle_wrappers::demangleSymbolAsNode(name);
+  swift::PrettyStackTraceStringAction prettyStackTrace("demangling string",
+                                                       name);
+  demangler.reset();
+  swift::Demangle::NodePointer pointer = demangler.demangleSymbol(name);
   if (ExpandMode || TreeOnly) {
-    llvm::outs() << "Demangling for " << name << '\n';
-    swift::demangle_wrappers::NodeDumper(pointer).print(llvm::outs());
+    os << "Demangling for " << name << '\n';
+    swift::demangle_wrappers::NodeDumper(pointer).print(os);
   }
   if (RemangleMode) {
-    if (hadLeadingUnderscore) llvm::outs() << '_';
+    if (hadLeadingUnderscore) os << '_';
     // Just reprint the original mangled name if it didn't demangle.
     // This makes it easier to share the same database between the
     // mangling and demangling tests.
     if (!pointer) {
-      llvm::outs() << name;
+      os << name;
     } else {
-      llvm::outs() << swift::Demangle::mangleNode(pointer);
+      os << swift::Demangle::mangleNode(pointer);
     }
     return;
   }
   if (!TreeOnly) {
     std::string string = swift::Demangle::nodeToString(pointer, options);
     if (!CompactMode)
-      llvm::outs() << name << " ---> ";
-    llvm::outs() << (string.empty() ? name : llvm::StringRef(string));
+      os << name << " ---> ";
+    os << (string.empty() ? name : llvm::StringRef(string));
   }
 }
 
-static llvm::StringRef substrBefore(llvm::StringRef whole,
-                                    llvm::StringRef part) {
-  return whole.slice(0, part.data() - whole.data());
+/// Whether \p c can be part of a mangled name found in running text.
+///
+/// This doesn't handle Unicode symbols, but maybe that's okay.
+static bool isSymbolChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_' || c == '$';
+}
+
+/// Copy \p text to \p os, demangling everything that looks like a mangled
+/// name, i.e. matches "_T[_a-zA-Z0-9$]+".
+static void demangleText(llvm::raw_ostream &os, llvm::StringRef text,
+                         const swift::Demangle::DemangleOptions &options,
+                         swift::Demangle::Demangler &demangler) {
+  const char *copied = text.begin();
+  const char *cur = text.begin();
+  const char *end = text.end();
+  // memchr is vectorized on all the platforms we care about, so skip ahead
+  // to the next underscore with it rather than looking at every character.
+  while (auto underscore = static_cast<const char *>(
+                             memchr(cur, '_', end - cur))) {
+    if (end - underscore < 3 || underscore[1] != 'T' ||
+        !isSymbolChar(underscore[2])) {
+      cur = underscore + 1;
+      continue;
+    }
+    const char *symbolEnd = underscore + 3;
+    while (symbolEnd != end && isSymbolChar(*symbolEnd))
+      ++symbolEnd;
+
+    os << llvm::StringRef(copied, underscore - copied);
+    demangle(os, llvm::StringRef(underscore, symbolEnd - underscore), options,
+             demangler);
+    copied = cur = symbolEnd;
+  }
+  os << llvm::StringRef(copied, end - copied);
 }
 
-static llvm::StringRef substrAfter(llvm::StringRef whole,
-                                   llvm::StringRef part) {
-  return whole.substr((part.data() - whole.data()) + part.size());
+namespace {
+/// A block of standard input and its demangled form.
+struct Chunk {
+  std::string Input;
+  std::string Output;
+  bool Done = false;
+};
+
+/// Demangles chunks on a pool of worker threads, each with its own
+/// Demangler so that they share no node storage.
+class BatchDemangler {
+  const swift::Demangle::DemangleOptions &Options;
+  std::mutex Lock;
+  std::condition_variable WorkAvailable;
+  std::condition_variable ChunkDone;
+  std::deque<Chunk *> Pending;
+  bool Finished = false;
+  std::vector<std::thread> Workers;
+
+  void runWorker() {
+    swift::Demangle::Demangler demangler;
+    while (true) {
+      Chunk *chunk;
+      {
+        std::unique_lock<std::mutex> guard(Lock);
+        WorkAvailable.wait(guard, [&] { return Finished || !Pending.empty(); });
+        if (Pending.empty())
+          return;
+        chunk = Pending.front();
+        Pending.pop_front();
+      }
+
+      llvm::raw_string_ostream os(chunk->Output);
+      demangleText(os, chunk->Input, Options, demangler);
+      os.flush();
+
+      {
+        std::lock_guard<std::mutex> guard(Lock);
+        chunk->Done = true;
+      }
+      ChunkDone.notify_all();
+    }
+  }
+
+public:
+  BatchDemangler(unsigned numWorkers,
+                 const swift::Demangle::DemangleOptions &options)
+      : Options(options) {
+    for (unsigned i = 0; i < numWorkers; ++i)
+      Workers.emplace_back([this] { runWorker(); });
+  }
+
+  ~BatchDemangler() {
+    {
+      std::lock_guard<std::mutex> guard(Lock);
+      Finished = true;
+    }
+    WorkAvailable.notify_all();
+    for (auto &worker : Workers)
+      worker.join();
+  }
+
+  unsigned getNumWorkers() const { return Workers.size(); }
+
+  void submit(Chunk *chunk) {
+    {
+      std::lock_guard<std::mutex> guard(Lock);
+      Pending.push_back(chunk);
+    }
+    WorkAvailable.notify_one();
+  }
+
+  void waitFor(Chunk *chunk) {
+    std::unique_lock<std::mutex> guard(Lock);
+    ChunkDone.wait(guard, [&] { return chunk->Done; });
+  }
+};
+} // end anonymous namespace
+
+/// Demangle standard input block by block on a pool of threads, writing
+/// the blocks out in their original order.
+///
+/// \returns the number of bytes read, or -1 on a read error.
+static int64_t demangleBatch(const swift::Demangle::DemangleOptions &options) {
+  unsigned numWorkers = NumThreads;
+  if (numWorkers == 0)
+    numWorkers = std::max(1u, std::thread::hardware_concurrency());
+  const size_t blockSize = std::max(1u, unsigned(BatchBlockSize));
+
+  BatchDemangler pool(numWorkers, options);
+  std::deque<std::unique_ptr<Chunk>> inFlight;
+  std::string carry;
+  int64_t bytesRead = 0;
+
+  auto writeFront = [&] {
+    pool.waitFor(inFlight.front().get());
+    llvm::outs() << inFlight.front()->Output;
+    inFlight.pop_front();
+  };
+
+  bool atEnd = false;
+  while (!atEnd) {
+    std::unique_ptr<Chunk> chunk(new Chunk());
+    chunk->Input.swap(carry);
+    size_t start = chunk->Input.size();
+    chunk->Input.resize(start + blockSize);
+    size_t count = fread(&chunk->Input[start], 1, blockSize, stdin);
+    chunk->Input.resize(start + count);
+    bytesRead += count;
+    atEnd = count < blockSize;
+
+    // A run of symbol characters at the end of the block may continue in
+    // the next one, so hold it back.
+    if (!atEnd) {
+      size_t split = chunk->Input.size();
+      while (split > 0 && isSymbolChar(chunk->Input[split - 1]))
+        --split;
+      carry.assign(chunk->Input, split, std::string::npos);
+      chunk->Input.resize(split);
+    }
+
+    if (!chunk->Input.empty()) {
+      pool.submit(chunk.get());
+      inFlight.push_back(std::move(chunk));
+    }
+
+    // Keep every worker busy, but bound the memory held by finished chunks
+    // waiting for an earlier one.
+    while (inFlight.size() > 2 * pool.getNumWorkers())
+      writeFront();
+  }
+  while (!inFlight.empty())
+    writeFront();
+
+  if (ferror(stdin))
+    return -1;
+  return bytesRead;
 }
 
 int main(int argc, char **argv) {
@@ -109,28 +309,40 @@ int main(int argc, char **argv) {
   if (Simplified)
     options = swift::Demangle::DemangleOptions::SimplifiedUIDemangleOptions();
 
+  swift::Demangle::Demangler demangler;
   if (InputNames.empty()) {
     CompactMode = true;
-    auto input = llvm::MemoryBuffer::getSTDIN();
-    if (!input) {
-      llvm::errs() << input.getError().message() << '\n';
-      return EXIT_FAILURE;
-    }
-    llvm::StringRef inputContents = input.get()->getBuffer();
-
-    // This doesn't handle Unicode symbols, but maybe that's okay.
-    llvm::Regex maybeSymbol("_T[_a-zA-Z0-9$]+");
-    llvm::SmallVector<llvm::StringRef, 1> matches;
-    while (maybeSymbol.match(inputContents, &matches)) {
-      llvm::outs() << substrBefore(inputContents, matches.front());
-      demangle(llvm::outs(), matches.front(), options);
-      inputContents = substrAfter(inputContents, matches.front());
+    auto startTime = std::chrono::steady_clock::now();
+    int64_t bytesRead;
+    if (BatchMode) {
+      bytesRead = demangleBatch(options);
+      if (bytesRead < 0) {
+        llvm::errs() << "error reading standard input\n";
+        return EXIT_FAILURE;
+      }
+    } else {
+      auto input = llvm::MemoryBuffer::getSTDIN();
+      if (!input) {
+        llvm::errs() << input.getError().message() << '\n';
+        return EXIT_FAILURE;
+      }
+      llvm::StringRef inputContents = input.get()->getBuffer();
+      demangleText(llvm::outs(), inputContents, options, demangler);
+      bytesRead = inputContents.size();
     }
-    llvm::outs() << inputContents;
 
+    if (PrintThroughput) {
+      llvm::outs().flush();
+      double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - startTime).count();
+      double megabytes = bytesRead / (1024.0 * 1024.0);
+      llvm::errs() << llvm::format("%.1f MB in %.3f s (%.1f MB/s)\n",
+                                   megabytes, seconds,
+                                   seconds > 0 ? megabytes / seconds : 0.0);
+    }
   } else {
     for (llvm::StringRef name : InputNames) {
-      demangle(llvm::outs(), name, options);
+      demangle(llvm::outs(), name, options, demangler);
       llvm::outs() << '\n';
     }
   }
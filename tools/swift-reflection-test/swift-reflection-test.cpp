@@ -18,6 +18,7 @@
 #include "llvm/ADT/Optional.h"
 #include "messages.h"
 
+#include <chrono>
 #include <unistd.h>
 
 using namespace swift;
@@ -131,9 +132,9 @@ public:
 
   template <typename T>
   void collectBytesFromPipe(T *Value, size_t Size) {
-    auto Dest = reinterpret_cast<uint8_t *>(&Value);
+    auto Dest = reinterpret_cast<uint8_t *>(Value);
     while (Size) {
-      auto bytesRead = read(getParentReadFD(), Value, Size);
+      auto bytesRead = read(getParentReadFD(), Dest, Size);
       if (bytesRead <= 0)
         errorAndExit("collectBytesFromPipe");
       Size -= bytesRead;
@@ -284,9 +285,82 @@ public:
   }
 };
 
+/// Forwards to another reader, counting the requests made through it.
+class CountingMemoryReader final : public MemoryReader {
+  MemoryReader &Underlying;
 
+public:
+  uint64_t NumReads = 0;
+  uint64_t NumBytes = 0;
+
+  CountingMemoryReader(MemoryReader &Underlying) : Underlying(Underlying) {}
+
+  uint8_t getPointerSize() override {
+    return Underlying.getPointerSize();
+  }
+
+  uint8_t getSizeSize() override {
+    return Underlying.getSizeSize();
+  }
+
+  addr_t getSymbolAddress(const std::string &Name) override {
+    ++NumReads;
+    return Underlying.getSymbolAddress(Name);
+  }
+
+  std::string readString(addr_t Address) override {
+    ++NumReads;
+    auto String = Underlying.readString(Address);
+    NumBytes += String.size() + 1;
+    return String;
+  }
+
+  bool readBytes(addr_t Address, uint8_t *Dest, uint64_t Size) override {
+    ++NumReads;
+    NumBytes += Size;
+    return Underlying.readBytes(Address, Dest, Size);
+  }
+};
+
+/// Decodes the type of the instance and of its fields \p Iterations times,
+/// each time with a new ReflectionContext, first reading from the child
+/// directly and then through a CachingMemoryReader, and prints the number of
+/// reads from the child and the time each decoding took on average.
 template <typename Runtime>
-static int doDumpHeapInstance(std::string BinaryFilename) {
+static void benchmarkDecoding(MemoryReader &Pipe,
+                              const std::vector<ReflectionInfo> &Infos,
+                              typename Runtime::StoredPointer isa,
+                              unsigned Iterations) {
+  for (bool Cached : {false, true}) {
+    CountingMemoryReader Counter(Pipe);
+    CachingMemoryReader Cache(Counter);
+    MemoryReader &Reader = Cached
+      ? static_cast<MemoryReader &>(Cache)
+      : static_cast<MemoryReader &>(Counter);
+
+    auto Start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < Iterations; ++i) {
+      ReflectionContext<External<Runtime>> RC(Reader);
+      for (auto &Info : Infos)
+        RC.addReflectionInfo(Info);
+      RC.getTypeRef(isa);
+      RC.getFieldTypeRefs(isa);
+      Cache.invalidate();
+    }
+    auto Elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - Start).count();
+
+    std::cout << std::dec
+              << (Cached ? "Page cache: " : "Uncached: ")
+              << Counter.NumReads / Iterations << " reads, "
+              << Counter.NumBytes / Iterations << " bytes, "
+              << Elapsed / Iterations << " us per decoding" << std::endl;
+  }
+}
+
+template <typename Runtime>
+static int doDumpHeapInstance(std::string BinaryFilename,
+                              unsigned BenchmarkIterations) {
   using StoredPointer = typename Runtime::StoredPointer;
 
   PipeMemoryReader<Runtime> Pipe;
@@ -323,7 +397,8 @@ static int doDumpHeapInstance(std::string BinaryFilename) {
       if (!Pipe.readInteger(instance, &isa))
         errorAndExit("Couldn't get heap object's metadata address");
 
-      for (auto &Info : Pipe.receiveReflectionInfo())
+      auto Infos = Pipe.receiveReflectionInfo();
+      for (auto &Info : Infos)
         RC.addReflectionInfo(Info);
 
       std::cout << "Parent: metadata pointer in child address space: 0x";
@@ -340,6 +415,9 @@ static int doDumpHeapInstance(std::string BinaryFilename) {
         // TODO: Print field layout here.
         std::cout << std::endl;
       }
+
+      if (BenchmarkIterations > 0)
+        benchmarkDecoding<Runtime>(Pipe, Infos, isa, BenchmarkIterations);
     }
   }
 
@@ -349,18 +427,28 @@ static int doDumpHeapInstance(std::string BinaryFilename) {
 }
 
 void printUsageAndExit() {
-  std::cerr << "swift-reflection-test <arch> <binary filename>" << std::endl;
+  std::cerr << "swift-reflection-test <arch> <binary filename> "
+               "[-benchmark <iterations>]" << std::endl;
   exit(EXIT_FAILURE);
 }
 
 int main(int argc, char *argv[]) {
 
-  if (argc != 3)
+  if (argc != 3 && argc != 5)
     printUsageAndExit();
 
   std::string arch(argv[1]);
   std::string BinaryFilename(argv[2]);
 
+  unsigned BenchmarkIterations = 0;
+  if (argc == 5) {
+    if (std::string(argv[3]) != "-benchmark")
+      printUsageAndExit();
+    BenchmarkIterations = std::strtoul(argv[4], nullptr, 10);
+    if (BenchmarkIterations == 0)
+      printUsageAndExit();
+  }
+
   unsigned PointerSize = 0;
   if (arch == "x86_64")
     PointerSize = 8;
@@ -376,7 +464,9 @@ int main(int argc, char *argv[]) {
     errorAndExit("Unsupported architecture");
 
   if (PointerSize == 4)
-    return doDumpHeapInstance<External<RuntimeTarget<4>>>(BinaryFilename);
+    return doDumpHeapInstance<External<RuntimeTarget<4>>>(BinaryFilename,
+                                                          BenchmarkIterations);
   else
-    return doDumpHeapInstance<External<RuntimeTarget<8>>>(BinaryFilename);
+    return doDumpHeapInstance<External<RuntimeTarget<8>>>(BinaryFilename,
+                                                          BenchmarkIterations);
 }
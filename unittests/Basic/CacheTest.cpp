@@ -0,0 +1,157 @@
+#include "swift/Basic/Cache.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace swift;
+using namespace swift::sys;
+
+namespace {
+
+/// A value that counts how many of its copies the cache created and
+/// destroyed, and whose cost is given explicitly.
+struct Counted {
+  static std::atomic<unsigned> NumCreated;
+  static std::atomic<unsigned> NumDestroyed;
+
+  std::string Name;
+  size_t Cost;
+};
+
+std::atomic<unsigned> Counted::NumCreated{0};
+std::atomic<unsigned> Counted::NumDestroyed{0};
+
+struct CountedValueInfo {
+  static void *enterCache(const Counted &Val) {
+    ++Counted::NumCreated;
+    return new Counted(Val);
+  }
+  static void exitCache(void *Ptr) {
+    ++Counted::NumDestroyed;
+    delete static_cast<Counted *>(Ptr);
+  }
+  static const Counted &getFromCache(void *Ptr) {
+    return *static_cast<Counted *>(Ptr);
+  }
+  static size_t getCost(const Counted &Val) { return Val.Cost; }
+};
+
+using CountedCache = Cache<int, Counted, CacheKeyInfo<int>, CountedValueInfo>;
+
+class CacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Counted::NumCreated = 0;
+    Counted::NumDestroyed = 0;
+  }
+};
+
+} // end anonymous namespace
+
+TEST_F(CacheTest, SetGetRemove) {
+  CountedCache C("swift.test.Cache");
+  C.set(1, {"one", 1});
+  C.set(2, {"two", 1});
+
+  auto One = C.get(1);
+  ASSERT_TRUE(One.hasValue());
+  EXPECT_EQ("one", One->Name);
+  EXPECT_FALSE(C.get(3).hasValue());
+
+  // Replacing a value destroys the previous one.
+  C.set(1, {"uno", 1});
+  EXPECT_EQ("uno", C.get(1)->Name);
+  EXPECT_EQ(1U, Counted::NumDestroyed);
+
+  EXPECT_TRUE(C.remove(2));
+  EXPECT_FALSE(C.remove(2));
+  EXPECT_FALSE(C.get(2).hasValue());
+  EXPECT_EQ(2U, Counted::NumDestroyed);
+
+  C.clear();
+  EXPECT_FALSE(C.get(1).hasValue());
+  EXPECT_EQ(3U, Counted::NumDestroyed);
+}
+
+#if !defined(__APPLE__)
+
+TEST_F(CacheTest, Stats) {
+  CountedCache C("swift.test.Cache");
+  C.set(1, {"one", 10});
+  C.set(2, {"two", 20});
+  (void)C.get(1);
+  (void)C.get(1);
+  (void)C.get(3);
+
+  CacheStats Stats = C.getStats();
+  EXPECT_EQ(2U, Stats.Hits);
+  EXPECT_EQ(1U, Stats.Misses);
+  EXPECT_EQ(0U, Stats.Evictions);
+  EXPECT_EQ(2U, Stats.Count);
+  EXPECT_EQ(30U, Stats.TotalCost);
+}
+
+TEST_F(CacheTest, EvictsToCostLimit) {
+  CountedCache C("swift.test.Cache");
+  C.setCostLimit(100);
+  for (int i = 0; i != 50; ++i)
+    C.set(i, {std::to_string(i), 10});
+
+  CacheStats Stats = C.getStats();
+  EXPECT_LE(Stats.TotalCost, 100U);
+  EXPECT_EQ(Stats.TotalCost / 10, Stats.Count);
+  EXPECT_EQ(50U - Stats.Count, Stats.Evictions);
+  EXPECT_EQ(Stats.Evictions, Counted::NumDestroyed);
+
+  // Lowering the limit evicts right away.
+  C.setCostLimit(30);
+  EXPECT_LE(C.getStats().TotalCost, 30U);
+}
+
+TEST_F(CacheTest, KeepsRecentlyUsedEntries) {
+  CountedCache C("swift.test.Cache");
+  C.setCostLimit(100);
+  C.set(0, {"hot", 10});
+  for (int i = 1; i != 200; ++i) {
+    ASSERT_TRUE(C.get(0).hasValue()) << "evicted after " << i << " inserts";
+    C.set(i, {std::to_string(i), 10});
+  }
+}
+
+TEST_F(CacheTest, ConcurrentAccess) {
+  {
+    CountedCache C("swift.test.Cache");
+    C.setCostLimit(64);
+
+    std::vector<std::thread> Threads;
+    for (int t = 0; t != 8; ++t) {
+      Threads.emplace_back([&C, t] {
+        for (int i = 0; i != 2000; ++i) {
+          int Key = (i * 7 + t) % 97;
+          if (auto V = C.get(Key))
+            EXPECT_EQ(std::to_string(Key), V->Name);
+          else
+            C.set(Key, {std::to_string(Key), 1});
+          if (i % 100 == 0)
+            C.remove(Key);
+        }
+      });
+    }
+    for (auto &Thread : Threads)
+      Thread.join();
+
+    // Values retained by other threads can keep the cache over its limit for
+    // a while; evict them now that nothing is retained.
+    C.setCostLimit(64);
+    CacheStats Stats = C.getStats();
+    EXPECT_LE(Stats.TotalCost, 64U);
+    EXPECT_EQ(Stats.TotalCost, Stats.Count);
+  }
+  // Every value that entered the cache was destroyed exactly once.
+  EXPECT_EQ(Counted::NumCreated, Counted::NumDestroyed);
+}
+
+#endif
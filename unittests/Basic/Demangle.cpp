@@ -1,5 +1,11 @@
+#include "swift/Basic/Demangle.h"
 #include "swift/Basic/DemangleWrappers.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "gtest/gtest.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 
 using namespace swift::demangle_wrappers;
 
@@ -11,3 +17,127 @@ TEST(Demangle, DemangleWrappers) {
       demangleSymbolAsString(MangledName));
 }
 
+/// A sample of the manglings in test/Demangle/Inputs/manglings.txt.
+static const char *const Manglings[] = {
+  "_TtBw",
+  "_TtSa",
+  "_TtSS",
+  "_TtCSo8NSObject",
+  "_TtKSiSu",
+  "_TtRSi",
+  "_Ttu_z_rFxqd0__",
+  "_TtuRxs8RuncibleWx5Mince6Quince_zxrFxx",
+  "_TF3foolO3barSi",
+  "_TFC3foo3bar3basfT3zimCS_3zim_T_",
+  "_TFC3foo3barCfT_S0_",
+  "_TMC3foo3bar",
+  "_TwXXC3foo3bar",
+  "_TwprC3foo3bar",
+  "_TWlC3foo3barS0_S_8barrableS_",
+  "_TIF1t1fFT1iSi1sSS_T_A_",
+  "_TtXoC10attributes10SwiftClass",
+  "_TTRXFo_dSi_dGSqSi__XFo_iSi_iGSqSi__",
+  "_TFCSo1Ae",
+  "_TF8manglingX30Proprostnemluvesky_uybCEdmaEBaFT_T_",
+  "_TF8manglingoi2qqFTSiSi_T_",
+  "_TTSf1cpfr24_TF8capturep6helperFSiT__n___TTRXFo_dSi_dT__XFo_iSi_dT__",
+  "_TTSf3d_i_n_i_d_i___TFVs11_StringCoreCfVs13_StringBufferS_",
+  "_TFC3red11BaseClassEHcfzT1aSi_S0_",
+};
+
+TEST(Demangle, DemanglerMatchesNodeFactory) {
+  using namespace swift::Demangle;
+  using swift::Demangle::nodeToString;
+
+  Demangler Dem;
+  for (const char *Mangled : Manglings) {
+    Dem.reset();
+    NodePointer ArenaRoot = Dem.demangleSymbol(Mangled);
+    NodePointer HeapRoot = demangleSymbolAsNode(Mangled, strlen(Mangled));
+    ASSERT_TRUE(ArenaRoot != nullptr) << Mangled;
+    ASSERT_TRUE(HeapRoot != nullptr) << Mangled;
+    EXPECT_EQ(nodeToString(HeapRoot), nodeToString(ArenaRoot)) << Mangled;
+    EXPECT_EQ(mangleNode(HeapRoot), mangleNode(ArenaRoot)) << Mangled;
+  }
+
+  // Text that is part of the mangled name is not copied.
+  Dem.reset();
+  llvm::StringRef Mangled = "_TtC3foo3bar";
+  NodePointer Root = Dem.demangleType(Mangled.drop_front(3));
+  ASSERT_TRUE(Root != nullptr);
+  NodePointer Class = Root->getFirstChild();
+  ASSERT_EQ(Node::Kind::Class, Class->getKind());
+  llvm::StringRef Name = Class->getChild(1)->getText();
+  EXPECT_EQ("bar", Name);
+  EXPECT_EQ(Mangled.end(), Name.end());
+}
+
+TEST(Demangle, DemanglerNodesOutliveArena) {
+  using namespace swift::Demangle;
+  using swift::Demangle::nodeToString;
+
+  const char *Mangled = "_TFC3foo3bar3basfT3zimCS_3zim_T_";
+  std::string Expected = nodeToString(
+      demangleSymbolAsNode(Mangled, strlen(Mangled)));
+
+  NodePointer Kept, Created;
+  {
+    Demangler Dem;
+    Kept = Dem.demangleSymbol(Mangled);
+    ASSERT_TRUE(Kept != nullptr);
+
+    // Resetting while a tree is referenced must not reuse its memory.
+    Dem.reset();
+    Created = Dem.createNode(Node::Kind::Identifier,
+                             std::string("not in the mangled name"));
+    NodePointer Other = Dem.demangleSymbol(Manglings[0]);
+    ASSERT_TRUE(Other != nullptr);
+    EXPECT_EQ(Expected, nodeToString(Kept));
+  }
+
+  // Nor must destroying the Demangler free it.
+  EXPECT_EQ(Expected, nodeToString(Kept));
+  EXPECT_EQ("not in the mangled name", Created->getText());
+}
+
+// Demangling with a reused Demangler should be considerably faster than
+// building the tree node by node on the heap.
+TEST(Demangle, DISABLED_DemanglerBenchmark) {
+  using namespace swift::Demangle;
+
+  auto Buffer = llvm::MemoryBuffer::getFile(SWIFT_DEMANGLE_MANGLINGS_FILE);
+  ASSERT_TRUE(bool(Buffer)) << SWIFT_DEMANGLE_MANGLINGS_FILE;
+
+  std::vector<std::string> Inputs;
+  llvm::SmallVector<llvm::StringRef, 256> Lines;
+  (*Buffer)->getBuffer().split(Lines, '\n', -1, /*KeepEmpty=*/false);
+  for (llvm::StringRef Line : Lines) {
+    llvm::StringRef Mangled = Line.split(" ---> ").first.trim();
+    if (!Mangled.empty())
+      Inputs.push_back(Mangled.str());
+  }
+  ASSERT_FALSE(Inputs.empty());
+
+  const unsigned Iterations = 200;
+  auto Start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < Iterations; ++i)
+    for (const std::string &Mangled : Inputs)
+      demangleSymbolAsNode(Mangled);
+  auto HeapTime = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - Start).count();
+
+  Demangler Dem;
+  Start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < Iterations; ++i) {
+    for (const std::string &Mangled : Inputs) {
+      Dem.reset();
+      Dem.demangleSymbol(Mangled);
+    }
+  }
+  auto ArenaTime = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - Start).count();
+
+  double Count = double(Iterations) * Inputs.size();
+  printf("demangleSymbolAsNode: %8.1f ns/symbol\n", HeapTime * 1e9 / Count);
+  printf("Demangler:            %8.1f ns/symbol\n", ArenaTime * 1e9 / Count);
+}
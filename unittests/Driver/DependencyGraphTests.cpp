@@ -1,7 +1,14 @@
 #include "swift/Driver/DependencyGraph.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
 
 using namespace swift;
+using namespace llvm::sys;
 using LoadResult = DependencyGraphImpl::LoadResult;
 
 TEST(DependencyGraph, BasicLoad) {
@@ -790,3 +797,255 @@ TEST(DependencyGraph, ChainedExternalPreMarked) {
   EXPECT_TRUE(graph.isMarked(0));
   EXPECT_FALSE(graph.isMarked(1));
 }
+
+/// Writes \p contents to \p path and backdates it, so that a summary written
+/// now will trust it.
+static void writeBackdatedFile(StringRef path, StringRef contents,
+                               TimeValue modTime) {
+  int fd;
+  ASSERT_FALSE(fs::openFileForWrite(path, fd, fs::F_None));
+  llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+  out << contents;
+  out.flush();
+  ASSERT_FALSE(fs::setLastModificationAndAccessTime(fd, modTime));
+}
+
+static TimeValue getAnHourAgo() {
+  TimeValue result = TimeValue::now();
+  result -= TimeValue(60 * 60);
+  return result;
+}
+
+TEST(DependencyGraph, SummaryCache) {
+  SmallString<128> dirPath;
+  ASSERT_FALSE(fs::createUniqueDirectory("DependencyGraph-test", dirPath));
+
+  SmallString<128> pathA = dirPath, pathB = dirPath, summaryPath = dirPath;
+  path::append(pathA, "a.swiftdeps");
+  path::append(pathB, "b.swiftdeps");
+  path::append(summaryPath, "main.depsummary");
+
+  TimeValue modTime = getAnHourAgo();
+  writeBackdatedFile(pathA,
+                     "interface-hash: \"abc\"\n"
+                     "provides-top-level: [a]\n"
+                     "provides-member: [[x, y]]\n"
+                     "depends-top-level: [b, !private c]\n",
+                     modTime);
+  writeBackdatedFile(pathB,
+                     "provides-top-level: [b]\n"
+                     "depends-member: [[x, y]]\n"
+                     "depends-external: [/foo]\n",
+                     modTime);
+
+  {
+    DependencyGraph<uintptr_t> graph;
+    EXPECT_FALSE(graph.loadSummaryCache(summaryPath));
+    EXPECT_EQ(graph.loadFromPath(0, pathA), LoadResult::UpToDate);
+    EXPECT_EQ(graph.loadFromPath(1, pathB), LoadResult::UpToDate);
+    EXPECT_TRUE(graph.writeSummaryCache(summaryPath));
+  }
+
+  // Replace a.swiftdeps with garbage of the same size and timestamp. The
+  // summary should be used in its place.
+  uint64_t sizeA;
+  ASSERT_FALSE(fs::file_size(pathA, sizeA));
+  writeBackdatedFile(pathA, std::string(sizeA, '['), modTime);
+
+  {
+    DependencyGraph<uintptr_t> graph;
+    EXPECT_TRUE(graph.loadSummaryCache(summaryPath));
+    EXPECT_EQ(graph.loadFromPath(0, pathA), LoadResult::UpToDate);
+    EXPECT_EQ(graph.loadFromPath(1, pathB), LoadResult::UpToDate);
+
+    SmallVector<uintptr_t, 4> marked;
+    graph.markTransitive(marked, 0);
+    EXPECT_EQ(1u, marked.size());
+    EXPECT_EQ(1u, marked.front());
+
+    marked.clear();
+    DependencyGraph<uintptr_t> externalGraph;
+    EXPECT_TRUE(externalGraph.loadSummaryCache(summaryPath));
+    EXPECT_EQ(externalGraph.loadFromPath(1, pathB), LoadResult::UpToDate);
+    EXPECT_EQ(1, std::distance(externalGraph.getExternalDependencies().begin(),
+                               externalGraph.getExternalDependencies().end()));
+    EXPECT_EQ("/foo", *externalGraph.getExternalDependencies().begin());
+
+    // Loading the same file again in one build always rereads it.
+    EXPECT_EQ(graph.loadFromPath(0, pathA), LoadResult::HadError);
+  }
+
+  // Without the summary, the garbage is noticed.
+  {
+    DependencyGraph<uintptr_t> graph;
+    EXPECT_EQ(graph.loadFromPath(0, pathA), LoadResult::HadError);
+  }
+
+  // Once the file changes, the summary is no longer trusted.
+  writeBackdatedFile(pathA, "[", modTime);
+  {
+    DependencyGraph<uintptr_t> graph;
+    EXPECT_TRUE(graph.loadSummaryCache(summaryPath));
+    EXPECT_EQ(graph.loadFromPath(0, pathA), LoadResult::HadError);
+  }
+
+  EXPECT_FALSE(fs::remove(pathA));
+  EXPECT_FALSE(fs::remove(pathB));
+  EXPECT_FALSE(fs::remove(summaryPath));
+  EXPECT_FALSE(fs::remove(dirPath));
+}
+
+TEST(DependencyGraph, SummaryCacheIgnoresRecentFiles) {
+  SmallString<128> dirPath;
+  ASSERT_FALSE(fs::createUniqueDirectory("DependencyGraph-test", dirPath));
+
+  SmallString<128> pathA = dirPath, summaryPath = dirPath;
+  path::append(pathA, "a.swiftdeps");
+  path::append(summaryPath, "main.depsummary");
+
+  // A file modified in the same second the summary is written might change
+  // again without its timestamp changing.
+  TimeValue modTime = TimeValue::now();
+  modTime += TimeValue(60 * 60);
+  writeBackdatedFile(pathA, "provides-top-level: [a]\n", modTime);
+
+  {
+    DependencyGraph<uintptr_t> graph;
+    EXPECT_EQ(graph.loadFromPath(0, pathA), LoadResult::UpToDate);
+    EXPECT_TRUE(graph.writeSummaryCache(summaryPath));
+  }
+
+  writeBackdatedFile(pathA, "[[[[[[[[[[[[[[[[[[[[[[[\n", modTime);
+  {
+    DependencyGraph<uintptr_t> graph;
+    EXPECT_TRUE(graph.loadSummaryCache(summaryPath));
+    EXPECT_EQ(graph.loadFromPath(0, pathA), LoadResult::HadError);
+  }
+
+  EXPECT_FALSE(fs::remove(pathA));
+  EXPECT_FALSE(fs::remove(summaryPath));
+  EXPECT_FALSE(fs::remove(dirPath));
+}
+
+TEST(DependencyGraph, SummaryCacheMatchesParsedGraph) {
+  // A graph loaded from the summary must mark the same jobs as one parsed
+  // from the dependency files themselves.
+  const unsigned fileCount = 16;
+  SmallString<128> dirPath;
+  ASSERT_FALSE(fs::createUniqueDirectory("DependencyGraph-test", dirPath));
+  TimeValue modTime = getAnHourAgo();
+
+  std::vector<std::string> paths;
+  for (unsigned i = 0; i < fileCount; ++i) {
+    std::string contents;
+    llvm::raw_string_ostream out(contents);
+    out << "interface-hash: \"" << i << "\"\n";
+    out << "provides-top-level: [name" << i << "]\n";
+    out << "provides-member: [[Type" << i << ", member]]\n";
+    if (i % 3 != 0)
+      out << "depends-top-level: [name" << (i + 1) % fileCount << "]\n";
+    out << "depends-member: [[Type" << (i * 5) % fileCount << ", member]]\n";
+    out.flush();
+
+    SmallString<128> filePath = dirPath;
+    path::append(filePath, "file" + std::to_string(i) + ".swiftdeps");
+    writeBackdatedFile(filePath, contents, modTime);
+    paths.push_back(filePath.str());
+  }
+
+  SmallString<128> summaryPath = dirPath;
+  path::append(summaryPath, "main.depsummary");
+  {
+    DependencyGraph<uintptr_t> graph;
+    for (unsigned i = 0; i < fileCount; ++i)
+      EXPECT_EQ(graph.loadFromPath(i, paths[i]), LoadResult::UpToDate);
+    EXPECT_TRUE(graph.writeSummaryCache(summaryPath));
+  }
+
+  auto getMarked = [&](unsigned changed, bool useSummary) {
+    DependencyGraph<uintptr_t> graph;
+    if (useSummary)
+      EXPECT_TRUE(graph.loadSummaryCache(summaryPath));
+    for (unsigned i = 0; i < fileCount; ++i)
+      EXPECT_EQ(graph.loadFromPath(i, paths[i]), LoadResult::UpToDate);
+    SmallVector<uintptr_t, 16> marked;
+    graph.markTransitive(marked, changed);
+    std::sort(marked.begin(), marked.end());
+    return marked;
+  };
+
+  for (unsigned i = 0; i < fileCount; ++i)
+    EXPECT_EQ(getMarked(i, /*useSummary=*/false),
+              getMarked(i, /*useSummary=*/true));
+
+  for (auto &path : paths)
+    EXPECT_FALSE(fs::remove(path));
+  EXPECT_FALSE(fs::remove(summaryPath));
+  EXPECT_FALSE(fs::remove(dirPath));
+}
+
+TEST(DependencyGraph, DISABLED_SummaryCacheLoadTime) {
+  // Not a correctness test: report how long it takes to load the graph for
+  // a module of a given size, with and without a summary.
+  const unsigned namesPerFile = 32;
+  TimeValue modTime = getAnHourAgo();
+
+  for (unsigned fileCount : {128, 512, 2048}) {
+    SmallString<128> dirPath;
+    ASSERT_FALSE(fs::createUniqueDirectory("DependencyGraph-test", dirPath));
+
+    std::vector<std::string> paths;
+    for (unsigned i = 0; i < fileCount; ++i) {
+      std::string contents;
+      llvm::raw_string_ostream out(contents);
+      out << "interface-hash: \"" << i << "\"\n";
+      out << "provides-top-level: [";
+      for (unsigned j = 0; j < namesPerFile; ++j)
+        out << (j ? ", " : "") << "name_" << i << "_" << j;
+      out << "]\n";
+      out << "depends-top-level: [";
+      for (unsigned j = 0; j < namesPerFile; ++j)
+        out << (j ? ", " : "") << "name_" << ((i * 7 + j) % fileCount) << "_"
+            << j;
+      out << "]\n";
+      out << "depends-member: [";
+      for (unsigned j = 0; j < namesPerFile; ++j)
+        out << (j ? ", " : "") << "[Type" << j << ", member" << i << "]";
+      out << "]\n";
+      out.flush();
+
+      SmallString<128> filePath = dirPath;
+      path::append(filePath, "file" + std::to_string(i) + ".swiftdeps");
+      writeBackdatedFile(filePath, contents, modTime);
+      paths.push_back(filePath.str());
+    }
+
+    SmallString<128> summaryPath = dirPath;
+    path::append(summaryPath, "main.depsummary");
+
+    auto loadAll = [&](bool useSummary) -> double {
+      auto start = std::chrono::steady_clock::now();
+      DependencyGraph<uintptr_t> graph;
+      if (useSummary)
+        EXPECT_TRUE(graph.loadSummaryCache(summaryPath));
+      for (unsigned i = 0; i < fileCount; ++i)
+        EXPECT_EQ(graph.loadFromPath(i, paths[i]), LoadResult::UpToDate);
+      std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      if (!useSummary)
+        EXPECT_TRUE(graph.writeSummaryCache(summaryPath));
+      return elapsed.count();
+    };
+
+    double parseTime = loadAll(/*useSummary=*/false);
+    double summaryTime = loadAll(/*useSummary=*/true);
+    llvm::outs() << fileCount << " files: "
+                 << llvm::format("%.1f", parseTime) << " ms parsing, "
+                 << llvm::format("%.1f", summaryTime) << " ms from summary\n";
+
+    for (auto &path : paths)
+      EXPECT_FALSE(fs::remove(path));
+    EXPECT_FALSE(fs::remove(summaryPath));
+    EXPECT_FALSE(fs::remove(dirPath));
+  }
+}
@@ -0,0 +1,226 @@
+#include "swift/Reflection/Reader.h"
+#include "gtest/gtest.h"
+
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace swift::reflection;
+
+namespace {
+
+/// A MemoryReader over a buffer at a fixed address that counts the requests
+/// it gets. Reads that go past the end of the buffer, or touch one of the
+/// bytes in FailingAddresses, fail.
+class FakeMemoryReader final : public MemoryReader {
+public:
+  const addr_t Base = 0x10000;
+
+  std::vector<uint8_t> Memory;
+  std::set<addr_t> FailingAddresses;
+
+  /// The (address, size) of every readBytes() call.
+  std::vector<std::pair<addr_t, uint64_t>> Reads;
+  unsigned NumStringReads = 0;
+
+  explicit FakeMemoryReader(size_t Size) : Memory(Size) {
+    for (size_t i = 0; i < Size; ++i)
+      Memory[i] = static_cast<uint8_t>(i * 7 + 1);
+  }
+
+  void writeString(addr_t Address, const std::string &Str) {
+    memcpy(&Memory[Address - Base], Str.c_str(), Str.size() + 1);
+  }
+
+  uint8_t getPointerSize() override { return 8; }
+  uint8_t getSizeSize() override { return 8; }
+  addr_t getSymbolAddress(const std::string &Name) override { return 0; }
+
+  std::string readString(addr_t Address) override {
+    ++NumStringReads;
+    return std::string(
+        reinterpret_cast<const char *>(&Memory[Address - Base]));
+  }
+
+  bool readBytes(addr_t Address, uint8_t *Dest, uint64_t Size) override {
+    Reads.push_back({Address, Size});
+    if (Address < Base || Address + Size > Base + Memory.size())
+      return false;
+    auto Failing = FailingAddresses.lower_bound(Address);
+    if (Failing != FailingAddresses.end() && *Failing < Address + Size)
+      return false;
+    memcpy(Dest, &Memory[Address - Base], Size);
+    return true;
+  }
+};
+
+const uint64_t PageSize = 64;
+
+/// Reads \p Size bytes at \p Address through \p Reader and checks them
+/// against \p Fake's memory.
+void expectReadMatches(MemoryReader &Reader, FakeMemoryReader &Fake,
+                       addr_t Address, uint64_t Size) {
+  std::vector<uint8_t> Bytes(Size);
+  ASSERT_TRUE(Reader.readBytes(Address, Bytes.data(), Size));
+  EXPECT_TRUE(std::equal(Bytes.begin(), Bytes.end(),
+                         Fake.Memory.begin() + (Address - Fake.Base)));
+}
+
+} // end anonymous namespace
+
+TEST(CachingMemoryReader, ReadsWithinAPage) {
+  FakeMemoryReader Fake(8 * PageSize);
+  CachingMemoryReader Cache(Fake, PageSize);
+
+  expectReadMatches(Cache, Fake, Fake.Base + 8, 8);
+  expectReadMatches(Cache, Fake, Fake.Base + 16, 4);
+  expectReadMatches(Cache, Fake, Fake.Base + PageSize - 8, 8);
+
+  // The first read fetched the whole page; the others hit it.
+  ASSERT_EQ(1u, Fake.Reads.size());
+  EXPECT_EQ(Fake.Base, Fake.Reads[0].first);
+  EXPECT_EQ(PageSize, Fake.Reads[0].second);
+
+  auto &Stats = Cache.getStatistics();
+  EXPECT_EQ(3u, Stats.NumReads);
+  EXPECT_EQ(1u, Stats.NumUnderlyingReads);
+  EXPECT_EQ(1u, Stats.NumPageMisses);
+  EXPECT_EQ(2u, Stats.NumPageHits);
+}
+
+TEST(CachingMemoryReader, ReadsAcrossPages) {
+  FakeMemoryReader Fake(8 * PageSize);
+  CachingMemoryReader Cache(Fake, PageSize);
+
+  // Pages 1 to 3 are missing and fetched with a single read.
+  expectReadMatches(Cache, Fake, Fake.Base + PageSize + 10, 2 * PageSize);
+  ASSERT_EQ(1u, Fake.Reads.size());
+  EXPECT_EQ(Fake.Base + PageSize, Fake.Reads[0].first);
+  EXPECT_EQ(3 * PageSize, Fake.Reads[0].second);
+
+  // Pages 2 and 3 are cached, so only 4 and 5 are read.
+  expectReadMatches(Cache, Fake, Fake.Base + 2 * PageSize, 4 * PageSize);
+  ASSERT_EQ(2u, Fake.Reads.size());
+  EXPECT_EQ(Fake.Base + 4 * PageSize, Fake.Reads[1].first);
+  EXPECT_EQ(2 * PageSize, Fake.Reads[1].second);
+
+  // Page 0 and 6 are missing on either side of cached ones.
+  expectReadMatches(Cache, Fake, Fake.Base + 10, 6 * PageSize);
+  ASSERT_EQ(4u, Fake.Reads.size());
+  EXPECT_EQ(Fake.Base, Fake.Reads[2].first);
+  EXPECT_EQ(PageSize, Fake.Reads[2].second);
+  EXPECT_EQ(Fake.Base + 6 * PageSize, Fake.Reads[3].first);
+  EXPECT_EQ(PageSize, Fake.Reads[3].second);
+}
+
+TEST(CachingMemoryReader, EvictsLeastRecentlyUsed) {
+  FakeMemoryReader Fake(8 * PageSize);
+  CachingMemoryReader Cache(Fake, PageSize, /*MaxPages=*/3);
+
+  expectReadMatches(Cache, Fake, Fake.Base, 4);
+  expectReadMatches(Cache, Fake, Fake.Base + PageSize, 4);
+  expectReadMatches(Cache, Fake, Fake.Base + 2 * PageSize, 4);
+  EXPECT_EQ(3u, Fake.Reads.size());
+
+  // Use page 0 again, so that page 1 is the least recently used when page 3
+  // needs room.
+  expectReadMatches(Cache, Fake, Fake.Base + 8, 4);
+  expectReadMatches(Cache, Fake, Fake.Base + 3 * PageSize, 4);
+  EXPECT_EQ(4u, Fake.Reads.size());
+
+  expectReadMatches(Cache, Fake, Fake.Base + 16, 4);
+  expectReadMatches(Cache, Fake, Fake.Base + 2 * PageSize + 16, 4);
+  expectReadMatches(Cache, Fake, Fake.Base + 3 * PageSize + 16, 4);
+  EXPECT_EQ(4u, Fake.Reads.size());
+
+  expectReadMatches(Cache, Fake, Fake.Base + PageSize + 16, 4);
+  ASSERT_EQ(5u, Fake.Reads.size());
+  EXPECT_EQ(Fake.Base + PageSize, Fake.Reads[4].first);
+}
+
+TEST(CachingMemoryReader, LargeReadsBypassCache) {
+  FakeMemoryReader Fake(8 * PageSize);
+  CachingMemoryReader Cache(Fake, PageSize, /*MaxPages=*/4);
+
+  expectReadMatches(Cache, Fake, Fake.Base + 1, 4 * PageSize);
+  ASSERT_EQ(1u, Fake.Reads.size());
+  EXPECT_EQ(Fake.Base + 1, Fake.Reads[0].first);
+  EXPECT_EQ(4 * PageSize, Fake.Reads[0].second);
+
+  // Nothing was cached.
+  expectReadMatches(Cache, Fake, Fake.Base + 1, 4);
+  EXPECT_EQ(2u, Fake.Reads.size());
+}
+
+TEST(CachingMemoryReader, ReadStringAcrossPages) {
+  FakeMemoryReader Fake(8 * PageSize);
+  CachingMemoryReader Cache(Fake, PageSize);
+
+  std::string Long(2 * PageSize, 'x');
+  Fake.writeString(Fake.Base + PageSize - 5, Long);
+  Fake.writeString(Fake.Base + 5 * PageSize + 3, "short");
+
+  EXPECT_EQ(Long, Cache.readString(Fake.Base + PageSize - 5));
+  EXPECT_EQ(3u, Fake.Reads.size());
+  EXPECT_EQ("short", Cache.readString(Fake.Base + 5 * PageSize + 3));
+  EXPECT_EQ(4u, Fake.Reads.size());
+
+  // The string's pages are cached now.
+  EXPECT_EQ(Long.substr(10), Cache.readString(Fake.Base + PageSize + 5));
+  EXPECT_EQ(4u, Fake.Reads.size());
+  EXPECT_EQ(0u, Fake.NumStringReads);
+}
+
+TEST(CachingMemoryReader, FallsBackOnFailedPageReads) {
+  // The memory ends in the middle of the last page, so reading that page as
+  // a whole fails.
+  FakeMemoryReader Fake(4 * PageSize + 16);
+  CachingMemoryReader Cache(Fake, PageSize);
+
+  expectReadMatches(Cache, Fake, Fake.Base + 4 * PageSize, 16);
+  ASSERT_EQ(2u, Fake.Reads.size());
+  EXPECT_EQ(Fake.Base + 4 * PageSize, Fake.Reads[0].first);
+  EXPECT_EQ(PageSize, Fake.Reads[0].second);
+  EXPECT_EQ(Fake.Base + 4 * PageSize, Fake.Reads[1].first);
+  EXPECT_EQ(16u, Fake.Reads[1].second);
+
+  // A read that spans into it falls back as a whole, too.
+  expectReadMatches(Cache, Fake, Fake.Base + 3 * PageSize + 8, PageSize);
+  ASSERT_EQ(4u, Fake.Reads.size());
+  EXPECT_EQ(Fake.Base + 3 * PageSize + 8, Fake.Reads[3].first);
+  EXPECT_EQ(PageSize, Fake.Reads[3].second);
+
+  // Strings are read directly as well.
+  Fake.writeString(Fake.Base + 4 * PageSize + 2, "tail");
+  EXPECT_EQ("tail", Cache.readString(Fake.Base + 4 * PageSize + 2));
+  EXPECT_EQ(1u, Fake.NumStringReads);
+
+  // Reads that fail in the underlying reader still fail.
+  Fake.FailingAddresses.insert(Fake.Base + PageSize + 4);
+  uint8_t Byte;
+  EXPECT_FALSE(Cache.readBytes(Fake.Base + PageSize + 4, &Byte, 1));
+  EXPECT_TRUE(Cache.readBytes(Fake.Base + 3 * PageSize, &Byte, 1));
+  EXPECT_FALSE(Cache.readBytes(Fake.Base + 8 * PageSize, &Byte, 1));
+}
+
+TEST(CachingMemoryReader, Invalidate) {
+  FakeMemoryReader Fake(4 * PageSize);
+  CachingMemoryReader Cache(Fake, PageSize);
+
+  uint8_t Byte;
+  ASSERT_TRUE(Cache.readBytes(Fake.Base + 3, &Byte, 1));
+  EXPECT_EQ(Fake.Memory[3], Byte);
+
+  // The cache is a snapshot until it is invalidated.
+  uint8_t Old = Fake.Memory[3];
+  Fake.Memory[3] = Old + 1;
+  ASSERT_TRUE(Cache.readBytes(Fake.Base + 3, &Byte, 1));
+  EXPECT_EQ(Old, Byte);
+  EXPECT_EQ(1u, Fake.Reads.size());
+
+  Cache.invalidate();
+  ASSERT_TRUE(Cache.readBytes(Fake.Base + 3, &Byte, 1));
+  EXPECT_EQ(Old + 1, Byte);
+  EXPECT_EQ(2u, Fake.Reads.size());
+}
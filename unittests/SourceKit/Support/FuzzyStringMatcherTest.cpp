@@ -315,4 +315,21 @@ TEST(FuzzyStringMatcher, ShortUnconnectedMatches) {
   FuzzyStringMatcher m("abcd");
   EXPECT_GT(m.scoreCandidate("xaxbxcdxxxxxx"), m.scoreCandidate("xaxbxcxd"));
   EXPECT_GT(m.scoreCandidate("xaxbxc_d"), m.scoreCandidate("xaxbxcxd"));
-}
\ No newline at end of file
+}
+
+TEST(FuzzyStringMatcher, CharacterClassPrefilter) {
+  FuzzyStringMatcher m("aZ9_");
+  EXPECT_TRUE(m.mayMatchCandidateMask(
+      FuzzyStringMatcher::getCharacterClassMask("xA_z9")));
+  EXPECT_FALSE(m.mayMatchCandidateMask(
+      FuzzyStringMatcher::getCharacterClassMask("az_")));
+  EXPECT_FALSE(m.mayMatchCandidateMask(
+      FuzzyStringMatcher::getCharacterClassMask("")));
+  EXPECT_TRUE(m.matchesCandidate("xaxzx9x_"));
+  EXPECT_FALSE(m.matchesCandidate("xaxzxxx_"));
+
+  // Non-ASCII bytes are opaque but still have to be present.
+  FuzzyStringMatcher n("\xC3\xA9");
+  EXPECT_TRUE(n.matchesCandidate("caf\xC3\xA9"));
+  EXPECT_FALSE(n.matchesCandidate("cafe"));
+}
@@ -0,0 +1,236 @@
+//===----------------------------------------------------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "SourceKit/Support/Concurrency.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#endif
+
+using namespace SourceKit;
+
+namespace {
+
+/// Lets a test wait until a number of dispatched blocks have run.
+class Counter {
+  std::mutex Mtx;
+  std::condition_variable Cond;
+  unsigned Count = 0;
+
+public:
+  void increment() {
+    std::lock_guard<std::mutex> Guard(Mtx);
+    ++Count;
+    Cond.notify_all();
+  }
+
+  bool waitFor(unsigned Expected) {
+    std::unique_lock<std::mutex> Guard(Mtx);
+    return Cond.wait_for(Guard, std::chrono::seconds(30),
+                         [&] { return Count >= Expected; });
+  }
+};
+
+} // end anonymous namespace
+
+TEST(WorkQueue, SerialRunsInOrder) {
+  WorkQueue Queue(WorkQueue::Dequeuing::Serial, "sourcekit.test.serial");
+  std::vector<int> Order;
+  std::atomic<unsigned> Running{0};
+  Counter Done;
+
+  for (int i = 0; i != 100; ++i) {
+    Queue.dispatch([&, i] {
+      EXPECT_EQ(1U, ++Running);
+      Order.push_back(i);
+      --Running;
+      Done.increment();
+    });
+  }
+  ASSERT_TRUE(Done.waitFor(100));
+
+  ASSERT_EQ(100U, Order.size());
+  for (int i = 0; i != 100; ++i)
+    EXPECT_EQ(i, Order[i]);
+}
+
+TEST(WorkQueue, DispatchSync) {
+  WorkQueue Queue(WorkQueue::Dequeuing::Serial, "sourcekit.test.sync");
+  std::atomic<bool> Ran{false};
+  Queue.dispatch([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    Ran = true;
+  });
+
+  // Runs after the asynchronous block, on a large enough stack if asked to.
+  bool SawRan = false;
+  Queue.dispatchSync([&] { SawRan = Ran; });
+  EXPECT_TRUE(SawRan);
+  Queue.dispatchSync([&] { SawRan = Ran; }, /*isStackDeep=*/true);
+  EXPECT_TRUE(SawRan);
+}
+
+TEST(WorkQueue, BarrierExcludesConcurrentBlocks) {
+  WorkQueue Queue(WorkQueue::Dequeuing::Concurrent, "sourcekit.test.barrier");
+  std::atomic<unsigned> Readers{0};
+  std::atomic<bool> Failed{false};
+  Counter Done;
+
+  for (int i = 0; i != 20; ++i) {
+    Queue.dispatch([&] {
+      ++Readers;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      --Readers;
+      Done.increment();
+    });
+    if (i % 5 == 0) {
+      Queue.dispatchBarrier([&] {
+        if (Readers != 0)
+          Failed = true;
+        Done.increment();
+      });
+    }
+  }
+  Queue.dispatchBarrierSync([&] {
+    if (Readers != 0)
+      Failed = true;
+  });
+
+  EXPECT_TRUE(Done.waitFor(24));
+  EXPECT_FALSE(Failed);
+}
+
+TEST(WorkQueue, SuspendResume) {
+  WorkQueue Queue(WorkQueue::Dequeuing::Serial, "sourcekit.test.suspend");
+  std::atomic<bool> Ran{false};
+  Counter Done;
+
+  Queue.suspend();
+  Queue.dispatch([&] {
+    Ran = true;
+    Done.increment();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(Ran);
+
+  Queue.resume();
+  EXPECT_TRUE(Done.waitFor(1));
+  EXPECT_TRUE(Ran);
+}
+
+TEST(WorkQueue, QueueOutlivedByItsBlocks) {
+  Counter Done;
+  {
+    WorkQueue Queue(WorkQueue::Dequeuing::Serial, "sourcekit.test.lifetime");
+    for (int i = 0; i != 10; ++i)
+      Queue.dispatch([&] { Done.increment(); });
+  }
+  EXPECT_TRUE(Done.waitFor(10));
+}
+
+TEST(WorkQueue, BackgroundWorkLeavesRoomForOtherWork) {
+  std::mutex Mtx;
+  std::condition_variable Cond;
+  bool Release = false;
+  Counter Done;
+  unsigned NumBlocking = 4 * std::max(2U, std::thread::hardware_concurrency());
+
+  // Background blocks that wait until the high priority one has run.
+  for (unsigned i = 0; i != NumBlocking; ++i) {
+    WorkQueue::dispatchConcurrent([&] {
+      {
+        std::unique_lock<std::mutex> Guard(Mtx);
+        Cond.wait(Guard, [&] { return Release; });
+      }
+      Done.increment();
+    }, WorkQueue::Priority::Background);
+  }
+
+  WorkQueue::dispatchConcurrent([&] {
+    {
+      std::lock_guard<std::mutex> Guard(Mtx);
+      Release = true;
+    }
+    Cond.notify_all();
+    Done.increment();
+  }, WorkQueue::Priority::High);
+
+  EXPECT_TRUE(Done.waitFor(NumBlocking + 1));
+}
+
+#if defined(__linux__)
+static unsigned getNumThreads() {
+  unsigned Count = 0;
+  if (DIR *Tasks = opendir("/proc/self/task")) {
+    while (dirent *Entry = readdir(Tasks))
+      if (Entry->d_name[0] != '.')
+        ++Count;
+    closedir(Tasks);
+  }
+  return Count;
+}
+
+TEST(WorkQueue, SurplusThreadsExitWhenIdle) {
+  WorkQueue Queue(WorkQueue::Dequeuing::Serial, "sourcekit.test.surplus");
+  Queue.dispatchSync([] {});
+  unsigned NumThreadsBefore = getNumThreads();
+
+  // Occupy every thread of the pool, then have all of them wait for the same
+  // serial queue. Blocking in dispatchSync() with no idle threads left
+  // starts extra ones.
+  std::mutex Mtx;
+  std::condition_variable Cond;
+  unsigned NumStarted = 0;
+  std::atomic<unsigned> MaxNumThreads{0};
+  Counter Done;
+  unsigned Width = std::max(2U, std::thread::hardware_concurrency());
+  for (unsigned i = 0; i != Width; ++i) {
+    WorkQueue::dispatchConcurrent([&] {
+      {
+        std::unique_lock<std::mutex> Guard(Mtx);
+        if (++NumStarted == Width)
+          Cond.notify_all();
+        Cond.wait(Guard, [&] { return NumStarted == Width; });
+      }
+      Queue.dispatchSync([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        unsigned NumThreads = getNumThreads();
+        if (NumThreads > MaxNumThreads)
+          MaxNumThreads = NumThreads;
+      });
+      Done.increment();
+    });
+  }
+  ASSERT_TRUE(Done.waitFor(Width));
+  EXPECT_GT(MaxNumThreads, NumThreadsBefore);
+
+  // Once idle, the extra threads go away again.
+  auto Deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while (getNumThreads() > NumThreadsBefore &&
+         std::chrono::steady_clock::now() < Deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_LE(getNumThreads(), NumThreadsBefore);
+
+  // The pool still runs work afterwards.
+  Queue.dispatch([&] { Done.increment(); });
+  EXPECT_TRUE(Done.waitFor(Width + 1));
+}
+#endif
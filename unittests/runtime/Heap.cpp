@@ -0,0 +1,137 @@
+//===--- Heap.cpp - Thread-caching allocator tests ------------------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Runtime/HeapObject.h"
+#include "../../stdlib/public/runtime/HeapCache.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <cstring>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+using namespace swift;
+
+// The allocator is chosen once, at the runtime's first allocation, which is
+// why these tests have a binary of their own: nothing has allocated yet when
+// the first of them turns the thread caches on.
+class HeapCacheTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_TRUE(heapcache::requestThreadCache());
+  }
+};
+
+TEST_F(HeapCacheTest, Enabled) {
+  EXPECT_TRUE(heapcache::isEnabled());
+}
+
+TEST_F(HeapCacheTest, ReusesFreedBlocks) {
+  void *first = swift_slowAlloc(24, 7);
+  swift_slowDealloc(first, 24, 7);
+
+  // Any size of the same class gets the block back.
+  void *second = swift_slowAlloc(20, 7);
+  EXPECT_EQ(first, second);
+  swift_slowDealloc(second, 20, 7);
+
+  // Large requests bypass the cache.
+  void *large = swift_slowAlloc(heapcache::MaxCachedSize + 1, 7);
+  memset(large, 0, heapcache::MaxCachedSize + 1);
+  swift_slowDealloc(large, heapcache::MaxCachedSize + 1, 7);
+}
+
+TEST_F(HeapCacheTest, FreeOnOtherThreads) {
+  const size_t NumBlocks = 4 * heapcache::MaxBlocksPerClass;
+
+  // Blocks allocated here and freed by a thread that then exits.
+  std::vector<void *> blocks;
+  for (size_t i = 0; i < NumBlocks; ++i) {
+    size_t size = 1 + i % heapcache::MaxCachedSize;
+    blocks.push_back(swift_slowAlloc(size, 7));
+    memset(blocks.back(), 0xAB, size);
+  }
+  std::thread([&] {
+    for (size_t i = 0; i < NumBlocks; ++i)
+      swift_slowDealloc(blocks[i], 1 + i % heapcache::MaxCachedSize, 7);
+  }).join();
+
+  // Blocks allocated by threads that have exited and freed here.
+  blocks.clear();
+  std::vector<std::thread> threads;
+  std::vector<std::vector<void *>> threadBlocks(4);
+  for (auto &mine : threadBlocks) {
+    threads.emplace_back([&mine, NumBlocks] {
+      for (size_t i = 0; i < NumBlocks; ++i) {
+        void *block = swift_slowAlloc(32, 15);
+        memset(block, 0xCD, 32);
+        // Cycle some blocks through this thread's cache as well.
+        if (i % 2)
+          swift_slowDealloc(block, 32, 15);
+        else
+          mine.push_back(block);
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  for (auto &mine : threadBlocks) {
+    for (void *block : mine) {
+      EXPECT_EQ(0xCD, *static_cast<unsigned char *>(block));
+      swift_slowDealloc(block, 32, 15);
+    }
+  }
+}
+
+namespace {
+  pthread_key_t LateKey;
+  std::atomic<bool> LateDestructorRan{false};
+  std::atomic<bool> LateDestructorSawTornDownCache{false};
+
+  /// Allocates from a thread-specific data destructor after the thread's
+  /// cache has been destroyed.
+  void lateDestructor(void *value) {
+    // The first round of destructors may run before the cache's destructor;
+    // ask for a second round, which runs after it.
+    if (value == &LateKey) {
+      pthread_setspecific(LateKey, &LateDestructorRan);
+      return;
+    }
+
+    std::vector<void *> blocks;
+    for (size_t i = 0; i < 2 * heapcache::MaxBlocksPerClass; ++i)
+      blocks.push_back(swift_slowAlloc(48, 7));
+    for (void *block : blocks)
+      swift_slowDealloc(block, 48, 7);
+
+    LateDestructorSawTornDownCache =
+      pthread_getspecific(heapcache::ThreadCacheKey) ==
+      &heapcache::TornDownThreadCache;
+    LateDestructorRan = true;
+  }
+} // end anonymous namespace
+
+TEST_F(HeapCacheTest, AllocateDuringThreadExit) {
+  ASSERT_EQ(0, pthread_key_create(&LateKey, lateDestructor));
+
+  std::thread([] {
+    void *block = swift_slowAlloc(48, 7);
+    swift_slowDealloc(block, 48, 7);
+    pthread_setspecific(LateKey, &LateKey);
+  }).join();
+
+  EXPECT_TRUE(LateDestructorRan);
+  // The allocations went to malloc rather than into a new cache that would
+  // have leaked.
+  EXPECT_TRUE(LateDestructorSawTornDownCache);
+  pthread_key_delete(LateKey);
+}
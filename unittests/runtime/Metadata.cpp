@@ -12,9 +12,13 @@
 
 #include "swift/Runtime/Metadata.h"
 #include "swift/Runtime/Concurrent.h"
+#include "swift/Runtime/Debug.h"
 #include "gtest/gtest.h"
+#include <chrono>
+#include <cstring>
 #include <iterator>
 #include <functional>
+#include <memory>
 #include <sys/mman.h>
 #include <vector>
 #include <pthread.h>
@@ -225,6 +229,7 @@ TEST(Concurrent, ConcurrentMap) {
     int compareWithKey(size_t key) const {
       return (key == Key ? 0 : (key < Key ? -1 : 1));
     }
+    static size_t getKeyHash(size_t key) { return key; }
     static size_t getExtraAllocationSize(size_t key) { return 0; }
   };
 
@@ -248,6 +253,119 @@ TEST(Concurrent, ConcurrentMap) {
   }
 }
 
+TEST(Concurrent, ConcurrentMapGrowth) {
+  const size_t numElem = 10000;
+
+  struct Entry {
+    size_t Key;
+    Entry(size_t key) : Key(key) {}
+    int compareWithKey(size_t key) const {
+      return (key == Key ? 0 : (key < Key ? -1 : 1));
+    }
+    // Deliberately weak, so that many keys share a hash.
+    static size_t getKeyHash(size_t key) { return key & 0xFF; }
+    static size_t getExtraAllocationSize(size_t key) { return 0; }
+  };
+
+  ConcurrentMap<Entry> Map;
+
+  // Insert overlapping ranges from every thread, forcing the table to grow
+  // while other threads are probing it.
+  RaceTest<int*>(
+    [&]() -> int* {
+      for (size_t i = 0; i < numElem; i++) {
+        auto result = Map.getOrInsert(i);
+        EXPECT_EQ(i, result.first->Key);
+        EXPECT_EQ(result.first, Map.find(i));
+      }
+      return nullptr;
+    }
+  );
+
+  for (size_t i = 0; i < numElem; i++) {
+    auto entry = Map.find(i);
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(i, entry->Key);
+    EXPECT_FALSE(Map.getOrInsert(i).second);
+  }
+  EXPECT_FALSE(Map.find(numElem));
+}
+
+namespace {
+  struct PointerPairEntry {
+    const void *First, *Second;
+    PointerPairEntry(std::pair<const void *, const void *> key)
+      : First(key.first), Second(key.second) {}
+    int compareWithKey(std::pair<const void *, const void *> key) const {
+      if (key.first != First)
+        return (uintptr_t(key.first) < uintptr_t(First) ? -1 : 1);
+      if (key.second != Second)
+        return (uintptr_t(key.second) < uintptr_t(Second) ? -1 : 1);
+      return 0;
+    }
+    static size_t getKeyHash(std::pair<const void *, const void *> key) {
+      return uintptr_t(key.first) ^ (uintptr_t(key.second) >> 4);
+    }
+    static size_t
+    getExtraAllocationSize(std::pair<const void *, const void *> key) {
+      return 0;
+    }
+  };
+
+  /// Time a lookup-only workload over a conformance-cache-like map with
+  /// NumThreads readers, and print the aggregate lookup rate.
+  template <int NumThreads>
+  void measureConcurrentMapLookups(ConcurrentMap<PointerPairEntry> &map,
+                                   const std::vector<std::pair<const void *,
+                                                     const void *>> &keys) {
+    const size_t lookupsPerThread = 200000;
+
+    auto start = std::chrono::steady_clock::now();
+    RaceTest<int*, NumThreads>(
+      [&]() -> int* {
+        size_t found = 0;
+        for (size_t i = 0; i < lookupsPerThread; i++)
+          found += map.find(keys[(i * 7919) % keys.size()]) != nullptr;
+        EXPECT_EQ(lookupsPerThread, found);
+        return nullptr;
+      }
+    );
+    auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start).count();
+
+    printf("ConcurrentMap lookups: %2d threads: %8.2f Mlookups/s\n",
+           NumThreads, NumThreads * lookupsPerThread / elapsed / 1e6);
+  }
+}
+
+// Lookups must not write shared state, so the aggregate lookup rate should
+// grow with the number of threads rather than collapse.
+//
+// This is a benchmark, not a test; run it with
+// --gtest_also_run_disabled_tests.
+TEST(Concurrent, DISABLED_ConcurrentMapLookupScaling) {
+  // Keys that arrive in allocation order, which is the pattern that made
+  // a binary tree degenerate.
+  std::vector<std::pair<const void *, const void *>> keys;
+  std::vector<std::unique_ptr<char[]>> storage;
+  for (size_t i = 0; i < 4096; i++) {
+    storage.emplace_back(new char[32]);
+    keys.emplace_back(storage.back().get(), &Global1);
+  }
+
+  ConcurrentMap<PointerPairEntry> Map;
+  for (auto &key : keys)
+    EXPECT_TRUE(Map.getOrInsert(key).second);
+
+  measureConcurrentMapLookups<1>(Map, keys);
+  measureConcurrentMapLookups<2>(Map, keys);
+  measureConcurrentMapLookups<4>(Map, keys);
+  measureConcurrentMapLookups<8>(Map, keys);
+  measureConcurrentMapLookups<16>(Map, keys);
+  measureConcurrentMapLookups<32>(Map, keys);
+  measureConcurrentMapLookups<64>(Map, keys);
+}
+
 
 TEST(MetadataTest, getGenericMetadata) {
   auto metadataTemplate = (GenericMetadata*) &MetadataTest1;
@@ -289,6 +407,57 @@ TEST(MetadataTest, getGenericMetadata) {
     });
 }
 
+namespace {
+  /// Time NumThreads threads repeatedly looking up the same few instances
+  /// of a generic type, and print the average latency of one lookup.
+  template <int NumThreads>
+  void measureGenericMetadataLookups(GenericMetadata *pattern,
+                                     std::vector<void *> &keys) {
+    const size_t lookupsPerThread = 200000;
+
+    auto start = std::chrono::steady_clock::now();
+    RaceTest<int*, NumThreads>(
+      [&]() -> int* {
+        for (size_t i = 0; i < lookupsPerThread; i++) {
+          void *args[] = { keys[i % keys.size()] };
+          auto inst = swift_getGenericMetadata(pattern, args);
+          auto fields = reinterpret_cast<void * const *>(inst);
+          EXPECT_EQ(args[0], fields[2]);
+        }
+        return nullptr;
+      }
+    );
+    auto elapsed = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start).count();
+
+    printf("swift_getGenericMetadata: %2d threads: %8.1f ns/lookup/thread\n",
+           NumThreads, elapsed * 1e9 / lookupsPerThread);
+  }
+}
+
+// Lookups of already-instantiated metadata must not contend with each
+// other, so the per-lookup latency should stay flat as threads are added
+// (up to the number of cores).
+//
+// This is a benchmark, not a test; run it with
+// --gtest_also_run_disabled_tests.
+TEST(MetadataTest, DISABLED_getGenericMetadataContention) {
+  auto metadataTemplate = (GenericMetadata*) &MetadataTest1;
+
+  std::vector<void *> keys;
+  static uint32_t KeyStorage[8];
+  for (auto &key : KeyStorage)
+    keys.push_back(&key);
+
+  measureGenericMetadataLookups<1>(metadataTemplate, keys);
+  measureGenericMetadataLookups<2>(metadataTemplate, keys);
+  measureGenericMetadataLookups<4>(metadataTemplate, keys);
+  measureGenericMetadataLookups<8>(metadataTemplate, keys);
+  measureGenericMetadataLookups<16>(metadataTemplate, keys);
+  measureGenericMetadataLookups<32>(metadataTemplate, keys);
+  measureGenericMetadataLookups<64>(metadataTemplate, keys);
+}
+
 FullMetadata<ClassMetadata> MetadataTest2 = {
   { { nullptr }, { &_TWVBo } },
   { { { MetadataKind::Class } }, nullptr, 0, ClassFlags(), nullptr, 0, 0, 0, 0, 0 }
@@ -341,6 +510,40 @@ TEST(MetadataTest, getMetatypeMetadata) {
   ASSERT_EQ(inst1, inst5->InstanceType);
 }
 
+static MetadataAllocationStats getMetadataAllocationStats(const char *kind) {
+  MetadataAllocationStats stats[32];
+  size_t numKinds = swift_getMetadataAllocationStats(stats, 32, nullptr);
+  EXPECT_LE(numKinds, 32u);
+  for (size_t i = 0; i < numKinds; ++i)
+    if (strcmp(stats[i].Kind, kind) == 0)
+      return stats[i];
+  ADD_FAILURE() << "no statistics for " << kind;
+  return {kind, 0, 0};
+}
+
+TEST(MetadataTest, getMetadataAllocationStats) {
+  uint64_t mappedBefore;
+  swift_getMetadataAllocationStats(nullptr, 0, &mappedBefore);
+  auto before = getMetadataAllocationStats("MetatypeCache");
+
+  // Instantiate metatypes from several threads at once; each one is
+  // allocated once, whichever thread wins.
+  auto inst = RaceTest_ExpectEqual<const MetatypeMetadata *>(
+    [&]() -> const MetatypeMetadata * {
+      return swift_getMetatypeMetadata(&_TMBi8_.base);
+    });
+  ASSERT_EQ(&_TMBi8_.base, inst->InstanceType);
+
+  auto after = getMetadataAllocationStats("MetatypeCache");
+  EXPECT_EQ(before.NumAllocations + 1, after.NumAllocations);
+  EXPECT_LT(before.BytesAllocated, after.BytesAllocated);
+
+  uint64_t mappedAfter;
+  swift_getMetadataAllocationStats(nullptr, 0, &mappedAfter);
+  EXPECT_LE(mappedBefore, mappedAfter);
+  EXPECT_LE(after.BytesAllocated, mappedAfter);
+}
+
 ProtocolDescriptor ProtocolA{
   "_TMp8Metadata9ProtocolA",
   nullptr,
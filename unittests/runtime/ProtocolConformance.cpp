@@ -0,0 +1,89 @@
+//===--- ProtocolConformance.cpp - Conformance lookup tests ---------------===//
+//
+// This source file is part of the Swift.org open source project
+//
+// Copyright (c) 2014 - 2016 Apple Inc. and the Swift project authors
+// Licensed under Apache License v2.0 with Runtime Library Exception
+//
+// See http://swift.org/LICENSE.txt for license information
+// See http://swift.org/CONTRIBUTORS.txt for the list of Swift project authors
+//
+//===----------------------------------------------------------------------===//
+
+#include "swift/Runtime/Metadata.h"
+#include "gtest/gtest.h"
+#include <cstdint>
+
+using namespace swift;
+
+namespace {
+
+/// The layout of a ProtocolConformanceRecord, which can't be built directly
+/// because its fields are relative pointers.
+struct RawConformanceRecord {
+  int32_t Protocol;
+  int32_t Type;
+  int32_t WitnessTable;
+  uint32_t Flags;
+};
+static_assert(sizeof(RawConformanceRecord) == sizeof(ProtocolConformanceRecord),
+              "record layout changed");
+
+int32_t relativeOffset(const void *target, const void *field) {
+  return int32_t(reinterpret_cast<intptr_t>(target) -
+                 reinterpret_cast<intptr_t>(field));
+}
+
+/// A stand-in protocol descriptor; the runtime only uses its address as a
+/// lookup key here.
+alignas(ProtocolDescriptor) char FakeProtocol[sizeof(ProtocolDescriptor)];
+
+const void *FakeWitnessTable[1];
+
+/// The conforming type's metadata is referenced indirectly, since it lives
+/// in the runtime and may be too far away for a relative offset.
+const Metadata *ConformingType = &_TMBi32_.base;
+
+RawConformanceRecord ConformanceRecord;
+
+const ProtocolDescriptor *getFakeProtocol() {
+  return reinterpret_cast<const ProtocolDescriptor *>(FakeProtocol);
+}
+
+const ProtocolConformanceRecord *makeConformanceRecord() {
+  auto &R = ConformanceRecord;
+  R.Protocol = relativeOffset(FakeProtocol, &R.Protocol);
+  R.Type = relativeOffset(&ConformingType, &R.Type) | 1;
+  R.WitnessTable = relativeOffset(FakeWitnessTable, &R.WitnessTable);
+  R.Flags = ProtocolConformanceFlags()
+    .withTypeKind(TypeMetadataRecordKind::UniqueDirectType)
+    .withConformanceKind(ProtocolConformanceReferenceKind::WitnessTable)
+    .getValue();
+  return reinterpret_cast<const ProtocolConformanceRecord *>(&R);
+}
+
+} // end anonymous namespace
+
+TEST(ProtocolConformanceTest, RegisteringSectionInvalidatesCachedFailure) {
+  // Cache a failure for a type that doesn't conform yet.
+  EXPECT_EQ(nullptr, swift_conformsToProtocol(ConformingType,
+                                              getFakeProtocol()));
+  EXPECT_EQ(nullptr, swift_conformsToProtocol(ConformingType,
+                                              getFakeProtocol()));
+
+  // Registering a section, as loading an image does, must make the lookup
+  // look again instead of returning the cached failure.
+  auto record = makeConformanceRecord();
+  swift_registerProtocolConformances(record, record + 1);
+
+  EXPECT_EQ(reinterpret_cast<const WitnessTable *>(FakeWitnessTable),
+            swift_conformsToProtocol(ConformingType, getFakeProtocol()));
+
+  // The successful result is cached from now on.
+  ConformanceCacheStatistics before, after;
+  swift_getConformanceCacheStatistics(&before);
+  EXPECT_EQ(reinterpret_cast<const WitnessTable *>(FakeWitnessTable),
+            swift_conformsToProtocol(ConformingType, getFakeProtocol()));
+  swift_getConformanceCacheStatistics(&after);
+  EXPECT_EQ(before.CacheMisses, after.CacheMisses);
+}